@@ -186,6 +186,9 @@ VirtualAC3DecoderUnit::VirtualAC3DecoderUnit(PhysicalAC3DecoderUnit * physicalAC
 																"AC3Decoder")	// Thread ID name,
 	{
 	this->physicalAC3Decoder = physicalAC3Decoder;
+
+	// Decoding never blocks, so the unit can share the executor workers
+	UseStreamingUnitExecutor(this);
 	}
 
 
@@ -0,0 +1,745 @@
+///
+/// @brief      Software Frame Mixer for 16 bit PCM audio
+///
+
+#include "PCMFrameMixer.h"
+#include "PCMSampleMixer.h"
+#include "VDR/Source/Construction/IUnitConstruction.h"
+#include "VDR/Source/Unit/ITagUnit.h"
+#include "STF/Interface/STFDebug.h"
+
+#include <math.h>
+#include <string.h>
+
+/// Normal playback speed of a mixer input
+#define PCMFRAMEMIXER_NORMAL_SPEED	0x00010000
+
+static const uint64 PCMFrameMixerTicksPerSecond = 108000000;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// PCM Frame Mixer Input Node
+///////////////////////////////////////////////////////////////////////////////
+
+PCMFrameMixerInputNode::PCMFrameMixerInputNode(void)
+	{
+	queueHead				= 0;
+	queueTail				= 0;
+	queuedBytes				= 0;
+	rangeIndex				= 0;
+	rangeOffset				= 0;
+	tailParsed				= false;
+	forcedRendering		= false;
+	inputTimeValid			= false;
+	inputSamples			= 0;
+	starving					= false;
+	attenuation				= 0;
+	pendingAttenuation	= 0;
+	inputState				= MIS_ON;
+	pendingInputState		= MIS_ON;
+	gain						= PCM_MIXER_UNITY_GAIN;
+	}
+
+
+///
+/// Apply the PCM format tags of a packet
+///
+static void ParsePCMFrameMixerTags(StreamingDataPacket * packet, PCMFrameMixerFormat & format, bool * forcedRendering)
+	{
+	TAG	*	tags;
+	uint32	i;
+
+	if (!(packet->vdrPacket.flags & VDR_MSMF_TAGS_VALID))
+		return;
+
+	tags = (TAG *)packet->vdrPacket.tagRanges.tags;
+
+	for (i = 0; i < packet->vdrPacket.numTags && tags[i].id; i++)
+		{
+		switch (tags[i].id)
+			{
+			case CSET_AUDIO_STREAM_SAMPLE_RATE:
+				format.sampleRate = VAL_AUDIO_STREAM_SAMPLE_RATE(&tags[i]);
+				break;
+
+			case CSET_AUDIO_STREAM_NUMBER_OF_CHANNELS:
+				format.channels = VAL_AUDIO_STREAM_NUMBER_OF_CHANNELS(&tags[i]);
+				break;
+
+			case CSET_AUDIO_STREAM_BITS_PER_SAMPLE:
+				format.bitsPerSample = VAL_AUDIO_STREAM_BITS_PER_SAMPLE(&tags[i]);
+				break;
+
+			case CSET_STREAM_FORCED_RENDERING:
+				if (forcedRendering)
+					*forcedRendering = VAL_STREAM_FORCED_RENDERING(&tags[i]);
+				break;
+			}
+		}
+	}
+
+
+///
+/// Convert an attenuation in dB into a Q15 gain
+///
+static uint32 PCMFrameMixerAttenuationToGain(uint32 attenuation)
+	{
+	if (attenuation == 0)
+		return PCM_MIXER_UNITY_GAIN;
+	else if (attenuation >= PCMFRAMEMIXER_MUTE_ATTENUATION)
+		return 0;
+	else
+		return (uint32)(PCM_MIXER_UNITY_GAIN * pow(10.0, -(double)attenuation / 20.0) + 0.5);
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Physical PCM Frame Mixer
+///////////////////////////////////////////////////////////////////////////////
+
+UNIT_CREATION_FUNCTION(CreatePCMFrameMixer, PCMFrameMixerUnit)
+
+
+STFResult PCMFrameMixerUnit::CreateVirtual(IVirtualUnit * & unit, IVirtualUnit * parent, IVirtualUnit * root)
+	{
+	unit = (IVirtualUnit*)(new VirtualPCMFrameMixerUnit(this));
+
+	if (unit)
+		{
+		STFRES_REASSERT(unit->Connect(parent, root));
+		}
+	else
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+
+	STFRES_RAISE_OK;
+	}
+
+
+// Creation parameters:
+// 0: output sample rate in Hz
+// 1: samples per mixer frame at the output sample rate
+// 2: number of output channels
+// 3: number of mixer inputs (optional, default 2 for main and auxiliary input)
+STFResult PCMFrameMixerUnit::Create(uint64 * createParams)
+	{
+	STFRES_REASSERT(GetDWordParameter(createParams, 0, outputFormat.sampleRate));
+	STFRES_REASSERT(GetDWordParameter(createParams, 1, samplesPerFrame));
+	STFRES_REASSERT(GetDWordParameter(createParams, 2, outputFormat.channels));
+
+	outputFormat.bitsPerSample = 16;
+
+	maxInputs = 2;
+	if (GetNumberOfParameters(createParams) >= 4)
+		STFRES_REASSERT(GetDWordParameter(createParams, 3, maxInputs));
+
+	if (outputFormat.sampleRate == 0 || samplesPerFrame == 0 || outputFormat.channels == 0 || maxInputs == 0)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult PCMFrameMixerUnit::Connect(uint64 localID, IPhysicalUnit * source)
+	{
+	// The PCM frame mixer does not use other units
+	STFRES_RAISE(STFRES_RANGE_VIOLATION);
+	}
+
+
+STFResult PCMFrameMixerUnit::Initialize(uint64 * depUnitsParams)
+	{
+	STFRES_RAISE_OK;
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Virtual PCM Frame Mixer
+///////////////////////////////////////////////////////////////////////////////
+
+VirtualPCMFrameMixerUnit::VirtualPCMFrameMixerUnit(PCMFrameMixerUnit * physicalMixer) : VirtualUnit(physicalMixer)
+	{
+	uint32	i;
+
+	this->physicalMixer = physicalMixer;
+
+	inputNodes	= new PCMFrameMixerInputNode[physicalMixer->maxInputs];
+	numInputs	= 0;
+
+	// Until the first format tags arrive, the inputs are expected in the output format
+	if (inputNodes)
+		{
+		for (i = 0; i < physicalMixer->maxInputs; i++)
+			{
+			inputNodes[i].inputFormat	= physicalMixer->outputFormat;
+			inputNodes[i].mixFormat		= physicalMixer->outputFormat;
+			}
+		}
+
+	for (i = 0; i < PCMFRAMEMIXER_MAX_OUTPUTS; i++)
+		{
+		outputAllocators[i]	= NULL;
+		outputTagsPending[i]	= true;
+		}
+	numOutputs = 0;
+
+	// The frame duration is rounded to 108 MHz ticks, the number of samples per frame then
+	// varies such that the output follows the frame timing exactly
+	frameTicks = (uint32)(((uint64)physicalMixer->samplesPerFrame * PCMFrameMixerTicksPerSecond + physicalMixer->outputFormat.sampleRate / 2) /
+								 physicalMixer->outputFormat.sampleRate);
+	frameDuration = STFHiPrec64BitDuration(STFInt64(frameTicks), STFTU_108MHZTICKS);
+	sampleTicks = 0;
+
+	mixFrameNumber = 0;
+	}
+
+
+VirtualPCMFrameMixerUnit::~VirtualPCMFrameMixerUnit(void)
+	{
+	uint32	i;
+
+	if (inputNodes)
+		{
+		for (i = 0; i < numInputs; i++)
+			{
+			while (inputNodes[i].queueTail != inputNodes[i].queueHead)
+				ReleaseTailPacket(&inputNodes[i]);
+			}
+
+		delete[] inputNodes;
+		}
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::QueryInterface(VDRIID iid, void *& ifp)
+	{
+	VDRQI_BEGIN
+		VDRQI_IMPLEMENT(VDRIID_FRAME_MIXER, IFrameMixer);
+	VDRQI_END(VirtualUnit);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::GetPCMInputNode(uint32 inputID, PCMFrameMixerInputNode * & node)
+	{
+	if (!inputNodes)
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+
+	if (inputID >= physicalMixer->maxInputs)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	if (inputID >= numInputs)
+		numInputs = inputID + 1;
+
+	node = &inputNodes[inputID];
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFHiPrec64BitDuration VirtualPCMFrameMixerUnit::GetSamplesDuration(uint32 samples, uint32 sampleRate)
+	{
+	uint64	ticks;
+
+	if (sampleRate == 0)
+		return STFHiPrec64BitDuration();
+
+	ticks = (uint64)samples * PCMFrameMixerTicksPerSecond / sampleRate;
+
+	return STFHiPrec64BitDuration(STFInt64((uint32)ticks, (uint32)(ticks >> 32)), STFTU_108MHZTICKS);
+	}
+
+
+bool VirtualPCMFrameMixerUnit::IsFormatMixable(const PCMFrameMixerFormat & format)
+	{
+	return format.sampleRate == physicalMixer->outputFormat.sampleRate &&
+			 format.channels == physicalMixer->outputFormat.channels &&
+			 format.bitsPerSample == 16;
+	}
+
+
+bool VirtualPCMFrameMixerUnit::IsInputAudible(PCMFrameMixerInputNode * node)
+	{
+	// Audio is muted during trick play
+	if (node->speed != PCMFRAMEMIXER_NORMAL_SPEED || node->gain == 0)
+		return false;
+
+	switch (node->inputState)
+		{
+		case MIS_OFF:
+			return false;
+
+		case MIS_FORCEDONLY:
+			return node->forcedRendering;
+
+		default:
+			return true;
+		}
+	}
+
+
+void VirtualPCMFrameMixerUnit::ReleaseTailPacket(PCMFrameMixerInputNode * node)
+	{
+	StreamingDataPacket	*	packet = node->queue[node->queueTail % PCMFRAMEMIXER_INPUT_QUEUE_SIZE];
+
+	packet->ReleaseRanges();
+	packet->ReturnToOrigin();
+
+	node->queueTail++;
+	node->rangeIndex	= 0;
+	node->rangeOffset	= 0;
+	node->tailParsed	= false;
+
+	// A queue entry is free again, so an input that was refused may send again
+	if (node->packetBounced)
+		{
+		node->packetBounced = false;
+		node->packetRequest = true;
+		}
+	}
+
+
+void VirtualPCMFrameMixerUnit::ConsumeInput(PCMFrameMixerInputNode * node, int16 * dst, uint32 numSamples, uint32 & consumedSamples, uint32 & mixedSamples)
+	{
+	StreamingDataPacket	*	packet;
+	VDRDataRange			*	range;
+	const int16				*	src;
+	uint32						frameSize, channels, available, num, mix;
+
+	consumedSamples = 0;
+
+	while (consumedSamples < numSamples && node->queueTail != node->queueHead)
+		{
+		packet = node->queue[node->queueTail % PCMFRAMEMIXER_INPUT_QUEUE_SIZE];
+
+		// Format changes take effect when the read position reaches their packet
+		if (!node->tailParsed)
+			{
+			ParsePCMFrameMixerTags(packet, node->mixFormat, &node->forcedRendering);
+			node->tailParsed = true;
+			}
+
+		if (node->rangeIndex >= packet->vdrPacket.numRanges)
+			{
+			ReleaseTailPacket(node);
+			continue;
+			}
+
+		range = &packet->vdrPacket.tagRanges.ranges[packet->vdrPacket.numTags + node->rangeIndex];
+		frameSize = node->mixFormat.GetSampleFrameSize();
+		available = frameSize ? (range->size - node->rangeOffset) / frameSize : 0;
+
+		if (available == 0)
+			{
+			// Skip the rest of the range, which is less than a sample
+			node->queuedBytes -= range->size - node->rangeOffset;
+			node->rangeIndex++;
+			node->rangeOffset = 0;
+			continue;
+			}
+
+		num = numSamples - consumedSamples;
+		if (num > available)
+			num = available;
+
+		if (dst && IsFormatMixable(node->mixFormat))
+			{
+			src = (const int16 *)(range->GetStart() + node->rangeOffset);
+			channels = node->mixFormat.channels;
+
+			// Silence the part of the frame skipped because of an unmixable format
+			if (consumedSamples > mixedSamples)
+				{
+				memset(dst + mixedSamples * channels, 0, (consumedSamples - mixedSamples) * frameSize);
+				mixedSamples = consumedSamples;
+				}
+
+			// The part of the frame already filled by other inputs is mixed, the rest is written
+			mix = mixedSamples - consumedSamples;
+			if (mix > num)
+				mix = num;
+			if (mix)
+				MixPCMSamples(dst + consumedSamples * channels, src, mix * channels, node->gain);
+			if (num > mix)
+				ScalePCMSamples(dst + (consumedSamples + mix) * channels, src + mix * channels, (num - mix) * channels, node->gain);
+
+			if (consumedSamples + num > mixedSamples)
+				mixedSamples = consumedSamples + num;
+			}
+
+		node->rangeOffset += num * frameSize;
+		node->queuedBytes -= num * frameSize;
+		consumedSamples += num;
+		}
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::GetInputNode(uint32 inputID, StreamMixerInputNode * & node)
+	{
+	PCMFrameMixerInputNode	*	pcmNode;
+
+	STFRES_REASSERT(GetPCMInputNode(inputID, pcmNode));
+
+	node = pcmNode;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::SendInputPacket(uint32 inputID, StreamingDataPacket * packet, StreamMixerStartupRequest & req)
+	{
+	PCMFrameMixerInputNode	*	node;
+	uint32						size, frameSize;
+
+	req = MIXSUPREQ_NONE;
+
+	STFRES_REASSERT(GetPCMInputNode(inputID, node));
+
+	node->queueMutex.Enter();
+
+	if (node->GetQueuedPackets() == PCMFRAMEMIXER_INPUT_QUEUE_SIZE)
+		{
+		node->packetBounced = true;
+		node->queueMutex.Leave();
+
+		STFRES_RAISE(STFRES_OBJECT_FULL);
+		}
+
+	ParsePCMFrameMixerTags(packet, node->inputFormat, NULL);
+
+	//
+	// Track the stream time at the input, for GetCurrentInputStreamTime()
+	//
+	if (packet->vdrPacket.flags & VDR_MSMF_START_TIME_VALID)
+		{
+		node->inputTime		= packet->vdrPacket.startTime;
+		node->inputTimeValid	= true;
+		node->inputSamples	= 0;
+		}
+
+	size = packet->GetPacketDataSize();
+	frameSize = node->inputFormat.GetSampleFrameSize();
+	if (frameSize)
+		node->inputSamples += size / frameSize;
+
+	if (packet->vdrPacket.flags & VDR_MSMF_END_TIME_VALID)
+		{
+		node->inputTime		= packet->vdrPacket.endTime;
+		node->inputTimeValid	= true;
+		node->inputSamples	= 0;
+		}
+
+	node->queue[node->queueHead % PCMFRAMEMIXER_INPUT_QUEUE_SIZE] = packet;
+	node->queueHead++;
+	node->queuedBytes += size;
+	node->receivedStreamFrames++;
+
+	//
+	// During startup, request the start of the input once a few frames are queued,
+	// and require it once the queue is full
+	//
+	if (node->startupState == MIXSS_NOT_ENOUGH_DATA && frameSize &&
+		 node->queuedBytes >= PCMFRAMEMIXER_START_FRAMES * physicalMixer->samplesPerFrame * frameSize)
+		{
+		node->startupState = MIXSS_SUFFICIENT_DATA;
+		req = MIXSUPREQ_START_POSSIBLE;
+		}
+
+	if ((node->startupState == MIXSS_NOT_ENOUGH_DATA || node->startupState == MIXSS_SUFFICIENT_DATA) &&
+		 node->GetQueuedPackets() == PCMFRAMEMIXER_INPUT_QUEUE_SIZE)
+		{
+		node->startupState = MIXSS_FULL;
+		req = MIXSUPREQ_START_REQUIRED;
+		}
+
+	node->queueMutex.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::GetFrameDuration(STFHiPrec64BitDuration & mixerFrameDuration)
+	{
+	mixerFrameDuration = frameDuration;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::MixFrame(StreamingDataPacket ** packets)
+	{
+	const PCMFrameMixerFormat	&	outputFormat = physicalMixer->outputFormat;
+	IVDRMemoryPoolAllocator		*	allocator = NULL;
+	VDRMemoryBlock					*	block;
+	StreamingDataPacket			*	packet;
+	PCMFrameMixerInputNode		*	node;
+	TAG								*	tags;
+	int16								*	frame;
+	uint64								ticks;
+	uint32								i, done, numSamples, frameSize, consumedSamples, mixedSamples;
+
+	//
+	// The mixed frame is placed in a block of the first output's pool. The Stream Mixer numbers
+	// the groups of the output packets by mixer frame, which keeps our frame number in step.
+	//
+	for (i = 0; i < numOutputs; i++)
+		{
+		if (packets[i] && outputAllocators[i])
+			{
+			allocator = outputAllocators[i];
+			mixFrameNumber += (int16)(packets[i]->vdrPacket.groupNumber - (uint16)mixFrameNumber);
+			break;
+			}
+		}
+
+	if (!allocator)
+		STFRES_RAISE(STFRES_OBJECT_NOT_ALLOCATED);
+
+	ticks = sampleTicks + (uint64)frameTicks * outputFormat.sampleRate;
+	numSamples = (uint32)(ticks / PCMFrameMixerTicksPerSecond);
+	frameSize = outputFormat.GetSampleFrameSize();
+
+	STFRES_REASSERT(allocator->GetMemoryBlocks(&block, 0, 1, done));
+	if (done == 0)
+		STFRES_RAISE(STFRES_OBJECT_EMPTY);
+
+	if (block->GetSize() < numSamples * frameSize)
+		{
+		DP("PCMFrameMixer: memory block too small for a frame of %d samples\n", numSamples);
+		block->Release();
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+		}
+
+	frame = (int16 *)block->GetStart();
+	mixedSamples = 0;
+
+	//
+	// Mix all inputs that are started for this frame. The first input writes its
+	// samples into the frame, all further inputs are added with saturation.
+	//
+	for (i = 0; i < numInputs; i++)
+		{
+		node = &inputNodes[i];
+
+		if (node->frameNumber == INFINITE_FRAME_NUMBER || (int32)(mixFrameNumber - node->frameNumber) < 0)
+			continue;
+
+		node->queueMutex.Enter();
+		ConsumeInput(node, IsInputAudible(node) ? frame : NULL, numSamples, consumedSamples, mixedSamples);
+		node->queueMutex.Leave();
+
+		if (consumedSamples < numSamples)
+			{
+			if (!node->starving)
+				{
+				node->starving			= true;
+				node->starvation		= true;
+				node->packetRequest	= true;
+				}
+			}
+		else
+			node->starving = false;
+
+		node->frameNumber = mixFrameNumber + 1;
+		}
+
+	if (mixedSamples < numSamples)
+		memset(frame + mixedSamples * outputFormat.channels, 0, (numSamples - mixedSamples) * frameSize);
+
+	//
+	// All outputs get the same frame, each packet holds its own reference to the block
+	//
+	for (i = 0; i < numOutputs; i++)
+		{
+		packet = packets[i];
+		if (!packet)
+			continue;
+
+		if (outputTagsPending[i])
+			{
+			tags = (TAG *)packet->vdrPacket.tagRanges.tags;
+			tags[0] = SET_AUDIO_STREAM_SAMPLE_RATE(outputFormat.sampleRate);
+			tags[1] = SET_AUDIO_STREAM_NUMBER_OF_CHANNELS((uint16)outputFormat.channels);
+			tags[2] = SET_AUDIO_STREAM_BITS_PER_SAMPLE((uint16)outputFormat.bitsPerSample);
+			tags[3] = TAGDONE;
+
+			packet->vdrPacket.numTags = 4;
+			packet->vdrPacket.flags |= VDR_MSMF_TAGS_VALID;
+			outputTagsPending[i] = false;
+			}
+
+		packet->vdrPacket.tagRanges.ranges[packet->vdrPacket.numTags].Init(block, 0, numSamples * frameSize);
+		packet->vdrPacket.numRanges = 1;
+		packet->AddRefToRanges();
+		}
+
+	block->Release();
+
+	sampleTicks = ticks - (uint64)numSamples * PCMFrameMixerTicksPerSecond;
+	mixFrameNumber++;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::ReceiveAllocator(uint32 outputID, IVDRMemoryPoolAllocator * allocator)
+	{
+	if (outputID >= PCMFRAMEMIXER_MAX_OUTPUTS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	if (outputID >= numOutputs)
+		numOutputs = outputID + 1;
+
+	outputAllocators[outputID] = allocator;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::PrepareStream(uint32 inputID)
+	{
+	PCMFrameMixerInputNode	*	node;
+
+	// The inputs keep the packets of their own pools, so there is no allocator to provide
+	STFRES_RAISE(GetPCMInputNode(inputID, node));
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::StepStream(uint32 inputID, uint32 numFrames)
+	{
+	PCMFrameMixerInputNode	*	node;
+	uint32						consumedSamples, mixedSamples = 0;
+
+	STFRES_REASSERT(GetPCMInputNode(inputID, node));
+
+	// Audio is not played while stepping, the frames stepped over are dropped
+	node->queueMutex.Enter();
+	ConsumeInput(node, NULL, numFrames * physicalMixer->samplesPerFrame, consumedSamples, mixedSamples);
+	node->queueMutex.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::FlushStream(uint32 inputID, int32 mode)
+	{
+	PCMFrameMixerInputNode	*	node;
+
+	STFRES_REASSERT(GetPCMInputNode(inputID, node));
+
+	node->queueMutex.Enter();
+
+	while (node->queueTail != node->queueHead)
+		ReleaseTailPacket(node);
+
+	node->queuedBytes				= 0;
+	node->inputTimeValid			= false;
+	node->inputSamples			= 0;
+	node->starving					= false;
+	node->receivedStreamFrames	= 0;
+
+	// Back to the initial state, the first consumed packet requests more data
+	node->packetBounced			= true;
+	node->packetRequest			= false;
+
+	node->queueMutex.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::GetStreamTagIDs(uint32 inputID, VDRTID * & ids)
+	{
+	static const VDRTID supportedTagTypes[] =
+		{
+		VDRTID_AUDIO_GENERAL_MODE_PROPERTY,
+		VDRTID_MIXER_INPUT_CONTROL,
+		VDRTID_DONE
+		};
+
+	ids = (VDRTID *)supportedTagTypes;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::ConfigureStreamTags(uint32 inputID, TAG * tags)
+	{
+	PCMFrameMixerInputNode	*	node;
+	uint32						changeSet = 0;
+
+	STFRES_REASSERT(GetPCMInputNode(inputID, node));
+
+	PARSE_TAGS_START(tags, changeSet)
+		GETSETC(AUDIO_MASTER_VOLUME,	node->pendingAttenuation, 0);
+		GETSETC(MIXER_INPUT_STATE,		node->pendingInputState, 0);
+	PARSE_TAGS_END
+
+	STFRES_RAISE_OK;
+	}
+
+
+// Called on the mixing thread, so the settings change between two frames
+STFResult VirtualPCMFrameMixerUnit::InternalUpdateStreamTags(uint32 inputID)
+	{
+	PCMFrameMixerInputNode	*	node;
+
+	STFRES_REASSERT(GetPCMInputNode(inputID, node));
+
+	node->attenuation	= node->pendingAttenuation;
+	node->inputState	= node->pendingInputState;
+	node->gain			= PCMFrameMixerAttenuationToGain(node->attenuation);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::SetRendererInformation(const STFHiPrec64BitTime & renderTime, uint32 renderFrame)
+	{
+	// The frames are sized by the output sample rate, so the render timing is not needed
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::GetCurrentInputStreamTime(uint32 inputID, STFHiPrec64BitTime & inputTime)
+	{
+	PCMFrameMixerInputNode	*	node;
+
+	STFRES_REASSERT(GetPCMInputNode(inputID, node));
+
+	node->queueMutex.Enter();
+
+	if (node->inputTimeValid)
+		inputTime = node->inputTime + GetSamplesDuration(node->inputSamples, node->inputFormat.sampleRate);
+	else
+		inputTime = STFHiPrec64BitTime(0);
+
+	node->queueMutex.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::BeginOutput(uint32 outputID)
+	{
+	if (outputID >= PCMFRAMEMIXER_MAX_OUTPUTS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	if (outputID >= numOutputs)
+		numOutputs = outputID + 1;
+
+	// The first frame of the output tells the renderer the PCM format
+	outputTagsPending[outputID] = true;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualPCMFrameMixerUnit::FlushOutput(uint32 outputID)
+	{
+	if (outputID >= PCMFRAMEMIXER_MAX_OUTPUTS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	// Frames are handed to the outputs as soon as they are mixed, nothing is pending here
+	STFRES_RAISE_OK;
+	}
@@ -0,0 +1,184 @@
+#ifndef PCMFRAMEMIXER_H
+#define PCMFRAMEMIXER_H
+
+///
+/// @brief      Software Frame Mixer for 16 bit PCM audio
+///
+/// Mixes the PCM streams of all mixer inputs into one frame per mixer output, to be used as
+/// the frame mixer of the generic Stream Mixer (e.g. for the main and the auxiliary audio input
+/// of VDRUID_AUDIO_PCM_STREAM_MIXER). The input data is mixed straight from the data ranges of
+/// the received packets into a memory block of the output's pool.
+///
+/// Inputs are expected in the sample rate and channel count of the output, with 16 bit samples.
+/// Inputs in a different format are consumed at the mixer rate, but muted.
+///
+
+#include "Device/Interface/Unit/Datapath/IStreamMixer.h"
+#include "VDR/Source/Unit/PhysicalUnit.h"
+#include "VDR/Source/Unit/VirtualUnit.h"
+#include "VDR/Interface/Unit/Audio/IVDRAudioTypes.h"
+#include "VDR/Interface/Unit/Audio/IVDRAudioStreamTypes.h"
+#include "VDR/Interface/Unit/Datapath/VDRStreamMixerTags.h"
+#include "STF/Interface/STFMutex.h"
+
+/// Number of packets each input can queue
+#define PCMFRAMEMIXER_INPUT_QUEUE_SIZE		32
+/// Maximum number of mixer outputs
+#define PCMFRAMEMIXER_MAX_OUTPUTS			4
+/// Number of queued mixer frames that allow an input to start
+#define PCMFRAMEMIXER_START_FRAMES			4
+/// Attenuation (in dB) from which on an input is muted
+#define PCMFRAMEMIXER_MUTE_ATTENUATION		96
+
+
+///////////////////////////////////////////////////////////////////////////////
+// PCM Frame Mixer Input Node
+///////////////////////////////////////////////////////////////////////////////
+
+/// Format of a PCM stream
+struct PCMFrameMixerFormat
+	{
+	uint32	sampleRate;
+	uint32	channels;
+	uint32	bitsPerSample;
+
+	/// Size of one sample of all channels in bytes
+	uint32 GetSampleFrameSize(void) const
+		{
+		return channels * bitsPerSample / 8;
+		}
+	};
+
+
+/// Input node extended by the packet queue and the mixing parameters of a PCM input
+struct PCMFrameMixerInputNode : public StreamMixerInputNode
+	{
+	STFMutex						queueMutex;			/// Protects the queue against concurrent sending, mixing and flushing
+
+	StreamingDataPacket	*	queue[PCMFRAMEMIXER_INPUT_QUEUE_SIZE];
+	uint32						queueHead;			/// Number of packets queued so far
+	uint32						queueTail;			/// Number of packets consumed so far
+	uint32						queuedBytes;		/// PCM data in the queue not yet consumed
+
+	uint32						rangeIndex;			/// Read position in the packet at the queue tail
+	uint32						rangeOffset;
+	bool							tailParsed;			/// The tags of the packet at the queue tail have been applied
+
+	PCMFrameMixerFormat		inputFormat;		/// Format of the data last received
+	PCMFrameMixerFormat		mixFormat;			/// Format of the data at the read position
+	bool							forcedRendering;	/// The stream at the read position is marked for forced rendering
+
+	bool							inputTimeValid;
+	STFHiPrec64BitTime		inputTime;			/// Last time stamp received
+	uint32						inputSamples;		/// Samples received after the last time stamp
+
+	bool							starving;			/// The last mixed frame ran out of data
+
+	// Mixer input control configuration, set in ConfigureStreamTags() and applied by InternalUpdateStreamTags()
+	uint32						attenuation, pendingAttenuation;
+	MixerInputState			inputState, pendingInputState;
+	uint32						gain;					/// Q15 gain derived from the attenuation
+
+	PCMFrameMixerInputNode(void);
+
+	uint32 GetQueuedPackets(void) {return queueHead - queueTail;}
+	};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Physical PCM Frame Mixer
+///////////////////////////////////////////////////////////////////////////////
+
+class PCMFrameMixerUnit : public ExclusivePhysicalUnit
+	{
+	friend class VirtualPCMFrameMixerUnit;
+
+	protected:
+		PCMFrameMixerFormat	outputFormat;
+		uint32					samplesPerFrame;	/// Nominal number of samples per mixer frame
+		uint32					maxInputs;
+
+	public:
+		PCMFrameMixerUnit(VDRUID unitID) : ExclusivePhysicalUnit(unitID) {}
+
+		//
+		// IPhysicalUnit interface implementation
+		//
+		virtual STFResult CreateVirtual(IVirtualUnit * & unit, IVirtualUnit * parent = NULL, IVirtualUnit * root = NULL);
+		virtual STFResult Create(uint64 * createParams);
+		virtual STFResult Connect(uint64 localID, IPhysicalUnit * source);
+		virtual STFResult Initialize(uint64 * depUnitsParams);
+	};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Virtual PCM Frame Mixer
+///////////////////////////////////////////////////////////////////////////////
+
+class VirtualPCMFrameMixerUnit : public VirtualUnit,
+											public virtual IFrameMixer
+	{
+	protected:
+		PCMFrameMixerUnit				*	physicalMixer;
+
+		PCMFrameMixerInputNode		*	inputNodes;
+		uint32								numInputs;			/// Highest input ID requested plus one
+
+		IVDRMemoryPoolAllocator		*	outputAllocators[PCMFRAMEMIXER_MAX_OUTPUTS];
+		bool									outputTagsPending[PCMFRAMEMIXER_MAX_OUTPUTS];
+		uint32								numOutputs;			/// Highest output ID used plus one
+
+		STFHiPrec64BitDuration			frameDuration;
+		uint32								frameTicks;			/// Frame duration in 108 MHz ticks
+		uint64								sampleTicks;		/// Fractional samples carried to the next frame, in samples * 108 MHz ticks
+		uint32								mixFrameNumber;	/// Number of the frame mixed next, runs in step with the Stream Mixer
+
+		/// Get the node of an input, and register it as used
+		STFResult GetPCMInputNode(uint32 inputID, PCMFrameMixerInputNode * & node);
+
+		/// Duration of a number of samples at a sample rate
+		STFHiPrec64BitDuration GetSamplesDuration(uint32 samples, uint32 sampleRate);
+
+		/// Take samples from the queue of an input, and mix them into the frame in dst if it is not NULL.
+		/// mixedSamples is the number of samples in dst that already contain data.
+		void ConsumeInput(PCMFrameMixerInputNode * node, int16 * dst, uint32 numSamples, uint32 & consumedSamples, uint32 & mixedSamples);
+
+		/// Release the packet at the queue tail
+		void ReleaseTailPacket(PCMFrameMixerInputNode * node);
+
+		/// Check if data in a format can be mixed into the output
+		bool IsFormatMixable(const PCMFrameMixerFormat & format);
+
+		/// Check if an input is mixed in, or only consumed
+		bool IsInputAudible(PCMFrameMixerInputNode * node);
+
+	public:
+		VirtualPCMFrameMixerUnit(PCMFrameMixerUnit * physicalMixer);
+		virtual ~VirtualPCMFrameMixerUnit(void);
+
+		//
+		// IVDRBase functions
+		//
+		virtual STFResult QueryInterface(VDRIID iid, void *& ifp);
+
+		//
+		// IFrameMixer interface implementation
+		//
+		virtual STFResult GetInputNode(uint32 inputID, StreamMixerInputNode * & node);
+		virtual STFResult SendInputPacket(uint32 inputID, StreamingDataPacket * packet, StreamMixerStartupRequest & req);
+		virtual STFResult GetFrameDuration(STFHiPrec64BitDuration & mixerFrameDuration);
+		virtual STFResult MixFrame(StreamingDataPacket ** packets);
+		virtual STFResult ReceiveAllocator(uint32 outputID, IVDRMemoryPoolAllocator * allocator);
+		virtual STFResult PrepareStream(uint32 inputID);
+		virtual STFResult StepStream(uint32 inputID, uint32 numFrames);
+		virtual STFResult FlushStream(uint32 inputID, int32 mode);
+		virtual STFResult GetStreamTagIDs (uint32 inputID, VDRTID * & ids);
+		virtual STFResult ConfigureStreamTags(uint32 inputID, TAG * tags);
+		virtual STFResult InternalUpdateStreamTags(uint32 inputID);
+		virtual STFResult SetRendererInformation(const STFHiPrec64BitTime & renderTime, uint32 renderFrame);
+		virtual STFResult GetCurrentInputStreamTime(uint32 inputID, STFHiPrec64BitTime & inputTime);
+		virtual STFResult BeginOutput(uint32 outputID);
+		virtual STFResult FlushOutput(uint32 outputID);
+	};
+
+#endif // PCMFRAMEMIXER_H
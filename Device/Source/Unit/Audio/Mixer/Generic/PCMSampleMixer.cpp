@@ -0,0 +1,207 @@
+///
+/// @brief      Scaling and saturated mixing of 16 bit PCM samples
+///
+
+#include "PCMSampleMixer.h"
+
+#include <string.h>
+
+#if PCM_SAMPLE_MIXER_SIMD
+#include <immintrin.h>
+#endif
+
+typedef void (* PCMSampleMixerFunction)(int16 * dst, const int16 * src, uint32 num, uint32 gain);
+
+
+static inline int32 ScalePCMSample(int16 sample, uint32 gain)
+	{
+	return ((int32)sample * (int32)gain + 0x4000) >> 15;
+	}
+
+
+static void ScalePCMSamplesScalar(int16 * dst, const int16 * src, uint32 num, uint32 gain)
+	{
+	uint32	i;
+
+	if (gain >= PCM_MIXER_UNITY_GAIN)
+		{
+		memcpy(dst, src, num * sizeof(int16));
+		return;
+		}
+
+	for (i = 0; i < num; i++)
+		dst[i] = (int16)ScalePCMSample(src[i], gain);
+	}
+
+
+static void MixPCMSamplesScalar(int16 * dst, const int16 * src, uint32 num, uint32 gain)
+	{
+	uint32	i;
+	int32		sum;
+
+	for (i = 0; i < num; i++)
+		{
+		if (gain >= PCM_MIXER_UNITY_GAIN)
+			sum = (int32)dst[i] + src[i];
+		else
+			sum = (int32)dst[i] + ScalePCMSample(src[i], gain);
+
+		if (sum > 32767)
+			sum = 32767;
+		else if (sum < -32768)
+			sum = -32768;
+
+		dst[i] = (int16)sum;
+		}
+	}
+
+
+#if PCM_SAMPLE_MIXER_SIMD
+
+//
+// The 32 bit products are built from the low and high halves of the 16 bit multiplications.
+// Unpacking and packing both work within 128 bit lanes, so the sample order is preserved.
+//
+
+__attribute__((target("sse2")))
+static inline __m128i ScalePCMVectorSSE2(__m128i samples, __m128i gain, __m128i round)
+	{
+	__m128i	lo = _mm_mullo_epi16(samples, gain);
+	__m128i	hi = _mm_mulhi_epi16(samples, gain);
+
+	return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 15),
+	                       _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 15));
+	}
+
+
+__attribute__((target("sse2")))
+static void ScalePCMSamplesSSE2(int16 * dst, const int16 * src, uint32 num, uint32 gain)
+	{
+	const __m128i	g = _mm_set1_epi16((short)gain);
+	const __m128i	round = _mm_set1_epi32(0x4000);
+	uint32			i = 0;
+
+	if (gain >= PCM_MIXER_UNITY_GAIN)
+		{
+		memcpy(dst, src, num * sizeof(int16));
+		return;
+		}
+
+	for (; i + 8 <= num; i += 8)
+		_mm_storeu_si128((__m128i *)(dst + i), ScalePCMVectorSSE2(_mm_loadu_si128((const __m128i *)(src + i)), g, round));
+
+	ScalePCMSamplesScalar(dst + i, src + i, num - i, gain);
+	}
+
+
+__attribute__((target("sse2")))
+static void MixPCMSamplesSSE2(int16 * dst, const int16 * src, uint32 num, uint32 gain)
+	{
+	const __m128i	g = _mm_set1_epi16((short)gain);
+	const __m128i	round = _mm_set1_epi32(0x4000);
+	__m128i			samples;
+	uint32			i = 0;
+
+	for (; i + 8 <= num; i += 8)
+		{
+		samples = _mm_loadu_si128((const __m128i *)(src + i));
+		if (gain < PCM_MIXER_UNITY_GAIN)
+			samples = ScalePCMVectorSSE2(samples, g, round);
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epi16(_mm_loadu_si128((const __m128i *)(dst + i)), samples));
+		}
+
+	MixPCMSamplesScalar(dst + i, src + i, num - i, gain);
+	}
+
+
+__attribute__((target("avx2")))
+static inline __m256i ScalePCMVectorAVX2(__m256i samples, __m256i gain, __m256i round)
+	{
+	__m256i	lo = _mm256_mullo_epi16(samples, gain);
+	__m256i	hi = _mm256_mulhi_epi16(samples, gain);
+
+	return _mm256_packs_epi32(_mm256_srai_epi32(_mm256_add_epi32(_mm256_unpacklo_epi16(lo, hi), round), 15),
+	                          _mm256_srai_epi32(_mm256_add_epi32(_mm256_unpackhi_epi16(lo, hi), round), 15));
+	}
+
+
+__attribute__((target("avx2")))
+static void ScalePCMSamplesAVX2(int16 * dst, const int16 * src, uint32 num, uint32 gain)
+	{
+	const __m256i	g = _mm256_set1_epi16((short)gain);
+	const __m256i	round = _mm256_set1_epi32(0x4000);
+	uint32			i = 0;
+
+	if (gain >= PCM_MIXER_UNITY_GAIN)
+		{
+		memcpy(dst, src, num * sizeof(int16));
+		return;
+		}
+
+	for (; i + 16 <= num; i += 16)
+		_mm256_storeu_si256((__m256i *)(dst + i), ScalePCMVectorAVX2(_mm256_loadu_si256((const __m256i *)(src + i)), g, round));
+
+	ScalePCMSamplesSSE2(dst + i, src + i, num - i, gain);
+	}
+
+
+__attribute__((target("avx2")))
+static void MixPCMSamplesAVX2(int16 * dst, const int16 * src, uint32 num, uint32 gain)
+	{
+	const __m256i	g = _mm256_set1_epi16((short)gain);
+	const __m256i	round = _mm256_set1_epi32(0x4000);
+	__m256i			samples;
+	uint32			i = 0;
+
+	for (; i + 16 <= num; i += 16)
+		{
+		samples = _mm256_loadu_si256((const __m256i *)(src + i));
+		if (gain < PCM_MIXER_UNITY_GAIN)
+			samples = ScalePCMVectorAVX2(samples, g, round);
+
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_adds_epi16(_mm256_loadu_si256((const __m256i *)(dst + i)), samples));
+		}
+
+	MixPCMSamplesSSE2(dst + i, src + i, num - i, gain);
+	}
+
+#endif // PCM_SAMPLE_MIXER_SIMD
+
+
+static PCMSampleMixerFunction SelectPCMSampleMixer(bool mix)
+	{
+#if PCM_SAMPLE_MIXER_SIMD
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return mix ? MixPCMSamplesAVX2 : ScalePCMSamplesAVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return mix ? MixPCMSamplesSSE2 : ScalePCMSamplesSSE2;
+#endif
+
+	return mix ? MixPCMSamplesScalar : ScalePCMSamplesScalar;
+	}
+
+
+void ScalePCMSamples(int16 * dst, const int16 * src, uint32 num, uint32 gain)
+	{
+	// Selecting the function is idempotent, so concurrent first calls do no harm
+	static PCMSampleMixerFunction scaler = NULL;
+
+	if (!scaler)
+		scaler = SelectPCMSampleMixer(false);
+
+	scaler(dst, src, num, gain);
+	}
+
+
+void MixPCMSamples(int16 * dst, const int16 * src, uint32 num, uint32 gain)
+	{
+	static PCMSampleMixerFunction mixer = NULL;
+
+	if (!mixer)
+		mixer = SelectPCMSampleMixer(true);
+
+	mixer(dst, src, num, gain);
+	}
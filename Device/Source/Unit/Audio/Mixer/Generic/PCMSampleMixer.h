@@ -0,0 +1,33 @@
+///
+/// @brief      Scaling and saturated mixing of 16 bit PCM samples
+///
+
+#ifndef PCMSAMPLEMIXER_H
+#define PCMSAMPLEMIXER_H
+
+#include "STF/Interface/Types/STFBasicTypes.h"
+
+/// Gain of 1.0 in the Q15 format used for the gain parameters below
+#define PCM_MIXER_UNITY_GAIN	0x8000
+
+/// Enables the SSE2/AVX2 versions of the sample mixer on x86 targets, selected at runtime
+#ifndef PCM_SAMPLE_MIXER_SIMD
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define PCM_SAMPLE_MIXER_SIMD	1
+#else
+#define PCM_SAMPLE_MIXER_SIMD	0
+#endif
+#endif
+
+///
+/// Write num samples of src, multiplied by gain (Q15, at most PCM_MIXER_UNITY_GAIN), to dst.
+///
+void ScalePCMSamples(int16 * dst, const int16 * src, uint32 num, uint32 gain);
+
+///
+/// Add num samples of src, multiplied by gain (Q15, at most PCM_MIXER_UNITY_GAIN), to the
+/// samples in dst. The sums are saturated to the 16 bit range.
+///
+void MixPCMSamples(int16 * dst, const int16 * src, uint32 num, uint32 gain);
+
+#endif // PCMSAMPLEMIXER_H
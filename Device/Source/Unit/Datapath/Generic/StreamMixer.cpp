@@ -259,6 +259,29 @@ StreamMixerInput::~StreamMixerInput()
 	}
 
 
+uint32 MixerInputMessageDispatcher::GetMessageLevel(const STFMessage & message)
+	{
+	switch (message.message)
+		{
+		case VDRMID_STRM_MIXER_PACKET_REQUEST:
+			return STFMSG_LEVEL_DATA;
+
+		case VDRMID_STRM_MIXER_STOPPED:
+		case VDRMID_STRM_MIXER_PREPARED:
+		case VDRMID_STRM_MIXER_STEPPED:
+		case VDRMID_STRM_MIXER_FLUSHED:
+		case VDRMID_STRM_MIXER_STARVATION:
+		case VDRMID_STRM_MIXER_START_POSSIBLE:
+		case VDRMID_STRM_MIXER_START_REQUIRED:
+		case VDRMID_STRM_MIXER_SYNCH_REQUEST:
+			return STFMSG_LEVEL_CONTROL;
+
+		default:
+			return STFMSG_LEVEL_NORMAL;
+		}
+	}
+
+
 STFResult StreamMixerInput::CreateVirtual(IVirtualUnit * & unit, IVirtualUnit * parent, IVirtualUnit * root)
 	{
 	unit = (IVirtualUnit*)(new VirtualStreamMixerInput(this));
@@ -286,7 +309,7 @@ STFResult StreamMixerInput::Create(uint64 * createParams)
 	
 	STFRES_REASSERT(GetDWordParameter(createParams, 3, (uint32&)this->inputType));
 
-	dispatcher = new TriggeredWaitableQueuedSTFMessageProcessingDispatcher(32);
+	dispatcher = new MixerInputMessageDispatcher(32);
 	threadedDispatcher = new ThreadedSTFMessageDispatcher(STFString(threadName) + STFString(GetUnitID(), 8, 16),
 																		   threadStackSize,
 																			(STFThreadPriority)threadPriority, 
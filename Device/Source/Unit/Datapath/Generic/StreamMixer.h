@@ -105,6 +105,22 @@ class MixerInputMessageSink : public DispatchedSTFMessageSink
 	};
 
 
+/// Dispatcher of the messages from the mixer to a Stream Mixer Input.
+/// Mixer state changes, starvation and clock synchronization bypass
+/// packet requests.
+class MixerInputMessageDispatcher : public TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher
+	{
+	protected:
+		uint32 GetMessageLevel(const STFMessage & message);
+
+	public:
+		MixerInputMessageDispatcher(int queueSize)
+			: TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher(queueSize)
+			{
+			}
+	};
+
+
 /// Physical Stream Mixer Input unit.
 /// Connected by a Physical-to-Physical connection with the Physical Stream
 /// Mixer unit. Represents one client stream to the Stream Mixer.
@@ -127,7 +143,7 @@ class StreamMixerInput : public virtual IStreamMixerInput,
 		VirtualStreamMixerInput * 	curVirtualInput;	/// Currently active virtual input unit
 
 		MixerInputMessageSink	* messageSink;			/// Sink to receive messages from mixer
-		TriggeredWaitableQueuedSTFMessageProcessingDispatcher	* dispatcher;	/// Dispatcher used to forward messages upstream
+		MixerInputMessageDispatcher	* dispatcher;	/// Dispatcher used to forward messages upstream
 		ThreadedSTFMessageDispatcher * threadedDispatcher;							/// Thread based dispatcher based on "dispatcher" above
 		VDRMixerInputType				inputType;
 
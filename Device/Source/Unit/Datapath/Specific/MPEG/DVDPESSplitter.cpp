@@ -8,6 +8,7 @@
 #include "VDR/Interface/Unit/Video/Decoder/IVDRVideoDecoderTypes.h"
 #include "VDR/Source/Construction/IUnitConstruction.h"
 #include "Device/Interface/Unit/Video/IMPEGVideoTypes.h"
+#include "MPEGStartCodeScanner.h"
 
 
 /// The change set group which is used for the streaming-synchronized tag updates
@@ -79,8 +80,7 @@ STFResult VirtualDVDPESSplitterUnit::ParsePESPacket(const VDRDataRange * ranges,
 	uint8			value;
 	uint8		*	pos;
 	uint32		size = ranges[range].size;
-	uint32		start, done;
-	static uint8 packHeader[4] = {0x00, 0x00, 0x01, 0xba};
+	uint32		start, done, next;
 
 	while (range < num)
 		{
@@ -88,7 +88,8 @@ STFResult VirtualDVDPESSplitterUnit::ParsePESPacket(const VDRDataRange * ranges,
 		size = ranges[range].size;
 		start = offset;
 
-		if (state == DVDPESS_PARSE_PACKHEADER_0 && size == 2048 && offset == 0 && ((PADDR)pos & 3) == 0 && *((uint32 *)pos) == *((uint32 *)&packHeader))
+		if (state == DVDPESS_PARSE_PACKHEADER_0 && size == 2048 && offset == 0 &&
+			 pos[0] == 0x00 && pos[1] == 0x00 && pos[2] == 0x01 && pos[3] == MPEG_PACK_START_CODE)
 			{
 			streamQueue.AppendRange(ranges[range], this);
 			range++;
@@ -106,15 +107,22 @@ STFResult VirtualDVDPESSplitterUnit::ParsePESPacket(const VDRDataRange * ranges,
 				switch (state)
 					{
 					case DVDPESS_PARSE_PACKHEADER_0:
-						if (value == 0x00)
+						//
+						// Skip to the next possible pack start code, the following states verify
+						// it byte by byte, also when it continues in the next range
+						//
+						next = FindMPEGStartCode(pos, offset, size, MPEG_PACK_START_CODE);
+						if (next != offset)
+							{
+							streamQueue.FlushRanges(this);
+							offset = next;
+							}
+						else
 							{
 							state = DVDPESS_PARSE_PACKHEADER_1;
 							start = offset;
+							offset++;
 							}
-						else
-							streamQueue.FlushRanges(this);
-
-						offset++;
 						break;
 
 					case DVDPESS_PARSE_PACKHEADER_1:
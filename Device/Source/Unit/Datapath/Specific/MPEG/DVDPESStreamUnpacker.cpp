@@ -5,6 +5,7 @@
 #include "DVDPESStreamUnpacker.h"
 #include "VDR/Source/Construction/IUnitConstruction.h"
 #include "Device/Interface/Unit/Video/IMPEGVideoTypes.h"
+#include "MPEGStartCodeScanner.h"
 
 
 UNIT_CREATION_FUNCTION(CreateDVDPESStreamUnpackerUnit, DVDPESStreamUnpackerUnit)
@@ -81,7 +82,7 @@ STFResult VirtualDVDPESStreamUnpackerUnit::ParsePESPacket(const VDRDataRange * r
 	uint8			value;
 	uint8		*	pos;
 	uint32		size = ranges[range].size;
-	uint32		start, done;
+	uint32		start, done, next;
 
 	while (range < num)
 		{
@@ -96,15 +97,22 @@ STFResult VirtualDVDPESStreamUnpackerUnit::ParsePESPacket(const VDRDataRange * r
 			switch (state)
 				{
 				case DVDPESS_PARSE_PACKHEADER_0:
-					if (value == 0x00)
+					//
+					// Skip to the next possible pack start code, the following states verify
+					// it byte by byte, also when it continues in the next range
+					//
+					next = FindMPEGStartCode(pos, offset, size, MPEG_PACK_START_CODE);
+					if (next != offset)
+						{
+						streamQueue.FlushRanges(this);
+						offset = next;
+						}
+					else
 						{
 						state = DVDPESS_PARSE_PACKHEADER_1;
 						start = offset;
+						offset++;
 						}
-					else
-						streamQueue.FlushRanges(this);
-
-					offset++;
 					break;
 
 				case DVDPESS_PARSE_PACKHEADER_1:
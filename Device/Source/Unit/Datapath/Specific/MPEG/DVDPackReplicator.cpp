@@ -0,0 +1,116 @@
+///
+/// @brief      Single pass DVD demux, replicates each pack only to the splitter of its elementary stream
+///
+
+#include "DVDPackReplicator.h"
+#include "VDR/Source/Construction/IUnitConstruction.h"
+#include "Device/Interface/Unit/Video/IMPEGVideoTypes.h"
+#include "MPEGStartCodeScanner.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Physical DVD Pack Replicator Unit
+///////////////////////////////////////////////////////////////////////////////
+
+UNIT_CREATION_FUNCTION(CreateDVDPackReplicatorUnit, DVDPackReplicatorUnit)
+
+
+STFResult DVDPackReplicatorUnit::CreateVirtual(IVirtualUnit * & unit, IVirtualUnit * parent, IVirtualUnit * root)
+	{
+	unit = (IVirtualUnit*)(new VirtualDVDPackReplicatorUnit(this, numPacketsPerOutput, messageMode));
+
+	if (unit)
+		{
+		STFRES_REASSERT(unit->Connect(parent, root));
+		}
+	else
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult DVDPackReplicatorUnit::Create(uint64 * createParams)
+	{
+	STFRES_REASSERT(StreamReplicatorStreamingUnit::Create(createParams));
+
+	if (numOutputs != DVDPRO_TOTAL)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	STFRES_RAISE_OK;
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Virtual DVD Pack Replicator Unit
+///////////////////////////////////////////////////////////////////////////////
+
+VirtualDVDPackReplicatorUnit::VirtualDVDPackReplicatorUnit(IPhysicalUnit * physical, uint32 numPacketsPerOutput, StreamReplicatorMessageForwardMode messageMode)
+	: VirtualStreamReplicatorStreamingUnit(physical, DVDPRO_TOTAL, numPacketsPerOutput, messageMode)
+	{
+	}
+
+
+STFResult VirtualDVDPackReplicatorUnit::SelectOutputRanges(const StreamingDataPacket * packet)
+	{
+	const VDRDataRange	*	ranges = packet->vdrPacket.tagRanges.ranges + packet->vdrPacket.numTags;
+	uint8						*	pos;
+	uint8							id, subStreamID;
+	uint32						i, output;
+
+	for(output=0; output<DVDPRO_TOTAL; output++)
+		outputRangeMasks[output] = 0;
+
+	for(i=0; i<packet->vdrPacket.numRanges; i++)
+		{
+		pos = ranges[i].GetStart();
+
+		//
+		// Packs not aligned to the ranges are left to the byte-wise parsing of all
+		// splitters, this keeps their resynchronisation unchanged
+		//
+		if (ranges[i].size != DVD_PACK_SIZE ||
+			 pos[0] != 0x00 || pos[1] != 0x00 || pos[2] != 0x01 || pos[3] != MPEG_PACK_START_CODE ||
+			 pos[14] != 0x00 || pos[15] != 0x00 || pos[16] != 0x01)
+			{
+			STFRES_RAISE(VirtualStreamReplicatorStreamingUnit::SelectOutputRanges(packet));
+			}
+
+		// The first PES packet follows the 14 byte pack header
+		id = pos[17];
+
+		if ((id & 0xf0) == 0xe0)
+			{
+			outputRangeMasks[DVDPRO_VIDEO] |= MKFLAG(i);
+			}
+		else if ((id & 0xe0) == 0xc0)
+			{
+			outputRangeMasks[DVDPRO_AUDIO] |= MKFLAG(i);
+			}
+		else if (id == PRIVATE_STREAM_1_ID)
+			{
+			// The sub stream ID is the first byte behind the PES header
+			subStreamID = pos[14 + 9 + pos[14 + 8]];
+
+			if ((subStreamID & 0xe0) == 0x20)
+				outputRangeMasks[DVDPRO_SUBPICTURE] |= MKFLAG(i);
+			else
+				outputRangeMasks[DVDPRO_AUDIO] |= MKFLAG(i);
+			}
+		else if (id != PADDING_STREAM_ID)
+			{
+			// Nav packs (system header followed by the PCI/DSI packets) and unknown packs go to all splitters
+			for(output=0; output<DVDPRO_TOTAL; output++)
+				outputRangeMasks[output] |= MKFLAG(i);
+			}
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+
+#if _DEBUG
+STFString VirtualDVDPackReplicatorUnit::GetInformation(void)
+	{
+	return STFString("DVDPackReplicator ") + STFString(physical->GetUnitID(), 8, 16);
+	}
+#endif
@@ -0,0 +1,64 @@
+///
+/// @brief      Single pass DVD demux, replicates each pack only to the splitter of its elementary stream
+///
+
+#ifndef DVDPACKREPLICATOR_H
+#define DVDPACKREPLICATOR_H
+
+#include "VDR/Source/Streaming/InfiniteStreamReplicator.h"
+
+/// Size of a DVD sector, each sector holds exactly one pack
+#define DVD_PACK_SIZE	2048
+
+/// The outputs of the DVD pack replicator, in the order the DVD stream demux connects them
+enum DVDPackReplicatorOutput
+	{
+	DVDPRO_VIDEO,
+	DVDPRO_AUDIO,
+	DVDPRO_SUBPICTURE,
+
+	DVDPRO_TOTAL
+	};
+
+///////////////////////////////////////////////////////////////////////////////
+// Physical DVD Pack Replicator Unit
+///////////////////////////////////////////////////////////////////////////////
+
+/// Drop-in replacement for the stream replicator of the DVD stream demux.
+/// Takes the same create parameters, the number of outputs has to be DVDPRO_TOTAL.
+class DVDPackReplicatorUnit : public StreamReplicatorStreamingUnit
+	{
+	public:
+		DVDPackReplicatorUnit(VDRUID unitID) : StreamReplicatorStreamingUnit(unitID) {}
+
+		//
+		// IPhysicalUnit interface implementation
+		//
+		virtual STFResult CreateVirtual(IVirtualUnit * & unit, IVirtualUnit * parent = NULL, IVirtualUnit * root = NULL);
+
+		virtual STFResult Create(uint64 * createParams);
+	};
+
+///////////////////////////////////////////////////////////////////////////////
+// Virtual DVD Pack Replicator Unit
+///////////////////////////////////////////////////////////////////////////////
+
+/// Classifies each pack of a DVD program stream once by its stream ID and sub stream ID.
+/// Nav packs are replicated to all outputs, as all splitters take their timing from
+/// them, every other pack only to the output of its elementary stream type. So each
+/// splitter parses only its own packs instead of all packs of the stream. The exact
+/// stream selection is still done by the splitters.
+class VirtualDVDPackReplicatorUnit : public VirtualStreamReplicatorStreamingUnit
+	{
+	protected:
+		virtual STFResult SelectOutputRanges(const StreamingDataPacket * packet);
+
+	public:
+		VirtualDVDPackReplicatorUnit(IPhysicalUnit * physical, uint32 numPacketsPerOutput, StreamReplicatorMessageForwardMode messageMode);
+
+#if _DEBUG
+		virtual STFString GetInformation(void);
+#endif
+	};
+
+#endif
@@ -51,6 +51,7 @@ STFResult DVDStreamDemuxUnit::Connect(uint64 localID, IPhysicalUnit * source)
 	switch (localID)
 		{
 		case 0:
+			// Either a plain stream replicator or, for single pass demultiplexing, a DVD pack replicator
 			streamReplicator = source;
 			break;
 
@@ -0,0 +1,152 @@
+///
+/// @brief      Fast search for MPEG start codes (00 00 01 xx) in data ranges
+///
+
+#include "MPEGStartCodeScanner.h"
+
+#if MPEG_START_CODE_SCANNER_SIMD
+#include <immintrin.h>
+#endif
+
+typedef uint32 (* MPEGStartCodeScannerFunction)(const uint8 * data, uint32 offset, uint32 size, uint8 code);
+
+
+///
+/// Find the first trailing bytes that are the beginning of a start code
+///
+static uint32 FindMPEGStartCodePrefix(const uint8 * data, uint32 offset, uint32 size)
+	{
+	uint8		startCode[3] = {0x00, 0x00, 0x01};
+	uint32	i, j;
+
+	if (size > 3 && offset < size - 3)
+		offset = size - 3;
+
+	for (i = offset; i < size; i++)
+		{
+		for (j = 0; i + j < size && data[i + j] == startCode[j]; j++) ;
+
+		if (i + j == size)
+			return i;
+		}
+
+	return size;
+	}
+
+
+static uint32 FindMPEGStartCodeScalar(const uint8 * data, uint32 offset, uint32 size, uint8 code)
+	{
+	uint32	i = offset;
+	uint8		last;
+
+	//
+	// Check the last byte of the four byte window first, its value tells how far
+	// the next possible start code is away
+	//
+	while (i + 4 <= size)
+		{
+		last = data[i + 3];
+
+		if (last == code && data[i + 2] == 0x01 && data[i + 1] == 0x00 && data[i] == 0x00)
+			return i;
+
+		if (last == 0x00)
+			i += 2;
+		else if (last == 0x01)
+			i += 1;
+		else
+			i += 4;
+		}
+
+	return FindMPEGStartCodePrefix(data, i, size);
+	}
+
+
+#if MPEG_START_CODE_SCANNER_SIMD
+
+__attribute__((target("sse2")))
+static uint32 FindMPEGStartCodeSSE2(const uint8 * data, uint32 offset, uint32 size, uint8 code)
+	{
+	const __m128i	zero = _mm_setzero_si128();
+	const __m128i	one = _mm_set1_epi8(0x01);
+	const __m128i	last = _mm_set1_epi8((char)code);
+	__m128i			match;
+	uint32			mask;
+	uint32			i = offset;
+
+	//
+	// Compare 16 windows at once, each vector holds one of the four bytes of the windows
+	//
+	while (i + 16 + 3 <= size)
+		{
+		match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i)), zero),
+		                                    _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i + 1)), zero)),
+		                      _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i + 2)), one),
+		                                    _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i + 3)), last)));
+
+		mask = (uint32)_mm_movemask_epi8(match);
+		if (mask)
+			return i + __builtin_ctz(mask);
+
+		i += 16;
+		}
+
+	return FindMPEGStartCodeScalar(data, i, size, code);
+	}
+
+
+__attribute__((target("avx2")))
+static uint32 FindMPEGStartCodeAVX2(const uint8 * data, uint32 offset, uint32 size, uint8 code)
+	{
+	const __m256i	zero = _mm256_setzero_si256();
+	const __m256i	one = _mm256_set1_epi8(0x01);
+	const __m256i	last = _mm256_set1_epi8((char)code);
+	__m256i			match;
+	uint32			mask;
+	uint32			i = offset;
+
+	while (i + 32 + 3 <= size)
+		{
+		match = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i)), zero),
+		                                          _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i + 1)), zero)),
+		                         _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i + 2)), one),
+		                                          _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i + 3)), last)));
+
+		mask = (uint32)_mm256_movemask_epi8(match);
+		if (mask)
+			return i + __builtin_ctz(mask);
+
+		i += 32;
+		}
+
+	return FindMPEGStartCodeSSE2(data, i, size, code);
+	}
+
+#endif // MPEG_START_CODE_SCANNER_SIMD
+
+
+static MPEGStartCodeScannerFunction SelectMPEGStartCodeScanner(void)
+	{
+#if MPEG_START_CODE_SCANNER_SIMD
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return FindMPEGStartCodeAVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return FindMPEGStartCodeSSE2;
+#endif
+
+	return FindMPEGStartCodeScalar;
+	}
+
+
+uint32 FindMPEGStartCode(const uint8 * data, uint32 offset, uint32 size, uint8 code)
+	{
+	// Selecting the scanner is idempotent, so concurrent first calls do no harm
+	static MPEGStartCodeScannerFunction scanner = NULL;
+
+	if (!scanner)
+		scanner = SelectMPEGStartCodeScanner();
+
+	return scanner(data, offset, size, code);
+	}
@@ -0,0 +1,32 @@
+///
+/// @brief      Fast search for MPEG start codes (00 00 01 xx) in data ranges
+///
+
+#ifndef MPEGSTARTCODESCANNER_H
+#define MPEGSTARTCODESCANNER_H
+
+#include "STF/Interface/Types/STFBasicTypes.h"
+
+/// MPEG-2 program stream pack header start code value
+#define MPEG_PACK_START_CODE	0xba
+
+/// Enables the SSE2/AVX2 versions of the scanner on x86 targets, selected at runtime
+#ifndef MPEG_START_CODE_SCANNER_SIMD
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define MPEG_START_CODE_SCANNER_SIMD	1
+#else
+#define MPEG_START_CODE_SCANNER_SIMD	0
+#endif
+#endif
+
+///
+/// Search the start code 00 00 01 <code> in data[offset] to data[size - 1].
+///
+/// Returns the offset of the first start code found. If there is none, the offset
+/// of the first of the trailing bytes that may be the beginning of a start code
+/// continuing in the next range is returned, so that a byte-wise parser can pick up
+/// matches spanning range boundaries from there. Returns size if neither is found.
+///
+uint32 FindMPEGStartCode(const uint8 * data, uint32 offset, uint32 size, uint8 code);
+
+#endif // MPEGSTARTCODESCANNER_H
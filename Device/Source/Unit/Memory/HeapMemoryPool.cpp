@@ -33,7 +33,7 @@ STFResult HeapMemoryPoolPU::CreateVirtual(IVirtualUnit * & unit, IVirtualUnit *
 	STFResult res;
 
 	// Create our virtual unit.
-	unit = new HeapMemoryPoolVU(this);
+	unit = new HeapMemoryPoolVU(this, slabMinSize, numSizeClasses);
 	if (unit == NULL)
 		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
 
@@ -47,14 +47,37 @@ STFResult HeapMemoryPoolPU::CreateVirtual(IVirtualUnit * & unit, IVirtualUnit *
 	}
 
 
+STFResult HeapMemoryPoolPU::Create(uint64 * createParams)
+	{
+	slabMinSize = 0;
+	numSizeClasses = 0;
+
+	if (STFRES_SUCCEEDED(GetDWordParameter(createParams, 0, slabMinSize)))
+		{
+		if (STFRES_FAILED(GetDWordParameter(createParams, 1, numSizeClasses)))
+			numSizeClasses = HEAPMEMORYPOOL_MAX_SIZE_CLASSES;
+
+		if (slabMinSize == 0  ||  numSizeClasses == 0  ||  numSizeClasses > HEAPMEMORYPOOL_MAX_SIZE_CLASSES)
+			STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+		}
+	else if (createParams[0] != PARAMS_DONE)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	STFRES_RAISE_OK;
+	}
+
+
 
 ////////////////////////////////////////////////////////////////////
 // HeapMemoryPoolVU implementation.
 ////////////////////////////////////////////////////////////////////
 
-HeapMemoryPoolVU::HeapMemoryPoolVU(MemoryPoolAllocator * physicalUnit)
+HeapMemoryPoolVU::HeapMemoryPoolVU(MemoryPoolAllocator * physicalUnit, uint32 slabMinSize, uint32 numSizeClasses)
 	: VirtualVariableSizeMemoryPoolAllocator(physicalUnit)
 	{
+	this->slabMinSize = slabMinSize;
+	this->numSizeClasses = numSizeClasses;
+	slabBlocks = NULL;
 	}
 
 
@@ -73,6 +96,8 @@ HeapMemoryPoolVU::~HeapMemoryPoolVU()
 			block = next;
 			}
 		}
+
+	DeleteSlabBlocks();
 	}
 
 
@@ -88,7 +113,9 @@ STFResult HeapMemoryPoolVU::GetMemoryBlock(VDRMemoryBlock** block, uint32 size,
 
 	getMutex.Enter();
 
-	if (STFRES_SUCCEEDED(res = heapManager.Allocate(size, alignmentFactor, startAddress, physicalAddress)))
+	if (slabMinSize)
+		res = GetSlabMemoryBlock(block, size, holder);
+	else if (STFRES_SUCCEEDED(res = heapManager.Allocate(size, alignmentFactor, startAddress, physicalAddress)))
 		{
 		MemoryBlockNode* mbn = new MemoryBlockNode;
 		if (mbn == NULL)
@@ -121,6 +148,25 @@ STFResult HeapMemoryPoolVU::GetMemoryBlock(VDRMemoryBlock** block, uint32 size,
 STFResult HeapMemoryPoolVU::ReturnMemoryBlocks(VDRMemoryBlock ** blocks, uint32 number)
 	{
 	MemoryPoolBlock **b = (MemoryPoolBlock **)blocks;
+	SlabMemoryBlock *sb;
+
+	if (slabMinSize)
+		{
+		// Blocks of a size class go back to its free list. The heap needs getMutex, so the
+		// memory of oversized blocks is given back by the next GetMemoryBlock() call.
+		for (uint32 i = 0;  i < number;  i++)
+			{
+			sb = static_cast<SlabMemoryBlock*>(b[i]);
+			numSlabBlocksInUse--;
+
+			if (sb->sizeClass < numSizeClasses)
+				slabFreeLists[sb->sizeClass].Push(sb);
+			else
+				deferredSlabBlocks.Push(sb);
+			}
+
+		STFRES_RAISE_OK;
+		}
 
 	for (uint32 i = 0;  i < number;  i++)
 		{
@@ -142,6 +188,127 @@ STFResult HeapMemoryPoolVU::ReturnMemoryBlocks(VDRMemoryBlock ** blocks, uint32
 
 
 
+////////////////////////////////////////////////////////////////////
+// HeapMemoryPoolVU - size class mode.
+////////////////////////////////////////////////////////////////////
+
+// Called with getMutex held
+STFResult HeapMemoryPoolVU::GetSlabMemoryBlock(VDRMemoryBlock** block, uint32 size, IVDRDataHolder* holder)
+	{
+	SlabMemoryBlock *sb = NULL;
+	uint32 sizeClass = 0;
+	uint32 classSize = slabMinSize;
+	uint8* startAddress;
+	PADDR physicalAddress;
+
+	ReleaseDeferredSlabMemory();
+
+	while (sizeClass < numSizeClasses  &&  size > classSize)
+		{
+		sizeClass++;
+		classSize <<= 1;
+		}
+
+	if (sizeClass < numSizeClasses)
+		sb = static_cast<SlabMemoryBlock*>(slabFreeLists[sizeClass].Pop());
+	else
+		classSize = size;
+
+	if (sb == NULL)
+		{
+		// No free block of this class yet, get the memory from the heap, and if it is
+		// exhausted, from the blocks cached in all size classes
+		if (STFRES_FAILED(heapManager.Allocate(classSize, alignmentFactor, startAddress, physicalAddress)))
+			{
+			ReleaseCachedSlabMemory();
+			STFRES_REASSERT(heapManager.Allocate(classSize, alignmentFactor, startAddress, physicalAddress));
+			}
+
+		sb = static_cast<SlabMemoryBlock*>(spareSlabBlocks.Pop());
+		if (sb == NULL)
+			{
+			sb = new SlabMemoryBlock;
+			if (sb == NULL)
+				{
+				heapManager.Deallocate(startAddress, classSize);
+				STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+				}
+
+			sb->nextSlabBlock = slabBlocks;
+			slabBlocks = sb;
+			}
+
+		sb->kernelBase = sb->userBase = startAddress;
+		sb->physicalAddress = physicalAddress;
+		sb->pool = (IVDRMemoryPoolDeallocator*)this;
+		sb->sizeClass = sizeClass;
+		}
+
+	// The block reports the requested size, its size class is kept for the return
+	sb->size = size;
+	sb->SetInitialCounter (holder);
+	numSlabBlocksInUse++;
+
+	*block = sb;
+
+	STFRES_RAISE_OK;
+	}
+
+
+// Called with getMutex held
+void HeapMemoryPoolVU::ReleaseCachedSlabMemory(void)
+	{
+	SlabMemoryBlock *sb;
+	uint32 sizeClass;
+
+	for (sizeClass = 0;  sizeClass < numSizeClasses;  sizeClass++)
+		{
+		while ((sb = static_cast<SlabMemoryBlock*>(slabFreeLists[sizeClass].Pop())) != NULL)
+			{
+			heapManager.Deallocate(sb->kernelBase, slabMinSize << sizeClass);
+			spareSlabBlocks.Push(sb);
+			}
+		}
+	}
+
+
+// Called with getMutex held
+void HeapMemoryPoolVU::ReleaseDeferredSlabMemory(void)
+	{
+	SlabMemoryBlock *sb;
+
+	while ((sb = static_cast<SlabMemoryBlock*>(deferredSlabBlocks.Pop())) != NULL)
+		{
+		heapManager.Deallocate(sb->GetStart(), sb->GetSize());
+		spareSlabBlocks.Push(sb);
+		}
+	}
+
+
+void HeapMemoryPoolVU::DeleteSlabBlocks(void)
+	{
+	SlabMemoryBlock *sb, *next;
+	uint32 sizeClass;
+
+	for (sizeClass = 0;  sizeClass < numSizeClasses;  sizeClass++)
+		slabFreeLists[sizeClass].Clear();
+	spareSlabBlocks.Clear();
+	deferredSlabBlocks.Clear();
+
+	sb = slabBlocks;
+	while (sb != NULL)
+		{
+		next = sb->nextSlabBlock;
+		delete sb;
+		sb = next;
+		}
+
+	slabBlocks = NULL;
+	numSlabBlocksInUse = 0;
+	}
+
+
+
 ////////////////////////////////////////////////////////////////////
 // HeapMemoryPoolVU - IVirtualUnit implementation.
 ////////////////////////////////////////////////////////////////////
@@ -151,7 +318,7 @@ STFResult HeapMemoryPoolVU::InternalPassivate(const STFHiPrec64BitTime & systemT
 	//If list of memory block is not empty, some blocks are not released, so
 	//there may be someone still using them, and we can't passivate.
 	//The base class must not be passivated, either.
-	if (!memBlockList.IsEmpty())
+	if (!memBlockList.IsEmpty()  ||  numSlabBlocksInUse > 0)
 		STFRES_RAISE(STFRES_OBJECT_IN_USE);
 
 	//Passivate base class.
@@ -186,6 +353,8 @@ STFResult HeapMemoryPoolVU::PreemptUnit(uint32 flags)
 			memBlockList.Clear();
 			}
 
+		DeleteSlabBlocks();
+
 		// Initialize the block structures and partition the single memory partition.
 		startAddress = memPartInterface->GetStartAddress();
 		physicalStartAddress = memPartInterface->GetPhysicalAddress();
@@ -211,6 +380,10 @@ STFResult HeapMemoryPoolVU::PreemptUnit(uint32 flags)
 			memBlockList.Clear();
 			}
 
+		// The heap is initialized again on the next start, so the memory of the size class
+		// blocks does not need to be returned
+		DeleteSlabBlocks();
+
 		// The single memory partition will now be deallocated in its own class...
 		}
 
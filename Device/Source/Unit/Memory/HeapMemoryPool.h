@@ -42,6 +42,25 @@ class MemoryBlockList : public STFList
 	};
 
 
+////////////////////////////////////////////////////////////////////
+// SlabMemoryBlock
+//
+// Memory block of the size class mode. The block is its own node in the
+// free list of its size class, so once created it is reused without any
+// further allocation or list search.
+////////////////////////////////////////////////////////////////////
+
+/// Maximum number of size classes of a heap memory pool
+#define HEAPMEMORYPOOL_MAX_SIZE_CLASSES	16
+
+class SlabMemoryBlock : public MemoryPoolBlock, public STFInterlockedNode
+	{
+	public:
+		uint32				sizeClass;		// Size class index, number of size classes for blocks larger than the largest class
+		SlabMemoryBlock *	nextSlabBlock;	// Chain of all blocks created by the pool
+	};
+
+
 ////////////////////////////////////////////////////////////////////
 // HeapMemoryPoolPU
 ////////////////////////////////////////////////////////////////////
@@ -49,6 +68,8 @@ class MemoryBlockList : public STFList
 class HeapMemoryPoolPU : public MemoryPoolAllocator
 	{
 	protected:
+		uint32 slabMinSize;
+		uint32 numSizeClasses;
 
 	public:
 		HeapMemoryPoolPU(VDRUID unitID) : MemoryPoolAllocator(unitID) {}
@@ -56,6 +77,11 @@ class HeapMemoryPoolPU : public MemoryPoolAllocator
 	public:
 		//IPhysicalUnit implementation.
 		virtual STFResult CreateVirtual(IVirtualUnit * & unit, IVirtualUnit * parent = NULL, IVirtualUnit * root = NULL);
+
+		/// Without parameters the pool is a plain heap. With parameter 0 (size of the smallest
+		/// size class) and the optional parameter 1 (number of size classes, each twice the size
+		/// of the previous one) returned blocks are kept in per size class free lists for reuse.
+		virtual STFResult Create(uint64 * createParams);
 	};
 
 
@@ -70,8 +96,24 @@ class HeapMemoryPoolVU : public VirtualVariableSizeMemoryPoolAllocator
 		STFFreeListHeapMemoryManager heapManager;
 		MemoryBlockList memBlockList;
 
+		//
+		// Size class mode
+		//
+		uint32 slabMinSize;											// Size of the smallest size class, 0 if the mode is not used
+		uint32 numSizeClasses;
+		STFInterlockedStack slabFreeLists[HEAPMEMORYPOOL_MAX_SIZE_CLASSES];	// Returned blocks of each size class, still holding their memory
+		STFInterlockedStack spareSlabBlocks;					// Returned blocks without memory
+		STFInterlockedStack deferredSlabBlocks;				// Returned oversized blocks, their memory still to be given back to the heap
+		SlabMemoryBlock * slabBlocks;								// All blocks created so far
+		STFInterlockedInt numSlabBlocksInUse;
+
+		STFResult GetSlabMemoryBlock(VDRMemoryBlock** block, uint32 size, IVDRDataHolder* holder);
+		void ReleaseCachedSlabMemory(void);
+		void ReleaseDeferredSlabMemory(void);
+		void DeleteSlabBlocks(void);
+
 	public:
-		HeapMemoryPoolVU(MemoryPoolAllocator* physicalUnit);
+		HeapMemoryPoolVU(MemoryPoolAllocator* physicalUnit, uint32 slabMinSize = 0, uint32 numSizeClasses = 0);
 		virtual ~HeapMemoryPoolVU();
 
 	public:
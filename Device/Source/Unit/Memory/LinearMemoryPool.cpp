@@ -4,6 +4,8 @@
 
 #include "Device/Source/Unit/Memory/LinearMemoryPool.h"
 #include "STF/Interface/STFDebug.h"
+#include "STF/Interface/STFThread.h"
+#include "STF/Interface/STFTimer.h"
 #include <assert.h>
 
 
@@ -32,7 +34,7 @@ STFResult LinearMemoryPool::CreateVirtual (IVirtualUnit * & unit, IVirtualUnit *
 	STFResult res;
 
 	// Create our virtual unit.
-	unit = new VirtualLinearMemoryPool (this);
+	unit = new VirtualLinearMemoryPool (this, magazineSize, numMagazines);
 	if (unit == NULL)
 		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
 
@@ -46,21 +48,54 @@ STFResult LinearMemoryPool::CreateVirtual (IVirtualUnit * & unit, IVirtualUnit *
 	}
 
 
+STFResult LinearMemoryPool::Create (uint64 * createParams)
+	{
+	magazineSize = 0;
+	numMagazines = 0;
+
+	if (STFRES_SUCCEEDED(GetDWordParameter (createParams, 0, magazineSize)))
+		{
+		if (STFRES_FAILED(GetDWordParameter (createParams, 1, numMagazines)))
+			numMagazines = LINEARMEMORYPOOL_MAX_MAGAZINES;
+
+		if (magazineSize == 0  ||  magazineSize > LINEARMEMORYPOOL_MAX_MAGAZINE_SIZE  ||
+			 numMagazines == 0  ||  numMagazines > LINEARMEMORYPOOL_MAX_MAGAZINES)
+			STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+		}
+	else if (createParams[0] != PARAMS_DONE)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	STFRES_RAISE_OK;
+	}
+
+
 
 ////////////////////////////////////////////////////////////////////
 //! VirtualLinearMemoryPool implementation.
 ////////////////////////////////////////////////////////////////////
 
-VirtualLinearMemoryPool::VirtualLinearMemoryPool (MemoryPoolAllocator * physicalUnit)
+VirtualLinearMemoryPool::VirtualLinearMemoryPool (MemoryPoolAllocator * physicalUnit, uint32 magazineSize, uint32 numMagazines)
 	: VirtualMemoryPoolAllocator (physicalUnit)
 	{
 	poolBlocks = NULL;
+	freeBlockMap = NULL;
 	allocationFailed = false;
+
+	this->magazineSize = magazineSize;
+	this->numMagazines = numMagazines;
+	magazines = NULL;
+	if (magazineSize)
+		{
+		magazines = new BlockMagazine[numMagazines];
+		ResetMagazines ();
+		}
 	}
 
 VirtualLinearMemoryPool::~VirtualLinearMemoryPool (void)
 	{
 	delete[] poolBlocks;
+	delete[] freeBlockMap;
+	delete[] magazines;
 	}
 
 
@@ -132,20 +167,243 @@ void VirtualLinearMemoryPool::DumpMemoryBlockLog (void)
 
 
 
-STFResult VirtualLinearMemoryPool::GetMemoryBlocks (VDRMemoryBlock ** blocks, uint32 minWait, uint32 number, uint32 &done, IVDRDataHolder * holder)
+///
+/// Index of the lowest set bit, value must not be zero
+///
+static inline uint32 CountTrailingZeros (uint32 value)
+	{
+#if __GNUC__
+	return __builtin_ctz (value);
+#else
+	uint32 n = 0;
+
+	while ((value & 1) == 0)
+		{
+		value >>= 1;
+		n++;
+		}
+
+	return n;
+#endif
+	}
+
+
+// Returns the first free (or used) block in the range from position to end, or end if there is none
+uint32 VirtualLinearMemoryPool::FindBlock (uint32 position, uint32 end, bool free)
+	{
+	uint32 word;
+
+	while (position < end)
+		{
+		word = (uint32)(int32)freeBlockMap[position >> 5];
+		if (!free)
+			word = ~word;
+
+		// Ignore the blocks before the position in the first word
+		word &= ~0UL << (position & 31);
+
+		if (word)
+			{
+			position = (position & ~31UL) + CountTrailingZeros (word);
+			return position < end ? position : end;
+			}
+
+		position = (position & ~31UL) + 32;
+		}
+
+	return end;
+	}
+
+
+void VirtualLinearMemoryPool::UpdateFreeBlockMap (uint32 position, uint32 number, bool free)
+	{
+	uint32 shift, count, mask;
+	int32 previous;
+
+	while (number > 0)
+		{
+		shift = position & 31;
+		count = 32 - shift < number ? 32 - shift : number;
+		mask = (count == 32 ? ~0UL : MKFLAG(count) - 1) << shift;
+
+		do {
+			previous = freeBlockMap[position >> 5];
+			} while (freeBlockMap[position >> 5].CompareExchange (previous, free ? previous | mask : previous & ~mask) != previous);
+
+		position += count;
+		number -= count;
+		}
+	}
+
+
+// Find up to number free blocks, starting at position and wrapping around at the end of the pool.
+// Position is updated to behind the last block found.
+uint32 VirtualLinearMemoryPool::FindFreeBlocks (MemoryPoolBlock ** blocks, uint32 number, uint32 & position)
+	{
+	uint32 i, end, found;
+
+	found = 0;
+	i = position;
+	end = numBlocks;
+	while (found < number  &&  (i = FindBlock (i, end, true)) < end)
+		blocks[found++] = &poolBlocks[i++];
+
+	if (found < number)
+		{
+		// End of array reached, but not enough blocks yet. Wrap-around to the beginning of the array.
+		i = 0;
+		end = position;
+		while (found < number  &&  (i = FindBlock (i, end, true)) < end)
+			blocks[found++] = &poolBlocks[i++];
+		}
+
+	position = i;
+
+	return found;
+	}
+
+
+// Mark the found blocks as used, blocks allocated in sequence are cleared in one go
+void VirtualLinearMemoryPool::ClaimBlocks (MemoryPoolBlock ** blocks, uint32 number)
+	{
+	uint32 i, j, first;
+
+	for (i = 0;  i < number;  i = j)
+		{
+		first = blocks[i] - poolBlocks;
+
+		j = i + 1;
+		while (j < number  &&  (uint32)(blocks[j] - poolBlocks) == first + (j - i) * clusterSize)
+			j++;
+
+		UpdateFreeBlockMap (first, (j - i) * clusterSize, false);
+		}
+	}
+
+
+// Lock the magazine of the current thread, a free magazine is assigned on the first call of a thread.
+// Returns NULL if the thread has no magazine or the magazine is being drained.
+VirtualLinearMemoryPool::BlockMagazine * VirtualLinearMemoryPool::LockThreadMagazine (void)
+	{
+	STFThread	*	thread;
+	uint32			i;
+
+	if (STFRES_FAILED(GetCurrentSTFThread (thread))  ||  thread == NULL)
+		return NULL;
+
+	for (i = 0;  i < numMagazines;  i++)
+		{
+		if ((pointer)magazines[i].owner == (pointer)thread  ||
+			 magazines[i].owner.CompareExchange (NULL, (pointer)thread) == NULL)
+			{
+			if (magazines[i].busy.CompareExchange (0, 1) == 0)
+				return &magazines[i];
+
+			return NULL;
+			}
+		}
+
+	return NULL;   // all magazines are assigned to other threads
+	}
+
+
+// Return the blocks of all magazines to the pool. Must not be called while holding a magazine.
+void VirtualLinearMemoryPool::DrainMagazines (void)
 	{
-	MemoryPoolBlock *	b;
+	BlockMagazine	*	magazine;
 	uint32				i, j;
+
+	for (i = 0;  i < numMagazines;  i++)
+		{
+		magazine = &magazines[i];
+
+		if ((pointer)magazine->owner != NULL)
+			{
+			// The owner only holds its magazine for a short time
+			while (magazine->busy.CompareExchange (0, 1) != 0)
+				SystemTimer->WaitDuration (STFLoPrec32BitDuration (1));
+
+			for (j = 0;  j < magazine->numBlocks;  j++)
+				UpdateFreeBlockMap (magazine->blocks[j] - poolBlocks, 1, true);
+			magazine->numBlocks = 0;
+
+			magazine->busy = 0;
+			}
+		}
+	}
+
+
+void VirtualLinearMemoryPool::ResetMagazines (void)
+	{
+	uint32	i;
+
+	for (i = 0;  i < numMagazines;  i++)
+		{
+		magazines[i].owner = NULL;
+		magazines[i].busy = 0;
+		magazines[i].numBlocks = 0;
+		}
+
+	waitingThreads = 0;
+	}
+
+
+STFResult VirtualLinearMemoryPool::GetMemoryBlocks (VDRMemoryBlock ** blocks, uint32 minWait, uint32 number, uint32 &done, IVDRDataHolder * holder)
+	{
+	uint32				i, j, end;
 	uint32				blocksObtained;
 	uint32				clusterSize = this->clusterSize;
+	BlockMagazine	*	magazine;
+	bool					drained = false;
+	bool					waiting = false;
 
 	assert (poolBlocks != NULL);   // the virtual unit must be active
 
 	if (minWait > number)
 		minWait = number;
 
-	//??? This implementation is not optimal, but only a first approach. We sequentially select
-	// free blocks, starting from the last end position of the previous search.
+	// Serve the request from the magazine of the current thread if possible. The magazine is refilled
+	// from the pool in one go. No blocks are cached while other threads are waiting for blocks.
+	if (magazines  &&  clusterSize == 1  &&  number > 0  &&  number <= magazineSize  &&  (int32)waitingThreads == 0  &&
+		 (magazine = LockThreadMagazine ()) != NULL)
+		{
+		if (magazine->numBlocks < number)
+			{
+			getMutex.Enter ();
+
+			i = nextSearchPosition;
+			j = FindFreeBlocks (magazine->blocks + magazine->numBlocks, magazineSize - magazine->numBlocks, i);
+			ClaimBlocks (magazine->blocks + magazine->numBlocks, j);
+			nextSearchPosition = i;
+			magazine->numBlocks += j;
+
+			getMutex.Leave ();
+			}
+
+		if (magazine->numBlocks > 0  &&  magazine->numBlocks >= minWait)
+			{
+			// Hand out the most recently returned blocks first
+			done = magazine->numBlocks < number ? magazine->numBlocks : number;
+
+			MemoryPoolBlock **p = (MemoryPoolBlock **)blocks;
+			for (i = 0;  i < done;  i++)
+				{
+				p[i] = magazine->blocks[--magazine->numBlocks];
+				p[i]->size = blockSize;
+				p[i]->clusters = 1;
+				p[i]->SetInitialCounter (holder);
+				}
+
+			magazine->busy = 0;
+			STFRES_RAISE_OK;
+			}
+
+		// Leave the blocks to the pool search below, which might drain the magazines
+		magazine->busy = 0;
+		}
+
+	// We select free blocks from the free block map, starting from the last end position of
+	// the previous search. Returned blocks are marked in the map without taking the mutex.
 	while (number > 0)
 		{
 		getMutex.Enter ();
@@ -156,27 +414,9 @@ STFResult VirtualLinearMemoryPool::GetMemoryBlocks (VDRMemoryBlock ** blocks, ui
 		if (clusterSize == 1)
 			{
 			// Non-clustered mode. First pass: Find the available blocks.
-			while (blocksObtained < number  &&  i < numBlocks)
-				{
-				b = &poolBlocks[i];
-				if (b->counter == -1)
-					blocks[blocksObtained++] = b;   // free block available
-				i++;
-				}
-			if (blocksObtained < number)
-				{
-				// End of array reached, but not enough blocks yet. Wrap-around to the beginning of the array.
-				i = 0;
-				while (blocksObtained < number  &&  i < nextSearchPosition)
-					{
-					b = &poolBlocks[i];
-					if (b->counter == -1)
-						blocks[blocksObtained++] = b;   // free block available
-					i++;
-					}
-				}
+			blocksObtained = FindFreeBlocks ((MemoryPoolBlock **)blocks, number, i);
 
-			if (blocksObtained >= minWait)
+			if (blocksObtained >= minWait  &&  (blocksObtained > 0  ||  drained  ||  !magazines))
 				{
 				// We have all the blocks or we do not wait for them to become available.
 				nextSearchPosition = i;
@@ -185,6 +425,7 @@ STFResult VirtualLinearMemoryPool::GetMemoryBlocks (VDRMemoryBlock ** blocks, ui
 
 				// Second pass: Set the reference counters to one.
 				MemoryPoolBlock **p = (MemoryPoolBlock **)blocks;
+				ClaimBlocks (p, blocksObtained);
 				for (i = 0;  i < blocksObtained;  i++)
 					{
 					p[i]->size = blockSize;
@@ -195,60 +436,49 @@ STFResult VirtualLinearMemoryPool::GetMemoryBlocks (VDRMemoryBlock ** blocks, ui
 				if (done == 0) allocationFailed = true;
 
 				getMutex.Leave ();
+
+				if (waiting)
+					waitingThreads--;
+
 				STFRES_RAISE_OK;   // done
 				}
 			}
 		else
 			{
-			// Clustered pool allocator mode. First pass: Find the available blocks.
-			// Ask Ulrich Sigmund what this is doing...
-			while (blocksObtained < number && i + clusterSize <= numBlocks)
+			// Clustered pool allocator mode. First pass: Find runs of at least clusterSize free blocks.
+			end = numBlocks;
+			while (blocksObtained < number  &&  (i = FindBlock (i, end, true)) + clusterSize <= end)
 				{
-				b = &poolBlocks[i];
-				
-				j = clusterSize;
-				while (j > 0 && b[j-1].counter == -1)
-					j--;
-
-				if (j == 0)
-					{
-					blocks[blocksObtained++] = b;
-					i += clusterSize;
-					}
-				else
-					i += j;
+				// Skip behind the first used block if the run is too short
+				j = FindBlock (i, i + clusterSize, false);
+				if (j == i + clusterSize)
+					blocks[blocksObtained++] = &poolBlocks[i];
+				i = j;
 				}
 
 			if (blocksObtained < number)
 				{
 				i = 0;
-				while (blocksObtained < number && i + clusterSize <= nextSearchPosition)
+				end = nextSearchPosition;
+				while (blocksObtained < number  &&  (i = FindBlock (i, end, true)) + clusterSize <= end)
 					{
-					b = &poolBlocks[i];
-					
-					j = clusterSize;
-					while (j > 0 && b[j-1].counter == -1)
-						j--;
-
-					if (j == 0)
-						{
-						blocks[blocksObtained++] = b;
-						i += clusterSize;
-						}
-					else
-						i += j;
+					j = FindBlock (i, i + clusterSize, false);
+					if (j == i + clusterSize)
+						blocks[blocksObtained++] = &poolBlocks[i];
+					i = j;
 					}
 				}
 
 			if (blocksObtained >= minWait)
 				{
 				// We have all the blocks or we do not wait for them to become available.
-				nextSearchPosition = i;
+				nextSearchPosition = i < numBlocks ? i : 0;
 
 				done = blocksObtained;
 
 				// Second pass: Set the reference counters to one.
 				MemoryPoolBlock **p = (MemoryPoolBlock **)blocks;
+				ClaimBlocks (p, blocksObtained);
 				for (i = 0;  i < blocksObtained;  i++)
 					{
 					p[i]->clusters = clusterSize;
@@ -270,8 +500,27 @@ STFResult VirtualLinearMemoryPool::GetMemoryBlocks (VDRMemoryBlock ** blocks, ui
 		// When we get here, we have searched the array once, but not enough blocks were available.
 		getMutex.Leave ();
 
+		if (magazines  &&  clusterSize == 1)
+			{
+			// Take back the blocks cached by other threads before waiting. Returned blocks are not
+			// cached anymore until the waiting threads are served.
+			if (minWait > 0  &&  !waiting)
+				{
+				waitingThreads++;
+				waiting = true;
+				}
+
+			if (!drained)
+				{
+				DrainMagazines ();
+				drained = true;
+				continue;
+				}
+			}
+
 		// Wait until enough blocks are available.
 		waitSemaphore.Wait ();
+		drained = false;
 		}
 
 	STFRES_RAISE_OK;
@@ -284,16 +533,50 @@ STFResult VirtualLinearMemoryPool::GetMemoryBlocks (VDRMemoryBlock ** blocks, ui
 STFResult VirtualLinearMemoryPool::ReturnMemoryBlocks (VDRMemoryBlock ** blocks, uint32 number)
 	{
 	MemoryPoolBlock **b = (MemoryPoolBlock **)blocks;
-	uint32	i, j;
+	BlockMagazine	*	magazine;
+	uint32	i, j, n;
+
+	// Put the blocks into the magazine of the current thread, unless somebody waits for blocks.
+	// When the magazine is full, its older half is returned to the pool.
+	if (magazines  &&  clusterSize == 1  &&  (int32)waitingThreads == 0  &&  !allocationFailed  &&
+		 (magazine = LockThreadMagazine ()) != NULL)
+		{
+		if ((int32)waitingThreads == 0)
+			{
+			for (i = 0;  i < number;  i++)
+				{
+				b[i]->counter = -1;
+
+				if (magazine->numBlocks == magazineSize)
+					{
+					n = (magazineSize + 1) / 2;
+					for (j = 0;  j < n;  j++)
+						UpdateFreeBlockMap (magazine->blocks[j] - poolBlocks, 1, true);
+					for (j = n;  j < magazineSize;  j++)
+						magazine->blocks[j - n] = magazine->blocks[j];
+					magazine->numBlocks -= n;
+					}
+
+				magazine->blocks[magazine->numBlocks++] = b[i];
+				}
 
-	// To forcefully return memory blocks, we just need to force their counters to -1.
-	// The search process will later find the free blocks.
+			magazine->busy = 0;
+			STFRES_RAISE_OK;
+			}
+
+		magazine->busy = 0;
+		}
+
+	// To forcefully return memory blocks, we just need to force their counters to -1
+	// and mark them in the free block map, where the search process will find them.
 	// Note that zero cannot be used because there would be a racing condition if the
 	// Release() call reached zero but did not call ReturnMemoryBlocks() yet.
 	for (i = 0;  i < number;  i++)
 		{
 		for (j = 0; j < b[i]->clusters; j++)
 			b[i][j].counter = -1;
+
+		UpdateFreeBlockMap (b[i] - poolBlocks, b[i]->clusters, true);
 		}
 
 	// Now trigger any waiting GetMemoryBlocks().
@@ -364,6 +647,15 @@ STFResult VirtualLinearMemoryPool::PreemptUnit (uint32 flags)
 		if (poolBlocks == NULL)
 			STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
 
+		// All blocks are free, the bits behind the last block stay cleared
+		delete[] freeBlockMap;
+		freeBlockMap = new STFInterlockedInt[(numBlocks + 31) / 32];
+		if (freeBlockMap == NULL)
+			STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+		UpdateFreeBlockMap (0, numBlocks, true);
+		if (magazines)
+			ResetMagazines ();
+
 		// Initialize the block structures and partition the single memory partition.
 		startAddress = memPartInterface->GetStartAddress ();
 		physicalAddress = memPartInterface->GetPhysicalAddress ();
@@ -388,6 +680,12 @@ STFResult VirtualLinearMemoryPool::PreemptUnit (uint32 flags)
 		delete[] poolBlocks;
 		poolBlocks = NULL;
 
+		delete[] freeBlockMap;
+		freeBlockMap = NULL;
+
+		if (magazines)
+			ResetMagazines ();
+
 		// The single memory partition will now be deallocated in its own class...
 		}
 
@@ -8,6 +8,10 @@
 #include "VDR/Source/Memory/MemoryPoolAllocator.h"
 
 
+/// Limits of the per thread block caches ("magazines")
+#define LINEARMEMORYPOOL_MAX_MAGAZINE_SIZE	32
+#define LINEARMEMORYPOOL_MAX_MAGAZINES			16
+
 
 ////////////////////////////////////////////////////////////////////
 //! LinearMemoryPool implementation.
@@ -16,6 +20,8 @@
 class LinearMemoryPool : public MemoryPoolAllocator
 	{
 	protected:
+		uint32	magazineSize;
+		uint32	numMagazines;
 
 	public:
 		LinearMemoryPool (VDRUID unitID) : MemoryPoolAllocator (unitID) {}
@@ -23,6 +29,11 @@ class LinearMemoryPool : public MemoryPoolAllocator
 	public:
 		// Partial IPhysicalUnit implementation.
 		virtual STFResult CreateVirtual (IVirtualUnit * & unit, IVirtualUnit * parent = NULL, IVirtualUnit * root = NULL);
+
+		/// Without parameters all blocks are taken from and returned to the pool directly.
+		/// Parameter 0 (blocks per magazine) and the optional parameter 1 (number of magazines)
+		/// enable per thread caches of free blocks in front of the pool.
+		virtual STFResult Create (uint64 * createParams);
 	};
 
 
@@ -38,8 +49,38 @@ class VirtualLinearMemoryPool : public VirtualMemoryPoolAllocator
 		volatile uint32	nextSearchPosition;
 		volatile	bool		allocationFailed;
 
+		// One bit per block, set while the block is free. Bits are only cleared with getMutex
+		// held, but set without it when blocks are returned.
+		STFInterlockedInt	*freeBlockMap;
+
+		uint32 FindBlock (uint32 position, uint32 end, bool free);
+		uint32 FindFreeBlocks (MemoryPoolBlock ** blocks, uint32 number, uint32 & position);
+		void UpdateFreeBlockMap (uint32 position, uint32 number, bool free);
+		void ClaimBlocks (MemoryPoolBlock ** blocks, uint32 number);
+
+		// A magazine caches free blocks for one thread, it is filled from and emptied to the pool
+		// in bulk. Blocks in a magazine are marked as used in the free block map, but their counters
+		// are -1. A magazine is only accessed while its busy flag could be set, so other threads
+		// (and interrupts) can drain it, or fall back to the pool if it is in use.
+		struct BlockMagazine
+			{
+			STFInterlockedPointer	owner;		// Thread using the magazine, NULL while unassigned
+			STFInterlockedInt			busy;
+			uint32						numBlocks;
+			MemoryPoolBlock		*	blocks[LINEARMEMORYPOOL_MAX_MAGAZINE_SIZE];
+			};
+
+		BlockMagazine		*magazines;
+		uint32				magazineSize;
+		uint32				numMagazines;
+		STFInterlockedInt	waitingThreads;		// Threads waiting for blocks, returns bypass the magazines meanwhile
+
+		BlockMagazine * LockThreadMagazine (void);
+		void DrainMagazines (void);
+		void ResetMagazines (void);
+
 	public:
-		VirtualLinearMemoryPool (MemoryPoolAllocator * physicalUnit);
+		VirtualLinearMemoryPool (MemoryPoolAllocator * physicalUnit, uint32 magazineSize = 0, uint32 numMagazines = 0);
 		virtual ~VirtualLinearMemoryPool (void);
 
 	public:
@@ -81,9 +81,19 @@ VirtualMPEGVideoDecoderUnit::VirtualMPEGVideoDecoderUnit(MPEGVideoDecoderUnit *
 														  3,	// Number of output packets in output connector,
 														  4,	// Input connector queue size,
 														  0,	// Input connector threshold,
-														  "MPEGVideoDecoder")	// Thread ID name,
+														  "MPEGVideoDecoder"),	// Thread ID name,
+	  streamingOutputPool(this, 0)
 	{
 	this->physicalMPEGVideoDecoder = physicalMPEGVideoDecoder;
+
+	for (int i = 0; i < MPEG2_NUM_FRAME_BUFFERS; i++)
+		frameBlocks[i] = NULL;
+
+	decodeState = MPEGVIDEO_DECODE_IDLE;
+	frameBuffersNeeded = 0;
+
+	// Decoding suspends instead of blocking when the output is full, so the unit can share the executor workers
+	UseStreamingUnitExecutor(this);
 	}
 
 
@@ -126,6 +136,9 @@ STFResult VirtualMPEGVideoDecoderUnit::AllocateChildUnits (void)
 	STFRES_REASSERT(outputPoolAllocatorVU->ActivateAndLock((VDRUALF_REALTIME_PRIORITY | VDRUALF_WAIT),
 		STFHiPrec64BitTime(), STFHiPrec32BitDuration(0)));
 
+	// Get notified when blocks return to the pool after an allocation failed
+	STFRES_REASSERT(streamingOutputPool.SetAllocator(outputPoolAllocator));
+
 	STFRES_RAISE_OK;
 	}
 
@@ -139,6 +152,78 @@ STFResult VirtualMPEGVideoDecoderUnit::PrepareDecoder()
 	STFRES_RAISE_OK;
 	}
 
+STFResult VirtualMPEGVideoDecoderUnit::SetFrameBuffer(void)
+	{
+	VDRMemoryBlock * block;
+	uint8_t * buf[3];
+	uint32 slot;
+
+	for (slot = 0; slot < MPEG2_NUM_FRAME_BUFFERS && frameBlocks[slot]; slot++) ;
+
+	//
+	// libmpeg2 never holds more than MPEG2_NUM_FRAME_BUFFERS buffers, so running out of
+	// slots is a bookkeeping error. Waiting would not free a slot, so fail instead.
+	//
+	if (slot == MPEG2_NUM_FRAME_BUFFERS)
+		{
+		DP("MPEGVideoDecoder: no free frame buffer slot\n");
+		STFRES_RAISE(STFRES_OBJECT_INVALID);
+		}
+
+	STFRES_REASSERT(streamingOutputPool.GetMemoryBlocks(&block, 1, numObtainedBlocks));
+	if (numObtainedBlocks == 0)
+		STFRES_RAISE(STFRES_OBJECT_FULL);
+
+	//
+	// The picture is decoded straight into the pool block, with the Y, U and V planes
+	// following each other, so that it can be delivered without a copy
+	//
+	buf[0] = (uint8_t *) ALIGN_16(block->GetStart());
+	buf[1] = buf[0] + ysize;
+	buf[2] = buf[1] + uvsize;
+
+	if (buf[2] + uvsize > block->GetStart() + block->GetSize())
+		{
+		DP("MPEGVideoDecoder: memory block too small for a %d x %d picture\n", width, height);
+		block->Release(this);
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+		}
+
+	frameBlocks[slot] = block;
+	mpeg2_set_buf (decoder, buf, block);
+
+	STFRES_RAISE_OK;
+	}
+
+
+void VirtualMPEGVideoDecoderUnit::DiscardFrameBuffer(VDRMemoryBlock * block)
+	{
+	for (int i = 0; i < MPEG2_NUM_FRAME_BUFFERS; i++)
+		{
+		if (frameBlocks[i] == block)
+			{
+			// Delivered pictures keep their block alive through the references of the packets
+			frameBlocks[i] = NULL;
+			block->Release(this);
+			return;
+			}
+		}
+	}
+
+
+void VirtualMPEGVideoDecoderUnit::ReleaseFrameBuffers(void)
+	{
+	for (int i = 0; i < MPEG2_NUM_FRAME_BUFFERS; i++)
+		{
+		if (frameBlocks[i])
+			{
+			frameBlocks[i]->Release(this);
+			frameBlocks[i] = NULL;
+			}
+		}
+	}
+
+
 STFResult VirtualMPEGVideoDecoderUnit::DecodeData(const VDRDataRange & range, uint32 & offset)
 	{
 	uint8_t * buffer;
@@ -150,18 +235,62 @@ STFResult VirtualMPEGVideoDecoderUnit::DecodeData(const VDRDataRange & range, ui
 		PrepareDecoder();
 		}
 
-	buffer = range.GetStart() + offset;
-	end = buffer + range.size - offset;
+	//
+	// When resuming after the output was blocked, libmpeg2 still holds the
+	// position inside the range, so it must not be given the data again
+	//
+	if (decodeState == MPEGVIDEO_DECODE_IDLE)
+		{
+		buffer = range.GetStart() + offset;
+		end = buffer + range.size - offset;
 
-	mpeg2_buffer (decoder, buffer, end);
+		mpeg2_buffer (decoder, buffer, end);
+		decodeState = MPEGVIDEO_DECODE_PARSE;
+		}
 
 	while (!flushRequest)
 		{
+		//
+		// Complete what the last mpeg2_parse() asked for. Without a memory block or room
+		// at the output we return OBJECT_FULL, the input packet is kept pending and the
+		// thread continues here when a packet is returned or the output pool has blocks
+		// available again.
+		//
+		switch (decodeState)
+			{
+			case MPEGVIDEO_DECODE_SET_FRAME_BUFFERS:
+				while (frameBuffersNeeded > 0)
+					{
+					res = SetFrameBuffer();
+					if (res != STFRES_OK)
+						STFRES_RAISE(SuspendDecoding(res));
+					frameBuffersNeeded--;
+					}
+				break;
+			case MPEGVIDEO_DECODE_DELIVER_PICTURE:
+				if (info->display_fbuf)
+					{
+					// picture ready.
+					res = DeliverData();
+					if (res != STFRES_OK)
+						STFRES_RAISE(SuspendDecoding(res));
+					}
+				if (info->discard_fbuf)
+					{
+					DiscardFrameBuffer((VDRMemoryBlock *)info->discard_fbuf->id);
+					}
+				break;
+			default:
+				break;
+			}
+
+		decodeState = MPEGVIDEO_DECODE_PARSE;
+
 		state = mpeg2_parse (decoder);
 		switch (state)
 			{
 			case STATE_BUFFER:
-				mpeg2_buffer (decoder, buffer, end);
+				decodeState = MPEGVIDEO_DECODE_IDLE;
 				STFRES_RAISE_OK;
 				break;
 			case STATE_SEQUENCE:
@@ -230,48 +359,25 @@ STFResult VirtualMPEGVideoDecoderUnit::DecodeData(const VDRDataRange & range, ui
 				seqHeaderExtInfo.horizontalChromaSize = info->sequence->chroma_width;
 				seqHeaderExtInfo.verticalChromaSize = info->sequence->chroma_height;
 
+				// Frame buffers of a previous sequence are not used for prediction anymore
+				ReleaseFrameBuffers();
+
+				// libmpeg2 decodes into memory blocks of the output pool
 				mpeg2_custom_fbuf (decoder, 1);
-				for (int i = 0; i < 3; i++)
-					{
-					// For every frame buffer, allocate memory for y, u and v
-					fbuf[i].mbuf[0] = (uint8_t *) malloc(info->sequence->width*info->sequence->height + 15);
-					fbuf[i].mbuf[1] = (uint8_t *) malloc(info->sequence->chroma_width*info->sequence->chroma_height + 15);
-					fbuf[i].mbuf[2] = (uint8_t *) malloc(info->sequence->chroma_width*info->sequence->chroma_height + 15);
-					for (int j = 0; j < 3; j++)
-						{
-						fbuf[i].yuv[j] = (uint8_t*) ALIGN_16(fbuf[i].mbuf[j]);
-						}
-					fbuf[i].used = 0;
-					}
-				for (int i = 0; i < 2; i++)
-					{
-					current_fbuf = get_fbuf ();
-					mpeg2_set_buf (decoder, current_fbuf->yuv, current_fbuf);
-					}
 				mpeg2_skip (decoder, 0);
+				frameBuffersNeeded = 2;
+				decodeState = MPEGVIDEO_DECODE_SET_FRAME_BUFFERS;
 				break;
 			case STATE_PICTURE:
-				VirtualMPEGVideoDecoderUnit::current_fbuf = get_fbuf();
-				mpeg2_set_buf (decoder, VirtualMPEGVideoDecoderUnit::current_fbuf->yuv,
-					VirtualMPEGVideoDecoderUnit::current_fbuf);
+				frameBuffersNeeded = 1;
+				decodeState = MPEGVIDEO_DECODE_SET_FRAME_BUFFERS;
 				break;
 			case STATE_END:
 				// Intended fallthrough.
 			case STATE_INVALID_END:
 				// Intended fallthrough.
 			case STATE_SLICE:
-				if (info->display_fbuf)
-					{
-					// picture ready.
-					//STFRES_REASSERT(DeliverData());
-					res =  DeliverData();
-					while (res != STFRES_OK)
-						res =  DeliverData();
-					}
-				if (info->discard_fbuf)
-					{
-					((struct fbuf_s *)info->discard_fbuf->id)->used = 0;
-					}
+				decodeState = MPEGVIDEO_DECODE_DELIVER_PICTURE;
 				break;
 			default:
 				break;
@@ -281,6 +387,49 @@ STFResult VirtualMPEGVideoDecoderUnit::DecodeData(const VDRDataRange & range, ui
 	}
 
 
+STFResult VirtualMPEGVideoDecoderUnit::SuspendDecoding(STFResult result)
+	{
+	//
+	// Output blocked: keep the decode state, so that we continue at the same
+	// point when the thread is signalled again
+	//
+	if (result == STFRES_OBJECT_FULL)
+		STFRES_RAISE(result);
+
+	//
+	// Any other failure leaves libmpeg2 without a frame buffer or a picture
+	// half delivered, so restart with the next sequence header
+	//
+	DP("MPEGVideoDecoder: decoding failed (%08x), waiting for next sequence\n", result);
+	ResetDecoder();
+
+	STFRES_RAISE(result);
+	}
+
+
+void VirtualMPEGVideoDecoderUnit::ResetDecoder(void)
+	{
+	mpeg2_reset (decoder, 1);
+
+	decodeState = MPEGVIDEO_DECODE_IDLE;
+	frameBuffersNeeded = 0;
+	if (deliverState != MPEGVIDEO_DELIVER_SEGMENT_START)
+		deliverState = MPEGVIDEO_DELIVER_BEGIN_GROUP;
+	}
+
+
+STFResult VirtualMPEGVideoDecoderUnit::ProcessFlushing(void)
+	{
+	STFRES_REASSERT(VirtualThreadedStandardInOutStreamingUnitCollection::ProcessFlushing());
+
+	// The pending input was dropped, so libmpeg2 must not continue on it
+	if (InputPending())
+		ResetDecoder();
+
+	STFRES_RAISE_OK;
+	}
+
+
 STFResult VirtualMPEGVideoDecoderUnit::DeliverData()
 	{
 	//
@@ -317,23 +466,16 @@ STFResult VirtualMPEGVideoDecoderUnit::DeliverData()
 			// Deliver start time
 			STFRES_REASSERT(outputFormatter.PutStartTime(presentationTime));
 			startTime += STFHiPrec32BitDuration(40000, STFTU_MICROSECS); //PAL HACK
-			deliverState = MPEGVIDEO_DELIVER_GET_MEMORYBLOCKS;
-
-		case MPEGVIDEO_DELIVER_GET_MEMORYBLOCKS:
-			// picture ready.
-			// Get a memory block from the output formatter
-			STFRES_REASSERT(outputPoolAllocator->GetMemoryBlocks(&memoryBlock, 0, 1, numObtainedBlocks, this));
-			decodedPictureRange[rangeCounter%3].Init(memoryBlock, 0, memoryBlock->GetSize());
-			// memcopy to framebuffer. Note that u and v are reversed to
-			// get the correct color.
-			// Copy the sample into the memoryblock
-			memcpy (decodedPictureRange[rangeCounter%3].block->GetStart(), ((struct fbuf_s *)info->display_fbuf->id)->yuv[0], ysize);
-			memcpy (decodedPictureRange[rangeCounter%3].block->GetStart() + ysize, ((struct fbuf_s *)info->display_fbuf->id)->yuv[1], uvsize);
-			memcpy (decodedPictureRange[rangeCounter%3].block->GetStart() + ysize + uvsize, ((struct fbuf_s *)info->display_fbuf->id)->yuv[2], uvsize);
 			deliverState = MPEGVIDEO_DELIVER_RANGE;
 
 		case MPEGVIDEO_DELIVER_RANGE:
-			STFRES_REASSERT(outputFormatter.PutRange(decodedPictureRange[rangeCounter%3]));
+			// The picture was decoded into a pool block, the packet adds its own reference
+			// so the block stays alive while libmpeg2 still uses it for prediction and
+			// until the picture has been displayed
+			decodedPictureRange.Init((VDRMemoryBlock *)info->display_fbuf->id,
+											 (uint32)(info->display_fbuf->buf[0] - ((VDRMemoryBlock *)info->display_fbuf->id)->GetStart()),
+											 ysize + 2 * uvsize);
+			STFRES_REASSERT(outputFormatter.PutRange(decodedPictureRange));
 			deliverState = MPEGVIDEO_DELIVER_END_TIME;
 
 		case MPEGVIDEO_DELIVER_END_TIME:
@@ -418,6 +560,8 @@ STFResult VirtualMPEGVideoDecoderUnit::PreemptUnit(uint32 flags)
 			assert(0);
 			}
 		info = mpeg2_info (decoder);
+		decodeState = MPEGVIDEO_DECODE_IDLE;
+		frameBuffersNeeded = 0;
 
 		ResetThreadSignal();
 		STFRES_REASSERT(StartThread());
@@ -425,17 +569,12 @@ STFResult VirtualMPEGVideoDecoderUnit::PreemptUnit(uint32 flags)
 
 	if (flags & (VDRUALF_PREEMPT_STOP_PREVIOUS | VDRUALF_PREEMPT_STOP_NEW))
 		{
-		//cleanup
-		mpeg2_close (decoder);
-		for (int i = 0; i < 3; i++)
-			{
-			free (fbuf[i].mbuf[0]);
-			free (fbuf[i].mbuf[1]);
-			free (fbuf[i].mbuf[2]);
-			}
-
 		StopThread();
 		Wait();
+
+		//cleanup, the frame buffers must not be returned while the thread may still decode into them
+		mpeg2_close (decoder);
+		ReleaseFrameBuffers();
 		}
 
 	if (flags & (VDRUALF_PREEMPT_CHANGE | VDRUALF_PREEMPT_RESTORE))
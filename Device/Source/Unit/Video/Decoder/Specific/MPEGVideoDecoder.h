@@ -26,6 +26,9 @@ extern "C"
 
 #define MPEG2_VIDEOTYPE_CHANGED	MKFLAG(0)
 
+/// Number of frame buffers libmpeg2 holds at most at the same time (two reference frames and the current picture)
+#define MPEG2_NUM_FRAME_BUFFERS	3
+
 ///////////////////////////////////////////////////////////////////////////////
 // Streaming Terminator Unit
 ///////////////////////////////////////////////////////////////////////////////
@@ -71,38 +74,30 @@ public:
 // Streaming Unit with an input and an output
 class VirtualMPEGVideoDecoderUnit : public VirtualThreadedStandardInOutStreamingUnitCollection
 	{
-	struct fbuf_s
-		{
-		uint8_t * mbuf[3]; // Unaligned memory buffer pointers
-		uint8_t * yuv[3]; // Aligned memory buffer pointers
-		int used;
-		} fbuf[3]; // Frame buffer structure
-
-	struct fbuf_s * get_fbuf(void)
-		{
-		for (int i = 0; i < 3; i++)
-			if (!fbuf[i].used)
-				{
-				fbuf[i].used = 1;
-				return fbuf + i;
-				}
-		return NULL;
-		}
-
 	enum MPEGVIDEOState
 		{
 		MPEGVIDEO_DELIVER_SEGMENT_START,
 		MPEGVIDEO_DELIVER_BEGIN_GROUP,
 		MPEGVIDEO_DELIVER_START_TIME,
-		MPEGVIDEO_DELIVER_GET_MEMORYBLOCKS,
 		MPEGVIDEO_DELIVER_RANGE,
 		MPEGVIDEO_DELIVER_END_TIME,
 		MPEGVIDEO_DELIVER_GROUP_END
 		} deliverState;
 
+	/// Position of the decoder inside the decoding loop, so that it can return to the
+	/// thread loop while it waits for output resources and resume at the same point
+	enum MPEGVIDEODecodeState
+		{
+		MPEGVIDEO_DECODE_IDLE,					///< Waiting for the next input range
+		MPEGVIDEO_DECODE_PARSE,					///< libmpeg2 has input data to parse
+		MPEGVIDEO_DECODE_SET_FRAME_BUFFERS,	///< libmpeg2 waits for frame buffers
+		MPEGVIDEO_DECODE_DELIVER_PICTURE		///< A picture is ready for display
+		} decodeState;
+
 protected:
 	MPEGVideoDecoderUnit		*physicalMPEGVideoDecoder;
 	IVDRMemoryPoolAllocator	*outputPoolAllocator;
+	StreamingPoolAllocator		streamingOutputPool;	///< Wakes up the thread when blocks are returned to the output pool
 
 	STFHiPrec64BitDuration		currentSystemTimeOffset;
 	STFHiPrec64BitTime			currentStreamTime, systemStartTime;
@@ -118,7 +113,9 @@ protected:
 	int				uvPitch;
 	uint8_t			*frameBuffer;
 	int				width, height, ysize, uvsize, dest_pitch;
-	struct fbuf_s		*current_fbuf;
+
+	/// Memory blocks libmpeg2 decodes into, each holding one reference until libmpeg2 discards it
+	VDRMemoryBlock	*frameBlocks[MPEG2_NUM_FRAME_BUFFERS];
 
 	  //	STFHiPrec64BitTime		startTime;
 	  //	STFHiPrec64BitTime		endTime;
@@ -128,9 +125,9 @@ protected:
 	int segmentCount;
 	uint32 dataPropertiesChanged;
 	uint32 numObtainedBlocks; ///< Number of allocated memory blocks
-	VDRMemoryBlock *memoryBlock;
-	VDRDataRange	decodedPictureRange[3];
+	VDRDataRange	decodedPictureRange;
 	int rangeCounter;
+	int frameBuffersNeeded;	///< Number of frame buffers libmpeg2 still waits for
 	bool preparing;
 	STFHiPrec64BitTime		presentationTime;
 
@@ -138,6 +135,18 @@ protected:
 	virtual STFResult DecodeData(const VDRDataRange & range, uint32 & offset);
 	virtual STFResult DeliverData();
 
+	/// Get a memory block from the output pool and hand it to libmpeg2 as the next frame buffer
+	STFResult SetFrameBuffer(void);
+	/// Drop the reference held for a frame buffer libmpeg2 does not need anymore
+	void DiscardFrameBuffer(VDRMemoryBlock * block);
+	/// Drop the references to all frame buffers still held
+	void ReleaseFrameBuffers(void);
+
+	/// Handle a failure inside the decoding loop, OBJECT_FULL suspends decoding until the output can take more data
+	STFResult SuspendDecoding(STFResult result);
+	/// Drop the current decoding position and wait for the next sequence header
+	void ResetDecoder(void);
+
 	//
 	// IVirtualUnit
 	//
@@ -183,7 +192,9 @@ protected:
 	}
 	  */
 	/// Returns if input data is currently being used for processing.
-	virtual bool InputPending(void) {return false;}
+	virtual bool InputPending(void) {return decodeState != MPEGVIDEO_DECODE_IDLE;}
+
+	virtual STFResult ProcessFlushing(void);
 
 public:
 	/// Specific constructor.
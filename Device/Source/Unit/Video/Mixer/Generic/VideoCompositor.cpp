@@ -0,0 +1,1878 @@
+///
+/// @brief      Software Video Compositor for YCbCr 4:2:0 frames
+///
+
+#include "VideoCompositor.h"
+#include "VideoPlaneBlender.h"
+#include "VDR/Source/Construction/IUnitConstruction.h"
+#include "VDR/Source/Unit/ITagUnit.h"
+#include "STF/Interface/STFDebug.h"
+
+#include <string.h>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Rectangle helpers
+///////////////////////////////////////////////////////////////////////////////
+
+static inline bool IsRectEmpty(const VDRGfxRect & rect)
+	{
+	return rect.left >= rect.right || rect.top >= rect.bottom;
+	}
+
+
+static inline void SetRect(VDRGfxRect & rect, int32 left, int32 top, int32 right, int32 bottom)
+	{
+	rect.left	= left;
+	rect.top		= top;
+	rect.right	= right;
+	rect.bottom	= bottom;
+	}
+
+
+static void IntersectRect(VDRGfxRect & rect, const VDRGfxRect & other)
+	{
+	if (other.left > rect.left)		rect.left = other.left;
+	if (other.top > rect.top)			rect.top = other.top;
+	if (other.right < rect.right)		rect.right = other.right;
+	if (other.bottom < rect.bottom)	rect.bottom = other.bottom;
+	}
+
+
+static void UniteRect(VDRGfxRect & rect, const VDRGfxRect & other)
+	{
+	if (IsRectEmpty(other))
+		return;
+
+	if (IsRectEmpty(rect))
+		{
+		rect = other;
+		return;
+		}
+
+	if (other.left < rect.left)		rect.left = other.left;
+	if (other.top < rect.top)			rect.top = other.top;
+	if (other.right > rect.right)		rect.right = other.right;
+	if (other.bottom > rect.bottom)	rect.bottom = other.bottom;
+	}
+
+
+static inline bool ContainsRect(const VDRGfxRect & rect, const VDRGfxRect & other)
+	{
+	return IsRectEmpty(other) ||
+			 (other.left >= rect.left && other.top >= rect.top && other.right <= rect.right && other.bottom <= rect.bottom);
+	}
+
+
+///
+/// Get a rectangle inside a bitmap, the whole bitmap if no rectangle is given
+///
+static void ClipBitmapRect(VDRGfxRect & clipped, const VDRGfxRect * rect, VideoCompositorBitmap * bitmap)
+	{
+	VDRGfxRect	bounds;
+
+	SetRect(bounds, 0, 0, bitmap->GetWidth(), bitmap->GetHeight());
+
+	if (rect)
+		{
+		clipped = *rect;
+		IntersectRect(clipped, bounds);
+		}
+	else
+		clipped = bounds;
+	}
+
+
+///
+/// Fill a rectangle of a bitmap, the rectangle must be inside the bitmap
+///
+static void FillBitmapRect(VideoCompositorBitmap * bitmap, const VDRGfxRect & rect, VDRGfxColor color)
+	{
+	uint32	*	line;
+	int32			x, y;
+
+	for (y = rect.top; y < rect.bottom; y++)
+		{
+		line = bitmap->GetLine(y);
+		for (x = rect.left; x < rect.right; x++)
+			line[x] = color;
+		}
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Video Compositor Bitmap
+///////////////////////////////////////////////////////////////////////////////
+
+VideoCompositorBitmap::VideoCompositorBitmap(void)
+	{
+	memset(&desc, 0, sizeof(desc));
+	allocatedWidth		= 0;
+	allocatedHeight	= 0;
+
+	memory.bitmap	= this;
+	memory.start	= NULL;
+	memory.size		= 0;
+	}
+
+
+VideoCompositorBitmap::~VideoCompositorBitmap(void)
+	{
+	delete[] memory.start;
+	}
+
+
+STFResult VideoCompositorBitmap::Allocate(int32 width, int32 height, VDRGfxColorFormat colorFormat)
+	{
+	// The pitch of the bitmap must fit into the description
+	if (colorFormat != VDR_AYCbCr8888 || width <= 0 || height <= 0 || width > 0xffff / 4 || height > 0xffff)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	memory.size		= (uint32)width * (uint32)height * 4;
+	memory.start	= new uint8[memory.size];
+
+	if (!memory.start)
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+
+	// New bitmaps are fully transparent
+	memset(memory.start, 0, memory.size);
+
+	desc.width			= (uint16)width;
+	desc.height			= (uint16)height;
+	desc.pitch			= (uint16)(width * 4);
+	desc.pitch23		= 0;
+	desc.colorFormat	= colorFormat;
+	desc.flags			= 0;
+
+	allocatedWidth		= desc.width;
+	allocatedHeight	= desc.height;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VideoCompositorBitmap::QueryInterface(VDRIID iid, void *& ifp)
+	{
+	VDRQI_BEGIN
+		VDRQI_IMPLEMENT(VDRIID_VDR_GFX_BITMAP, IVDRGfxBitmap);
+		VDRQI_IMPLEMENT(VDRIID_VIDEO_COMPOSITOR_BITMAP, VideoCompositorBitmap);
+	VDRQI_END(VDRBase);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VideoCompositorBitmap::GetBitmapDesc(VDRGfxBitmapDesc* bmpDesc)
+	{
+	if (!bmpDesc)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	*bmpDesc = desc;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VideoCompositorBitmap::GetBitmapPixels(VDRGfxBitmapPixels* bmpPix)
+	{
+	if (!bmpPix)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	bmpPix->pixels.Init(&memory, 0, (uint32)desc.pitch * desc.height);
+	bmpPix->pixels2.Init(NULL, 0, 0);
+	bmpPix->pixels3.Init(NULL, 0, 0);
+	bmpPix->clut.Init(NULL, 0, 0);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VideoCompositorBitmap::SetBitmapDesc(VDRGfxBitmapDesc* bmpDesc)
+	{
+	// The bitmap can only be reduced within its pixel memory, keeping format and pitch
+	if (!bmpDesc || bmpDesc->colorFormat != desc.colorFormat ||
+		 bmpDesc->width > allocatedWidth || bmpDesc->height > allocatedHeight)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	desc.width	= bmpDesc->width;
+	desc.height	= bmpDesc->height;
+	desc.flags	= bmpDesc->flags;
+
+	STFRES_RAISE_OK;
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Video Compositor Input Node
+///////////////////////////////////////////////////////////////////////////////
+
+VideoCompositorInputNode::VideoCompositorInputNode(void)
+	{
+	queueHead			= 0;
+	queueTail			= 0;
+	current				= NULL;
+	forcedRendering	= false;
+	inputTimeValid		= false;
+	inputFrames			= 0;
+	starving				= false;
+	inputState			= MIS_ON;
+	pendingInputState	= MIS_ON;
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Physical Video Compositor
+///////////////////////////////////////////////////////////////////////////////
+
+UNIT_CREATION_FUNCTION(CreateVideoCompositor, VideoCompositorUnit)
+
+
+STFResult VideoCompositorUnit::CreateVirtual(IVirtualUnit * & unit, IVirtualUnit * parent, IVirtualUnit * root)
+	{
+	unit = (IVirtualUnit*)(new VirtualVideoCompositorUnit(this));
+
+	if (unit)
+		{
+		STFRES_REASSERT(unit->Connect(parent, root));
+		}
+	else
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+
+	STFRES_RAISE_OK;
+	}
+
+
+// Creation parameters:
+// 0: output width in pixels
+// 1: output height in lines
+// 2: duration of one output frame in microseconds
+STFResult VideoCompositorUnit::Create(uint64 * createParams)
+	{
+	STFRES_REASSERT(GetDWordParameter(createParams, 0, width));
+	STFRES_REASSERT(GetDWordParameter(createParams, 1, height));
+	STFRES_REASSERT(GetDWordParameter(createParams, 2, frameDuration));
+
+	// The chroma planes are subsampled by two in both directions
+	if (width == 0 || height == 0 || (width & 1) || (height & 1) || frameDuration == 0)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VideoCompositorUnit::Connect(uint64 localID, IPhysicalUnit * source)
+	{
+	// The video compositor does not use other units
+	STFRES_RAISE(STFRES_RANGE_VIOLATION);
+	}
+
+
+STFResult VideoCompositorUnit::Initialize(uint64 * depUnitsParams)
+	{
+	STFRES_RAISE_OK;
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Virtual Video Compositor
+///////////////////////////////////////////////////////////////////////////////
+
+VirtualVideoCompositorUnit::VirtualVideoCompositorUnit(VideoCompositorUnit * physicalCompositor) : VirtualUnit(physicalCompositor)
+	{
+	uint32	i;
+
+	this->physicalCompositor = physicalCompositor;
+
+	width		= physicalCompositor->width;
+	height	= physicalCompositor->height;
+
+	for (i = 0; i < VIDEOCOMPOSITOR_MAX_OUTPUTS; i++)
+		{
+		outputAllocators[i]	= NULL;
+		outputTagsPending[i]	= true;
+		}
+	numOutputs		= 0;
+	outputEnabled	= true;
+
+	frameDuration	= STFHiPrec64BitDuration(STFInt64(physicalCompositor->frameDuration), STFTU_MICROSECS);
+	mixFrameNumber	= 0;
+
+	// Without main video, frames of the output size are generated
+	memset(&outputFormat, 0, sizeof(outputFormat));
+	outputFormat.horizontalSize			= (uint16)width;
+	outputFormat.verticalSize				= (uint16)height;
+	outputFormat.horizontalChromaSize	= (uint16)(width / 2);
+	outputFormat.verticalChromaSize		= (uint16)(height / 2);
+	outputFormat.progressiveSequence		= true;
+	outputFormat.chromaFormat				= 1;
+	outputFormat.frameRateExtensionN		= (1000000 + physicalCompositor->frameDuration / 2) / physicalCompositor->frameDuration;
+	outputFormat.frameRateExtensionD		= 1;
+
+	memset(&mainFormat, 0, sizeof(mainFormat));
+	mainFormatValid = false;
+
+	for (i = 0; i < VIDEOCOMPOSITOR_NUM_MIXER_INPUTS; i++)
+		{
+		layers[i].enabled	= true;
+		layers[i].alpha	= 255;
+		layers[i].zOrder	= (uint8)i;
+		}
+	// The cursor is on top of everything by default
+	layers[VDR_VMIX_IN_CURSOR].zOrder = VIDEOCOMPOSITOR_NUM_MIXER_INPUTS;
+
+	// Black
+	backgroundY		= 16;
+	backgroundCb	= 128;
+	backgroundCr	= 128;
+
+	SetRect(subpictureBounds, 0, 0, 0, 0);
+	subpictureVisible = false;
+
+	numDisplayBitmaps	= 0;
+	numPendingBitmaps	= 0;
+	cursorBitmap		= NULL;
+	SetRect(cursorSrcRect, 0, 0, 0, 0);
+	SetRect(cursorDestRect, 0, 0, 0, 0);
+
+	overlayY					= new uint8[width * height];
+	overlayAlpha			= new uint8[width * height];
+	overlayCb				= new uint8[width * height / 4];
+	overlayCr				= new uint8[width * height / 4];
+	overlayChromaAlpha	= new uint8[width * height / 4];
+
+	if (overlayY && overlayAlpha && overlayCb && overlayCr && overlayChromaAlpha)
+		{
+		memset(overlayY, 0, width * height);
+		memset(overlayAlpha, 0, width * height);
+		memset(overlayCb, 0, width * height / 4);
+		memset(overlayCr, 0, width * height / 4);
+		memset(overlayChromaAlpha, 0, width * height / 4);
+		}
+
+	SetRect(overlayDirty, 0, 0, 0, 0);
+	SetRect(overlayBounds, 0, 0, 0, 0);
+	}
+
+
+VirtualVideoCompositorUnit::~VirtualVideoCompositorUnit(void)
+	{
+	uint32	i;
+
+	for (i = 0; i < VCSI_NUM_INPUTS; i++)
+		{
+		while (inputNodes[i].queueTail != inputNodes[i].queueHead)
+			ReleaseTailPacket(&inputNodes[i]);
+		ReleaseCurrentPacket(&inputNodes[i]);
+		}
+
+	ReleaseDisplayBitmaps(displayBitmaps, numDisplayBitmaps);
+	ReleaseDisplayBitmaps(pendingBitmaps, numPendingBitmaps);
+	if (cursorBitmap)
+		cursorBitmap->Release();
+
+	delete[] overlayY;
+	delete[] overlayAlpha;
+	delete[] overlayCb;
+	delete[] overlayCr;
+	delete[] overlayChromaAlpha;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::QueryInterface(VDRIID iid, void *& ifp)
+	{
+	VDRQI_BEGIN
+		VDRQI_IMPLEMENT(VDRIID_FRAME_MIXER, IFrameMixer);
+		VDRQI_IMPLEMENT(VDRIID_VDR_VIDEO_MIXER, IVDRVideoMixer);
+		VDRQI_IMPLEMENT(VDRIID_VDR_GRAPHICS_2D, IVDRGraphics2D);
+	VDRQI_END(VirtualUnit);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::GetCompositorInputNode(uint32 inputID, VideoCompositorInputNode * & node)
+	{
+	if (inputID >= VCSI_NUM_INPUTS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	node = &inputNodes[inputID];
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::GetCompositorBitmap(IVDRGfxBitmap * bmp, VideoCompositorBitmap * & bitmap)
+	{
+	void	*	ifp;
+
+	if (!bmp)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	// Only bitmaps created by the compositor can be drawn
+	if (STFRES_FAILED(bmp->QueryInterface(VDRIID_VIDEO_COMPOSITOR_BITMAP, ifp)))
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	bitmap = (VideoCompositorBitmap *)ifp;
+	bitmap->Release();
+
+	STFRES_RAISE_OK;
+	}
+
+
+void VirtualVideoCompositorUnit::ReleaseTailPacket(VideoCompositorInputNode * node)
+	{
+	StreamingDataPacket	*	packet = node->queue[node->queueTail % VIDEOCOMPOSITOR_INPUT_QUEUE_SIZE];
+
+	packet->ReleaseRanges();
+	packet->ReturnToOrigin();
+
+	node->queueTail++;
+
+	// A queue entry is free again, so an input that was refused may send again
+	if (node->packetBounced)
+		{
+		node->packetBounced = false;
+		node->packetRequest = true;
+		}
+	}
+
+
+void VirtualVideoCompositorUnit::ReleaseCurrentPacket(VideoCompositorInputNode * node)
+	{
+	if (node->current)
+		{
+		node->current->ReleaseRanges();
+		node->current->ReturnToOrigin();
+		node->current = NULL;
+		}
+	}
+
+
+bool VirtualVideoCompositorUnit::AdvanceInput(VideoCompositorInputNode * node)
+	{
+	StreamingDataPacket	*	packet;
+	TAG						*	tags;
+	uint32						i;
+
+	if (node->queueTail == node->queueHead)
+		return false;
+
+	ReleaseCurrentPacket(node);
+
+	packet = node->queue[node->queueTail % VIDEOCOMPOSITOR_INPUT_QUEUE_SIZE];
+	node->queueTail++;
+	node->current = packet;
+
+	if (node->packetBounced)
+		{
+		node->packetBounced = false;
+		node->packetRequest = true;
+		}
+
+	if (packet->vdrPacket.flags & VDR_MSMF_TAGS_VALID)
+		{
+		tags = (TAG *)packet->vdrPacket.tagRanges.tags;
+
+		for (i = 0; i < packet->vdrPacket.numTags && tags[i].id; i++)
+			{
+			if (tags[i].id == CSET_STREAM_FORCED_RENDERING)
+				node->forcedRendering = VAL_STREAM_FORCED_RENDERING(&tags[i]);
+			}
+		}
+
+	return true;
+	}
+
+
+void VirtualVideoCompositorUnit::ParseMainFrameTags(StreamingDataPacket * packet)
+	{
+	TAG	*	tags;
+	uint32	i;
+
+	if (!(packet->vdrPacket.flags & VDR_MSMF_TAGS_VALID))
+		return;
+
+	tags = (TAG *)packet->vdrPacket.tagRanges.tags;
+
+	for (i = 0; i < packet->vdrPacket.numTags && tags[i].id; i++)
+		{
+		if (tags[i].id == CSET_MPEG_VIDEO_SEQUENCE_PARAMETERS && VAL_MPEG_VIDEO_SEQUENCE_PARAMETERS(&tags[i]))
+			{
+			mainFormat = *VAL_MPEG_VIDEO_SEQUENCE_PARAMETERS(&tags[i]);
+			mainFormatValid = true;
+			}
+		}
+	}
+
+
+void VirtualVideoCompositorUnit::InvalidateOverlay(const VDRGfxRect & rect)
+	{
+	VDRGfxRect	area;
+
+	SetRect(area, 0, 0, width, height);
+	IntersectRect(area, rect);
+
+	UniteRect(overlayDirty, area);
+	}
+
+
+void VirtualVideoCompositorUnit::UpdateSubpicture(void)
+	{
+	VideoCompositorInputNode	*	node = &inputNodes[VCSI_SUBPICTURE];
+	StreamingDataPacket			*	packet = node->current;
+	const uint32					*	line;
+	bool									visible;
+	uint32								y, left, right;
+	VDRGfxRect							lineBounds;
+
+	//
+	// Always called when the subpicture or its settings changed, the area of the previous
+	// subpicture needs to be recomposed in any case
+	//
+	if (subpictureVisible)
+		InvalidateOverlay(subpictureBounds);
+
+	SetRect(subpictureBounds, 0, 0, 0, 0);
+
+	visible = packet && layers[VDR_VMIX_IN_SUBPIC].enabled &&
+				 (node->inputState == MIS_ON || (node->inputState == MIS_FORCEDONLY && node->forcedRendering)) &&
+				 packet->vdrPacket.numRanges > 0 &&
+				 packet->vdrPacket.tagRanges.ranges[packet->vdrPacket.numTags].size >= width * height * 4;
+
+	if (visible)
+		{
+		// Find the area of the subpicture that is not transparent
+		for (y = 0; y < height; y++)
+			{
+			line = (const uint32 *)packet->vdrPacket.tagRanges.ranges[packet->vdrPacket.numTags].GetStart() + y * width;
+
+			for (left = 0; left < width && !VDR_GET_A(line[left]); left++) ;
+
+			if (left < width)
+				{
+				for (right = width; !VDR_GET_A(line[right - 1]); right--) ;
+
+				SetRect(lineBounds, left, y, right, y + 1);
+				UniteRect(subpictureBounds, lineBounds);
+				}
+			}
+
+		InvalidateOverlay(subpictureBounds);
+		}
+
+	subpictureVisible = visible;
+	}
+
+
+void VirtualVideoCompositorUnit::ComposeOverlaySource(const VideoCompositorSource & source, const VDRGfxRect & area, VDRGfxRect & bounds)
+	{
+	VDRGfxRect			rect = source.destRect;
+	VDRGfxRect			lineBounds;
+	const uint32	*	pixels;
+	uint32				pixel, alpha, inverse, sumAlpha, sumCb, sumCr, cb, cr;
+	int32					x, y, cx, cy, px, py;
+	uint8				*	dstY, * dstAlpha;
+
+	IntersectRect(rect, area);
+	if (IsRectEmpty(rect))
+		return;
+
+	//
+	// Luma and alpha at full resolution
+	//
+	for (y = rect.top; y < rect.bottom; y++)
+		{
+		pixels	= (const uint32 *)(source.pixels + (y - source.destRect.top) * source.pitch);
+		dstY		= overlayY + y * width;
+		dstAlpha	= overlayAlpha + y * width;
+		SetRect(lineBounds, 0, 0, 0, 0);
+
+		for (x = rect.left; x < rect.right; x++)
+			{
+			pixel = pixels[x - source.destRect.left];
+			alpha = VideoPlaneScale(VDR_GET_A(pixel), source.alpha);
+
+			if (alpha)
+				{
+				inverse = 255 - alpha;
+				dstY[x]		= (uint8)(VideoPlaneScale(VDR_GET_Y(pixel), alpha) + VideoPlaneScale(dstY[x], inverse));
+				dstAlpha[x]	= (uint8)(alpha + VideoPlaneScale(dstAlpha[x], inverse));
+
+				if (IsRectEmpty(lineBounds))
+					SetRect(lineBounds, x, y, x + 1, y + 1);
+				else
+					lineBounds.right = x + 1;
+				}
+			}
+
+		UniteRect(bounds, lineBounds);
+		}
+
+	//
+	// Chroma at half resolution. The area is aligned to chroma samples, each chroma sample
+	// gets the average of the four pixels it covers, pixels outside the source being transparent.
+	//
+	for (cy = rect.top >> 1; cy < (rect.bottom + 1) >> 1; cy++)
+		{
+		for (cx = rect.left >> 1; cx < (rect.right + 1) >> 1; cx++)
+			{
+			sumAlpha = sumCb = sumCr = 0;
+
+			for (py = cy * 2; py < cy * 2 + 2; py++)
+				{
+				if (py < rect.top || py >= rect.bottom)
+					continue;
+
+				pixels = (const uint32 *)(source.pixels + (py - source.destRect.top) * source.pitch);
+
+				for (px = cx * 2; px < cx * 2 + 2; px++)
+					{
+					if (px < rect.left || px >= rect.right)
+						continue;
+
+					pixel = pixels[px - source.destRect.left];
+					alpha = VideoPlaneScale(VDR_GET_A(pixel), source.alpha);
+
+					sumAlpha	+= alpha;
+					sumCb		+= VDR_GET_Cb(pixel) * alpha;
+					sumCr		+= VDR_GET_Cr(pixel) * alpha;
+					}
+				}
+
+			if (sumAlpha)
+				{
+				alpha		= (sumAlpha + 2) >> 2;
+				inverse	= 255 - alpha;
+				x			= cy * (width / 2) + cx;
+
+				// Premultiplied chroma never exceeds the alpha, rounding must not make it
+				cb = (sumCb + 510) / 1020;
+				cr = (sumCr + 510) / 1020;
+				if (cb > alpha)
+					cb = alpha;
+				if (cr > alpha)
+					cr = alpha;
+
+				overlayCb[x]				= (uint8)(cb + VideoPlaneScale(overlayCb[x], inverse));
+				overlayCr[x]				= (uint8)(cr + VideoPlaneScale(overlayCr[x], inverse));
+				overlayChromaAlpha[x]	= (uint8)(alpha + VideoPlaneScale(overlayChromaAlpha[x], inverse));
+				}
+			}
+		}
+	}
+
+
+void VirtualVideoCompositorUnit::ComposeOverlay(void)
+	{
+	VideoCompositorSource			sources[VIDEOCOMPOSITOR_MAX_DISPLAY_BITMAPS + 2], source;
+	VideoCompositorInputNode	*	node = &inputNodes[VCSI_SUBPICTURE];
+	VDRGfxRect							area, bounds;
+	uint32								numSources = 0;
+	uint32								i, j, y;
+
+	SetRect(area, 0, 0, width, height);
+	IntersectRect(area, overlayDirty);
+	SetRect(overlayDirty, 0, 0, 0, 0);
+
+	if (IsRectEmpty(area))
+		return;
+
+	// Align to chroma samples
+	area.left	&= ~1;
+	area.top		&= ~1;
+	area.right	= (area.right + 1) & ~1;
+	area.bottom	= (area.bottom + 1) & ~1;
+
+	//
+	// Clear the area to transparent
+	//
+	for (y = area.top; y < (uint32)area.bottom; y++)
+		{
+		memset(overlayY + y * width + area.left, 0, area.Width());
+		memset(overlayAlpha + y * width + area.left, 0, area.Width());
+		}
+
+	for (y = area.top / 2; y < (uint32)area.bottom / 2; y++)
+		{
+		memset(overlayCb + y * (width / 2) + area.left / 2, 0, area.Width() / 2);
+		memset(overlayCr + y * (width / 2) + area.left / 2, 0, area.Width() / 2);
+		memset(overlayChromaAlpha + y * (width / 2) + area.left / 2, 0, area.Width() / 2);
+		}
+
+	//
+	// Collect the overlay sources, ordered by the Z-order of their mixer input, the bitmaps of
+	// the display set then by their own Z-order
+	//
+	if (subpictureVisible && node->current)
+		{
+		source.pixels	= node->current->vdrPacket.tagRanges.ranges[node->current->vdrPacket.numTags].GetStart();
+		source.pitch	= width * 4;
+		SetRect(source.destRect, 0, 0, width, height);
+		source.alpha	= layers[VDR_VMIX_IN_SUBPIC].alpha;
+		source.zOrder	= (uint32)layers[VDR_VMIX_IN_SUBPIC].zOrder << 16;
+		sources[numSources++] = source;
+		}
+
+	if (layers[VDR_VMIX_IN_GUI].enabled)
+		{
+		for (i = 0; i < numDisplayBitmaps; i++)
+			{
+			source.pixels	= (const uint8 *)(displayBitmaps[i].bitmap->GetLine(displayBitmaps[i].srcRect.top) + displayBitmaps[i].srcRect.left);
+			source.pitch	= displayBitmaps[i].bitmap->GetWidth() * 4;
+			source.destRect	= displayBitmaps[i].destRect;
+			source.alpha	= VideoPlaneScale(displayBitmaps[i].alpha, layers[VDR_VMIX_IN_GUI].alpha);
+			source.zOrder	= ((uint32)layers[VDR_VMIX_IN_GUI].zOrder << 16) | (displayBitmaps[i].zOrder < 0xffff ? displayBitmaps[i].zOrder : 0xffff);
+			sources[numSources++] = source;
+			}
+		}
+
+	if (cursorBitmap && layers[VDR_VMIX_IN_CURSOR].enabled)
+		{
+		source.pixels	= (const uint8 *)(cursorBitmap->GetLine(cursorSrcRect.top) + cursorSrcRect.left);
+		source.pitch	= cursorBitmap->GetWidth() * 4;
+		source.destRect	= cursorDestRect;
+		source.alpha	= layers[VDR_VMIX_IN_CURSOR].alpha;
+		source.zOrder	= (uint32)layers[VDR_VMIX_IN_CURSOR].zOrder << 16;
+		sources[numSources++] = source;
+		}
+
+	// Stable insertion sort, so sources of equal Z-order keep their order
+	for (i = 1; i < numSources; i++)
+		{
+		source = sources[i];
+		for (j = i; j > 0 && sources[j - 1].zOrder > source.zOrder; j--)
+			sources[j] = sources[j - 1];
+		sources[j] = source;
+		}
+
+	SetRect(bounds, 0, 0, 0, 0);
+	for (i = 0; i < numSources; i++)
+		ComposeOverlaySource(sources[i], area, bounds);
+
+	//
+	// The visible area outside the recomposed area is unknown, so the bounds can only
+	// shrink if the previous bounds were fully recomposed
+	//
+	if (ContainsRect(area, overlayBounds))
+		overlayBounds = bounds;
+	else
+		UniteRect(overlayBounds, bounds);
+	}
+
+
+void VirtualVideoCompositorUnit::BlendOverlay(uint8 * frame, uint32 frameWidth, uint32 frameHeight)
+	{
+	VDRGfxRect	area;
+	uint8		*	frameCb = frame + frameWidth * frameHeight;
+	uint8		*	frameCr = frameCb + (frameWidth / 2) * (frameHeight / 2);
+	uint32		y, offset;
+
+	SetRect(area, 0, 0, frameWidth & ~1, frameHeight & ~1);
+	IntersectRect(area, overlayBounds);
+
+	if (IsRectEmpty(area))
+		return;
+
+	area.left	&= ~1;
+	area.top		&= ~1;
+	area.right	= (area.right + 1) & ~1;
+	area.bottom	= (area.bottom + 1) & ~1;
+
+	for (y = area.top; y < (uint32)area.bottom; y++)
+		{
+		offset = y * width + area.left;
+		BlendPremultipliedPixels(frame + y * frameWidth + area.left, overlayY + offset, overlayAlpha + offset, area.Width());
+		}
+
+	for (y = area.top / 2; y < (uint32)area.bottom / 2; y++)
+		{
+		offset = y * (width / 2) + area.left / 2;
+		BlendPremultipliedPixels(frameCb + y * (frameWidth / 2) + area.left / 2, overlayCb + offset, overlayChromaAlpha + offset, area.Width() / 2);
+		BlendPremultipliedPixels(frameCr + y * (frameWidth / 2) + area.left / 2, overlayCr + offset, overlayChromaAlpha + offset, area.Width() / 2);
+		}
+	}
+
+
+bool VirtualVideoCompositorUnit::IsBitmapDisplayed(VideoCompositorBitmap * bitmap)
+	{
+	uint32	i;
+
+	if (bitmap == cursorBitmap)
+		return true;
+
+	for (i = 0; i < numDisplayBitmaps; i++)
+		{
+		if (displayBitmaps[i].bitmap == bitmap)
+			return true;
+		}
+
+	for (i = 0; i < numPendingBitmaps; i++)
+		{
+		if (pendingBitmaps[i].bitmap == bitmap)
+			return true;
+		}
+
+	return false;
+	}
+
+
+void VirtualVideoCompositorUnit::InvalidateBitmap(VideoCompositorBitmap * bitmap, const VDRGfxRect & rect)
+	{
+	VDRGfxRect	area;
+	uint32		i;
+
+	for (i = 0; i < numDisplayBitmaps; i++)
+		{
+		if (displayBitmaps[i].bitmap == bitmap)
+			{
+			area = rect;
+			IntersectRect(area, displayBitmaps[i].srcRect);
+			SetRect(area, area.left - displayBitmaps[i].srcRect.left + displayBitmaps[i].destRect.left,
+							  area.top - displayBitmaps[i].srcRect.top + displayBitmaps[i].destRect.top,
+							  area.right - displayBitmaps[i].srcRect.left + displayBitmaps[i].destRect.left,
+							  area.bottom - displayBitmaps[i].srcRect.top + displayBitmaps[i].destRect.top);
+			IntersectRect(area, displayBitmaps[i].destRect);
+			InvalidateOverlay(area);
+			}
+		}
+
+	if (bitmap == cursorBitmap)
+		{
+		area = rect;
+		IntersectRect(area, cursorSrcRect);
+		SetRect(area, area.left - cursorSrcRect.left + cursorDestRect.left,
+						  area.top - cursorSrcRect.top + cursorDestRect.top,
+						  area.right - cursorSrcRect.left + cursorDestRect.left,
+						  area.bottom - cursorSrcRect.top + cursorDestRect.top);
+		IntersectRect(area, cursorDestRect);
+		InvalidateOverlay(area);
+		}
+	}
+
+
+void VirtualVideoCompositorUnit::ReleaseDisplayBitmaps(DisplayBitmapEntry * entries, uint32 & num)
+	{
+	uint32	i;
+
+	for (i = 0; i < num; i++)
+		entries[i].bitmap->Release();
+
+	num = 0;
+	}
+
+
+//
+// IFrameMixer interface implementation
+//
+
+STFResult VirtualVideoCompositorUnit::GetInputNode(uint32 inputID, StreamMixerInputNode * & node)
+	{
+	VideoCompositorInputNode	*	compositorNode;
+
+	STFRES_REASSERT(GetCompositorInputNode(inputID, compositorNode));
+
+	node = compositorNode;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::SendInputPacket(uint32 inputID, StreamingDataPacket * packet, StreamMixerStartupRequest & req)
+	{
+	VideoCompositorInputNode	*	node;
+
+	req = MIXSUPREQ_NONE;
+
+	STFRES_REASSERT(GetCompositorInputNode(inputID, node));
+
+	node->queueMutex.Enter();
+
+	if (node->GetQueuedPackets() == VIDEOCOMPOSITOR_INPUT_QUEUE_SIZE)
+		{
+		node->packetBounced = true;
+		node->queueMutex.Leave();
+
+		STFRES_RAISE(STFRES_OBJECT_FULL);
+		}
+
+	//
+	// Track the stream time at the input, for GetCurrentInputStreamTime()
+	//
+	if (packet->vdrPacket.flags & VDR_MSMF_START_TIME_VALID)
+		{
+		node->inputTime		= packet->vdrPacket.startTime;
+		node->inputTimeValid	= true;
+		node->inputFrames		= 0;
+		}
+
+	node->inputFrames++;
+
+	if (packet->vdrPacket.flags & VDR_MSMF_END_TIME_VALID)
+		{
+		node->inputTime		= packet->vdrPacket.endTime;
+		node->inputTimeValid	= true;
+		node->inputFrames		= 0;
+		}
+
+	node->queue[node->queueHead % VIDEOCOMPOSITOR_INPUT_QUEUE_SIZE] = packet;
+	node->queueHead++;
+	node->receivedStreamFrames++;
+
+	//
+	// Subpictures are only sent when they change, so a single one allows the start.
+	// Main video can start with a few frames queued, and must start once the queue is full.
+	//
+	if (node->startupState == MIXSS_NOT_ENOUGH_DATA &&
+		 (inputID == VCSI_SUBPICTURE || node->GetQueuedPackets() >= VIDEOCOMPOSITOR_START_FRAMES))
+		{
+		node->startupState = MIXSS_SUFFICIENT_DATA;
+		req = MIXSUPREQ_START_POSSIBLE;
+		}
+
+	if ((node->startupState == MIXSS_NOT_ENOUGH_DATA || node->startupState == MIXSS_SUFFICIENT_DATA) &&
+		 node->GetQueuedPackets() == VIDEOCOMPOSITOR_INPUT_QUEUE_SIZE)
+		{
+		node->startupState = MIXSS_FULL;
+		req = MIXSUPREQ_START_REQUIRED;
+		}
+
+	node->queueMutex.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::GetFrameDuration(STFHiPrec64BitDuration & mixerFrameDuration)
+	{
+	mixerFrameDuration = frameDuration;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::MixFrame(StreamingDataPacket ** packets)
+	{
+	IVDRMemoryPoolAllocator		*	allocator = NULL;
+	VideoCompositorInputNode	*	node;
+	VideoCompositorInputNode	*	mainNode = &inputNodes[VCSI_MAIN];
+	StreamingDataPacket			*	packet;
+	VDRMemoryBlock					*	block = NULL;
+	VDRDataRange						frameRange;
+	const VDRDataRange			*	mainRange = NULL;
+	SequenceHeaderExtension			format;
+	TAG								*	tags;
+	uint8								*	frame;
+	uint32								i, done, frameWidth, frameHeight, lumaSize, chromaSize;
+
+	//
+	// New frames are placed in a block of the first output's pool. The Stream Mixer numbers
+	// the groups of the output packets by mixer frame, which keeps our frame number in step.
+	//
+	for (i = 0; i < numOutputs; i++)
+		{
+		if (packets[i] && outputAllocators[i])
+			{
+			allocator = outputAllocators[i];
+			mixFrameNumber += (int16)(packets[i]->vdrPacket.groupNumber - (uint16)mixFrameNumber);
+			break;
+			}
+		}
+
+	if (!allocator)
+		STFRES_RAISE(STFRES_OBJECT_NOT_ALLOCATED);
+
+	if (!overlayY || !overlayAlpha || !overlayCb || !overlayCr || !overlayChromaAlpha)
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+
+	overlayMutex.Enter();
+
+	//
+	// Take the next frame of all inputs started for this frame, the current frames are repeated
+	// if there is none
+	//
+	for (i = 0; i < VCSI_NUM_INPUTS; i++)
+		{
+		node = &inputNodes[i];
+
+		if (node->frameNumber == INFINITE_FRAME_NUMBER || (int32)(mixFrameNumber - node->frameNumber) < 0)
+			continue;
+
+		node->queueMutex.Enter();
+
+		if (AdvanceInput(node))
+			{
+			node->starving = false;
+
+			if (i == VCSI_MAIN)
+				ParseMainFrameTags(node->current);
+			else
+				UpdateSubpicture();
+			}
+		else if (i == VCSI_MAIN && !node->starving)
+			{
+			// Only the main video starves, subpictures arrive when they change
+			node->starving			= true;
+			node->starvation		= true;
+			node->packetRequest	= true;
+			}
+
+		node->queueMutex.Leave();
+
+		node->frameNumber = mixFrameNumber + 1;
+		}
+
+	if (!IsRectEmpty(overlayDirty))
+		ComposeOverlay();
+
+	//
+	// Determine the output format, the main video if it is shown, the output size otherwise
+	//
+	format = outputFormat;
+
+	if (outputEnabled && layers[VDR_VMIX_IN_VIDEO1].enabled && mainNode->inputState != MIS_OFF &&
+		 mainNode->current && mainFormatValid && mainNode->current->vdrPacket.numRanges > 0)
+		{
+		mainRange = &mainNode->current->vdrPacket.tagRanges.ranges[mainNode->current->vdrPacket.numTags];
+		format = mainFormat;
+
+		if (mainRange->size < (uint32)format.horizontalSize * format.verticalSize + 2 * (uint32)format.horizontalChromaSize * format.verticalChromaSize)
+			{
+			DP("VideoCompositor: main video frame too small for its format\n");
+			mainRange = NULL;
+			format = outputFormat;
+			}
+		}
+
+	if (!mainRange)
+		{
+		format.horizontalSize			= (uint16)width;
+		format.verticalSize				= (uint16)height;
+		format.horizontalChromaSize	= (uint16)(width / 2);
+		format.verticalChromaSize		= (uint16)(height / 2);
+		}
+
+	if (memcmp(&format, &outputFormat, sizeof(format)))
+		{
+		outputFormat = format;
+		for (i = 0; i < VIDEOCOMPOSITOR_MAX_OUTPUTS; i++)
+			outputTagsPending[i] = true;
+		}
+
+	frameWidth	= outputFormat.horizontalSize;
+	frameHeight	= outputFormat.verticalSize;
+	lumaSize		= frameWidth * frameHeight;
+	chromaSize	= (uint32)outputFormat.horizontalChromaSize * outputFormat.verticalChromaSize;
+
+	if (mainRange && (!outputEnabled || IsRectEmpty(overlayBounds)))
+		{
+		// Nothing to compose, the main video frame is passed on as it is
+		frameRange = *mainRange;
+		}
+	else
+		{
+		if (STFRES_FAILED(allocator->GetMemoryBlocks(&block, 0, 1, done)) || done == 0)
+			{
+			overlayMutex.Leave();
+			STFRES_RAISE(STFRES_OBJECT_EMPTY);
+			}
+
+		if (block->GetSize() < lumaSize + 2 * chromaSize)
+			{
+			DP("VideoCompositor: memory block too small for a %d x %d frame\n", frameWidth, frameHeight);
+			block->Release();
+			overlayMutex.Leave();
+			STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+			}
+
+		frame = block->GetStart();
+
+		if (mainRange)
+			memcpy(frame, mainRange->GetStart(), lumaSize + 2 * chromaSize);
+		else
+			{
+			memset(frame, backgroundY, lumaSize);
+			memset(frame + lumaSize, backgroundCb, chromaSize);
+			memset(frame + lumaSize + chromaSize, backgroundCr, chromaSize);
+			}
+
+		// The blending assumes chroma planes subsampled by two, as produced by the MPEG video decoder
+		if (outputEnabled && outputFormat.horizontalChromaSize == frameWidth / 2 && outputFormat.verticalChromaSize == frameHeight / 2)
+			BlendOverlay(frame, frameWidth, frameHeight);
+
+		frameRange.Init(block, 0, lumaSize + 2 * chromaSize);
+		}
+
+	//
+	// All outputs get the same frame, each packet holds its own reference to the block
+	//
+	for (i = 0; i < numOutputs; i++)
+		{
+		packet = packets[i];
+		if (!packet)
+			continue;
+
+		if (outputTagsPending[i])
+			{
+			tags = (TAG *)packet->vdrPacket.tagRanges.tags;
+			tags[0] = SET_MPEG_VIDEO_SEQUENCE_PARAMETERS(&outputFormat);
+			tags[1] = TAGDONE;
+
+			packet->vdrPacket.numTags = 2;
+			packet->vdrPacket.flags |= VDR_MSMF_TAGS_VALID;
+			outputTagsPending[i] = false;
+			}
+
+		packet->vdrPacket.tagRanges.ranges[packet->vdrPacket.numTags] = frameRange;
+		packet->vdrPacket.numRanges = 1;
+		packet->AddRefToRanges();
+		}
+
+	if (block)
+		block->Release();
+
+	overlayMutex.Leave();
+
+	mixFrameNumber++;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::ReceiveAllocator(uint32 outputID, IVDRMemoryPoolAllocator * allocator)
+	{
+	if (outputID >= VIDEOCOMPOSITOR_MAX_OUTPUTS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	if (outputID >= numOutputs)
+		numOutputs = outputID + 1;
+
+	outputAllocators[outputID] = allocator;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::PrepareStream(uint32 inputID)
+	{
+	VideoCompositorInputNode	*	node;
+
+	// The inputs keep the packets of their own pools, so there is no allocator to provide
+	STFRES_RAISE(GetCompositorInputNode(inputID, node));
+	}
+
+
+STFResult VirtualVideoCompositorUnit::StepStream(uint32 inputID, uint32 numFrames)
+	{
+	VideoCompositorInputNode	*	node;
+	bool								advanced = false;
+
+	STFRES_REASSERT(GetCompositorInputNode(inputID, node));
+
+	// The frames stepped over are skipped, the last one reached stays on display
+	overlayMutex.Enter();
+	node->queueMutex.Enter();
+
+	while (numFrames > 0 && AdvanceInput(node))
+		{
+		advanced = true;
+		numFrames--;
+
+		if (inputID == VCSI_MAIN)
+			ParseMainFrameTags(node->current);
+		}
+
+	node->queueMutex.Leave();
+
+	if (advanced && inputID == VCSI_SUBPICTURE)
+		UpdateSubpicture();
+
+	overlayMutex.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::FlushStream(uint32 inputID, int32 mode)
+	{
+	VideoCompositorInputNode	*	node;
+
+	STFRES_REASSERT(GetCompositorInputNode(inputID, node));
+
+	overlayMutex.Enter();
+	node->queueMutex.Enter();
+
+	while (node->queueTail != node->queueHead)
+		ReleaseTailPacket(node);
+
+	ReleaseCurrentPacket(node);
+
+	node->forcedRendering		= false;
+	node->inputTimeValid			= false;
+	node->inputFrames				= 0;
+	node->starving					= false;
+	node->receivedStreamFrames	= 0;
+
+	// Back to the initial state, the first consumed packet requests more data
+	node->packetBounced			= true;
+	node->packetRequest			= false;
+
+	node->queueMutex.Leave();
+
+	if (inputID == VCSI_SUBPICTURE)
+		UpdateSubpicture();
+
+	overlayMutex.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::GetStreamTagIDs(uint32 inputID, VDRTID * & ids)
+	{
+	static const VDRTID supportedTagTypes[] =
+		{
+		VDRTID_MIXER_INPUT_CONTROL,
+		VDRTID_DONE
+		};
+
+	ids = (VDRTID *)supportedTagTypes;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::ConfigureStreamTags(uint32 inputID, TAG * tags)
+	{
+	VideoCompositorInputNode	*	node;
+	uint32								changeSet = 0;
+
+	STFRES_REASSERT(GetCompositorInputNode(inputID, node));
+
+	PARSE_TAGS_START(tags, changeSet)
+		GETSETC(MIXER_INPUT_STATE,		node->pendingInputState, 0);
+	PARSE_TAGS_END
+
+	STFRES_RAISE_OK;
+	}
+
+
+// Called on the mixing thread, so the settings change between two frames
+STFResult VirtualVideoCompositorUnit::InternalUpdateStreamTags(uint32 inputID)
+	{
+	VideoCompositorInputNode	*	node;
+
+	STFRES_REASSERT(GetCompositorInputNode(inputID, node));
+
+	overlayMutex.Enter();
+
+	if (node->inputState != node->pendingInputState)
+		{
+		node->inputState = node->pendingInputState;
+
+		if (inputID == VCSI_SUBPICTURE)
+			UpdateSubpicture();
+		}
+
+	overlayMutex.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::SetRendererInformation(const STFHiPrec64BitTime & renderTime, uint32 renderFrame)
+	{
+	// Frames are composed at the mixer frame rate, so the render timing is not needed
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::GetCurrentInputStreamTime(uint32 inputID, STFHiPrec64BitTime & inputTime)
+	{
+	VideoCompositorInputNode	*	node;
+
+	STFRES_REASSERT(GetCompositorInputNode(inputID, node));
+
+	node->queueMutex.Enter();
+
+	if (node->inputTimeValid)
+		inputTime = node->inputTime + frameDuration * (int32)node->inputFrames;
+	else
+		inputTime = STFHiPrec64BitTime(0);
+
+	node->queueMutex.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::BeginOutput(uint32 outputID)
+	{
+	if (outputID >= VIDEOCOMPOSITOR_MAX_OUTPUTS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	if (outputID >= numOutputs)
+		numOutputs = outputID + 1;
+
+	// The first frame of the output tells the renderer the frame format
+	outputTagsPending[outputID] = true;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::FlushOutput(uint32 outputID)
+	{
+	if (outputID >= VIDEOCOMPOSITOR_MAX_OUTPUTS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	// Frames are handed to the outputs as soon as they are composed, nothing is pending here
+	STFRES_RAISE_OK;
+	}
+
+
+//
+// IVDRVideoMixer interface implementation
+//
+
+int32 VirtualVideoCompositorUnit::GetOutputColorFormats(VDRGfxColorFormat* colorFormats)
+	{
+	if (colorFormats)
+		colorFormats[0] = VDR_YCbCr420;
+
+	return 1;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::SetOutput(VMixOutput mixOut, VDRGfxColorFormat outColorFormat, VDRGfxScanLayout outScanLayout)
+	{
+	// There is only the main output, with frames as produced by the video decoder
+	if (mixOut != VDR_VMIX_OUT_MAIN || outColorFormat != VDR_YCbCr420 || outScanLayout != VDR_SL_FRAME)
+		STFRES_RAISE(STFRES_UNIMPLEMENTED);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::EnableOutput(VMixOutput mixOut, bool enable)
+	{
+	if (mixOut != VDR_VMIX_OUT_MAIN)
+		STFRES_RAISE(STFRES_UNIMPLEMENTED);
+
+	// A disabled output shows the background color only
+	STFAutoMutex	mutex(&overlayMutex);
+
+	outputEnabled = enable;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::GetOutputSize(int* width, int* height)
+	{
+	if (!width || !height)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	*width	= this->width;
+	*height	= this->height;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::SetInput(VMixInput mixIn, VMixInputType inType, uint8 alpha, uint8 zOrder, VDRGfxRect* srcRect, VDRGfxRect* destRect)
+	{
+	VDRGfxRect	screen;
+
+	if ((uint32)mixIn >= VIDEOCOMPOSITOR_NUM_MIXER_INPUTS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	// There is no scaler, inputs are always shown at their default position and size
+	if (srcRect || destRect)
+		STFRES_RAISE(STFRES_UNIMPLEMENTED);
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	if (layers[mixIn].alpha != alpha || layers[mixIn].zOrder != zOrder)
+		{
+		layers[mixIn].alpha	= alpha;
+		layers[mixIn].zOrder	= zOrder;
+
+		// The overlays are stacked differently now
+		if (mixIn != VDR_VMIX_IN_VIDEO1)
+			{
+			SetRect(screen, 0, 0, width, height);
+			InvalidateOverlay(screen);
+			}
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::GetInputSize(VMixInput mixIn, int* width, int* height)
+	{
+	if ((uint32)mixIn >= VIDEOCOMPOSITOR_NUM_MIXER_INPUTS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	if (!width || !height)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	if (mixIn == VDR_VMIX_IN_VIDEO1 && mainFormatValid)
+		{
+		*width	= mainFormat.horizontalSize;
+		*height	= mainFormat.verticalSize;
+		}
+	else
+		{
+		*width	= this->width;
+		*height	= this->height;
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::EnableInput(VMixInput mixIn, bool enable)
+	{
+	uint32		i;
+
+	if ((uint32)mixIn >= VIDEOCOMPOSITOR_NUM_MIXER_INPUTS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	if (layers[mixIn].enabled == enable)
+		STFRES_RAISE_OK;
+
+	layers[mixIn].enabled = enable;
+
+	switch (mixIn)
+		{
+		case VDR_VMIX_IN_SUBPIC:
+			UpdateSubpicture();
+			break;
+
+		case VDR_VMIX_IN_GUI:
+			for (i = 0; i < numDisplayBitmaps; i++)
+				InvalidateBitmap(displayBitmaps[i].bitmap, displayBitmaps[i].srcRect);
+			break;
+
+		case VDR_VMIX_IN_CURSOR:
+			if (cursorBitmap)
+				InvalidateBitmap(cursorBitmap, cursorSrcRect);
+			break;
+
+		default:
+			break;
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::SetBackgroundColor(VDRGfxColorRGB backgroundColor)
+	{
+	int32	r = VDR_GET_R(backgroundColor);
+	int32	g = VDR_GET_G(backgroundColor);
+	int32	b = VDR_GET_B(backgroundColor);
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	// ITU-R BT.601 conversion to studio range
+	backgroundY		= (uint8)(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+	backgroundCb	= (uint8)(128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8));
+	backgroundCr	= (uint8)(128 + ((112 * r - 94 * g - 18 * b + 128) >> 8));
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::WipeMixerInput(VMixInput mixIn, Eff2dWipeParam* wipe, uint32 flags)
+	{
+	STFRES_RAISE(STFRES_UNIMPLEMENTED);
+	}
+
+
+STFResult VirtualVideoCompositorUnit::BlendMixerInput(VMixInput mixIn, Eff2dZoomParam* blend, uint32 flags)
+	{
+	STFRES_RAISE(STFRES_UNIMPLEMENTED);
+	}
+
+
+STFResult VirtualVideoCompositorUnit::ZoomMoveMixerInputs(VMixInput* mixInputs, int32 numInputs, Eff2dZoomParam* zoomMove, uint32 flags)
+	{
+	STFRES_RAISE(STFRES_UNIMPLEMENTED);
+	}
+
+
+//
+// IVDRGraphics2D interface implementation
+//
+
+STFResult VirtualVideoCompositorUnit::BeginDrawing(void)
+	{
+	// Drawing is done synchronously, the changed areas are recomposed with the next frame
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::EndDrawing(void)
+	{
+	STFRES_RAISE_OK;
+	}
+
+
+uint32 VirtualVideoCompositorUnit::GetColorFormats(VDRGfxColorFormat* colorFormats)
+	{
+	if (colorFormats)
+		colorFormats[0] = VDR_AYCbCr8888;
+
+	return 1;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::CreateBitmap(IVDRGfxBitmap** bmp, int32 width, int32 height, VDRGfxColorFormat colorFormat)
+	{
+	VideoCompositorBitmap	*	bitmap;
+	STFResult						res;
+
+	if (!bmp)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	bitmap = new VideoCompositorBitmap();
+	if (!bitmap)
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+
+	res = bitmap->Allocate(width, height, colorFormat);
+	if (STFRES_FAILED(res))
+		{
+		bitmap->Release();
+		STFRES_RAISE(res);
+		}
+
+	*bmp = bitmap;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::FillRectangle(VDRGfxRect* rect, VDRGfxColor fillColor, IVDRGfxBitmap* destBmp)
+	{
+	VideoCompositorBitmap	*	bitmap;
+	VDRGfxRect					area;
+
+	STFRES_REASSERT(GetCompositorBitmap(destBmp, bitmap));
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	ClipBitmapRect(area, rect, bitmap);
+	if (!IsRectEmpty(area))
+		{
+		FillBitmapRect(bitmap, area, fillColor);
+		InvalidateBitmap(bitmap, area);
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::FillRectangleWithBorder(VDRGfxRect* rect, VDRGfxColor fillColor, bool borderOnly, int32 borderLines,
+																				  VDRGfxColor borderTopLeftColor, VDRGfxColor borderBottomRightColor, IVDRGfxBitmap* destBmp)
+	{
+	VideoCompositorBitmap	*	bitmap;
+	VDRGfxRect					area, border, outer;
+
+	if (!rect || borderLines < 0)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	STFRES_REASSERT(GetCompositorBitmap(destBmp, bitmap));
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	ClipBitmapRect(outer, rect, bitmap);
+	if (IsRectEmpty(outer))
+		STFRES_RAISE_OK;
+
+	// Inner area
+	if (!borderOnly)
+		{
+		SetRect(area, rect->left + borderLines, rect->top + borderLines, rect->right - borderLines, rect->bottom - borderLines);
+		IntersectRect(area, outer);
+		if (!IsRectEmpty(area))
+			FillBitmapRect(bitmap, area, fillColor);
+		}
+
+	// Top and left edges
+	SetRect(border, rect->left, rect->top, rect->right, rect->top + borderLines);
+	IntersectRect(border, outer);
+	if (!IsRectEmpty(border))
+		FillBitmapRect(bitmap, border, borderTopLeftColor);
+
+	SetRect(border, rect->left, rect->top, rect->left + borderLines, rect->bottom);
+	IntersectRect(border, outer);
+	if (!IsRectEmpty(border))
+		FillBitmapRect(bitmap, border, borderTopLeftColor);
+
+	// Bottom and right edges
+	SetRect(border, rect->left, rect->bottom - borderLines, rect->right, rect->bottom);
+	IntersectRect(border, outer);
+	if (!IsRectEmpty(border))
+		FillBitmapRect(bitmap, border, borderBottomRightColor);
+
+	SetRect(border, rect->right - borderLines, rect->top, rect->right, rect->bottom);
+	IntersectRect(border, outer);
+	if (!IsRectEmpty(border))
+		FillBitmapRect(bitmap, border, borderBottomRightColor);
+
+	InvalidateBitmap(bitmap, outer);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::FillTextRectangle(uint16* text, int32 textX, int32 textY, VDRGfxFont* font, VDRGfxColor textColor,
+																		  VDRGfxRect* rect, VDRGfxColor rectColor, IVDRGfxBitmap* destBmp)
+	{
+	// There is no font renderer, text has to be drawn into bitmaps by the application
+	STFRES_RAISE(STFRES_UNIMPLEMENTED);
+	}
+
+
+STFResult VirtualVideoCompositorUnit::BlitBitmap(IVDRGfxBitmap* srcBmp, IVDRGfxBitmap* destBmp, VDRGfxRect* srcRect, VDRGfxRect* destRect, uint8 alpha)
+	{
+	VideoCompositorBitmap	*	source, * dest;
+	VDRGfxRect					srcArea, destArea, destBounds;
+	const uint32			*	srcLine;
+	uint32					*	destLine;
+	uint32						s, d, inverse;
+	int32							w, h, x, y, dx, dy, line, column, lineStep, columnStep;
+
+	STFRES_REASSERT(GetCompositorBitmap(srcBmp, source));
+	STFRES_REASSERT(GetCompositorBitmap(destBmp, dest));
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	//
+	// There is no scaling, the smaller of both rectangles determines the size. The destination
+	// is clipped to the destination bitmap, and the source follows the clipping.
+	//
+	ClipBitmapRect(srcArea, srcRect, source);
+	if (destRect)
+		destArea = *destRect;
+	else
+		SetRect(destArea, 0, 0, dest->GetWidth(), dest->GetHeight());
+
+	w = srcArea.Width() < destArea.Width() ? srcArea.Width() : destArea.Width();
+	h = srcArea.Height() < destArea.Height() ? srcArea.Height() : destArea.Height();
+	destArea.right		= destArea.left + w;
+	destArea.bottom	= destArea.top + h;
+
+	SetRect(destBounds, 0, 0, dest->GetWidth(), dest->GetHeight());
+	dx = srcArea.left - destArea.left;
+	dy = srcArea.top - destArea.top;
+	IntersectRect(destArea, destBounds);
+
+	if (IsRectEmpty(destArea))
+		STFRES_RAISE_OK;
+
+	w = destArea.Width();
+	h = destArea.Height();
+
+	// Copy backwards if source and destination overlap in the same bitmap
+	if (source == dest && (dy < 0 || (dy == 0 && dx < 0)))
+		{
+		lineStep		= -1;
+		columnStep	= -1;
+		}
+	else
+		{
+		lineStep		= 1;
+		columnStep	= 1;
+		}
+
+	inverse = 255 - alpha;
+
+	for (line = 0; line < h; line++)
+		{
+		y = lineStep > 0 ? destArea.top + line : destArea.bottom - 1 - line;
+
+		srcLine	= source->GetLine(y + dy) + dx;
+		destLine	= dest->GetLine(y);
+
+		if (alpha == 255)
+			memmove(destLine + destArea.left, srcLine + destArea.left, w * 4);
+		else
+			{
+			for (column = 0; column < w; column++)
+				{
+				x = columnStep > 0 ? destArea.left + column : destArea.right - 1 - column;
+				s = srcLine[x];
+				d = destLine[x];
+
+				destLine[x] = VDR_AYCbCr2LONG(VideoPlaneScale(VDR_GET_A(s), alpha) + VideoPlaneScale(VDR_GET_A(d), inverse),
+														VideoPlaneScale(VDR_GET_Y(s), alpha) + VideoPlaneScale(VDR_GET_Y(d), inverse),
+														VideoPlaneScale(VDR_GET_Cb(s), alpha) + VideoPlaneScale(VDR_GET_Cb(d), inverse),
+														VideoPlaneScale(VDR_GET_Cr(s), alpha) + VideoPlaneScale(VDR_GET_Cr(d), inverse));
+				}
+			}
+		}
+
+	InvalidateBitmap(dest, destArea);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::StartDisplayBitmapsSet(void)
+	{
+	STFAutoMutex	mutex(&overlayMutex);
+
+	ReleaseDisplayBitmaps(pendingBitmaps, numPendingBitmaps);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::FinishAndShowDisplayBitmapsSet(void)
+	{
+	uint32	i;
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	for (i = 0; i < numDisplayBitmaps; i++)
+		InvalidateOverlay(displayBitmaps[i].destRect);
+
+	ReleaseDisplayBitmaps(displayBitmaps, numDisplayBitmaps);
+
+	// The references move from the pending to the displayed set
+	for (i = 0; i < numPendingBitmaps; i++)
+		{
+		displayBitmaps[i] = pendingBitmaps[i];
+		if (layers[VDR_VMIX_IN_GUI].enabled)
+			InvalidateOverlay(displayBitmaps[i].destRect);
+		}
+
+	numDisplayBitmaps = numPendingBitmaps;
+	numPendingBitmaps = 0;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::DisplayBitmap(IVDRGfxBitmap* dispBmp, VDRGfxRect* srcRect, VDRGfxRect* destRect, uint8 alpha, uint32 zOrder)
+	{
+	VideoCompositorBitmap	*	bitmap;
+	DisplayBitmapEntry		*	entry;
+
+	STFRES_REASSERT(GetCompositorBitmap(dispBmp, bitmap));
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	if (numPendingBitmaps == VIDEOCOMPOSITOR_MAX_DISPLAY_BITMAPS)
+		STFRES_RAISE(STFRES_OBJECT_FULL);
+
+	entry = &pendingBitmaps[numPendingBitmaps];
+
+	ClipBitmapRect(entry->srcRect, srcRect, bitmap);
+	if (destRect)
+		entry->destRect = *destRect;
+	else
+		SetRect(entry->destRect, 0, 0, entry->srcRect.Width(), entry->srcRect.Height());
+
+	// Without scaling, the bitmap covers the smaller of both rectangles
+	if (entry->srcRect.Width() < entry->destRect.Width())
+		entry->destRect.right = entry->destRect.left + entry->srcRect.Width();
+	if (entry->srcRect.Height() < entry->destRect.Height())
+		entry->destRect.bottom = entry->destRect.top + entry->srcRect.Height();
+
+	if (IsRectEmpty(entry->destRect))
+		STFRES_RAISE_OK;
+
+	entry->bitmap	= bitmap;
+	entry->alpha	= alpha;
+	entry->zOrder	= zOrder;
+
+	bitmap->AddRef();
+	numPendingBitmaps++;
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::SetCursorBitmap(IVDRGfxBitmap* cursorBmp, VDRGfxRect* srcRect, VDRGfxRect* destRect)
+	{
+	VideoCompositorBitmap	*	bitmap = NULL;
+
+	// A NULL bitmap removes the cursor
+	if (cursorBmp)
+		STFRES_REASSERT(GetCompositorBitmap(cursorBmp, bitmap));
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	if (cursorBitmap)
+		{
+		InvalidateOverlay(cursorDestRect);
+		cursorBitmap->Release();
+		cursorBitmap = NULL;
+		}
+
+	if (bitmap)
+		{
+		ClipBitmapRect(cursorSrcRect, srcRect, bitmap);
+		if (destRect)
+			cursorDestRect = *destRect;
+		else
+			SetRect(cursorDestRect, 0, 0, cursorSrcRect.Width(), cursorSrcRect.Height());
+
+		if (cursorSrcRect.Width() < cursorDestRect.Width())
+			cursorDestRect.right = cursorDestRect.left + cursorSrcRect.Width();
+		if (cursorSrcRect.Height() < cursorDestRect.Height())
+			cursorDestRect.bottom = cursorDestRect.top + cursorSrcRect.Height();
+
+		if (!IsRectEmpty(cursorDestRect))
+			{
+			cursorBitmap = bitmap;
+			cursorBitmap->AddRef();
+
+			if (layers[VDR_VMIX_IN_CURSOR].enabled)
+				InvalidateOverlay(cursorDestRect);
+			}
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::IsBusy(IVDRGfxBitmap* bmp)
+	{
+	VideoCompositorBitmap	*	bitmap;
+
+	STFRES_REASSERT(GetCompositorBitmap(bmp, bitmap));
+
+	STFAutoMutex	mutex(&overlayMutex);
+
+	// Bitmaps are only read while composing the overlay under the lock, so only bitmaps on
+	// display cause visible artifacts when modified
+	if (IsBitmapDisplayed(bitmap))
+		STFRES_RAISE_TRUE;
+	else
+		STFRES_RAISE_FALSE;
+	}
+
+
+STFResult VirtualVideoCompositorUnit::MoveCursorTo(int32 x, int32 y)
+	{
+	STFAutoMutex	mutex(&overlayMutex);
+
+	if (cursorBitmap && layers[VDR_VMIX_IN_CURSOR].enabled)
+		InvalidateOverlay(cursorDestRect);
+
+	SetRect(cursorDestRect, x, y, x + cursorDestRect.Width(), y + cursorDestRect.Height());
+
+	if (cursorBitmap && layers[VDR_VMIX_IN_CURSOR].enabled)
+		InvalidateOverlay(cursorDestRect);
+
+	STFRES_RAISE_OK;
+	}
@@ -0,0 +1,346 @@
+#ifndef VIDEOCOMPOSITOR_H
+#define VIDEOCOMPOSITOR_H
+
+///
+/// @brief      Software Video Compositor for YCbCr 4:2:0 frames
+///
+/// Frame mixer of the generic Stream Mixer for video (VDRUID_VIDEO_MIXER). The main video and
+/// the subpicture arrive on the streaming mixer inputs, the OSD and the cursor are drawn through
+/// IVDRGraphics2D. The compositor outputs planar YCbCr 4:2:0 frames (Y, Cb, Cr) in the format
+/// produced by the MPEG video decoder and consumed by the SDL2 video renderer.
+///
+/// All overlays are flattened into one premultiplied overlay plane set at output resolution.
+/// Only the dirty regions of this overlay are recomposed when an overlay changes, so a frame
+/// costs one copy of the main picture plus the blending of the area covered by overlays.
+/// Without visible overlays, the main picture is passed on without any copy.
+///
+/// The subpicture input carries AYCbCr8888 rasters of the output size. A subpicture stays
+/// visible until the next subpicture packet replaces it.
+///
+
+#include "Device/Interface/Unit/Datapath/IStreamMixer.h"
+#include "VDR/Source/Unit/PhysicalUnit.h"
+#include "VDR/Source/Unit/VirtualUnit.h"
+#include "VDR/Source/Base/VDRBase.h"
+#include "VDR/Interface/Unit/Video/Display/IVDRVideoDisplay.h"
+#include "VDR/Interface/Unit/Video/Decoder/IVDRVideoDecoderTypes.h"
+#include "VDR/Interface/Unit/Datapath/VDRStreamMixerTags.h"
+#include "STF/Interface/STFMutex.h"
+
+/// Number of packets each input can queue
+#define VIDEOCOMPOSITOR_INPUT_QUEUE_SIZE			8
+/// Maximum number of mixer outputs
+#define VIDEOCOMPOSITOR_MAX_OUTPUTS					4
+/// Number of queued frames that allow an input to start
+#define VIDEOCOMPOSITOR_START_FRAMES				2
+/// Maximum number of bitmaps in an OSD display set
+#define VIDEOCOMPOSITOR_MAX_DISPLAY_BITMAPS		16
+/// Number of IVDRVideoMixer inputs (see VMixInput)
+#define VIDEOCOMPOSITOR_NUM_MIXER_INPUTS			(VDR_VMIX_IN_BACKGROUND + 1)
+
+/// Interface ID to get the implementation of bitmaps created by the compositor
+static const VDRIID VDRIID_VIDEO_COMPOSITOR_BITMAP = 0x80000091;
+
+
+/// Streaming inputs of the Video Compositor, in the numbering of the Stream Mixer inputs
+enum VideoCompositorStreamInput
+	{
+	VCSI_MAIN = 0,			///< Main video, YCbCr 4:2:0 frames with MPEG_VIDEO_SEQUENCE_PARAMETERS tags
+	VCSI_SUBPICTURE,		///< Subpicture, AYCbCr8888 rasters of the output size
+	VCSI_NUM_INPUTS
+	};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Video Compositor Bitmap
+///////////////////////////////////////////////////////////////////////////////
+
+/// AYCbCr8888 bitmap created by IVDRGraphics2D::CreateBitmap()
+class VideoCompositorBitmap : public VDRBase,
+										public virtual IVDRGfxBitmap
+	{
+	protected:
+		/// Memory block wrapper, so the pixel memory can be described by a data range.
+		/// References to the block are references to the bitmap.
+		class PixelMemory : public VDRMemoryBlock
+			{
+			public:
+				VideoCompositorBitmap	*	bitmap;
+				uint8							*	start;
+				uint32							size;
+
+				virtual uint32 AddRef (IVDRDataHolder * holder = NULL) {return bitmap->AddRef();}
+				virtual uint32 Release (IVDRDataHolder * holder = NULL) {return bitmap->Release();}
+
+				virtual uint8 * GetStart (void) const {return start;}
+				virtual uint32 GetSize (void) const {return size;}
+			};
+
+		VDRGfxBitmapDesc		desc;
+		uint16					allocatedWidth, allocatedHeight;
+		PixelMemory				memory;
+
+	public:
+		VideoCompositorBitmap(void);
+		virtual ~VideoCompositorBitmap(void);
+
+		/// Allocate the pixel memory
+		STFResult Allocate(int32 width, int32 height, VDRGfxColorFormat colorFormat);
+
+		uint16 GetWidth(void) {return desc.width;}
+		uint16 GetHeight(void) {return desc.height;}
+
+		/// Pixels of one line
+		uint32 * GetLine(int32 y) {return (uint32 *)(memory.start + y * desc.pitch);}
+
+		//
+		// IVDRBase functions
+		//
+		virtual STFResult QueryInterface(VDRIID iid, void *& ifp);
+
+		//
+		// IVDRGfxBitmap interface implementation
+		//
+		virtual STFResult GetBitmapDesc(VDRGfxBitmapDesc* bmpDesc);
+		virtual STFResult GetBitmapPixels(VDRGfxBitmapPixels* bmpPix);
+		virtual STFResult SetBitmapDesc(VDRGfxBitmapDesc* bmpDesc);
+	};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Video Compositor Input Node
+///////////////////////////////////////////////////////////////////////////////
+
+/// Input node extended by the frame queue of a streaming input
+struct VideoCompositorInputNode : public StreamMixerInputNode
+	{
+	STFMutex						queueMutex;			/// Protects the queue against concurrent sending, mixing and flushing
+
+	StreamingDataPacket	*	queue[VIDEOCOMPOSITOR_INPUT_QUEUE_SIZE];
+	uint32						queueHead;			/// Number of packets queued so far
+	uint32						queueTail;			/// Number of packets consumed so far
+
+	StreamingDataPacket	*	current;				/// Frame currently shown, kept to repeat it on starvation. Only changed
+															/// with the overlay mutex of the compositor held, which also protects its use.
+	bool							forcedRendering;	/// The current frame is marked for forced rendering
+
+	bool							inputTimeValid;
+	STFHiPrec64BitTime		inputTime;			/// Last time stamp received
+	uint32						inputFrames;		/// Frames received after the last time stamp
+
+	bool							starving;			/// The last mixed frame had no new input frame
+
+	// Mixer input control configuration, set in ConfigureStreamTags() and applied by InternalUpdateStreamTags()
+	MixerInputState			inputState, pendingInputState;
+
+	VideoCompositorInputNode(void);
+
+	uint32 GetQueuedPackets(void) {return queueHead - queueTail;}
+	};
+
+
+/// Settings of an IVDRVideoMixer input
+struct VideoCompositorLayer
+	{
+	bool				enabled;
+	uint8				alpha;
+	uint8				zOrder;
+	};
+
+
+/// Overlay source to be composed into the overlay planes
+struct VideoCompositorSource
+	{
+	const uint8	*	pixels;			/// AYCbCr8888 pixel of destRect.left/destRect.top
+	uint32			pitch;			/// Bytes per line
+	VDRGfxRect		destRect;		/// Area covered on the output
+	uint32			alpha;			/// Opacity applied to the pixel alpha
+	uint32			zOrder;
+	};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Physical Video Compositor
+///////////////////////////////////////////////////////////////////////////////
+
+class VideoCompositorUnit : public ExclusivePhysicalUnit
+	{
+	friend class VirtualVideoCompositorUnit;
+
+	protected:
+		uint32					width, height;			/// Output size, also the size of the overlay planes
+		uint32					frameDuration;			/// Duration of one output frame in microseconds
+
+	public:
+		VideoCompositorUnit(VDRUID unitID) : ExclusivePhysicalUnit(unitID) {}
+
+		//
+		// IPhysicalUnit interface implementation
+		//
+		virtual STFResult CreateVirtual(IVirtualUnit * & unit, IVirtualUnit * parent = NULL, IVirtualUnit * root = NULL);
+		virtual STFResult Create(uint64 * createParams);
+		virtual STFResult Connect(uint64 localID, IPhysicalUnit * source);
+		virtual STFResult Initialize(uint64 * depUnitsParams);
+	};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Virtual Video Compositor
+///////////////////////////////////////////////////////////////////////////////
+
+class VirtualVideoCompositorUnit : public VirtualUnit,
+											  public virtual IFrameMixer,
+											  public virtual IVDRVideoMixer,
+											  public virtual IVDRGraphics2D
+	{
+	protected:
+		VideoCompositorUnit			*	physicalCompositor;
+		uint32								width, height;
+
+		VideoCompositorInputNode		inputNodes[VCSI_NUM_INPUTS];
+
+		IVDRMemoryPoolAllocator		*	outputAllocators[VIDEOCOMPOSITOR_MAX_OUTPUTS];
+		bool									outputTagsPending[VIDEOCOMPOSITOR_MAX_OUTPUTS];
+		uint32								numOutputs;			/// Highest output ID used plus one
+		bool									outputEnabled;
+
+		STFHiPrec64BitDuration			frameDuration;
+		uint32								mixFrameNumber;	/// Number of the frame mixed next, runs in step with the Stream Mixer
+
+		SequenceHeaderExtension			mainFormat;			/// Format of the main video frames
+		bool									mainFormatValid;
+		SequenceHeaderExtension			outputFormat;		/// Format announced to the outputs
+
+		//
+		// Overlay state, protected by overlayMutex
+		//
+		STFMutex								overlayMutex;
+
+		VideoCompositorLayer				layers[VIDEOCOMPOSITOR_NUM_MIXER_INPUTS];
+		uint8									backgroundY, backgroundCb, backgroundCr;
+
+		VDRGfxRect							subpictureBounds;	/// Non transparent area of the current subpicture
+		bool									subpictureVisible;
+
+		uint32								numDisplayBitmaps, numPendingBitmaps;
+		struct DisplayBitmapEntry
+			{
+			VideoCompositorBitmap	*	bitmap;
+			VDRGfxRect					srcRect, destRect;
+			uint8							alpha;
+			uint32						zOrder;
+			}									displayBitmaps[VIDEOCOMPOSITOR_MAX_DISPLAY_BITMAPS],
+												pendingBitmaps[VIDEOCOMPOSITOR_MAX_DISPLAY_BITMAPS];
+
+		VideoCompositorBitmap		*	cursorBitmap;
+		VDRGfxRect							cursorSrcRect, cursorDestRect;
+
+		// Premultiplied overlay planes, chroma and chroma alpha subsampled by 2 in both directions
+		uint8								*	overlayY, * overlayAlpha;
+		uint8								*	overlayCb, * overlayCr, * overlayChromaAlpha;
+		VDRGfxRect							overlayDirty;		/// Area of the overlay that needs to be recomposed
+		VDRGfxRect							overlayBounds;		/// Area of the overlay that may contain visible pixels
+
+		/// Get the node of a streaming input
+		STFResult GetCompositorInputNode(uint32 inputID, VideoCompositorInputNode * & node);
+
+		/// Get the compositor implementation of a bitmap
+		STFResult GetCompositorBitmap(IVDRGfxBitmap * bmp, VideoCompositorBitmap * & bitmap);
+
+		/// Release the packet at the queue tail (or the current packet) of an input
+		void ReleaseTailPacket(VideoCompositorInputNode * node);
+		void ReleaseCurrentPacket(VideoCompositorInputNode * node);
+
+		/// Make the next queued frame of an input the current one, returns true if there was one
+		bool AdvanceInput(VideoCompositorInputNode * node);
+
+		/// Apply the tags of a new main video frame
+		void ParseMainFrameTags(StreamingDataPacket * packet);
+
+		/// Update the visibility and bounds of the subpicture, marking the changed area dirty
+		void UpdateSubpicture(void);
+
+		/// Mark an area of the overlay for recomposition
+		void InvalidateOverlay(const VDRGfxRect & rect);
+
+		/// Recompose the dirty area of the overlay planes
+		void ComposeOverlay(void);
+		void ComposeOverlaySource(const VideoCompositorSource & source, const VDRGfxRect & area, VDRGfxRect & bounds);
+
+		/// Blend the overlay onto a frame of the given size
+		void BlendOverlay(uint8 * frame, uint32 frameWidth, uint32 frameHeight);
+
+		/// Check if a bitmap is shown on the screen
+		bool IsBitmapDisplayed(VideoCompositorBitmap * bitmap);
+
+		/// Mark the screen areas showing a part of a bitmap for recomposition
+		void InvalidateBitmap(VideoCompositorBitmap * bitmap, const VDRGfxRect & rect);
+
+		/// Release the bitmaps of a display set
+		void ReleaseDisplayBitmaps(DisplayBitmapEntry * entries, uint32 & num);
+
+	public:
+		VirtualVideoCompositorUnit(VideoCompositorUnit * physicalCompositor);
+		virtual ~VirtualVideoCompositorUnit(void);
+
+		//
+		// IVDRBase functions
+		//
+		virtual STFResult QueryInterface(VDRIID iid, void *& ifp);
+
+		//
+		// IFrameMixer interface implementation
+		//
+		virtual STFResult GetInputNode(uint32 inputID, StreamMixerInputNode * & node);
+		virtual STFResult SendInputPacket(uint32 inputID, StreamingDataPacket * packet, StreamMixerStartupRequest & req);
+		virtual STFResult GetFrameDuration(STFHiPrec64BitDuration & mixerFrameDuration);
+		virtual STFResult MixFrame(StreamingDataPacket ** packets);
+		virtual STFResult ReceiveAllocator(uint32 outputID, IVDRMemoryPoolAllocator * allocator);
+		virtual STFResult PrepareStream(uint32 inputID);
+		virtual STFResult StepStream(uint32 inputID, uint32 numFrames);
+		virtual STFResult FlushStream(uint32 inputID, int32 mode);
+		virtual STFResult GetStreamTagIDs (uint32 inputID, VDRTID * & ids);
+		virtual STFResult ConfigureStreamTags(uint32 inputID, TAG * tags);
+		virtual STFResult InternalUpdateStreamTags(uint32 inputID);
+		virtual STFResult SetRendererInformation(const STFHiPrec64BitTime & renderTime, uint32 renderFrame);
+		virtual STFResult GetCurrentInputStreamTime(uint32 inputID, STFHiPrec64BitTime & inputTime);
+		virtual STFResult BeginOutput(uint32 outputID);
+		virtual STFResult FlushOutput(uint32 outputID);
+
+		//
+		// IVDRVideoMixer interface implementation
+		//
+		virtual int32 GetOutputColorFormats(VDRGfxColorFormat* colorFormats);
+		virtual STFResult SetOutput(VMixOutput mixOut, VDRGfxColorFormat outColorFormat, VDRGfxScanLayout outScanLayout);
+		virtual STFResult EnableOutput(VMixOutput mixOut, bool enable);
+		virtual STFResult GetOutputSize(int* width, int* height);
+		virtual STFResult SetInput(VMixInput mixIn, VMixInputType inType, uint8 alpha, uint8 zOrder, VDRGfxRect* srcRect, VDRGfxRect* destRect);
+		virtual STFResult GetInputSize(VMixInput mixIn, int* width, int* height);
+		virtual STFResult EnableInput(VMixInput mixIn, bool enable);
+		virtual STFResult SetBackgroundColor(VDRGfxColorRGB backgroundColor);
+		virtual STFResult WipeMixerInput(VMixInput mixIn, Eff2dWipeParam* wipe, uint32 flags);
+		virtual STFResult BlendMixerInput(VMixInput mixIn, Eff2dZoomParam* blend, uint32 flags);
+		virtual STFResult ZoomMoveMixerInputs(VMixInput* mixInputs, int32 numInputs, Eff2dZoomParam* zoomMove, uint32 flags);
+
+		//
+		// IVDRGraphics2D interface implementation
+		//
+		virtual STFResult BeginDrawing(void);
+		virtual STFResult EndDrawing(void);
+		virtual uint32 GetColorFormats(VDRGfxColorFormat* colorFormats);
+		virtual STFResult CreateBitmap(IVDRGfxBitmap** bmp, int32 width, int32 height, VDRGfxColorFormat colorFormat);
+		virtual STFResult FillRectangle(VDRGfxRect* rect, VDRGfxColor fillColor, IVDRGfxBitmap* destBmp);
+		virtual STFResult FillRectangleWithBorder(VDRGfxRect* rect, VDRGfxColor fillColor, bool borderOnly, int32 borderLines,
+																VDRGfxColor borderTopLeftColor, VDRGfxColor borderBottomRightColor, IVDRGfxBitmap* destBmp);
+		virtual STFResult FillTextRectangle(uint16* text, int32 textX, int32 textY, VDRGfxFont* font, VDRGfxColor textColor,
+														VDRGfxRect* rect, VDRGfxColor rectColor, IVDRGfxBitmap* destBmp);
+		virtual STFResult BlitBitmap(IVDRGfxBitmap* srcBmp, IVDRGfxBitmap* destBmp, VDRGfxRect* srcRect, VDRGfxRect* destRect, uint8 alpha);
+		virtual STFResult StartDisplayBitmapsSet(void);
+		virtual STFResult FinishAndShowDisplayBitmapsSet(void);
+		virtual STFResult DisplayBitmap(IVDRGfxBitmap* dispBmp, VDRGfxRect* srcRect, VDRGfxRect* destRect, uint8 alpha, uint32 zOrder);
+		virtual STFResult SetCursorBitmap(IVDRGfxBitmap* cursorBmp, VDRGfxRect* srcRect, VDRGfxRect* destRect);
+		virtual STFResult IsBusy(IVDRGfxBitmap* bmp);
+		virtual STFResult MoveCursorTo(int32 x, int32 y);
+	};
+
+#endif // VIDEOCOMPOSITOR_H
@@ -0,0 +1,130 @@
+///
+/// @brief      Alpha blending of 8 bit video planes
+///
+
+#include "VideoPlaneBlender.h"
+
+#if VIDEO_PLANE_BLENDER_SIMD
+#include <immintrin.h>
+#endif
+
+typedef void (* VideoPlaneBlenderFunction)(uint8 * dst, const uint8 * src, const uint8 * alpha, uint32 num);
+
+
+static void BlendPremultipliedPixelsScalar(uint8 * dst, const uint8 * src, const uint8 * alpha, uint32 num)
+	{
+	uint32	i, sum;
+
+	for (i = 0; i < num; i++)
+		{
+		sum = src[i] + VideoPlaneScale(dst[i], 255 - alpha[i]);
+
+		dst[i] = (uint8)(sum > 255 ? 255 : sum);
+		}
+	}
+
+
+#if VIDEO_PLANE_BLENDER_SIMD
+
+//
+// The pixels are widened to 16 bits for the multiplication. Unpacking and packing both
+// work within 128 bit lanes, so the pixel order is preserved.
+//
+
+__attribute__((target("sse2")))
+static inline __m128i ScalePixelsSSE2(__m128i pixels, __m128i factors, __m128i round)
+	{
+	__m128i	zero = _mm_setzero_si128();
+	__m128i	lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_unpacklo_epi8(factors, zero)), round);
+	__m128i	hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), _mm_unpackhi_epi8(factors, zero)), round);
+
+	lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+	hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+	return _mm_packus_epi16(lo, hi);
+	}
+
+
+__attribute__((target("sse2")))
+static void BlendPremultipliedPixelsSSE2(uint8 * dst, const uint8 * src, const uint8 * alpha, uint32 num)
+	{
+	const __m128i	ones = _mm_set1_epi8((char)0xff);
+	const __m128i	round = _mm_set1_epi16(128);
+	__m128i			inverse;
+	uint32			i = 0;
+
+	for (; i + 16 <= num; i += 16)
+		{
+		inverse = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(alpha + i)), ones);
+
+		_mm_storeu_si128((__m128i *)(dst + i),
+							  _mm_adds_epu8(_mm_loadu_si128((const __m128i *)(src + i)),
+												 ScalePixelsSSE2(_mm_loadu_si128((const __m128i *)(dst + i)), inverse, round)));
+		}
+
+	BlendPremultipliedPixelsScalar(dst + i, src + i, alpha + i, num - i);
+	}
+
+
+__attribute__((target("avx2")))
+static inline __m256i ScalePixelsAVX2(__m256i pixels, __m256i factors, __m256i round)
+	{
+	__m256i	zero = _mm256_setzero_si256();
+	__m256i	lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(pixels, zero), _mm256_unpacklo_epi8(factors, zero)), round);
+	__m256i	hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(pixels, zero), _mm256_unpackhi_epi8(factors, zero)), round);
+
+	lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+	hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+
+	return _mm256_packus_epi16(lo, hi);
+	}
+
+
+__attribute__((target("avx2")))
+static void BlendPremultipliedPixelsAVX2(uint8 * dst, const uint8 * src, const uint8 * alpha, uint32 num)
+	{
+	const __m256i	ones = _mm256_set1_epi8((char)0xff);
+	const __m256i	round = _mm256_set1_epi16(128);
+	__m256i			inverse;
+	uint32			i = 0;
+
+	for (; i + 32 <= num; i += 32)
+		{
+		inverse = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(alpha + i)), ones);
+
+		_mm256_storeu_si256((__m256i *)(dst + i),
+								  _mm256_adds_epu8(_mm256_loadu_si256((const __m256i *)(src + i)),
+														 ScalePixelsAVX2(_mm256_loadu_si256((const __m256i *)(dst + i)), inverse, round)));
+		}
+
+	BlendPremultipliedPixelsSSE2(dst + i, src + i, alpha + i, num - i);
+	}
+
+#endif // VIDEO_PLANE_BLENDER_SIMD
+
+
+static VideoPlaneBlenderFunction SelectVideoPlaneBlender(void)
+	{
+#if VIDEO_PLANE_BLENDER_SIMD
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return BlendPremultipliedPixelsAVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return BlendPremultipliedPixelsSSE2;
+#endif
+
+	return BlendPremultipliedPixelsScalar;
+	}
+
+
+void BlendPremultipliedPixels(uint8 * dst, const uint8 * src, const uint8 * alpha, uint32 num)
+	{
+	// Selecting the function is idempotent, so concurrent first calls do no harm
+	static VideoPlaneBlenderFunction blender = NULL;
+
+	if (!blender)
+		blender = SelectVideoPlaneBlender();
+
+	blender(dst, src, alpha, num);
+	}
@@ -0,0 +1,35 @@
+///
+/// @brief      Alpha blending of 8 bit video planes
+///
+
+#ifndef VIDEOPLANEBLENDER_H
+#define VIDEOPLANEBLENDER_H
+
+#include "STF/Interface/Types/STFBasicTypes.h"
+
+/// Enables the SSE2/AVX2 versions of the plane blender on x86 targets, selected at runtime
+#ifndef VIDEO_PLANE_BLENDER_SIMD
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define VIDEO_PLANE_BLENDER_SIMD	1
+#else
+#define VIDEO_PLANE_BLENDER_SIMD	0
+#endif
+#endif
+
+///
+/// Multiply an 8 bit value by an 8 bit factor, with 255 representing 1.0
+///
+static inline uint32 VideoPlaneScale(uint32 value, uint32 factor)
+	{
+	uint32	t = value * factor + 128;
+
+	return (t + (t >> 8)) >> 8;
+	}
+
+///
+/// Blend num pixels of a premultiplied overlay row over the pixels in dst:
+/// dst = src + dst * (255 - alpha) / 255, saturated to 255.
+///
+void BlendPremultipliedPixels(uint8 * dst, const uint8 * src, const uint8 * alpha, uint32 num);
+
+#endif // VIDEOPLANEBLENDER_H
@@ -137,6 +137,9 @@ VirtualSDL2VideoRendererUnit::VirtualSDL2VideoRendererUnit (SDL2VideoRendererUni
 	this->physicalSDL2VideoRendererUnit = physical;
 	this->startTimeValid = false;
 	this->endTimeValid = false;
+
+	// The unit waits for the display time of each frame, so it keeps its own thread instead of
+	// using the streaming unit executor
 	}
 
 VirtualSDL2VideoRendererUnit::~VirtualSDL2VideoRendererUnit()
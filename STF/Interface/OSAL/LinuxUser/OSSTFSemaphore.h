@@ -8,6 +8,7 @@
 // Includes
 #include <semaphore.h>
 
+#include "STF/Interface/Types/STFBasicTypes.h"
 #include "STF/Interface/Types/STFResult.h"
 #include "STF/Interface/Types/STFTime.h"
 
@@ -41,6 +42,123 @@ class OSSTFTimeoutSemaphore : public OSSTFSemaphore
 	};
 
 
+//
+// Selection of the interlocked operations backend.
+//
+// With OSSTF_INTERLOCKED_HARDWARE_ATOMICS set, the interlocked int and pointer
+// classes use the compiler's atomic builtins, which map to lock-free read-modify-write
+// and compare-and-swap instructions of the CPU. Otherwise every operation is
+// serialized through the process-wide OSSTFGlobalLock(), which works with any
+// toolchain but makes the global lock the hottest lock in a multi-stream system.
+//
+#ifndef OSSTF_INTERLOCKED_HARDWARE_ATOMICS
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+#define OSSTF_INTERLOCKED_HARDWARE_ATOMICS	1
+#else
+#define OSSTF_INTERLOCKED_HARDWARE_ATOMICS	0
+#endif
+#endif
+
+#if OSSTF_INTERLOCKED_HARDWARE_ATOMICS
+
+//! Thread-safe and Interrupt-safe access to an integer variable
+/*!
+	Read-modify-write operations and CompareExchange have acquire/release semantics, so that
+	they can be used for reference counting and for publishing data to other threads.
+	Plain reads are acquire loads, plain assignments are release stores.
+*/
+class OSSTFInterlockedInt
+	{
+	protected:
+		volatile int32		value;
+
+	public:
+		OSSTFInterlockedInt(int32 init = 0)
+			: value(init) {}
+
+		int32 operator=(int32 val)
+			{
+			__atomic_store_n(&value, val, __ATOMIC_RELEASE);
+			return val;
+			}
+		
+		int32 operator++(void)
+			{
+			return __atomic_add_fetch(&value, 1, __ATOMIC_ACQ_REL);
+			}
+
+		int32 operator++(int)
+			{
+			return __atomic_fetch_add(&value, 1, __ATOMIC_ACQ_REL);
+			}
+
+		int32 operator--(void)
+			{
+			return __atomic_sub_fetch(&value, 1, __ATOMIC_ACQ_REL);
+			}
+
+		int32 operator--(int)
+			{
+			return __atomic_fetch_sub(&value, 1, __ATOMIC_ACQ_REL);
+			}
+
+		int32 operator+=(int add)	
+			{
+			return __atomic_add_fetch(&value, add, __ATOMIC_ACQ_REL);
+			}
+
+		int32 operator-=(int sub)
+ 			{
+			return __atomic_sub_fetch(&value, sub, __ATOMIC_ACQ_REL);
+			}
+
+		int32 CompareExchange(int32 cmp, int32 val)
+			{
+			// Compare value to cmp. If they match, replace value by val and return old value.
+			// On failure the builtin stores the current value into cmp.
+			__atomic_compare_exchange_n(&value, &cmp, val, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+
+			return cmp;
+			}
+
+		operator int32(void)
+			{
+			return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+			}
+		};
+
+class OSSTFInterlockedPointer
+	{
+	protected:
+		volatile pointer					ptr;
+    
+	public:
+		OSSTFInterlockedPointer(pointer val = NULL)
+			: ptr(val) {}
+
+		pointer operator=(pointer val)
+			{
+			__atomic_store_n(&ptr, val, __ATOMIC_RELEASE);
+
+			return val;
+			}
+
+		pointer CompareExchange(pointer cmp, pointer val)
+			{
+			// Compare ptr to cmp. If they match, replace ptr by val and return old ptr value
+			__atomic_compare_exchange_n(&ptr, &cmp, val, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+
+			return cmp;
+			}
+
+		operator pointer(void)
+			{
+			return __atomic_load_n(&ptr, __ATOMIC_ACQUIRE);
+			}
+	};
+
+#else // OSSTF_INTERLOCKED_HARDWARE_ATOMICS
+
 //! Thread-safe and Interrupt-safe access to an integer variable
 class OSSTFInterlockedInt
 	{
@@ -169,4 +287,167 @@ class OSSTFInterlockedPointer
 			}
 	};
 
+#endif // OSSTF_INTERLOCKED_HARDWARE_ATOMICS
+
+//
+// On x86-64 the tagged pointer is a pair of 64 bit words swapped with cmpxchg16b,
+// which every x86-64 CPU supported by the drivers provides.
+//
+#if OSSTF_INTERLOCKED_HARDWARE_ATOMICS && defined(__x86_64__)
+#define OSSTF_INTERLOCKED_DOUBLE_WIDTH_TAG	1
+#else
+#define OSSTF_INTERLOCKED_DOUBLE_WIDTH_TAG	0
+#endif
+
+//! Pointer with a generation tag, both exchanged in a single atomic operation
+/*!
+	Every successful CompareExchange increments the tag, so a compare against a (pointer, tag)
+	pair read earlier fails if the pointer has been replaced and restored in between (ABA).
+
+	On x86-64 the pointer and a 32 bit tag are kept in two words, which are swapped together
+	with a double width compare-and-swap. On 32 bit targets they are packed into one 64 bit
+	word, again with a 32 bit tag. A 32 bit tag only repeats if a thread is preempted between
+	Get() and CompareExchange() for 2^32 exchanges of the same pointer.
+
+	Other 64 bit targets keep the tag in the upper 16 bits of the (user space, canonical)
+	address, so there it wraps after 65536 exchanges. An ABA race then needs exactly a multiple
+	of 65536 exchanges while one thread is preempted, ending with the same node on top.
+*/
+class OSSTFInterlockedTaggedPointer
+	{
+	protected:
+#if OSSTF_INTERLOCKED_DOUBLE_WIDTH_TAG
+		// The pointer in the first, the tag in the second word
+		volatile uint64	value[2] __attribute__((aligned(16)));
+
+		bool CompareExchange128(uint64 cmpPtr, uint64 cmpTag, uint64 xchgPtr, uint64 xchgTag)
+			{
+			bool result;
+
+			__asm__ __volatile__ ("lock; cmpxchg16b %1\n\tsete %0"
+										 : "=q" (result), "+m" (value[0]), "+a" (cmpPtr), "+d" (cmpTag)
+										 : "b" (xchgPtr), "c" (xchgTag)
+										 : "memory", "cc");
+
+			return result;
+			}
+#else
+		volatile uint64	value;
+
+		static uint64 Pack(pointer ptr, uint32 tag)
+			{
+			if (sizeof(pointer) > sizeof(uint32))
+				return ((uint64)(uintptr_t)ptr & ((((uint64)1) << 48) - 1)) | ((uint64)(tag & 0xffff) << 48);
+			else
+				return (uint64)(uintptr_t)ptr | ((uint64)tag << 32);
+			}
+
+		static pointer UnpackPointer(uint64 val)
+			{
+			if (sizeof(pointer) > sizeof(uint32))
+				return (pointer)(uintptr_t)(val & ((((uint64)1) << 48) - 1));
+			else
+				return (pointer)(uintptr_t)(uint32)val;
+			}
+
+		static uint32 UnpackTag(uint64 val)
+			{
+			if (sizeof(pointer) > sizeof(uint32))
+				return (uint32)(val >> 48);
+			else
+				return (uint32)(val >> 32);
+			}
+
+		uint64 Load(void)
+			{
+#if OSSTF_INTERLOCKED_HARDWARE_ATOMICS
+			return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+#else
+			OSSTFGlobalLock();
+			uint64 result = value;
+			OSSTFGlobalUnlock();
+			return result;
+#endif
+			}
+#endif
+
+	public:
+		OSSTFInterlockedTaggedPointer(pointer val = NULL)
+			{
+#if OSSTF_INTERLOCKED_DOUBLE_WIDTH_TAG
+			value[0] = (uint64)(uintptr_t)val;
+			value[1] = 0;
+#else
+			value = Pack(val, 0);
+#endif
+			}
+
+		//! Read pointer and tag as one consistent pair
+		void Get(pointer & ptr, uint32 & tag)
+			{
+#if OSSTF_INTERLOCKED_DOUBLE_WIDTH_TAG
+			//
+			// The words are read one by one, the tag first. If an exchange happens in between,
+			// the pointer belongs to a newer tag. Such a pair does not match the current value,
+			// so the next CompareExchange fails and the caller retries.
+			//
+			tag = (uint32)__atomic_load_n(&value[1], __ATOMIC_ACQUIRE);
+			ptr = (pointer)(uintptr_t)__atomic_load_n(&value[0], __ATOMIC_ACQUIRE);
+#else
+			uint64 val = Load();
+
+			ptr = UnpackPointer(val);
+			tag = UnpackTag(val);
+#endif
+			}
+
+		//! Replace the pointer by val if both pointer and tag still match, bumping the tag
+		bool CompareExchange(pointer cmpPtr, uint32 cmpTag, pointer val)
+			{
+#if OSSTF_INTERLOCKED_DOUBLE_WIDTH_TAG
+			return CompareExchange128((uint64)(uintptr_t)cmpPtr, cmpTag, (uint64)(uintptr_t)val, (uint32)(cmpTag + 1));
+#else
+			uint64 cmp = Pack(cmpPtr, cmpTag);
+			uint64 xchg = Pack(val, cmpTag + 1);
+
+#if OSSTF_INTERLOCKED_HARDWARE_ATOMICS
+			return __atomic_compare_exchange_n(&value, &cmp, xchg, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#else
+			bool result;
+
+			OSSTFGlobalLock();
+
+			result = (value == cmp);
+			if (result)
+				value = xchg;
+
+			OSSTFGlobalUnlock();
+
+			return result;
+#endif
+#endif
+			}
+
+		pointer operator=(pointer val)
+			{
+			pointer	p;
+			uint32	tag;
+
+			do {
+				Get(p, tag);
+				} while (!CompareExchange(p, tag, val));
+
+			return val;
+			}
+
+		operator pointer(void)
+			{
+#if OSSTF_INTERLOCKED_DOUBLE_WIDTH_TAG
+			return (pointer)(uintptr_t)__atomic_load_n(&value[0], __ATOMIC_ACQUIRE);
+#else
+			return UnpackPointer(Load());
+#endif
+			}
+	};
+
 #endif
@@ -12,6 +12,122 @@
 
 #define OSSTFSIGNAL_OS21_EVENT_MASK	(0x1)
 
+//
+// Selection of the signal backend.
+//
+// With OSSTF_SIGNAL_FUTEX set, a signal is a single futex word that holds the signal flag
+// and the number of sleeping waiters.  Setting a signal that is already set, or that has no
+// sleeping waiter, stays in user space.  Repeated SetSignal calls before a wait coalesce into
+// one pending signal, like the auto clearing events of OS21 and WIN32.  A waiter spins
+// adaptively for a short while before it goes to sleep.  Otherwise the signal is a semaphore,
+// which counts each SetSignal and enters the kernel for each of them.
+//
+#ifndef OSSTF_SIGNAL_FUTEX
+#define OSSTF_SIGNAL_FUTEX	OSSTF_INTERLOCKED_HARDWARE_ATOMICS
+#endif
+
+/// Default upper limit for the number of polls of a signal before a waiter sleeps
+#define OSSTFSIGNAL_DEFAULT_SPIN_COUNT	100
+
+#if OSSTF_SIGNAL_FUTEX
+
+class OSSTFSignal
+	{
+	protected:
+		/// Bit 0 is the signal flag, the upper bits count the threads sleeping on the futex
+		volatile int32		state;
+
+		/// Upper limit for polls before sleeping, and the adaptive estimate below that limit
+		uint32				maxSpin;
+		uint32				spin;
+
+		bool TryConsumeSignal(void)
+			{
+			int32 s = __atomic_load_n(&state, __ATOMIC_RELAXED);
+
+			while (s & 1)
+				{
+				if (__atomic_compare_exchange_n(&state, &s, s & ~1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+					return true;
+				}
+
+			return false;
+			}
+
+		void WakeWaiter(void);
+
+		STFResult WaitSignalSlow(const STFLoPrec32BitDuration * duration);
+
+	public:
+		OSSTFSignal(void)
+			{
+			state = 0;
+			maxSpin = OSSTFSIGNAL_DEFAULT_SPIN_COUNT;
+			spin = 0;
+			}
+
+		~OSSTFSignal(void)
+			{
+			}
+
+		STFResult SetSignal(void)
+			{
+			int32 s = __atomic_fetch_or(&state, 1, __ATOMIC_ACQ_REL);
+
+			// Only a newly set signal with sleeping waiters needs the kernel
+			if (!(s & 1) && s >= 2)
+				WakeWaiter();
+
+			STFRES_RAISE_OK;
+			}
+
+		STFResult ResetSignal(void)
+			{
+			__atomic_fetch_and(&state, ~1, __ATOMIC_ACQ_REL);
+
+			STFRES_RAISE_OK;
+			}
+
+		STFResult WaitSignal(void)
+			{
+			if (TryConsumeSignal())
+				STFRES_RAISE_OK;
+
+			STFRES_RAISE(WaitSignalSlow(NULL));
+			}
+
+		STFResult WaitImmediateSignal(void)
+			{
+			if (!TryConsumeSignal())
+				STFRES_RAISE(STFRES_OPERATION_FAILED);
+
+			STFRES_RAISE_OK;
+			}
+
+		//! Sets the upper limit for polls of the signal before a waiter sleeps, 0 disables spinning
+		STFResult SetSpinCount(uint32 spinCount)
+			{
+			maxSpin = spinCount;
+			spin = 0;
+
+			STFRES_RAISE_OK;
+			}
+	};
+
+class OSSTFTimeoutSignal : public OSSTFSignal
+	{
+	public:
+		STFResult WaitTimeoutSignal(const STFLoPrec32BitDuration & duration)
+			{
+			if (TryConsumeSignal())
+				STFRES_RAISE_OK;
+
+			STFRES_RAISE(WaitSignalSlow(&duration));
+			}
+	};
+
+#else // OSSTF_SIGNAL_FUTEX
+
 class OSSTFSignal
 	{
 	protected:
@@ -58,6 +174,11 @@ class OSSTFSignal
 //			STFRES_RAISE_OK;
 			}
 
+		STFResult SetSpinCount(uint32 spinCount)
+			{
+			STFRES_RAISE_OK;
+			}
+
 		STFResult WaitImmediateSignal(void)
 			{
 //			unsigned int outMask;
@@ -91,6 +212,8 @@ class OSSTFTimeoutSignal : public OSSTFSignal
 			}
 	};
 
+#endif // OSSTF_SIGNAL_FUTEX
+
 class OSSTFArmedSignal
 	{
 	protected:
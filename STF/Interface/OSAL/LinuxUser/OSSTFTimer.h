@@ -18,6 +18,33 @@
 
 void Calculate108MhzMultiplier(STFInt64 SystemTicksPerSecond);
 
+
+/// Clock backends for OSSTFTimer::GetTime
+enum OSSTFClockSource
+	{
+	OSSTFCS_WALLCLOCK,		///< gettimeofday, microsecond resolution, jumps when the wall clock is set
+	OSSTFCS_MONOTONIC,		///< CLOCK_MONOTONIC, never steps, rate is slewed by NTP
+	OSSTFCS_MONOTONIC_RAW,	///< CLOCK_MONOTONIC_RAW, never steps, raw hardware rate
+	OSSTFCS_TSC					///< Calibrated time stamp counter, falls back to CLOCK_MONOTONIC_RAW if not usable
+	};
+
+/// Clock backend used unless another one is selected before InitializeOSSTFTimer
+#define OSSTFTIMER_DEFAULT_CLOCK_SOURCE	OSSTFCS_MONOTONIC
+
+/// Rate of the system ticks of all clock backends.  This is the MPEG system clock, so the
+/// conversion to and from the 108MHz time base is exact.
+#define OSSTFTIMER_TICKS_PER_SECOND			27000000
+
+//! Select the clock backend, must be called before InitializeOSSTFTimer
+/*! Switching the clock later would let the time jump, so this returns STFRES_OBJECT_IN_USE
+    once the timer is initialized.
+*/
+STFResult SelectOSSTFClockSource(OSSTFClockSource source);
+
+//! Returns the clock backend actually in use
+OSSTFClockSource GetOSSTFClockSource(void);
+
+
 class OSSTFTimer
 	{
 	public:		
@@ -99,6 +99,112 @@ class OSSTFInterlockedPointer
 			}
 	};
 
+//! Pointer with a generation tag, both exchanged in a single atomic operation
+/*!
+	Every successful CompareExchange increments the tag, so a compare against a (pointer, tag)
+	pair read earlier fails if the pointer has been replaced and restored in between (ABA).
+	On 64 bit targets pointer and tag are two words swapped with InterlockedCompareExchange128,
+	on 32 bit targets they are packed into one 64 bit word. The tag has 32 bits in both cases.
+*/
+class OSSTFInterlockedTaggedPointer
+	{
+	protected:
+#ifdef _WIN64
+		// The pointer in the low, the tag in the high word
+		__declspec(align(16)) volatile LONGLONG	value[2];
+#else
+		volatile LONGLONG	value;
+
+		// The 32 bit packing below would truncate wider pointers
+		typedef char PointerSizeCheck[sizeof(pointer) == sizeof(DWORD) ? 1 : -1];
+
+		static LONGLONG Pack(pointer ptr, uint32 tag)
+			{
+			return (LONGLONG)(((ULONGLONG)tag << 32) | (ULONGLONG)(DWORD)ptr);
+			}
+
+		static pointer UnpackPointer(LONGLONG val)
+			{
+			return (pointer)(DWORD)val;
+			}
+
+		static uint32 UnpackTag(LONGLONG val)
+			{
+			return (uint32)((ULONGLONG)val >> 32);
+			}
+#endif
+
+	public:
+#ifdef _WIN64
+		OSSTFInterlockedTaggedPointer(pointer val = NULL)
+			{
+			value[0] = (LONGLONG)(ULONG_PTR)val;
+			value[1] = 0;
+			}
+
+		void Get(pointer & ptr, uint32 & tag)
+			{
+			// A compare exchange with identical compare and exchange values is an atomic 128 bit read
+			LONGLONG val[2] = {0, 0};
+
+			::InterlockedCompareExchange128(value, 0, 0, val);
+
+			ptr = (pointer)(ULONG_PTR)val[0];
+			tag = (uint32)val[1];
+			}
+
+		bool CompareExchange(pointer cmpPtr, uint32 cmpTag, pointer val)
+			{
+			LONGLONG cmp[2];
+
+			cmp[0] = (LONGLONG)(ULONG_PTR)cmpPtr;
+			cmp[1] = (LONGLONG)cmpTag;
+
+			return ::InterlockedCompareExchange128(value, (LONGLONG)(uint32)(cmpTag + 1), (LONGLONG)(ULONG_PTR)val, cmp) != 0;
+			}
+#else
+		OSSTFInterlockedTaggedPointer(pointer val = NULL)
+			: value(Pack(val, 0)) {}
+
+		void Get(pointer & ptr, uint32 & tag)
+			{
+			// A compare exchange with identical compare and exchange values is an atomic 64 bit read
+			LONGLONG val = ::InterlockedCompareExchange64(&value, 0, 0);
+
+			ptr = UnpackPointer(val);
+			tag = UnpackTag(val);
+			}
+
+		bool CompareExchange(pointer cmpPtr, uint32 cmpTag, pointer val)
+			{
+			LONGLONG cmp = Pack(cmpPtr, cmpTag);
+
+			return ::InterlockedCompareExchange64(&value, Pack(val, cmpTag + 1), cmp) == cmp;
+			}
+#endif
+
+		pointer operator=(pointer val)
+			{
+			pointer	p;
+			uint32	tag;
+
+			do {
+				Get(p, tag);
+				} while (!CompareExchange(p, tag, val));
+
+			return val;
+			}
+
+		operator pointer(void)
+			{
+			pointer	p;
+			uint32	tag;
+
+			Get(p, tag);
+			return p;
+			}
+	};
+
 class OSSTFSemaphore
 	{
 	protected:
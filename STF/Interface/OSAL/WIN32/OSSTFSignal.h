@@ -37,6 +37,11 @@ class OSSTFSignal
 			STFRES_RAISE_OK;
 			}
 
+		STFResult SetSpinCount(uint32 spinCount)
+			{
+			STFRES_RAISE_OK;
+			}
+
 		STFResult WaitImmediateSignal(void)
 			{
 			HRESULT	hr;
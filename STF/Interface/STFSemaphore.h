@@ -65,6 +65,30 @@ class STFInterlockedPointer
    operator pointer(void);
    };
 
+//! Pointer with a generation tag to detect ABA races in lock-free algorithms
+/*! Each successful CompareExchange increments the tag. A CompareExchange only succeeds if both the pointer and the
+  tag still have the values previously obtained with Get(), so an intermediate replace-and-restore of the pointer
+  by another thread is detected.
+*/
+class STFInterlockedTaggedPointer
+   {
+   protected:
+   OSSTFInterlockedTaggedPointer	osp;
+   public:
+   STFInterlockedTaggedPointer(pointer val = NULL);
+
+   //! Assignment, bumps the tag
+   pointer operator=(pointer val);
+
+   //! Atomically read pointer and tag
+   void Get(pointer & ptr, uint32 & tag);
+
+   //! Replace the pointer by val if pointer and tag match cmpPtr and cmpTag, returns true on success
+   bool CompareExchange(pointer cmpPtr, uint32 cmpTag, pointer val);
+
+   operator pointer(void);
+   };
+
 /*! All objects which you want to push on the STFInterlockedStack (see below) must be derived from STFInterlockedNode.
   No implementation is neccessary.
 */
@@ -78,12 +102,17 @@ class STFInterlockedNode
 //! A thread-safe stack whose operations are atomic
 /*!
   This stack provides the standard stack operarions but these are implemeted as atomic operations so you you use these
-  from different concurrent threads. All classes you want to used with this stack must be derived from STFInterlockedNode
+  from different concurrent threads. All classes you want to used with this stack must be derived from STFInterlockedNode.
+
+  The stack is lock-free and ABA-safe: the top pointer carries a generation tag, so a Pop() racing with a
+  Pop()/Push() sequence that restores the same top node fails its compare and retries instead of corrupting
+  the list. Nodes must stay allocated as long as they may be accessed through the stack (e.g. packets owned
+  by a connector's packet store).
 */
 class STFInterlockedStack
    {
    protected:
-   STFInterlockedPointer	top;
+   STFInterlockedTaggedPointer	top;
    public:
    STFInterlockedStack(void);
 
@@ -324,6 +353,23 @@ inline pointer STFInterlockedPointer::CompareExchange(pointer cmp, pointer val)
 inline STFInterlockedPointer::operator pointer(void)
    {return osp;}
 
+// STFInterlockedTaggedPointer
+
+inline STFInterlockedTaggedPointer::STFInterlockedTaggedPointer(pointer val)
+   : osp(val) {}
+
+inline pointer STFInterlockedTaggedPointer::operator=(pointer val)
+   {return osp = val;}
+
+inline void STFInterlockedTaggedPointer::Get(pointer & ptr, uint32 & tag)
+   {osp.Get(ptr, tag);}
+
+inline bool STFInterlockedTaggedPointer::CompareExchange(pointer cmpPtr, uint32 cmpTag, pointer val)
+   {return osp.CompareExchange(cmpPtr, cmpTag, val);}
+
+inline STFInterlockedTaggedPointer::operator pointer(void)
+   {return osp;}
+
 // STFInterlockedStack
 		
 inline STFInterlockedStack::STFInterlockedStack(void)
@@ -331,32 +377,31 @@ inline STFInterlockedStack::STFInterlockedStack(void)
 
 inline void STFInterlockedStack::Push(STFInterlockedNode * node)
    {
-   pointer	p	= top;
-   pointer	n;
+   pointer	p;
+   uint32	tag;
 
    do {
-      n = p;
-      node->node = (STFInterlockedNode *)n;
-      p = top.CompareExchange(n, node);
-      } while (n != p);
+      top.Get(p, tag);
+      node->node = (STFInterlockedNode *)p;
+      } while (!top.CompareExchange(p, tag, node));
    }
 
 inline STFInterlockedNode * STFInterlockedStack::Pop(void)
    {
-   pointer	p	= top;
-   pointer	n;
-
-   if (p)
-      {
-      do {
-         n = p;
-         p = top.CompareExchange(p, ((STFInterlockedNode *)p)->node);
-         } while (n && n != p);
-
-      return (STFInterlockedNode *)n;
-      }
-   else
-      return NULL;
+   pointer	p;
+   uint32	tag;
+
+   //
+   // The next pointer of the top node may be stale if another thread popped that node
+   // meanwhile, but then the tag has changed as well and the compare exchange fails.
+   //
+   do {
+      top.Get(p, tag);
+      if (!p)
+         return NULL;
+      } while (!top.CompareExchange(p, tag, ((STFInterlockedNode *)p)->node));
+
+   return (STFInterlockedNode *)p;
    }
 
 inline STFInterlockedNode * STFInterlockedStack::Top(void)
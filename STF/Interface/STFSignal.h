@@ -28,6 +28,9 @@ class STFSignal : virtual public STFWaitable, virtual public STFSignalable
 		STFResult WaitSignal(void);
 		STFResult WaitImmediateSignal(void);
 
+		//! Upper limit for polls of the signal before a waiter sleeps, where the OS supports spinning
+		STFResult SetSpinCount(uint32 spinCount);
+
 		//
 		// Interface calls (for descriptions see STFSignallable and STFWaitable interfaces above)
 		//
@@ -56,6 +59,8 @@ class STFTimeoutSignal : virtual public STFTimeoutWaitable, virtual public STFSi
 		STFResult WaitImmediateSignal(void);
 		STFResult WaitTimeoutSignal(const STFLoPrec32BitDuration & duration);
 
+		STFResult SetSpinCount(uint32 spinCount);
+
 		//
 		// Interface calls
 		//
@@ -127,6 +132,9 @@ inline STFResult STFSignal::WaitSignal(void)
 inline STFResult STFSignal::WaitImmediateSignal(void)
 	{STFRES_RAISE(oss.WaitImmediateSignal());}
 
+inline STFResult STFSignal::SetSpinCount(uint32 spinCount)
+	{STFRES_RAISE(oss.SetSpinCount(spinCount));}
+
 // Interface calls
 
 inline STFResult STFSignal::Set(void)
@@ -164,6 +172,9 @@ inline STFResult STFTimeoutSignal::WaitTimeoutSignal(const STFLoPrec32BitDuratio
 	STFRES_RAISE_OK;
 	}
 
+inline STFResult STFTimeoutSignal::SetSpinCount(uint32 spinCount)
+	{STFRES_RAISE(oss.SetSpinCount(spinCount));}
+
 inline STFResult STFTimeoutSignal::Set(void)
 	{STFRES_RAISE(oss.SetSignal());}
 
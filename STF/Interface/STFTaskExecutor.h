@@ -0,0 +1,205 @@
+///
+/// @brief OS-independent work-stealing task executor
+///
+
+#ifndef STFTASKEXECUTOR_H
+#define STFTASKEXECUTOR_H
+
+#include "STF/Interface/Types/STFResult.h"
+#include "STF/Interface/Types/STFBasicTypes.h"
+#include "STF/Interface/STFSynchronisation.h"
+#include "STF/Interface/STFThread.h"
+
+class STFTaskExecutor;
+class STFTaskExecutorWorker;
+
+/// @name Scheduling states of an STFExecutorTask
+//@{
+static const int32 STFETS_IDLE					= 0;	///< Not queued, not running
+static const int32 STFETS_QUEUED					= 1;	///< Queued at one of the workers
+static const int32 STFETS_RUNNING				= 2;	///< Executed by a worker
+static const int32 STFETS_RUNNING_RESCHEDULED	= 3;	///< Executed by a worker and scheduled again meanwhile
+//@}
+
+///
+/// @class STFExecutorTask
+/// @brief Unit of work that can be scheduled on an STFTaskExecutor
+///
+/// A task is queued at most once at a time and is never executed by two workers
+/// concurrently. If it is scheduled while it is running, the worker executes it
+/// again right after the current run completes, so scheduling requests are never lost
+/// but may be merged.
+///
+class STFExecutorTask
+	{
+	friend class STFTaskExecutor;
+	friend class STFTaskExecutorWorker;
+
+	private:
+		STFInterlockedInt		taskState;
+		STFExecutorTask	*	prevTask;
+		STFExecutorTask	*	nextTask;
+
+		// A task becomes idle only while idleMutex is held, so a waiter that has seen it
+		// idle under the mutex knows the executor does not touch it anymore
+		STFMutex					idleMutex;
+		STFSignal				idleSignal;
+
+		/// Change the state from RUNNING to IDLE, returns false if it was scheduled again meanwhile
+		bool CompleteRun(void);
+
+		/// Return a queued task to IDLE without running it
+		void CancelTask(void);
+
+	protected:
+		/// Called by a worker thread of the executor each time the task is run
+		virtual void ExecuteTask(void) = 0;
+
+	public:
+		STFExecutorTask(void);
+		virtual ~STFExecutorTask(void) {}
+
+		/// Returns true if the task is neither queued nor running
+		bool IsTaskIdle(void);
+
+		/// Block until the task is neither queued nor running
+		/// Only one thread may wait for a task at a time.
+		void WaitTaskIdle(void);
+	};
+
+///
+/// @class STFTaskExecutorWorker
+/// @brief Worker thread of an STFTaskExecutor, owning a double ended task queue
+///
+/// The owning worker pushes and pops tasks at the head of its queue, other workers
+/// steal from the tail.
+///
+class STFTaskExecutorWorker : public STFThread
+	{
+	friend class STFTaskExecutor;
+
+	protected:
+		STFTaskExecutor	*	executor;
+		uint32					index;
+
+		STFMutex					mutex;
+		STFExecutorTask	*	head;
+		STFExecutorTask	*	tail;
+
+		void ThreadEntry(void);
+		STFResult NotifyThreadTermination(void);
+
+		void PushTask(STFExecutorTask * task);
+		STFExecutorTask * PopTask(void);
+		STFExecutorTask * StealTask(void);
+
+		/// Remove the given task from the queue, returns false if it is not queued here
+		bool RemoveTask(STFExecutorTask * task);
+
+	public:
+		STFTaskExecutorWorker(STFTaskExecutor * executor, uint32 index, STFString name, uint32 stackSize, STFThreadPriority priority);
+	};
+
+///
+/// @class STFTaskExecutor
+/// @brief Fixed pool of worker threads executing STFExecutorTasks
+///
+/// Tasks scheduled from a worker thread are queued at that worker, so that chains of
+/// tasks scheduling each other tend to stay on one core. Tasks scheduled from other
+/// threads are distributed round robin. Idle workers steal tasks from the other
+/// workers' queues before going to sleep.
+///
+class STFTaskExecutor
+	{
+	friend class STFTaskExecutorWorker;
+
+	protected:
+		STFTaskExecutorWorker	**	workers;
+		uint32							numWorkers;
+
+		STFInterlockedInt				nextWorker;
+		STFInterlockedInt				idleWorkers;
+		STFSemaphore					wakeup;
+		volatile bool					terminate;
+		bool								running;
+
+		void WorkerLoop(uint32 index);
+		STFExecutorTask * FindTask(uint32 index);
+		void RunTask(STFExecutorTask * task);
+
+	public:
+		/// @param name: base name of the worker threads
+		/// @param numWorkers: number of worker threads, 0 for one worker per processor
+		/// @param stackSize: stack size of each worker thread
+		/// @param priority: priority of the worker threads
+		STFTaskExecutor(STFString name, uint32 numWorkers, uint32 stackSize, STFThreadPriority priority);
+		virtual ~STFTaskExecutor(void);
+
+		/// Start the worker threads
+		STFResult Start(void);
+
+		/// Stop the worker threads and wait until they have exited. Tasks still queued are not executed,
+		/// they are returned to idle, which releases threads waiting in WaitTaskIdle().
+		/// Scheduling fails with STFRES_OBJECT_INVALID until the executor is started again.
+		STFResult Stop(void);
+
+		/// Schedule a task for execution
+		/// If the task is already queued, this call has no effect. If it is currently running
+		/// it is executed once more after the current run.
+		STFResult Schedule(STFExecutorTask * task);
+
+		uint32 GetNumberOfWorkers(void) {return numWorkers;}
+	};
+
+///
+/// @class STFSchedulableThread
+/// @brief Thread that can alternatively be executed as a task of an STFTaskExecutor
+///
+/// Derived classes implement ProcessThreadSignal(), which is called once for each
+/// thread signal (merged if several signals arrive meanwhile). Without an executor,
+/// this class behaves like an STFThread whose ThreadEntry waits for the thread signal
+/// and calls ProcessThreadSignal() until the thread is stopped. With an executor set,
+/// no OS thread is created. SetThreadSignal() then schedules the task and
+/// ProcessThreadSignal() is called on one of the executor's workers. In this mode,
+/// ProcessThreadSignal() must not block for long, as it occupies a worker shared with
+/// other tasks.
+///
+class STFSchedulableThread : public STFThread, public STFExecutorTask
+	{
+	protected:
+		STFTaskExecutor	*	executor;
+		volatile bool			started;
+		volatile bool			signalPending;
+
+		/// Handle one (or several merged) thread signals
+		virtual void ProcessThreadSignal(void) = 0;
+
+		//
+		// STFThread override
+		//
+		void ThreadEntry(void);
+
+		//
+		// STFExecutorTask implementation
+		//
+		void ExecuteTask(void);
+
+	public:
+		STFSchedulableThread(STFString name);
+
+		/// Execute the thread as a task of the executor instead of an OS thread
+		/// Must be called before StartThread(), NULL selects the OS thread again.
+		STFResult SetTaskExecutor(STFTaskExecutor * executor);
+
+		//
+		// STFThread functions redirected to the executor if one is set
+		//
+		STFResult StartThread(void);
+		STFResult StopThread(void);
+		STFResult Wait(void);
+		STFResult WaitImmediate(void);
+		STFResult SetThreadSignal(void);
+		STFResult ResetThreadSignal(void);
+	};
+
+#endif // STFTASKEXECUTOR_H
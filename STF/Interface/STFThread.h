@@ -207,8 +207,9 @@ class STFThread : public STFBaseThread, public STFWaitable
    /// @brief		Triggers the STFSignal event for this thread/class.
    /// @retval		STFRES_OK: Success
    ///
-   ///				This method increments the signal object's count.  While this
-   ///				value is greater than zero, the signal is considered active.
+   ///				This method sets the signal object.  Depending on the OS,
+   ///				signals set before the next wait are counted or coalesced
+   ///				into one pending signal.
    STFResult SetThreadSignal(void);
 
    /// @brief		Resets the thread's signal to an off state.
@@ -226,6 +227,14 @@ class STFThread : public STFBaseThread, public STFWaitable
    ///				and return.			
    STFResult WaitThreadSignal(void);
 
+   /// @brief		Tunes how long WaitThreadSignal polls before it sleeps
+   /// @param		spinCount	[in] Upper limit for polls of the signal, 0 disables spinning
+   /// @retval		STFRES_OK: Success
+   ///
+   ///				Threads that are signalled at a high rate by threads on other
+   ///				processors avoid a sleep and wakeup per signal with a higher count.
+   STFResult SetThreadSignalSpinCount(uint32 spinCount);
+
    /// Retrieve the name of this thread
    STFString GetName(void) const;
    };
@@ -234,6 +243,9 @@ STFResult InitializeSTFThreads(void);
 
 STFResult GetCurrentSTFThread(STFThread * & thread);
 
+/// Retrieve the number of processors available to the process
+STFResult GetNumberOfProcessors(uint32 & num);
+
 
 //-------------------------- INLINE --------------------------------
 
@@ -332,6 +344,11 @@ inline STFResult STFThread::WaitThreadSignal(void)
    STFRES_RAISE_OK;
    }
 
+inline STFResult STFThread::SetThreadSignalSpinCount(uint32 spinCount)
+   {
+   STFRES_RAISE(event->SetSpinCount(spinCount));
+   }
+
 inline STFString STFThread::GetName(void) const
    {
    return ost.GetName();
@@ -15,7 +15,11 @@ Timers can be used to retrieve their current value, to wait an amount of time
 or to schedule an event, that is later sent to a message sink.  
 */
 
-static const uint32 STFTIMER_MAX_EVENTS = 64;   // must be a power of two!
+/// The lower bits of an event id select the event slot, the upper bits count the reuses of the slot
+static const uint32 STFTIMER_EVENT_SLOT_BITS = 16;
+static const uint32 STFTIMER_MAX_EVENTS = 1 << STFTIMER_EVENT_SLOT_BITS;
+/// Number of event slots allocated on the first schedule, the slots are doubled when all are in use
+static const uint32 STFTIMER_INITIAL_EVENTS = 64;
 
 
 class STFTimer	: public STFThread
@@ -25,7 +29,32 @@ class STFTimer	: public STFThread
 
 		STFTimeoutSignal	signal;
 		STFMutex				mutex;
-		uint32 count;		// used to create a unique timer ID
+
+		struct PendingEvent
+			{
+			STFHiPrec64BitTime   	time;
+			STFMessageSink		*	   sink;				// NULL if the slot is free
+			STFMessage				   message;
+			uint32					   id;
+			bool                    recurrent;
+			STFHiPrec64BitDuration  dueCycleDuration;
+			uint32						heapIndex;		// position in eventHeap, next free slot while the slot is free
+			};
+
+		PendingEvent	*	pendingEvents;		// slots, indexed by the lower bits of the event id
+		uint32			*	eventHeap;			// slots of the scheduled events, as binary min-heap on the event time
+		uint32				numEventSlots;
+		uint32				numPendingEvents;
+		uint32				firstFreeEvent;	// free slots are reused in FIFO order, this spreads the reuse of ids
+		uint32				lastFreeEvent;
+
+		STFResult AllocateEvent(uint32 & slot);
+		void FreeEvent(uint32 slot);
+		void SiftEventUp(uint32 index);
+		void SiftEventDown(uint32 index);
+		void InsertEvent(uint32 slot);
+		void RemoveEvent(uint32 index);
+		STFResult ScheduleEvent(const STFHiPrec64BitTime & time, bool recurrent, const STFHiPrec64BitDuration & dueCycleDuration, STFMessageSink * sink, const STFMessage & message, uint32 & timer);
 
 	public:
 		STFTimer(void);
@@ -37,17 +66,6 @@ class STFTimer	: public STFThread
 		// Event scheduling
 		//
 
-		struct PendingEvents
-			{
-			STFHiPrec64BitTime   	time;
-			STFMessageSink		*	   sink;
-			STFMessage				   message;
-			uint32					   id;
-			bool                    recurrent;
-			STFHiPrec64BitDuration  dueCycleDuration;
-			} pendingEvents[STFTIMER_MAX_EVENTS];
-
-
 		void ThreadEntry(void);
 
 		STFResult NotifyThreadTermination(void);
@@ -115,7 +133,7 @@ class STFTimer	: public STFThread
 		/*!
 		Schedule an event, that is sent to a message sink after a point of time has been
 		reached.  The event can be canceled using CancelEvent with the timer id returned
-		by this call.	If no slot is free, this function may return with an error.
+		by this call.	If STFTIMER_MAX_EVENTS events are pending, this function returns with an error.
 		\param time Target time for the message
 		\param sink Message sink that receives the message
 		\param message The message id of the message
@@ -9,6 +9,206 @@
 #include "STF/Interface/Types/STFString.h"
 #include "STF/Interface/STFDataManipulationMacros.h" 
 
+//! Build with STF_NATIVE_INT64=1 to back STFInt64 by the native 64 bit integer of the compiler
+/*! The class API is the same in both modes.  The native mode keeps the lower/upper memory
+    layout, which is only possible on little endian targets.
+*/
+#ifndef STF_NATIVE_INT64
+#define STF_NATIVE_INT64	0
+#endif
+
+#if STF_NATIVE_INT64
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "STF_NATIVE_INT64 does not keep the STFInt64 memory layout on big endian targets"
+#endif
+
+//! a 64-Bit-Integer data type for all integer arithmetics, native version
+class STFInt64
+	{
+	private:
+		//! the value, the same memory layout as the lower/upper pair of the emulation
+		int64 value;
+
+		//! construct from a native value, all arithmetic wraps around like the emulation
+		static STFInt64 Native(int64 val)
+			{
+			STFInt64 result;
+			result.value = val;
+			return result;
+			}
+
+		static STFInt64 Native(uint64 val)
+			{
+			return Native((int64)val);
+			}
+
+	public:
+		STFInt64(void) : value(0) {}
+
+		STFInt64(uint32 val) : value(val) {}
+
+		STFInt64(int32 val) : value(val) {}
+
+		STFInt64(const STFInt64 & val) : value(val.value) {}
+
+		STFInt64 & operator= (const STFInt64 & val)
+			{
+			value = val.value;
+			return *this;
+			}
+
+		STFInt64(uint32 lower,int32 upper) : value((int64)(((uint64)(uint32)upper << 32) | lower)) {}
+
+		STFInt64(int32 lower,int32 upper) : value((int64)(((uint64)(uint32)upper << 32) | (uint32)lower)) {}
+
+		STFInt64(int32 lower,uint32 upper) : value((int64)(((uint64)upper << 32) | (uint32)lower)) {}
+
+		STFInt64(uint32 lower,uint32 upper) : value((int64)(((uint64)upper << 32) | lower)) {}
+
+		STFInt64(STFString str, int32 base = 10);
+
+		STFString ToString(int32 digits = 0, int32 base = 10, char fill = '0');
+
+		uint32 ToUint32(void) const
+			{
+			if (value < 0) 
+				return 0;
+			else if (value > (int64)0xffffffff)
+				return 0xffffffff;
+			else
+				return (uint32)value;
+			}
+
+		//!convert 64bit value to 32bit value with saturation
+		int32 ToInt32(void) const
+			{
+			if (value < -(int64)0x80000000)
+				return 0x80000000; //max_neg
+			else if (value > (int64)0x7fffffff)
+				return 0x7fffffff; //max_pos
+			else
+				return (int32)value;
+			}
+
+		int16 ToInt16(void) const
+			{
+			int32 tmp;
+			tmp = ToInt32();
+			if (tmp > 0x7fff)
+				return (int16)0x7fff;
+			else if(tmp < 0x8000)
+				return (int16)0x8000;
+			else
+				return (int16)value;
+			}
+			
+		uint32 Lower(void) const
+			{
+			return (uint32)value;
+			}
+
+		int32 Upper(void) const
+			{
+			return (int32)(value >> 32);
+			}
+
+		STFInt64 Abs(void) const
+			{
+			return value < 0 ? -*this : *this;
+			}
+
+		inline int operator! (void) const {return !value;}
+
+		inline STFInt64 operator- (void) const {return Native(0 - (uint64)value);}
+
+		inline STFInt64 operator~ (void) const {return Native(~value);}
+
+		inline friend STFInt64 operator+ (const STFInt64 & u, const STFInt64 & v) {return Native((uint64)u.value + (uint64)v.value);}
+		inline friend STFInt64 operator- (const STFInt64 & u, const STFInt64 & v) {return Native((uint64)u.value - (uint64)v.value);}
+		inline friend STFInt64 operator+ (const int32 u, const STFInt64 & v) {return Native((uint64)(int64)u + (uint64)v.value);}
+		inline friend STFInt64 operator- (const int32 u, const STFInt64 & v) {return Native((uint64)(int64)u - (uint64)v.value);}
+		inline friend STFInt64 operator+ (const STFInt64 & u, const int32 v) {return Native((uint64)u.value + (uint64)(int64)v);}
+		inline friend STFInt64 operator- (const STFInt64 & u, const int32 v) {return Native((uint64)u.value - (uint64)(int64)v);}
+		inline friend STFInt64 operator* (const STFInt64 & u, const STFInt64 & v) {return Native((uint64)u.value * (uint64)v.value);}
+		inline friend STFInt64 operator/ (const STFInt64 & u, const STFInt64 & v);
+		inline friend STFInt64 operator% (const STFInt64 & u, const STFInt64 & v) {return u - (u / v) * v;}
+
+		inline STFInt64 & operator+= (const STFInt64 & u) {return *this = *this + u;}
+		inline STFInt64 & operator-= (const STFInt64 & u) {return *this = *this - u;}
+		inline STFInt64 & operator+= (const int32 u) {return *this = *this + u;}
+		inline STFInt64 & operator-= (const int32 u) {return *this = *this - u;}
+		inline STFInt64 & operator*= (const STFInt64 & u) {return *this = *this * u;}
+		inline STFInt64 & operator/= (const STFInt64 & u) {return *this = *this / u;}
+		inline STFInt64 & operator%= (const STFInt64 & u) {return *this = *this % u;}
+
+		inline STFInt64 & operator++ (void) {return *this += 1;}
+		inline STFInt64 operator++ (int) {STFInt64 result = *this; *this += 1; return result;}
+		inline STFInt64 & operator-- (void) {return *this -= 1;}
+		inline STFInt64 operator-- (int) {STFInt64 result = *this; *this -= 1; return result;}
+
+		// shift operators, shifts by more than 63 bits behave like the bitwise emulation
+		inline friend STFInt64 operator << (const STFInt64 & u, const int32 shl)
+			{
+			if (shl <= 0)
+				return u;
+			else if (shl >= 64)
+				return STFInt64();
+			else
+				return Native((uint64)u.value << shl);
+			}
+
+		inline friend STFInt64 operator >> (const STFInt64 & u, const int32 shr)
+			{
+			if (shr <= 0)
+				return u;
+			else
+				return Native(u.value >> (shr < 63 ? shr : 63));
+			}
+
+		inline STFInt64 & operator <<= (const int32 shl) {return *this = *this << shl;}
+		inline STFInt64 & operator >>= (const int32 shr) {return *this = *this >> shr;}
+		
+		inline int Compare(const STFInt64 & u) const
+			{
+			return value < u.value ? -1 : (value > u.value ? 1 : 0);
+			}
+
+		friend bool operator==(const STFInt64 & u, const STFInt64 & v) {return u.value == v.value;}
+		friend bool operator!=(const STFInt64 & u, const STFInt64 & v) {return u.value != v.value;}
+		friend bool operator<(const STFInt64 & u, const STFInt64 & v) {return u.value < v.value;}
+		friend bool operator>(const STFInt64 & u, const STFInt64 & v) {return u.value > v.value;}
+		friend bool operator<=(const STFInt64 & u, const STFInt64 & v) {return u.value <= v.value;}
+		friend bool operator>=(const STFInt64 & u, const STFInt64 & v) {return u.value >= v.value;}
+
+		friend STFInt64 operator& (const STFInt64 & u, const STFInt64 & v) {return Native(u.value & v.value);}
+		friend STFInt64 operator| (const STFInt64 & u, const STFInt64 & v) {return Native(u.value | v.value);}
+		
+		STFInt64 & operator&= (const STFInt64 & u) 
+			{
+			value &= u.value; 
+			return *this;
+			}
+		STFInt64 & operator|= (const STFInt64 & u) 
+			{
+			value |= u.value; 
+			return *this;
+			}		
+	};	
+
+// Division by zero saturates like the emulation, and the one overflowing case is not left to the CPU
+inline STFInt64 operator/ (const STFInt64 & u, const STFInt64 & v)
+	{
+	if (v.value == 0)
+		return u.value < 0 ? STFInt64(0x00000000, 0x80000000) : STFInt64((uint32)0xffffffff, (uint32)0x7fffffff);
+	else if (v.value == -1)
+		return -u;
+	else
+		return STFInt64::Native(u.value / v.value);
+	}
+
+#else // STF_NATIVE_INT64
+
 // this defines a new data type as a class,
 //! a 64-Bit-Integer data type for all integer arithmetics 
 class STFInt64
@@ -563,6 +763,7 @@ inline STFInt64 & STFInt64::operator>>= (const int32 shl)
 	return *this;
 	}
 
+#endif // STF_NATIVE_INT64
 
 
 #endif //STFINT64_H
@@ -10,6 +10,7 @@
 //#include "STF/Interface/STFMemoryManagement.h"
 #include "STF/Interface/STFThread.h"
 #include "STF/Interface/STFSynchronisation.h"
+#include "STF/Interface/Types/STFQueue.h"
 
 class STFMessageDispatcher;
 
@@ -560,6 +561,141 @@ class DirectSTFMessageDispatcher	: public BaseSTFMessageDispatcher
    STFResult DispatchMessage(STFMessageSink * sink, STFMessage message, bool wait);
    };
 
+/// Number of messages the processor side takes out of a STFMessageRing at once
+#ifndef STFMSG_PROCESS_BATCH_SIZE
+#define STFMSG_PROCESS_BATCH_SIZE	8
+#endif
+
+///
+/// @class STFMessageRing
+///
+/// @brief Bounded multi producer, single consumer queue of STFMessages
+///
+/// Each slot carries a sequence number (D. Vyukov's bounded queue). A sender claims the
+/// slot at the write position by a compare exchange on that position, fills it and then
+/// publishes it by setting the sequence number of the slot to position + 1. The processor
+/// side takes published slots in order and hands them back to the senders by advancing
+/// their sequence number by the size of the ring. Senders therefore never block each
+/// other or the processor, and Enqueue() may be called from any thread or interrupt.
+///
+/// All processor side methods (Dequeue(), Flush(), FlushSink()) must be serialized by
+/// the owner of the ring, e.g. by the readLock of the dispatcher. The processor side
+/// takes up to STFMSG_PROCESS_BATCH_SIZE messages out of the ring at once, so their slots
+/// are returned to the senders early; FlushSink() also removes messages of that batch.
+
+class STFMessageRing
+   {
+   protected:
+   /// A slot of the ring
+   struct Slot
+      {
+      STFInterlockedInt		sequence;	///<	Position + 1 if published, position if free
+      STFMessageSink		*	sink;			///<	The target sink of this message
+      STFMessage				message_;	///<	A copy of the message, if the sender does not wait
+      STFMessage			*	message;		///<	A pointer to the message (either &message_ or to the sender stack)
+      uint32					stamp;		///<	Value passed by the sender, e.g. the enqueue time
+      }	*	slots;
+
+   /// A message taken out of the ring, but not yet delivered
+   struct Entry
+      {
+      STFMessageSink		*	sink;
+      STFMessage				message;
+      uint32					stamp;
+      };
+
+   /// The size of the ring (a power of two)
+   uint32					size;
+   /// The size mask of the ring (size - 1) used for modulo calculation.
+   uint32					mask;
+   uint8						pad0[STF_CACHE_LINE_SIZE];
+
+   // Written by the senders
+   STFInterlockedInt		enqueuePos;
+   STFInterlockedInt		highWaterMark;
+   STFInterlockedInt		overflows;
+   uint8						pad1[STF_CACHE_LINE_SIZE];
+
+   // Written by the processor side only
+   STFInterlockedInt		dequeuePos;
+   Entry						batch[STFMSG_PROCESS_BATCH_SIZE];
+   uint32					batchRead, batchNum;
+   uint8						pad2[STF_CACHE_LINE_SIZE];
+
+   /// Checks if the slot for position pos is published
+   bool IsPublished(Slot * slot, uint32 pos)
+      {
+      return (uint32)(int32)slot->sequence == pos + 1;
+      }
+
+   /// Returns a published slot to the senders
+   void Release(Slot * slot, uint32 pos)
+      {
+      slot->sequence = (int32)(pos + size);
+      }
+
+   public:
+   /// Major constructor
+   /*!
+     @param size The size of the ring, it is rounded up to a power of two
+   */
+   STFMessageRing(uint32 size);
+
+   ~STFMessageRing(void);
+
+   /// Put a message into the ring, can be called from any thread
+   /*!
+     If wait is true, the slot points to message, and message.BeginWait() has been
+     called when this method returns successfully. The caller then has to trigger
+     the processor and call message.CompleteWait().
+     The stamp is handed back by Dequeue() with the message.
+     - @p STFRES_OBJECT_FULL If the ring is full
+   */
+   STFResult Enqueue(STFMessageSink * sink, STFMessage & message, bool wait, uint32 stamp = 0);
+
+   /// Take the next message out of the ring, processor side only
+   /*!
+     Messages of flushed sinks are skipped.
+     - @p STFRES_OBJECT_EMPTY If no published message is available
+   */
+   STFResult Dequeue(STFMessageSink * & sink, STFMessage & message, uint32 & stamp);
+
+   STFResult Dequeue(STFMessageSink * & sink, STFMessage & message)
+      {
+      uint32 stamp;
+
+      STFRES_RAISE(Dequeue(sink, message, stamp));
+      }
+
+   /// Remove all published messages, processor side only
+   /*!
+     @param complete Call Complete() on the removed messages
+   */
+   void Flush(bool complete);
+
+   /// Remove all published messages for the given sink, processor side only
+   /*!
+     @param sink The sink whose messages are removed
+     @param complete Call Complete() on the removed messages
+   */
+   void FlushSink(STFMessageSink * sink, bool complete);
+
+   /// Checks for a published message, processor side only
+   bool IsEmpty(void);
+
+   /// Checks if all slots are claimed by senders
+   bool IsFull(void);
+
+   /// Returns the number of slots claimed by senders and not yet taken by the processor side
+   uint32 NumElements(void);
+
+   /// Returns the current depth, the highest depth and the number of rejected messages
+   void GetStatistics(uint32 & depth, uint32 & maxDepth, uint32 & rejected);
+
+   /// Restarts the depth high-water mark and the rejected message count
+   void ResetStatistics(void);
+   };
+
 ///
 /// @class QueuedSTFMessageProcessingDispatcher
 ///
@@ -567,29 +703,14 @@ class DirectSTFMessageDispatcher	: public BaseSTFMessageDispatcher
 ///
 /// All messages that are sent to this type of STFMessageDispatcher are put into a queue.
 /// They are processed by another thread that calls the ProcessMessages() method. A dispatcher
-/// of this type is interrupt save for sending, if only the interrupt uses it, but does not
-/// provide wait capabilities for the sender. It is also not save to be used by potentially
-/// nesting interrupts or interrupt/thread or thread/thread mixtures. It should therefore
-/// only be used for a single sender thread or interrupt.
+/// of this type does not provide wait capabilities for the sender. The queue is a STFMessageRing,
+/// so messages can be sent from any number of threads and interrupts concurrently.
 
 class QueuedSTFMessageProcessingDispatcher	: public BaseSTFMessageProcessingDispatcher
    {
    protected:
    /// The queue, that holds the pending messages
-   struct STFMessageQueue
-      {
-      STFMessageSink	*	sink;			///<	The target sink of this message
-      STFMessage			message;		///<	The message itself
-      }	*	queue;
-
-   /// The write pointer of the queue
-   int	queueWrite;
-   /// The read pointer of the queue
-   int	queueRead;
-   /// The size of the queue (must be a power of two)
-   int	queueSize;
-   /// The size mask of the queue (size - 1) used for modulo calculation.
-   int	queueMask;
+   STFMessageRing		queue;
 
    /// Signal message arrival
    /*!
@@ -619,6 +740,12 @@ class QueuedSTFMessageProcessingDispatcher	: public BaseSTFMessageProcessingDisp
    STFResult FlushMessages(STFMessageSink * sink);
 
    STFResult CheckQueueState(void);
+
+   /// Returns the current and the highest queue depth and the number of rejected messages
+   STFResult GetQueueStatistics(uint32 & depth, uint32 & maxDepth, uint32 & rejected);
+
+   /// Restarts the queue depth high-water mark and the rejected message count
+   STFResult ResetQueueStatistics(void);
    };
 
 ///
@@ -695,31 +822,15 @@ class TriggeringSlavedQueuedSTFMessageProcessingDispatcher : public SlavedQueued
 /// @brief A STFMessageDispatcher that queues STFMessages and provides sender wait
 ///
 /// All messages that are sent to this type of STFMessageDispatcher are put into a queue.
-/// They are processed by another thread that calls the ProcessMessages() method. A dispatcher
-/// of this type is not interrupt save. It is save for multiple threads on the sender side.
+/// They are processed by another thread that calls the ProcessMessages() method. The queue is a
+/// STFMessageRing, so it is save for multiple threads on the sender side. Senders that do not
+/// wait for message completion may also be interrupts.
 
 class WaitableQueuedSTFMessageProcessingDispatcher	: public BaseSTFMessageProcessingDispatcher
    {
    protected:
    /// The queue, that holds the pending messages
-   struct STFMessageQueue
-      {
-      STFMessageSink	*	sink;			///<	The target sink of this message
-      STFMessage			message_;	///<	A copy of the message, if the sender does not wait
-      STFMessage		*	message;		///<	A pointer to the message (either &message_ or to the sender stack)
-      }	*	queue;
-
-   /// The write pointer of the queue
-   int	queueWrite;
-   /// The read pointer of the queue
-   int	queueRead;
-   /// The size of the queue (<b>must be a power of two</b>)
-   int	queueSize;
-   /// The size mask of the queue (size - 1) used for modulo calculation.
-   int	queueMask;
-
-   /// Protects the sender side of the queue
-   STFMutex	writeLock;
+   STFMessageRing		queue;
 
    /// Protects the processor side of the queue
    STFMutex	readLock;
@@ -745,6 +856,12 @@ class WaitableQueuedSTFMessageProcessingDispatcher	: public BaseSTFMessageProces
    STFResult FlushMessages(STFMessageSink * sink);
 
    STFResult CheckQueueState(void);
+
+   /// Returns the current and the highest queue depth and the number of rejected messages
+   STFResult GetQueueStatistics(uint32 & depth, uint32 & maxDepth, uint32 & rejected);
+
+   /// Restarts the queue depth high-water mark and the rejected message count
+   STFResult ResetQueueStatistics(void);
    };
 
 ///
@@ -781,22 +898,8 @@ class TriggeredWaitableQueuedSTFMessageProcessingDispatcher	: public WaitableQue
 class WaitablePriorityQueuedSTFMessageProcessingDispatcher	: public WaitableQueuedSTFMessageProcessingDispatcher
    {
    protected:
-   /// The queue, that holds the pending messages
-   struct STFMessageQueue
-      {
-      STFMessageSink	*	sink;			///<	The target sink of this message
-      STFMessage			message_;	///<	A copy of the message, if the sender does not wait
-      STFMessage		*	message;		///<	A pointer to the message (either &message_ or to the sender stack)
-      }	*	priorityQueue;
-
-   /// The write pointer of the queue
-   int	priorityQueueWrite;
-   /// The read pointer of the queue
-   int	priorityQueueRead;
-   /// The size of the queue (<b>must be a power of two</b>)
-   int	priorityQueueSize;
-   /// The size mask of the queue (size - 1) used for modulo calculation.
-   int	priorityQueueMask;
+   /// The queue, that holds the pending high priority messages
+   STFMessageRing		priorityQueue;
 
    public:
    /// Major constructor
@@ -842,6 +945,127 @@ class TriggeredWaitablePriorityQueuedSTFMessageProcessingDispatcher	: public Wai
    STFResult WaitMessage(void);
    };
 
+///
+/// Levels of a MultiLevelQueuedSTFMessageProcessingDispatcher, lower levels are processed first
+///
+#define STFMSG_LEVEL_CONTROL			0	///< Control plane messages, e.g. command completion
+#define STFMSG_LEVEL_NORMAL			1	///< All messages that are not classified otherwise
+#define STFMSG_LEVEL_DATA				2	///< Data plane messages, e.g. packet requests
+#define STFMSG_NUM_LEVELS				3
+
+/// Number of buckets of a STFMessageLatencyHistogram
+#define STFMSG_LATENCY_BUCKETS		20
+
+///
+/// @brief Queueing latency histogram of a message level
+///
+/// The latency is the time from DispatchMessage() to the start of the message processing.
+/// Bucket 0 counts the messages that waited less than one microsecond, bucket i the messages
+/// that waited between 2^(i-1) and 2^i - 1 microseconds. The last bucket counts all longer waits.
+
+struct STFMessageLatencyHistogram
+   {
+   uint32	buckets[STFMSG_LATENCY_BUCKETS];
+   uint32	numMessages;		///<	Number of processed messages
+   uint32	maxLatency;			///<	Longest wait in microseconds
+   };
+
+///
+/// @class MultiLevelQueuedSTFMessageProcessingDispatcher
+///
+/// @brief A STFMessageDispatcher that queues STFMessages in several levels of priority
+///
+/// Each message is put into the STFMessageRing of its level, which is returned by GetMessageLevel().
+/// ProcessMessages() always processes the next message of the lowest non empty level, so control
+/// plane messages are never queued behind data plane messages. Senders may wait for message
+/// completion. For each level the dispatcher keeps a histogram of the queueing latency.
+
+class MultiLevelQueuedSTFMessageProcessingDispatcher	: public BaseSTFMessageProcessingDispatcher
+   {
+   protected:
+   /// The queues of the levels
+   STFMessageRing		*	levels[STFMSG_NUM_LEVELS];
+
+   /// The latency histograms of the levels, protected by readLock
+   STFMessageLatencyHistogram	latency[STFMSG_NUM_LEVELS];
+
+   /// Protects the processor side of the queues
+   STFMutex	readLock;
+
+   /// Called on message arrival
+   virtual void Trigger(void) {}
+
+   /// Returns the level of a message
+   /*!
+     The default implementation puts messages with param2 == STFMSG_HIGH_PRIORITY into
+     STFMSG_LEVEL_CONTROL and all others into STFMSG_LEVEL_NORMAL. Derived classes classify
+     by message type.
+   */
+   virtual uint32 GetMessageLevel(const STFMessage & message);
+
+   /// Returns the current time in microseconds, used as stamp of queued messages
+   uint32 GetLatencyTime(void);
+
+   /// Clears the latency histograms of all levels
+   void ResetLatencyHistograms(void);
+
+   /// Checks if no level has a published message
+   bool IsEmpty(void);
+
+   public:
+   /// Major constructor
+   /*!
+     @param queueSize The size of the message queue of each level, <b>it must be a power of two</b>
+   */
+   MultiLevelQueuedSTFMessageProcessingDispatcher(int queueSize);
+
+   virtual ~MultiLevelQueuedSTFMessageProcessingDispatcher(void);
+
+   STFResult DispatchMessage(STFMessageSink * sink, STFMessage message, bool wait);
+
+   STFResult ProcessMessages(void);
+	
+   STFResult FlushMessages(void);
+
+   STFResult FlushMessages(STFMessageSink * sink);
+
+   STFResult CheckQueueState(void);
+
+   /// Returns the current and the highest queue depth and the number of rejected messages of a level
+   STFResult GetQueueStatistics(uint32 level, uint32 & depth, uint32 & maxDepth, uint32 & rejected);
+
+   /// Returns the queueing latency histogram of a level
+   STFResult GetLatencyHistogram(uint32 level, STFMessageLatencyHistogram & histogram);
+
+   /// Restarts the queue statistics and latency histograms of all levels
+   STFResult ResetQueueStatistics(void);
+   };
+
+///
+/// @class TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher
+///
+/// @brief A MultiLevelQueuedSTFMessageProcessingDispatcher that provides reader wait
+class TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher	: public MultiLevelQueuedSTFMessageProcessingDispatcher, virtual public TriggeredSTFMessageProcessingDispatcher
+   {
+   protected:
+   /// Signal, when a message arrives
+   STFSignal		trigger;
+
+   /// Sends the signal
+   void Trigger(void);
+
+   public:
+   /// Major constructor
+   /*!
+     @param queueSize The size of the message queue of each level, <b>it must be a power of two</b>
+   */
+   TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher(int queueSize);
+
+   virtual ~TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher(void) {};
+
+   STFResult WaitMessage(void);
+   };
+
 ///
 /// @class STFMessageProcessorThread
 ///
@@ -94,6 +94,71 @@ class STFLockedQueue : public STFFixedQueue
 
 
 
+//! Size of a cache line, used to keep data written by different threads apart
+#ifndef STF_CACHE_LINE_SIZE
+#define STF_CACHE_LINE_SIZE	64
+#endif
+
+//! Lock-free single producer, single consumer queue (FIFO)
+/*! Exactly one thread may call Enqueue()/EnqueueBatch() and exactly one (other) thread may
+	call Dequeue()/DequeueBatch()/Peek()/Flush(). The write index is published with a release
+	store after the element has been written, and read with an acquire load by the consumer
+	(and vice versa for the read index), so elements are handed over correctly between cores.
+	Producer and consumer indices are kept in separate cache lines, and each side keeps a
+	cached copy of the other side's index, so the shared lines are only touched when the
+	queue looks full (producer) or empty (consumer).
+*/
+class STFSPSCQueue : public STFQueue
+	{
+	private:
+		void				**	buffer;
+		uint32					size, mask;
+		uint8						pad0[STF_CACHE_LINE_SIZE];
+
+		// Written by the producer only
+		STFInterlockedInt		writeIndex;
+		uint32					cachedReadIndex;
+		uint8						pad1[STF_CACHE_LINE_SIZE];
+
+		// Written by the consumer only
+		STFInterlockedInt		readIndex;
+		uint32					cachedWriteIndex;
+		uint8						pad2[STF_CACHE_LINE_SIZE];
+
+	public:
+		STFSPSCQueue(uint32 size);
+		~STFSPSCQueue(void);
+
+		//! Producer side
+		virtual STFResult Enqueue(void * data);
+
+		//! Enqueue up to num elements, publishing them with a single index update
+		/*! Returns STFRES_OBJECT_FULL if not all elements could be enqueued, the number of
+			enqueued elements is returned in done.
+		*/
+		virtual STFResult EnqueueBatch(void ** data, uint32 num, uint32 & done);
+
+		//! Consumer side
+		virtual STFResult Dequeue(void * &data);
+
+		//! Dequeue up to max elements, releasing their slots with a single index update
+		/*! Returns STFRES_OBJECT_EMPTY if no element was available, the number of dequeued
+			elements is returned in num.
+		*/
+		virtual STFResult DequeueBatch(void ** data, uint32 max, uint32 & num);
+
+		virtual STFResult Peek(void * &data);
+
+		//! Remove all elements, must be called by the consumer
+		virtual STFResult Flush (void);
+
+		virtual bool IsEmpty(void);
+		virtual bool IsFull(void);
+		virtual uint32 NumElements(void);
+	};
+
+
+
 class STFIntQueue
 	{
 	public:
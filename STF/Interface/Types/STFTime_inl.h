@@ -2031,6 +2031,29 @@ inline STFTimeOfDay::operator STFString() const
 
 // methods to convert to a 108Mhz clock and the other way round
 
+#if STF_NATIVE_INT64
+
+// The magnitude is multiplied in two 32 bit halves, which gives the same truncation as the emulation
+
+inline STFInt64 ConvertClock108ToSystem(const STFInt64 & duration)
+	{
+	uint64	magnitude = ((uint64)(uint32)duration.Upper() << 32) | duration.Lower();
+	uint64	result;
+	bool		sign = duration.Upper() < 0;
+
+	if (sign)
+		magnitude = 0 - magnitude;
+
+	result = (((magnitude >> 32) * ClockMultiplier_108ToSystem) << 14) + (((magnitude & 0xffffffff) * ClockMultiplier_108ToSystem) >> 18);
+
+	if (sign)
+		result = 0 - result;
+
+	return STFInt64((uint32)result, (uint32)(result >> 32));
+	}
+
+#else
+
 inline STFInt64 ConvertClock108ToSystem(const STFInt64 & duration)
 	{
 	uint32	hlower,llower, hhigher, lhigher; //32bit values returned by the MUL32x32 macro.
@@ -2067,6 +2090,8 @@ inline STFInt64 ConvertClock108ToSystem(const STFInt64 & duration)
 	return STFInt64(lower, higher);
 	}
 
+#endif
+
 
 inline int32 ConvertClock108ToSystem(const int32 & duration)
 	{
@@ -2102,6 +2127,27 @@ inline int32 ConvertClock108ToSystem(const int32 & duration)
 	return dlower;
 	}
 
+#if STF_NATIVE_INT64
+
+inline STFInt64 ConvertClockSystemTo108(const STFInt64 & duration)
+	{
+	uint64	magnitude = ((uint64)(uint32)duration.Upper() << 32) | duration.Lower();
+	uint64	result;
+	bool		sign = duration.Upper() < 0;
+
+	if (sign)
+		magnitude = 0 - magnitude;
+
+	result = (((magnitude >> 32) * ClockMultiplier_SystemTo108) << 18) + (((magnitude & 0xffffffff) * ClockMultiplier_SystemTo108) >> 14);
+
+	if (sign)
+		result = 0 - result;
+
+	return STFInt64((uint32)result, (uint32)(result >> 32));
+	}
+
+#else
+
 inline STFInt64 ConvertClockSystemTo108(const STFInt64 & duration)
 	{
 	uint32	hlower,llower, hhigher, lhigher; //32bit values returned by the MUL32x32 macro.
@@ -2137,6 +2183,8 @@ inline STFInt64 ConvertClockSystemTo108(const STFInt64 & duration)
 	return STFInt64(lower, higher);
 	}
 
+#endif
+
 inline int32 ConvertClockSystemTo108(const int32 & duration)
 	{
 	uint32 dhigher,dlower;
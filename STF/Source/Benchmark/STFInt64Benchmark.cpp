@@ -0,0 +1,113 @@
+///
+/// @brief      Benchmark of the STFInt64 and time class arithmetic
+///
+/// Times the 64 bit operations that the mixer, clock, splitter and SCR multiplexer
+/// use for their time stamps: addition and comparison, multiplication, division, the
+/// conversion between system clock and 108 MHz ticks, time differences converted to
+/// milliseconds and the conversion of a time to 90 kHz ticks. Comparing a build with
+/// STF_NATIVE_INT64=1 against one without shows the gain of the native 64 bit mode.
+///
+/// The benchmark is not part of the STF library. Build it for Linux User Mode from
+/// the driver base directory against the STF library of the linuxpcusrdbg target with
+///
+///   g++ -O2 -pthread -DLINUX=1 -D_REENTRANT -DSTF_NATIVE_INT64=1 -I. -ISTF/Interface
+///       -ISTF/Interface/OSAL/LinuxUser -ISTF/Interface/Types/OSAL/LinuxUser
+///       -ISTF/Interface/OSAL/LinuxPCUser -ISTF/Interface/Types/OSAL/LinuxPCUser
+///       STF/Source/Benchmark/STFInt64Benchmark.cpp STF/Library/LINUXPCUSR/libstf_d.a
+///       -o int64bench
+///
+/// The emulated operators are compiled into the library, so to measure the emulation
+/// build both the library and the benchmark with STF_NATIVE_INT64=0. The library is
+/// built with -O0 for the debug target, use the same optimization for both builds.
+///
+/// Usage: int64bench [iterations]
+///
+
+#include "STF/Interface/Types/STFTime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// The results are stored here, so that the compiler cannot drop the loops
+static volatile int32	sink32;
+static volatile uint32	sinkU32;
+
+
+static double GetSeconds(void)
+	{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+	}
+
+
+static void PrintResult(const char * name, double start, uint32 iterations)
+	{
+	printf("%-16s %7.2f ns\n", name, (GetSeconds() - start) * 1e9 / iterations);
+	}
+
+
+int main(int argc, char ** argv)
+	{
+	uint32	iterations, i;
+	double	start;
+
+	iterations = argc > 1 ? (uint32)atoi(argv[1]) : 20000000;
+
+	// The multipliers are set up by the timer initialization, use the values of a 27 MHz system clock
+	ClockMultiplier_SystemTo108 = 1769472;
+	ClockMultiplier_108ToSystem = 2427;
+
+	printf("%s STFInt64, %u iterations\n", STF_NATIVE_INT64 ? "native" : "emulated", iterations);
+
+	STFInt64 acc(1u, 0u), step(123457u, 0u), limit(90000u, 0u);
+	start = GetSeconds();
+	for (i = 0; i < iterations; i++)
+		{
+		acc += step;
+		if (acc > limit)
+			sinkU32 = acc.Lower();
+		}
+	PrintResult("add/compare", start, iterations);
+
+	start = GetSeconds();
+	for (i = 0; i < iterations; i++)
+		sinkU32 = (STFInt64(i, 3u) * STFInt64(27)).Lower();
+	PrintResult("multiply", start, iterations);
+
+	start = GetSeconds();
+	for (i = 0; i < iterations; i++)
+		sinkU32 = (STFInt64(i, 3u) / STFInt64(108000)).Lower();
+	PrintResult("divide", start, iterations);
+
+	start = GetSeconds();
+	for (i = 0; i < iterations; i++)
+		sinkU32 = ConvertClockSystemTo108(STFInt64(i, 2u)).Lower();
+	PrintResult("system->108MHz", start, iterations);
+
+	start = GetSeconds();
+	for (i = 0; i < iterations; i++)
+		{
+		STFHiPrec64BitTime a(STFInt64(i * 1000, 5u), STFTU_108MHZTICKS), b(STFInt64(i, 5u), STFTU_108MHZTICKS);
+		STFHiPrec64BitDuration d = a - b;
+
+		sink32 = d.Get32BitDuration(STFTU_MILLISECS);
+		if (a < b)
+			sink32++;
+		}
+	PrintResult("time diff->ms", start, iterations);
+
+	start = GetSeconds();
+	for (i = 0; i < iterations; i++)
+		{
+		STFHiPrec64BitTime a(STFInt64(i * 1000, 1u), STFTU_108MHZTICKS);
+
+		sinkU32 = a.Get64BitTime(STFTU_90KHZTICKS).Lower();
+		}
+	PrintResult("time->90kHz", start, iterations);
+
+	return 0;
+	}
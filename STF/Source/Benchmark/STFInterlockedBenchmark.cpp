@@ -0,0 +1,201 @@
+///
+/// @brief      Scaling benchmark of the interlocked int, pointer and stack
+///
+/// Runs 1 to N threads that all increment one shared STFInterlockedInt, then all
+/// replace one shared STFInterlockedPointer with a CompareExchange loop, and then all
+/// push and pop nodes of one shared STFInterlockedStack. For each step the time per
+/// operation and the total throughput of all threads is printed. All threads work on
+/// the same variable, which is the worst case of the reference counters of shared
+/// memory blocks and of the packet stores of the connectors.
+///
+/// The benchmark is not part of the STF library. Build it for Linux User Mode from
+/// the driver base directory against the STF library of the linuxpcusrdbg target with
+///
+///   g++ -O2 -pthread -DLINUX=1 -D_REENTRANT -DSTF_NATIVE_INT64=1 -I. -ISTF/Interface
+///       -ISTF/Interface/OSAL/LinuxUser -ISTF/Interface/Types/OSAL/LinuxUser
+///       -ISTF/Interface/OSAL/LinuxPCUser -ISTF/Interface/Types/OSAL/LinuxPCUser
+///       STF/Source/Benchmark/STFInterlockedBenchmark.cpp STF/Library/LINUXPCUSR/libstf_d.a
+///       -o interlockedbench
+///
+/// The interlocked classes are compiled into the library, so to measure the global lock
+/// backend build both the library and the benchmark with -DOSSTF_INTERLOCKED_HARDWARE_ATOMICS=0.
+///
+/// Usage: interlockedbench [maximum number of threads [operations per thread]]
+///
+
+#include "STF/Interface/STFSemaphore.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/// Nodes each thread pushes before it starts popping, so that the stack is never empty
+#define BENCHMARK_NODES_PER_THREAD	4
+
+enum BenchmarkKind
+	{
+	BK_INT_INCREMENT,
+	BK_POINTER_EXCHANGE,
+	BK_STACK_PUSH_POP
+	};
+
+static const char * BenchmarkNames[] =
+	{
+	"int increment",
+	"pointer exchange",
+	"stack push/pop"
+	};
+
+class BenchmarkNode : public STFInterlockedNode
+	{
+	};
+
+struct BenchmarkThreadTimes
+	{
+	double	start, end;
+	};
+
+static STFInterlockedInt		sharedInt;
+static STFInterlockedPointer	sharedPointer;
+static STFInterlockedStack		sharedStack;
+
+static BenchmarkKind				kind;
+static uint32						numOperations;
+static pthread_barrier_t		startBarrier;
+
+
+static double GetSeconds(void)
+	{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+	}
+
+
+static void * BenchmarkThread(void * arg)
+	{
+	BenchmarkThreadTimes	*	times = (BenchmarkThreadTimes *)arg;
+	BenchmarkNode				nodes[BENCHMARK_NODES_PER_THREAD];
+	pointer						cmp;
+	uint32						i;
+
+	for (i = 0; i < BENCHMARK_NODES_PER_THREAD; i++)
+		sharedStack.Push(&nodes[i]);
+
+	pthread_barrier_wait(&startBarrier);
+
+	// Each thread takes its own times, the main thread may not be scheduled right after the barrier
+	times->start = GetSeconds();
+
+	switch (kind)
+		{
+		case BK_INT_INCREMENT:
+			for (i = 0; i < numOperations; i++)
+				sharedInt++;
+			break;
+
+		case BK_POINTER_EXCHANGE:
+			for (i = 0; i < numOperations; i++)
+				{
+				do
+					cmp = sharedPointer;
+				while (sharedPointer.CompareExchange(cmp, (pointer)times) != cmp);
+				}
+			break;
+
+		case BK_STACK_PUSH_POP:
+			for (i = 0; i < numOperations; i++)
+				sharedStack.Push(sharedStack.Pop());
+			break;
+		}
+
+	times->end = GetSeconds();
+
+	// The nodes live on our stack, so wait until all threads are done with the stack
+	pthread_barrier_wait(&startBarrier);
+
+	return NULL;
+	}
+
+
+static double RunBenchmark(uint32 numThreads)
+	{
+	pthread_t					*	threads;
+	BenchmarkThreadTimes		*	times;
+	double							start, end;
+	uint32							i;
+
+	threads = new pthread_t[numThreads];
+	times = new BenchmarkThreadTimes[numThreads];
+
+	sharedInt = 0;
+	sharedPointer = NULL;
+	sharedStack.Clear();
+
+	pthread_barrier_init(&startBarrier, NULL, numThreads + 1);
+
+	for (i = 0; i < numThreads; i++)
+		pthread_create(&threads[i], NULL, BenchmarkThread, &times[i]);
+
+	pthread_barrier_wait(&startBarrier);
+	pthread_barrier_wait(&startBarrier);
+
+	start = times[0].start;
+	end = times[0].end;
+	for (i = 0; i < numThreads; i++)
+		{
+		pthread_join(threads[i], NULL);
+
+		if (times[i].start < start)
+			start = times[i].start;
+		if (times[i].end > end)
+			end = times[i].end;
+		}
+
+	pthread_barrier_destroy(&startBarrier);
+	delete[] threads;
+	delete[] times;
+
+	if (kind == BK_INT_INCREMENT && (uint32)(int32)sharedInt != numThreads * numOperations)
+		printf("ERROR: counter is %u instead of %u\n", (uint32)(int32)sharedInt, numThreads * numOperations);
+
+	return end - start;
+	}
+
+
+int main(int argc, char ** argv)
+	{
+	uint32	maxThreads, numThreads;
+	double	seconds;
+	int		k;
+
+	maxThreads = argc > 1 ? (uint32)atoi(argv[1]) : (uint32)sysconf(_SC_NPROCESSORS_ONLN);
+	numOperations = argc > 2 ? (uint32)atoi(argv[2]) : 1000000;
+	if (maxThreads == 0)
+		maxThreads = 1;
+
+	printf("%s backend, %u operations per thread\n",
+			 OSSTF_INTERLOCKED_HARDWARE_ATOMICS ? "hardware atomics" : "global lock", numOperations);
+
+	for (k = BK_INT_INCREMENT; k <= BK_STACK_PUSH_POP; k++)
+		{
+		kind = (BenchmarkKind)k;
+
+		printf("\n%-18s threads   ns/op   Mops/s total\n", BenchmarkNames[k]);
+
+		for (numThreads = 1; numThreads <= maxThreads; numThreads++)
+			{
+			seconds = RunBenchmark(numThreads);
+
+			printf("%-18s %7u %7.1f %14.1f\n", "", numThreads,
+					 seconds * 1e9 / numOperations,
+					 (double)numThreads * numOperations / seconds * 1e-6);
+			}
+		}
+
+	return 0;
+	}
@@ -10,6 +10,17 @@
 #include "STF/Interface/STFMutex.h"
 #include "STF/Interface/STFDebug.h"
 
+#include <time.h>
+
+// sem_clockwait lets timed waits use the monotonic clock, so they are not affected when
+// the wall clock is set.  It is available since glibc 2.30.
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+#define OSSTF_SEMAPHORE_CLOCKWAIT	1
+#define OSSTF_SEMAPHORE_CLOCK			CLOCK_MONOTONIC
+#else
+#define OSSTF_SEMAPHORE_CLOCKWAIT	0
+#define OSSTF_SEMAPHORE_CLOCK			CLOCK_REALTIME
+#endif
 
 static STFMutex GlobalLockMutex;
 
@@ -112,20 +123,34 @@ STFResult OSSTFSemaphore::WaitTimeout(const STFLoPrec32BitDuration & duration)
 	{	
 	int res;
 	struct timespec time;
-	STFHiPrec64BitTime targetTime;
 
-	SystemTimer->GetTime(targetTime);
-	targetTime += duration;
+	// The deadline is taken from the clock the semaphore waits on, the system timer may
+	// run on a different time base
+	STFInt64 micros = duration.Get64BitDuration(STFTU_MICROSECS);
+	STFInt64 seconds = micros / 1000000;
+	micros = micros - seconds * 1000000;
 
-	STFInt64 millis = targetTime.Get64BitTime(STFTU_MILLISECS);
-	STFInt64 seconds = millis / 1000;
-	millis = millis - seconds * 1000;
-	
-	time.tv_sec = (time_t) seconds.ToInt32();
-	time.tv_nsec = millis.ToInt32() * 1000;
+	clock_gettime(OSSTF_SEMAPHORE_CLOCK, &time);
+
+	time.tv_sec += (time_t) seconds.ToInt32();
+	time.tv_nsec += micros.ToInt32() * 1000;
+	if (time.tv_nsec >= 1000000000)
+		{
+		time.tv_sec++;
+		time.tv_nsec -= 1000000000;
+		}
+	else if (time.tv_nsec < 0)
+		{
+		time.tv_sec--;
+		time.tv_nsec += 1000000000;
+		}
 
 	DP("%s : Starting\n", __FUNCTION__);
+#if OSSTF_SEMAPHORE_CLOCKWAIT
+	res = sem_clockwait(&sema, OSSTF_SEMAPHORE_CLOCK, &time);
+#else
 	res = sem_timedwait(&sema, &time);
+#endif
 	DP("%s : Finishing\n", __FUNCTION__);
 
 	if (res != 0)
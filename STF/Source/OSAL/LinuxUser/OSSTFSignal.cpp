@@ -0,0 +1,145 @@
+///
+/// @brief      Linux PC User Mode specific signal methods
+///
+
+#include "STF/Interface/STFSignal.h"
+
+#if OSSTF_SIGNAL_FUTEX
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+
+
+static inline void CPURelax(void)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#endif
+	}
+
+static inline int FutexWait(volatile int32 * address, int32 value, const struct timespec * timeout)
+	{
+	return syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, value, timeout, NULL, 0);
+	}
+
+static inline void FutexWake(volatile int32 * address)
+	{
+	syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	}
+
+//! Spinning only helps if the signalling thread can run at the same time
+static bool SpinningPossible(void)
+	{
+	static int32 processors = 0;
+
+	if (!processors)
+		processors = (int32)sysconf(_SC_NPROCESSORS_ONLN);
+
+	return processors > 1;
+	}
+
+
+void OSSTFSignal::WakeWaiter(void)
+	{
+	FutexWake(&state);
+	}
+
+
+STFResult OSSTFSignal::WaitSignalSlow(const STFLoPrec32BitDuration * duration)
+	{
+	struct timespec	deadline, timeout;
+	uint32				limit, i;
+	int32					s;
+
+	//
+	// Adaptive spin, the limit follows the number of polls after which the signal
+	// was found recently, and backs off when spinning did not find it
+	//
+	if (maxSpin && SpinningPossible())
+		{
+		limit = 2 * spin + 16;
+		if (limit > maxSpin)
+			limit = maxSpin;
+
+		for (i = 0; i < limit; i++)
+			{
+			CPURelax();
+
+			if (TryConsumeSignal())
+				{
+				spin = (7 * spin + i) / 8;
+				STFRES_RAISE_OK;
+				}
+			}
+
+		spin /= 2;
+		}
+
+	if (duration)
+		{
+		STFInt64 micros = duration->Get64BitDuration(STFTU_MICROSECS);
+		STFInt64 seconds = micros / 1000000;
+		micros = micros - seconds * 1000000;
+
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += (time_t)seconds.ToInt32();
+		deadline.tv_nsec += micros.ToInt32() * 1000;
+		if (deadline.tv_nsec >= 1000000000)
+			{
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+			}
+		}
+
+	//
+	// Register as sleeping waiter and sleep until the signal flag is set
+	//
+	s = __atomic_add_fetch(&state, 2, __ATOMIC_ACQ_REL);
+
+	for(;;)
+		{
+		if (s & 1)
+			{
+			// Consume the signal and unregister in one step, a failed exchange reloads s
+			if (__atomic_compare_exchange_n(&state, &s, (s & ~1) - 2, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				STFRES_RAISE_OK;
+			}
+		else
+			{
+			if (duration)
+				{
+				clock_gettime(CLOCK_MONOTONIC, &timeout);
+				timeout.tv_sec = deadline.tv_sec - timeout.tv_sec;
+				timeout.tv_nsec = deadline.tv_nsec - timeout.tv_nsec;
+				if (timeout.tv_nsec < 0)
+					{
+					timeout.tv_sec--;
+					timeout.tv_nsec += 1000000000;
+					}
+
+				if (timeout.tv_sec < 0)
+					break;
+
+				FutexWait(&state, s, &timeout);
+				}
+			else
+				FutexWait(&state, s, NULL);
+
+			s = __atomic_load_n(&state, __ATOMIC_ACQUIRE);
+			}
+		}
+
+	//
+	// Timeout, a wakeup that was meant for this thread is passed on to the next waiter
+	//
+	s = __atomic_sub_fetch(&state, 2, __ATOMIC_ACQ_REL);
+	if ((s & 1) && s >= 2)
+		FutexWake(&state);
+
+	STFRES_RAISE(STFRES_TIMEOUT);
+	}
+
+#endif // OSSTF_SIGNAL_FUTEX
@@ -6,6 +6,7 @@
 #include <sched.h>
 #include <signal.h>
 #include <errno.h>
+#include <unistd.h>
 
 #include "STF/Interface/STFDebug.h"
 #include "OSSTFThread.h"
@@ -406,4 +407,16 @@ STFResult GetCurrentSTFThread(STFThread * & thread)
    STFRES_RAISE_OK;
    }
 
+STFResult GetNumberOfProcessors(uint32 & num)
+   {
+   long ret = sysconf(_SC_NPROCESSORS_ONLN);
+
+   if (ret < 1)
+      STFRES_RAISE(STFRES_OPERATION_FAILED);
+
+   num = (uint32)ret;
+
+   STFRES_RAISE_OK;
+   }
+
 
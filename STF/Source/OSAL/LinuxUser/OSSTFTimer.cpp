@@ -9,21 +9,86 @@
 #include <time.h>
 #include <errno.h>
 #include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#define OSSTFTIMER_TSC_SUPPORTED	1
+#endif
 
 uint32 ClockMultiplier_SystemTo108;
 uint32 ClockMultiplier_108ToSystem;                 
 
+/// Duration of the TSC calibration against CLOCK_MONOTONIC_RAW in milliseconds
+static const uint32 TSC_CALIBRATION_MILLISECS = 20;
+
+static bool					timerInitialized = false;
+static OSSTFClockSource	requestedClockSource = OSSTFTIMER_DEFAULT_CLOCK_SOURCE;
+static OSSTFClockSource	clockSource = OSSTFCS_MONOTONIC;
+static clockid_t			clockID = CLOCK_MONOTONIC;
+
+#if OSSTFTIMER_TSC_SUPPORTED
+static uint64				tscBase;				// TSC value at the end of the calibration
+static uint64				tscTicksBase;		// system ticks at the end of the calibration
+static uint64				tscMultiplier;		// system ticks per TSC cycle as 32.32 fixed point
+
+static inline uint64 ReadTSC(void)
+	{
+	uint32 lower, upper;
+
+	__asm__ __volatile__ ("rdtsc" : "=a" (lower), "=d" (upper));
+
+	return ((uint64)upper << 32) | lower;
+	}
+
+//! Returns the lower 64 bits of (a * b) >> 32, without a 128 bit type
+static inline uint64 MultiplyShift32(uint64 a, uint64 b)
+	{
+	uint64 aLower = a & 0xffffffff, aUpper = a >> 32;
+	uint64 bLower = b & 0xffffffff, bUpper = b >> 32;
+
+	return ((aUpper * bUpper) << 32) + aUpper * bLower + aLower * bUpper + ((aLower * bLower) >> 32);
+	}
+#endif
+
+static inline uint64 TimespecToTicks(const struct timespec & ts)
+	{
+	return (uint64)ts.tv_sec * OSSTFTIMER_TICKS_PER_SECOND + (uint64)ts.tv_nsec * (OSSTFTIMER_TICKS_PER_SECOND / 1000000) / 1000;
+	}
+
+
 void OSSTFTimer::GetTime(STFHiPrec64BitTime & time)
 	{
+	struct timespec	ts;
 	struct timeval		timeOfDay;
-	struct timezone	timeZone;
+	uint64				ticks;
 
-	if (gettimeofday(&timeOfDay, &timeZone) != 0)
+	switch (clockSource)
 		{
-		DP("OSSTFTimer::GetTime - gettimeofday failed, errno: %d\n", errno);
+#if OSSTFTIMER_TSC_SUPPORTED
+		case OSSTFCS_TSC:
+			ticks = tscTicksBase + MultiplyShift32(ReadTSC() - tscBase, tscMultiplier);
+			break;
+#endif
+		case OSSTFCS_WALLCLOCK:
+			if (gettimeofday(&timeOfDay, NULL) != 0)
+				{
+				DP("OSSTFTimer::GetTime - gettimeofday failed, errno: %d\n", errno);
+				}
+			ticks = (uint64)timeOfDay.tv_sec * OSSTFTIMER_TICKS_PER_SECOND + (uint64)timeOfDay.tv_usec * (OSSTFTIMER_TICKS_PER_SECOND / 1000000);
+			break;
+
+		default:
+			// Served from the vDSO, no system call
+			if (clock_gettime(clockID, &ts) != 0)
+				{
+				DP("OSSTFTimer::GetTime - clock_gettime failed, errno: %d\n", errno);
+				}
+			ticks = TimespecToTicks(ts);
+			break;
 		}
 
-	time = STFHiPrec64BitTime(STFInt64((int32)timeOfDay.tv_sec) * STFInt64(1000000) + STFInt64((int32)timeOfDay.tv_usec), STFTU_HIGHSYSTEM);
+	time = STFHiPrec64BitTime(STFInt64((uint32)ticks, (uint32)(ticks >> 32)), STFTU_HIGHSYSTEM);
 	}
 
 
@@ -98,6 +163,99 @@ void Calculate108MhzMultiplier(STFInt64 SystemTicksPerSecond)
 	}
 
 
+#if OSSTFTIMER_TSC_SUPPORTED
+
+//! Checks that the TSC runs at a constant rate and is synchronized between the cores
+/*! The invariant TSC flag guarantees the constant rate.  The synchronization is checked
+    by the kernel, which only uses the TSC as its clocksource if it passed.
+*/
+
+static bool IsTSCUsable(void)
+	{
+	uint32	eax, ebx, ecx, edx;
+	FILE	*	file;
+	char		name[32];
+	bool		usable = false;
+
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+		return false;
+
+	file = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+	if (file)
+		{
+		if (fgets(name, sizeof(name), file))
+			usable = strncmp(name, "tsc", 3) == 0;
+		fclose(file);
+		}
+
+	return usable;
+	}
+
+
+//! Measures the TSC frequency against CLOCK_MONOTONIC_RAW and continues its time line
+static STFResult CalibrateTSC(void)
+	{
+	struct timespec	startTime, endTime, delay;
+	uint64				startTSC, endTSC, nanos, ticks, cycles;
+
+	delay.tv_sec = 0;
+	delay.tv_nsec = TSC_CALIBRATION_MILLISECS * 1000 * 1000;
+
+	if (clock_gettime(CLOCK_MONOTONIC_RAW, &startTime) != 0)
+		STFRES_RAISE(STFRES_OPERATION_NOT_SUPPORTED);
+	startTSC = ReadTSC();
+
+	while (nanosleep(&delay, &delay) == -1 && errno == EINTR)
+		;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &endTime);
+	endTSC = ReadTSC();
+
+	nanos = (uint64)(endTime.tv_sec - startTime.tv_sec) * 1000000000 + endTime.tv_nsec - startTime.tv_nsec;
+	if (endTSC <= startTSC || nanos == 0)
+		STFRES_RAISE(STFRES_OPERATION_FAILED);
+
+	//
+	// The multiplier is (ticks << 32) / cycles, with the ticks kept in units of 1/1000 to
+	// retain the precision. Both are scaled down until the shift fits into 64 bits.
+	//
+	ticks = nanos * (OSSTFTIMER_TICKS_PER_SECOND / 1000000);
+	cycles = (endTSC - startTSC) * 1000;
+	while (ticks > 0xffffffff)
+		{
+		ticks >>= 1;
+		cycles >>= 1;
+		}
+	if (cycles == 0)
+		STFRES_RAISE(STFRES_OPERATION_FAILED);
+
+	tscMultiplier = (ticks << 32) / cycles;
+	tscBase = endTSC;
+	tscTicksBase = TimespecToTicks(endTime);
+
+	STFRES_RAISE_OK;
+	}
+
+#endif
+
+
+STFResult SelectOSSTFClockSource(OSSTFClockSource source)
+	{
+	if (timerInitialized)
+		STFRES_RAISE(STFRES_OBJECT_IN_USE);
+
+	requestedClockSource = source;
+
+	STFRES_RAISE_OK;
+	}
+
+
+OSSTFClockSource GetOSSTFClockSource(void)
+	{
+	return clockSource;
+	}
+
+
 //! This function initializes the timer system and must be called before any timer operation is performed
 /*! This function returns STFRES_TIMEOUT when the timer is not accurate enough or an error occured during
     initialization ('out of time' would be a better error value ;) )
@@ -105,13 +263,40 @@ void Calculate108MhzMultiplier(STFInt64 SystemTicksPerSecond)
 
 STFResult InitializeOSSTFTimer(void)
 	{	
-	static bool		initialized = false;
+	struct timespec	ts;
 
-	if (!initialized)
+	if (!timerInitialized)
 		{
-		initialized = true;
-		
-		Calculate108MhzMultiplier(STFInt64(1000000)); // The resolution of gettimeofday is microseconds
+		timerInitialized = true;
+
+		clockSource = requestedClockSource;
+
+		if (clockSource == OSSTFCS_TSC)
+			{
+#if OSSTFTIMER_TSC_SUPPORTED
+			if (!IsTSCUsable() || STFRES_FAILED(CalibrateTSC()))
+#endif
+				{
+				DP("InitializeOSSTFTimer - TSC not usable, falling back to CLOCK_MONOTONIC_RAW\n");
+				clockSource = OSSTFCS_MONOTONIC_RAW;
+				}
+			}
+
+		if (clockSource == OSSTFCS_MONOTONIC_RAW)
+			{
+			clockID = CLOCK_MONOTONIC_RAW;
+			if (clock_gettime(clockID, &ts) != 0)
+				{
+				DP("InitializeOSSTFTimer - CLOCK_MONOTONIC_RAW not supported, falling back to CLOCK_MONOTONIC\n");
+				clockSource = OSSTFCS_MONOTONIC;
+				}
+			}
+
+		if (clockSource == OSSTFCS_MONOTONIC)
+			clockID = CLOCK_MONOTONIC;
+
+		// All clock backends deliver their time in the same system ticks
+		Calculate108MhzMultiplier(STFInt64(OSSTFTIMER_TICKS_PER_SECOND));
 		}
 
 	STFRES_RAISE_OK;
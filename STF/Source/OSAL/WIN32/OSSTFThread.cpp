@@ -296,4 +296,14 @@ STFResult GetCurrentSTFThread(STFThread * & thread)
 	STFRES_RAISE_OK;
 	}
 
+STFResult GetNumberOfProcessors(uint32 & num)
+	{
+	SYSTEM_INFO info;
+
+	::GetSystemInfo(&info);
+	num = info.dwNumberOfProcessors;
+
+	STFRES_RAISE_OK;
+	}
+
 
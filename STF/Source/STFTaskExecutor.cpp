@@ -0,0 +1,525 @@
+///
+/// @brief OS-independent work-stealing task executor
+///
+
+#include "STF/Interface/STFTaskExecutor.h"
+#include "STF/Interface/STFDebug.h"
+
+
+///////////////////////////////////////////////////////////////
+// STFExecutorTask
+///////////////////////////////////////////////////////////////
+
+STFExecutorTask::STFExecutorTask(void)
+	: taskState(STFETS_IDLE)
+	{
+	prevTask = NULL;
+	nextTask = NULL;
+	}
+
+bool STFExecutorTask::IsTaskIdle(void)
+	{
+	return (int32)taskState == STFETS_IDLE;
+	}
+
+void STFExecutorTask::WaitTaskIdle(void)
+	{
+	bool idle;
+
+	for(;;)
+		{
+		idleMutex.Enter();
+		idle = IsTaskIdle();
+		idleMutex.Leave();
+
+		if (idle)
+			return;
+
+		// The signal is set by every transition to IDLE after our check
+		idleSignal.WaitSignal();
+		}
+	}
+
+bool STFExecutorTask::CompleteRun(void)
+	{
+	bool idle;
+
+	idleMutex.Enter();
+
+	idle = taskState.CompareExchange(STFETS_RUNNING, STFETS_IDLE) == STFETS_RUNNING;
+	if (idle)
+		idleSignal.SetSignal();
+
+	// The task may be deleted as soon as the mutex is released
+	idleMutex.Leave();
+
+	return idle;
+	}
+
+void STFExecutorTask::CancelTask(void)
+	{
+	idleMutex.Enter();
+
+	taskState = STFETS_IDLE;
+	idleSignal.SetSignal();
+
+	idleMutex.Leave();
+	}
+
+
+///////////////////////////////////////////////////////////////
+// STFTaskExecutorWorker
+///////////////////////////////////////////////////////////////
+
+STFTaskExecutorWorker::STFTaskExecutorWorker(STFTaskExecutor * executor, uint32 index, STFString name, uint32 stackSize, STFThreadPriority priority)
+	: STFThread(name, stackSize, priority)
+	{
+	this->executor = executor;
+	this->index = index;
+
+	head = NULL;
+	tail = NULL;
+	}
+
+void STFTaskExecutorWorker::ThreadEntry(void)
+	{
+	executor->WorkerLoop(index);
+	}
+
+STFResult STFTaskExecutorWorker::NotifyThreadTermination(void)
+	{
+	// The executor wakes up all workers when it stops
+	STFRES_RAISE_OK;
+	}
+
+void STFTaskExecutorWorker::PushTask(STFExecutorTask * task)
+	{
+	mutex.Enter();
+
+	task->prevTask = NULL;
+	task->nextTask = head;
+	if (head)
+		head->prevTask = task;
+	else
+		tail = task;
+	head = task;
+
+	mutex.Leave();
+	}
+
+STFExecutorTask * STFTaskExecutorWorker::PopTask(void)
+	{
+	STFExecutorTask * task;
+
+	mutex.Enter();
+
+	task = head;
+	if (task)
+		{
+		head = task->nextTask;
+		if (head)
+			head->prevTask = NULL;
+		else
+			tail = NULL;
+		}
+
+	mutex.Leave();
+
+	return task;
+	}
+
+STFExecutorTask * STFTaskExecutorWorker::StealTask(void)
+	{
+	STFExecutorTask * task;
+
+	mutex.Enter();
+
+	task = tail;
+	if (task)
+		{
+		tail = task->prevTask;
+		if (tail)
+			tail->nextTask = NULL;
+		else
+			head = NULL;
+		}
+
+	mutex.Leave();
+
+	return task;
+	}
+
+bool STFTaskExecutorWorker::RemoveTask(STFExecutorTask * task)
+	{
+	STFExecutorTask * t;
+
+	mutex.Enter();
+
+	for (t = head; t && t != task; t = t->nextTask) ;
+	if (t)
+		{
+		if (task->prevTask)
+			task->prevTask->nextTask = task->nextTask;
+		else
+			head = task->nextTask;
+
+		if (task->nextTask)
+			task->nextTask->prevTask = task->prevTask;
+		else
+			tail = task->prevTask;
+		}
+
+	mutex.Leave();
+
+	return t != NULL;
+	}
+
+
+///////////////////////////////////////////////////////////////
+// STFTaskExecutor
+///////////////////////////////////////////////////////////////
+
+STFTaskExecutor::STFTaskExecutor(STFString name, uint32 numWorkers, uint32 stackSize, STFThreadPriority priority)
+	{
+	uint32 i;
+
+	if (numWorkers == 0)
+		{
+		if (STFRES_FAILED(GetNumberOfProcessors(numWorkers)) || numWorkers == 0)
+			numWorkers = 1;
+		}
+
+	this->numWorkers = numWorkers;
+	terminate = false;
+	running = false;
+
+	workers = new STFTaskExecutorWorker * [numWorkers];
+	for (i = 0; i < numWorkers; i++)
+		workers[i] = new STFTaskExecutorWorker(this, i, name + STFString(i), stackSize, priority);
+	}
+
+STFTaskExecutor::~STFTaskExecutor(void)
+	{
+	uint32 i;
+
+	Stop();
+
+	for (i = 0; i < numWorkers; i++)
+		delete workers[i];
+	delete[] workers;
+	}
+
+STFResult STFTaskExecutor::Start(void)
+	{
+	uint32 i;
+
+	if (running)
+		STFRES_RAISE(STFRES_OBJECT_IN_USE);
+
+	terminate = false;
+	running = true;
+
+	for (i = 0; i < numWorkers; i++)
+		STFRES_REASSERT(workers[i]->StartThread());
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult STFTaskExecutor::Stop(void)
+	{
+	STFExecutorTask * task;
+	uint32 i;
+
+	if (!running)
+		STFRES_RAISE_OK;
+
+	terminate = true;
+
+	for (i = 0; i < numWorkers; i++)
+		{
+		workers[i]->StopThread();
+		wakeup.Signal();
+		}
+
+	for (i = 0; i < numWorkers; i++)
+		workers[i]->Wait();
+
+	//
+	// Return the tasks that were not executed anymore to idle, so that
+	// nobody waits for them forever
+	//
+	for (i = 0; i < numWorkers; i++)
+		{
+		while ((task = workers[i]->PopTask()) != NULL)
+			task->CancelTask();
+		}
+
+	running = false;
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult STFTaskExecutor::Schedule(STFExecutorTask * task)
+	{
+	STFThread * current;
+	uint32 i;
+
+	if (terminate)
+		STFRES_RAISE(STFRES_OBJECT_INVALID);
+
+	for(;;)
+		{
+		switch ((int32)task->taskState)
+			{
+			case STFETS_IDLE:
+				if (task->taskState.CompareExchange(STFETS_IDLE, STFETS_QUEUED) == STFETS_IDLE)
+					{
+					//
+					// Queue at the calling worker to keep task chains on one core, or
+					// distribute round robin when called from outside the executor
+					//
+					GetCurrentSTFThread(current);
+					for (i = 0; i < numWorkers && workers[i] != current; i++) ;
+					if (i == numWorkers)
+						i = (uint32)(nextWorker++) % numWorkers;
+
+					workers[i]->PushTask(task);
+
+					//
+					// Stop() may have drained the queues between our first check and the
+					// push. The worker mutex orders the push against the drain, so if the
+					// drain missed the task we see terminate here and take it back.
+					//
+					if (terminate && workers[i]->RemoveTask(task))
+						{
+						task->CancelTask();
+						STFRES_RAISE(STFRES_OBJECT_INVALID);
+						}
+
+					//
+					// The read-modify-write on idleWorkers orders against the increment
+					// a worker does before its final queue check, so either that worker
+					// finds the task or we see it idle and wake one up.
+					//
+					if ((idleWorkers += 0) > 0)
+						wakeup.Signal();
+
+					STFRES_RAISE_OK;
+					}
+				break;
+
+			case STFETS_RUNNING:
+				if (task->taskState.CompareExchange(STFETS_RUNNING, STFETS_RUNNING_RESCHEDULED) == STFETS_RUNNING)
+					STFRES_RAISE_OK;
+				break;
+
+			default:
+				// Already queued or scheduled for another run
+				STFRES_RAISE_OK;
+			}
+		}
+	}
+
+STFExecutorTask * STFTaskExecutor::FindTask(uint32 index)
+	{
+	STFExecutorTask * task;
+	uint32 i;
+
+	task = workers[index]->PopTask();
+
+	for (i = 1; task == NULL && i < numWorkers; i++)
+		task = workers[(index + i) % numWorkers]->StealTask();
+
+	return task;
+	}
+
+void STFTaskExecutor::RunTask(STFExecutorTask * task)
+	{
+	task->taskState = STFETS_RUNNING;
+
+	//
+	// Run the task until it was not scheduled again during its execution
+	//
+	for(;;)
+		{
+		task->ExecuteTask();
+
+		if (task->CompleteRun())
+			break;
+
+		task->taskState = STFETS_RUNNING;
+		}
+	}
+
+void STFTaskExecutor::WorkerLoop(uint32 index)
+	{
+	STFExecutorTask * task;
+
+	while (!terminate)
+		{
+		task = FindTask(index);
+
+		if (!task)
+			{
+			//
+			// Announce that we are going idle and look once more, a task scheduled
+			// before the announcement is found here, a later one signals the wakeup
+			//
+			idleWorkers++;
+
+			task = FindTask(index);
+			if (!task)
+				wakeup.Wait();
+
+			idleWorkers--;
+			}
+
+		//
+		// A task popped after Stop() was requested is not run anymore, but must
+		// still return to idle for its waiters
+		//
+		if (task)
+			{
+			if (terminate)
+				task->CancelTask();
+			else
+				RunTask(task);
+			}
+		}
+	}
+
+
+///////////////////////////////////////////////////////////////
+// STFSchedulableThread
+///////////////////////////////////////////////////////////////
+
+STFSchedulableThread::STFSchedulableThread(STFString name)
+	: STFThread(name)
+	{
+	executor = NULL;
+	started = false;
+	signalPending = false;
+	}
+
+void STFSchedulableThread::ThreadEntry(void)
+	{
+	// Don't do anything until we are signalled for the first time
+	STFThread::WaitThreadSignal();
+
+	while (!terminate)
+		{
+		ProcessThreadSignal();
+
+		STFThread::WaitThreadSignal();
+		}
+	}
+
+void STFSchedulableThread::ExecuteTask(void)
+	{
+	if (started && !terminate)
+		ProcessThreadSignal();
+	}
+
+STFResult STFSchedulableThread::SetTaskExecutor(STFTaskExecutor * executor)
+	{
+	if (started)
+		STFRES_RAISE(STFRES_OBJECT_IN_USE);
+
+	this->executor = executor;
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult STFSchedulableThread::StartThread(void)
+	{
+	if (!executor)
+		STFRES_RAISE(STFThread::StartThread());
+
+	if (started)
+		STFRES_RAISE(STFRES_OBJECT_IN_USE);
+
+	terminate = false;
+	started = true;
+
+	if (signalPending)
+		{
+		signalPending = false;
+		STFRES_RAISE(executor->Schedule(this));
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult STFSchedulableThread::StopThread(void)
+	{
+	if (!executor)
+		STFRES_RAISE(STFThread::StopThread());
+
+	if (!started)
+		STFRES_RAISE(STFRES_OBJECT_NOT_FOUND);
+
+	terminate = true;
+
+	STFRES_RAISE(NotifyThreadTermination());
+	}
+
+STFResult STFSchedulableThread::Wait(void)
+	{
+	if (!executor)
+		STFRES_RAISE(STFThread::Wait());
+
+	if (!started)
+		STFRES_RAISE(STFRES_OBJECT_NOT_FOUND);
+
+	//
+	// Once terminate is set the task does not process signals anymore, so it
+	// becomes idle after the current or last queued run, or when the executor
+	// stops before running it
+	//
+	WaitTaskIdle();
+
+	started = false;
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult STFSchedulableThread::WaitImmediate(void)
+	{
+	if (!executor)
+		STFRES_RAISE(STFThread::WaitImmediate());
+
+	if (!started)
+		STFRES_RAISE(STFRES_OBJECT_NOT_FOUND);
+
+	if (!terminate || !IsTaskIdle())
+		STFRES_RAISE(STFRES_TIMEOUT);
+
+	started = false;
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult STFSchedulableThread::SetThreadSignal(void)
+	{
+	if (!executor)
+		STFRES_RAISE(STFThread::SetThreadSignal());
+
+	if (!started)
+		{
+		// Remember the signal until the thread is started
+		signalPending = true;
+		STFRES_RAISE_OK;
+		}
+
+	STFRES_RAISE(executor->Schedule(this));
+	}
+
+STFResult STFSchedulableThread::ResetThreadSignal(void)
+	{
+	if (!executor)
+		STFRES_RAISE(STFThread::ResetThreadSignal());
+
+	signalPending = false;
+
+	STFRES_RAISE_OK;
+	}
@@ -3,72 +3,210 @@
 
 STFTimer * SystemTimer;
 
+/// Marks the end of the free slot list
+static const uint32 STFTIMER_NO_EVENT = 0xffffffff;
+
+
 STFTimer::STFTimer(void)
 	: STFThread(TCTN_EVENT_SCHEDULER, TCSS_EVENT_SCHEDULER, TCTP_EVENT_SCHEDULER)
 	{			
-	count = 0;
-
-	for (uint32 i = 0; i < STFTIMER_MAX_EVENTS; i++)
-		pendingEvents[i].sink = NULL;
+	pendingEvents = NULL;
+	eventHeap = NULL;
+	numEventSlots = 0;
+	numPendingEvents = 0;
+	firstFreeEvent = lastFreeEvent = STFTIMER_NO_EVENT;
 
 	StartThread();
 	}
 
 STFTimer::~STFTimer()
 	{
+	delete[] pendingEvents;
+	delete[] eventHeap;
+	}
+
+
+//
+// Event slot management, all called with the mutex held
+//
+
+STFResult STFTimer::AllocateEvent(uint32 & slot)
+	{
+	PendingEvent	*	events;
+	uint32			*	heap;
+	uint32				num, i;
+
+	if (firstFreeEvent == STFTIMER_NO_EVENT)
+		{
+		// All slots are in use, double their number
+		if (numEventSlots == STFTIMER_MAX_EVENTS)
+			STFRES_RAISE(STFRES_OBJECT_FULL);
+
+		num = numEventSlots ? 2 * numEventSlots : STFTIMER_INITIAL_EVENTS;
+
+		events = new PendingEvent[num];
+		heap = new uint32[num];
+		if (events == NULL || heap == NULL)
+			{
+			delete[] events;
+			delete[] heap;
+			STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+			}
+
+		for (i = 0; i < numEventSlots; i++)
+			{
+			events[i] = pendingEvents[i];
+			heap[i] = eventHeap[i];
+			}
+
+		for (i = numEventSlots; i < num; i++)
+			{
+			events[i].sink = NULL;
+			events[i].id = i;
+			events[i].heapIndex = i + 1 < num ? i + 1 : STFTIMER_NO_EVENT;
+			}
+
+		delete[] pendingEvents;
+		delete[] eventHeap;
+		pendingEvents = events;
+		eventHeap = heap;
+
+		firstFreeEvent = numEventSlots;
+		lastFreeEvent = num - 1;
+		numEventSlots = num;
+		}
+
+	slot = firstFreeEvent;
+	firstFreeEvent = pendingEvents[slot].heapIndex;
+	if (firstFreeEvent == STFTIMER_NO_EVENT)
+		lastFreeEvent = STFTIMER_NO_EVENT;
+
+	// A new id for each use of the slot, so that stale ids do not cancel the new event
+	pendingEvents[slot].id += STFTIMER_MAX_EVENTS;
+
+	STFRES_RAISE_OK;
+	}
+
+void STFTimer::FreeEvent(uint32 slot)
+	{
+	pendingEvents[slot].sink = NULL;
+	pendingEvents[slot].heapIndex = STFTIMER_NO_EVENT;
+
+	if (lastFreeEvent == STFTIMER_NO_EVENT)
+		firstFreeEvent = slot;
+	else
+		pendingEvents[lastFreeEvent].heapIndex = slot;
+	lastFreeEvent = slot;
+	}
+
+void STFTimer::SiftEventUp(uint32 index)
+	{
+	uint32	slot = eventHeap[index];
+	uint32	parent;
+
+	while (index > 0)
+		{
+		parent = (index - 1) / 2;
+		if (!(pendingEvents[slot].time < pendingEvents[eventHeap[parent]].time))
+			break;
+
+		eventHeap[index] = eventHeap[parent];
+		pendingEvents[eventHeap[index]].heapIndex = index;
+		index = parent;
+		}
+
+	eventHeap[index] = slot;
+	pendingEvents[slot].heapIndex = index;
+	}
+
+void STFTimer::SiftEventDown(uint32 index)
+	{
+	uint32	slot = eventHeap[index];
+	uint32	child;
+
+	while ((child = 2 * index + 1) < numPendingEvents)
+		{
+		if (child + 1 < numPendingEvents && pendingEvents[eventHeap[child + 1]].time < pendingEvents[eventHeap[child]].time)
+			child++;
+
+		if (!(pendingEvents[eventHeap[child]].time < pendingEvents[slot].time))
+			break;
+
+		eventHeap[index] = eventHeap[child];
+		pendingEvents[eventHeap[index]].heapIndex = index;
+		index = child;
+		}
+
+	eventHeap[index] = slot;
+	pendingEvents[slot].heapIndex = index;
+	}
+
+void STFTimer::InsertEvent(uint32 slot)
+	{
+	eventHeap[numPendingEvents] = slot;
+	SiftEventUp(numPendingEvents++);
+	}
+
+void STFTimer::RemoveEvent(uint32 index)
+	{
+	uint32	slot;
+
+	numPendingEvents--;
+
+	// Move the last event into the gap, it may have to go either way from there
+	if (index < numPendingEvents)
+		{
+		slot = eventHeap[numPendingEvents];
+		eventHeap[index] = slot;
+		SiftEventUp(index);
+		SiftEventDown(pendingEvents[slot].heapIndex);
+		}
 	}
 
 
 void STFTimer::ThreadEntry(void)
 	{
-	STFHiPrec64BitTime      currentTime, nextTime;
+	STFHiPrec64BitTime      currentTime;
 	STFLoPrec32BitDuration  duration;
 
 	STFMessageSink *        sink;
-	// uint32                  id;
-	int                     nextEvent;
-	uint32                  i;
-	// bool                    timeout;
+	STFMessage              message;
+	PendingEvent *          event;
+	uint32                  slot;
 
 	while (!terminate)
 		{
-		nextEvent = -1;
-
 		mutex.Enter();
 
-		for(i=0; i<STFTIMER_MAX_EVENTS; i++)
+		if (numPendingEvents > 0)
 			{
-			if (pendingEvents[i].sink && (nextEvent == -1 || pendingEvents[i].time < nextTime))
-				{
-				nextTime = pendingEvents[i].time;
-				nextEvent = i;
-				}
-			}
+			// The event due next is on top of the heap
+			slot = eventHeap[0];
+			event = &pendingEvents[slot];
 
-		if (nextEvent >= 0)
-			{
 			GetTime(currentTime);
-			if (nextTime < currentTime)
+			if (event->time < currentTime)
 				{
-				sink = pendingEvents[nextEvent].sink;
-				// id = pendingEvents[nextEvent].id;
-				if (pendingEvents[nextEvent].recurrent)
+				sink = event->sink;
+				message = event->message;
+				if (event->recurrent)
 					{
-					pendingEvents[nextEvent].time += pendingEvents[nextEvent].dueCycleDuration;
+					event->time += event->dueCycleDuration;
+					SiftEventDown(0);
 					}
 				else
 					{
-					pendingEvents[nextEvent].sink = NULL;
+					RemoveEvent(0);
+					FreeEvent(slot);
 					}
 				mutex.Leave();
-				sink->SendMessage(pendingEvents[nextEvent].message, false);
+				sink->SendMessage(message, false);
 				}
 			else
 				{
-				duration = nextTime - currentTime;
+				duration = event->time - currentTime;
 
 				mutex.Leave();
-				// timeout = signal.WaitTimeout(duration) == STFRES_TIMEOUT;
 				signal.WaitTimeout(duration);
 				}
 
@@ -88,75 +226,56 @@ STFResult STFTimer::NotifyThreadTermination(void)
 	STFRES_RAISE_OK;
 	}		
 
-STFResult STFTimer::ScheduleEvent(const STFHiPrec64BitTime & time, STFMessageSink * sink, const STFMessage & message, uint32 & timer)
+STFResult STFTimer::ScheduleEvent(const STFHiPrec64BitTime & time, bool recurrent, const STFHiPrec64BitDuration & dueCycleDuration, STFMessageSink * sink, const STFMessage & message, uint32 & timer)
 	{
-	uint32 i;
-	STFResult err = STFRES_OK;
+	uint32 slot;
+	STFResult err;
 
 	mutex.Enter();
 
-	i = 0;
-	while (i < STFTIMER_MAX_EVENTS && pendingEvents[i].sink)
-		i++;
-
-	if (i < STFTIMER_MAX_EVENTS)
+	err = AllocateEvent(slot);
+	if (STFRES_SUCCEEDED(err))
 		{
-		pendingEvents[i].sink = sink;
-		pendingEvents[i].message = message;
-		pendingEvents[i].time = time;
-		pendingEvents[i].id = timer = i + count;
-		pendingEvents[i].recurrent = false;
-		count += STFTIMER_MAX_EVENTS;
-
-		signal.SetSignal();
+		pendingEvents[slot].sink = sink;
+		pendingEvents[slot].message = message;
+		pendingEvents[slot].time = time;
+		pendingEvents[slot].recurrent = recurrent;
+		pendingEvents[slot].dueCycleDuration = dueCycleDuration;
+		timer = pendingEvents[slot].id;
+
+		InsertEvent(slot);
+
+		// Only a new first event changes the wait time of the timer thread
+		if (pendingEvents[slot].heapIndex == 0)
+			signal.SetSignal();
 		}
-	else
-		err = STFRES_OBJECT_FULL;
 
 	mutex.Leave();
 
 	STFRES_RAISE(err);
 	}
 
-STFResult STFTimer::ScheduleRecurrentEvent(const STFHiPrec64BitTime & time, const STFHiPrec64BitDuration & dueCycleDuration, STFMessageSink * sink, const STFMessage & message, uint32 & timer)
+STFResult STFTimer::ScheduleEvent(const STFHiPrec64BitTime & time, STFMessageSink * sink, const STFMessage & message, uint32 & timer)
 	{
-	uint32 i;
-	STFResult err = STFRES_OK;
-
-	mutex.Enter();
-
-	i = 0;
-	while (i < STFTIMER_MAX_EVENTS && pendingEvents[i].sink)
-		i++;
-
-	if (i < STFTIMER_MAX_EVENTS)
-		{
-		pendingEvents[i].sink = sink;
-		pendingEvents[i].message = message;
-		pendingEvents[i].time = time;
-		pendingEvents[i].id = timer = i + count;
-		pendingEvents[i].recurrent = true;
-		pendingEvents[i].dueCycleDuration = dueCycleDuration;
-		count += STFTIMER_MAX_EVENTS;
-
-		signal.SetSignal();
-		}
-	else
-		err = STFRES_OBJECT_FULL;
-
-	mutex.Leave();
+	STFRES_RAISE(ScheduleEvent(time, false, STFHiPrec64BitDuration(), sink, message, timer));
+	}
 
-	STFRES_RAISE(err);
+STFResult STFTimer::ScheduleRecurrentEvent(const STFHiPrec64BitTime & time, const STFHiPrec64BitDuration & dueCycleDuration, STFMessageSink * sink, const STFMessage & message, uint32 & timer)
+	{
+	STFRES_RAISE(ScheduleEvent(time, true, dueCycleDuration, sink, message, timer));
 	}
 
 
 STFResult STFTimer::CancelEvent(uint32 timer)
 	{
+	uint32 slot = timer & (STFTIMER_MAX_EVENTS-1);
+
 	mutex.Enter();
 
-	if (pendingEvents[timer & (STFTIMER_MAX_EVENTS-1)].id == timer)
+	if (slot < numEventSlots && pendingEvents[slot].sink && pendingEvents[slot].id == timer)
 		{
-		pendingEvents[timer & (STFTIMER_MAX_EVENTS-1)].sink = NULL;
+		RemoveEvent(pendingEvents[slot].heapIndex);
+		FreeEvent(slot);
 		}
 
 	mutex.Leave();
@@ -166,19 +285,30 @@ STFResult STFTimer::CancelEvent(uint32 timer)
 
 STFResult STFTimer::CancelEvent(STFMessageSink * sink)
 	{
-	uint32 i;
+	uint32 i, num;
 	if (sink == NULL)
 		STFRES_RAISE(STFRES_OBJECT_NOT_ALLOCATED);
 
 	mutex.Enter();
 
-	for (i=0; i < STFTIMER_MAX_EVENTS; i++)
+	//cancel all events scheduled for this message sink, then restore the heap order of the remaining ones
+	num = 0;
+	for (i=0; i < numPendingEvents; i++)
 		{
-		if (pendingEvents[i].sink == sink)
-			{
-			//cancel all events scheduled for this message sink
-			pendingEvents[i].sink = NULL;
-			}
+		if (pendingEvents[eventHeap[i]].sink == sink)
+			FreeEvent(eventHeap[i]);
+		else
+			eventHeap[num++] = eventHeap[i];
+		}
+
+	if (num < numPendingEvents)
+		{
+		numPendingEvents = num;
+
+		for (i=0; i < num; i++)
+			pendingEvents[eventHeap[i]].heapIndex = i;
+		for (i=num/2; i > 0; i--)
+			SiftEventDown(i - 1);
 		}
 
 	mutex.Leave();
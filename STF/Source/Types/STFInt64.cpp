@@ -5,6 +5,7 @@
 #include "STF/Interface/Types/STFInt64.h"
 
 
+#if !STF_NATIVE_INT64
 
 STFInt64 operator* (const STFInt64 & u, const STFInt64 & v)
 	{
@@ -120,6 +121,8 @@ STFInt64 operator/ (const STFInt64 & u, const STFInt64 & v)
 		}
 	}
 
+#endif
+
 STFInt64::STFInt64(STFString str, int32 base)
 	{
 	int32 i = 0;
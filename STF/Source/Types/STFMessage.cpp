@@ -3,6 +3,7 @@
 ///
 
 #include "STF/Interface/Types/STFMessage.h"
+#include "STF/Interface/STFTimer.h"
 
 //#include "STF/Interface/STFMemoryManagement.h"
 // Gabriel Gooslin removed 4/13/04.  This will allow the 5700 team to build with the 196 compiler.  If this is a problem, 
@@ -43,18 +44,247 @@ STFResult DirectSTFMessageDispatcher::DispatchMessage(STFMessageSink * sink, STF
 		STFRES_RAISE(sink->ReceiveMessage(message));
 	}
 
+STFMessageRing::STFMessageRing(uint32 size)
+	: enqueuePos(0), highWaterMark(0), overflows(0), dequeuePos(0)
+	{
+	uint32 i;
+
+	this->size = 1;
+	while (this->size < size)
+		this->size <<= 1;
+	mask = this->size - 1;
+
+	slots = new Slot[this->size];
+	for (i = 0; i < this->size; i++)
+		slots[i].sequence = (int32)i;
+
+	batchRead = 0;
+	batchNum = 0;
+	}
+
+STFMessageRing::~STFMessageRing(void)
+	{
+	delete[] slots;
+	}
+
+STFResult STFMessageRing::Enqueue(STFMessageSink * sink, STFMessage & message, bool wait, uint32 stamp)
+	{
+	uint32	pos = (uint32)(int32)enqueuePos;
+	uint32	prev, depth, maxDepth;
+	int32		diff;
+	Slot	*	slot;
+
+	//
+	// Claim the slot at the write position. The slot is free for this round if its
+	// sequence number equals the position, if it is lower the processor side has
+	// not yet taken the message of the previous round.
+	//
+	for(;;)
+		{
+		slot = &slots[pos & mask];
+		diff = (int32)((uint32)(int32)slot->sequence - pos);
+		if (diff == 0)
+			{
+			prev = (uint32)enqueuePos.CompareExchange((int32)pos, (int32)(pos + 1));
+			if (prev == pos)
+				break;
+			pos = prev;
+			}
+		else if (diff < 0)
+			{
+			overflows++;
+			STFRES_RAISE(STFRES_OBJECT_FULL);
+			}
+		else
+			pos = (uint32)(int32)enqueuePos;
+		}
+
+	slot->sink = sink;
+	if (wait)
+		{
+		message.BeginWait();
+		slot->message = &message;
+		}
+	else
+		{
+		slot->message_ = message;
+		slot->message = &(slot->message_);
+		}
+	slot->stamp = stamp;
+
+	// Publish the slot, the release store orders the writes above before it
+	slot->sequence = (int32)(pos + 1);
+
+	depth = pos + 1 - (uint32)(int32)dequeuePos;
+	if (depth > size)
+		depth = size;
+
+	maxDepth = (uint32)(int32)highWaterMark;
+	while (depth > maxDepth)
+		{
+		prev = (uint32)highWaterMark.CompareExchange((int32)maxDepth, (int32)depth);
+		if (prev == maxDepth)
+			break;
+		maxDepth = prev;
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult STFMessageRing::Dequeue(STFMessageSink * & sink, STFMessage & message, uint32 & stamp)
+	{
+	uint32	pos;
+	Slot	*	slot;
+
+	for(;;)
+		{
+		while (batchRead < batchNum)
+			{
+			if (batch[batchRead].sink)
+				{
+				sink = batch[batchRead].sink;
+				message = batch[batchRead].message;
+				stamp = batch[batchRead].stamp;
+				batchRead++;
+
+				STFRES_RAISE_OK;
+				}
+			batchRead++;
+			}
+
+		//
+		// Take the next published messages out of the ring, their slots are
+		// returned to the senders right away
+		//
+		pos = (uint32)(int32)dequeuePos;
+		batchRead = 0;
+		batchNum = 0;
+		while (batchNum < STFMSG_PROCESS_BATCH_SIZE && IsPublished(&slots[pos & mask], pos))
+			{
+			slot = &slots[pos & mask];
+
+			//
+			// A slot flushed by FlushSink() was already completed, its message may have
+			// lived on the stack of a sender that has returned meanwhile
+			//
+			if (slot->sink)
+				{
+				batch[batchNum].sink = slot->sink;
+				batch[batchNum].message = *(slot->message);
+				batch[batchNum].stamp = slot->stamp;
+				batchNum++;
+				}
+			Release(slot, pos);
+			pos++;
+			}
+
+		// Flushed slots may have been released even if no message was taken
+		dequeuePos = (int32)pos;
+
+		if (batchNum == 0)
+			STFRES_RAISE(STFRES_OBJECT_EMPTY);
+		}
+	}
+
+void STFMessageRing::Flush(bool complete)
+	{
+	uint32	pos = (uint32)(int32)dequeuePos;
+	Slot	*	slot;
+
+	while (batchRead < batchNum)
+		{
+		if (complete && batch[batchRead].sink)
+			batch[batchRead].message.Complete();
+		batchRead++;
+		}
+
+	slot = &slots[pos & mask];
+	while (IsPublished(slot, pos))
+		{
+		// Slots flushed by FlushSink() were completed already
+		if (complete && slot->sink)
+			slot->message->Complete();
+		Release(slot, pos);
+		pos++;
+		slot = &slots[pos & mask];
+		}
+
+	dequeuePos = (int32)pos;
+	}
+
+void STFMessageRing::FlushSink(STFMessageSink * sink, bool complete)
+	{
+	uint32	pos = (uint32)(int32)dequeuePos;
+	uint32	i;
+	Slot	*	slot;
+
+	for (i = batchRead; i < batchNum; i++)
+		{
+		if (batch[i].sink == sink)
+			{
+			batch[i].sink = NULL;
+			if (complete)
+				batch[i].message.Complete();
+			}
+		}
+
+	//
+	// Published slots belong to the processor side until they are released, so
+	// the sink can be cleared in place
+	//
+	slot = &slots[pos & mask];
+	while (IsPublished(slot, pos))
+		{
+		if (slot->sink == sink)
+			{
+			slot->sink = NULL;
+			if (complete)
+				slot->message->Complete();
+			}
+		pos++;
+		slot = &slots[pos & mask];
+		}
+	}
+
+bool STFMessageRing::IsEmpty(void)
+	{
+	uint32 pos = (uint32)(int32)dequeuePos;
+
+	return batchRead == batchNum && !IsPublished(&slots[pos & mask], pos);
+	}
+
+bool STFMessageRing::IsFull(void)
+	{
+	return NumElements() >= size;
+	}
+
+uint32 STFMessageRing::NumElements(void)
+	{
+	uint32 pos = (uint32)(int32)dequeuePos;
+
+	return (uint32)(int32)enqueuePos - pos;
+	}
+
+void STFMessageRing::GetStatistics(uint32 & depth, uint32 & maxDepth, uint32 & rejected)
+	{
+	depth = NumElements();
+	maxDepth = (uint32)(int32)highWaterMark;
+	rejected = (uint32)(int32)overflows;
+	}
+
+void STFMessageRing::ResetStatistics(void)
+	{
+	highWaterMark = 0;
+	overflows = 0;
+	}
+
 QueuedSTFMessageProcessingDispatcher::QueuedSTFMessageProcessingDispatcher(int queueSize) // must be power of two
+	: queue(queueSize)
 	{
-	this->queueSize = queueSize;
-	this->queueMask = queueSize - 1;
-	this->queueWrite = 0;
-	this->queueRead = 0;
-	this->queue = new STFMessageQueue[queueSize];
 	}
 
 QueuedSTFMessageProcessingDispatcher::~QueuedSTFMessageProcessingDispatcher()
    {
-   delete[] this->queue;
    }
 
 STFResult QueuedSTFMessageProcessingDispatcher::DispatchMessage(STFMessageSink * sink, STFMessage message, bool wait)
@@ -63,18 +293,14 @@ STFResult QueuedSTFMessageProcessingDispatcher::DispatchMessage(STFMessageSink *
 		STFRES_RAISE(STFRES_INVALID_PARAMETERS);	//	Can not wait with a dispatcher of this type
 	else if (abort)
 		STFRES_RAISE(STFRES_OPERATION_ABORTED);
-	else if (queueWrite - queueRead < queueSize)
+	else
 		{
-		queue[queueWrite & queueMask].sink = sink;
-		queue[queueWrite & queueMask].message = message;
-		queueWrite++;
+		STFRES_REASSERT(queue.Enqueue(sink, message, false));
 
 		Trigger();
 
 		STFRES_RAISE_OK;
 		}
-	else
-		STFRES_RAISE(STFRES_OBJECT_FULL);
 	}
 
 STFResult QueuedSTFMessageProcessingDispatcher::ProcessMessages(void)
@@ -82,35 +308,14 @@ STFResult QueuedSTFMessageProcessingDispatcher::ProcessMessages(void)
 	STFMessageSink	*	msgSink;
 	STFMessage			msg;
 
-	// For performance reasons, this check was moved outside of
-	// the readLock. It is assumed to be thread safe concerning the
-	// queueRead and queueWrite variables.
-	while (!abort && queueRead < queueWrite)
+	readLock.Enter();
+	while (!abort && queue.Dequeue(msgSink, msg) == STFRES_OK)
 		{
+		readLock.Leave();
+		msgSink->ReceiveMessage(msg);
 		readLock.Enter();
-		if (!abort && queueRead < queueWrite)
-			{
-			if (queue[queueRead & queueMask].sink)
-				{
-				msgSink = queue[queueRead & queueMask].sink;
-				msg = queue[queueRead & queueMask].message;
-				queue[queueRead & queueMask].sink = NULL;
-				queueRead++;
-				readLock.Leave();
-				msgSink->ReceiveMessage(msg);
-				}
-			else
-				{
-				queueRead++;
-				readLock.Leave();
-				}
-			}
-		else
-			{
-
-			readLock.Leave();
-			}
 		}
+	readLock.Leave();
 
 	if (abort)
 		STFRES_RAISE(STFRES_OPERATION_ABORTED);
@@ -122,7 +327,7 @@ STFResult QueuedSTFMessageProcessingDispatcher::FlushMessages(void)
 	{
 	readLock.Enter();
 
-	queueRead = queueWrite;
+	queue.Flush(false);
 
 	readLock.Leave();
 
@@ -131,21 +336,9 @@ STFResult QueuedSTFMessageProcessingDispatcher::FlushMessages(void)
 
 STFResult QueuedSTFMessageProcessingDispatcher::FlushMessages(STFMessageSink * sink)
 	{
-	int i;
-
 	readLock.Enter();
 
-	i = queueRead;
-	while (i < queueWrite)
-		{
-		if (queue[i & queueMask].sink == sink)
-			{
-			queue[i & queueMask].sink = NULL;
-			if (i == queueRead)
-				queueRead++;
-			}
-		i++;
-		}
+	queue.FlushSink(sink, false);
 
 	readLock.Leave();
 
@@ -156,14 +349,28 @@ STFResult QueuedSTFMessageProcessingDispatcher::CheckQueueState(void)
 	{
 	if (abort)
 		STFRES_RAISE(STFRES_OPERATION_ABORTED);
-	else if (queueWrite == queueRead)
+	else if (queue.IsEmpty())
 		STFRES_RAISE(STFRES_OBJECT_EMPTY);
-	else if (queueWrite == queueRead + queueSize)
+	else if (queue.IsFull())
 		STFRES_RAISE(STFRES_OBJECT_FULL);
 	else
 		STFRES_RAISE_OK;
 	}
 
+STFResult QueuedSTFMessageProcessingDispatcher::GetQueueStatistics(uint32 & depth, uint32 & maxDepth, uint32 & rejected)
+	{
+	queue.GetStatistics(depth, maxDepth, rejected);
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult QueuedSTFMessageProcessingDispatcher::ResetQueueStatistics(void)
+	{
+	queue.ResetStatistics();
+
+	STFRES_RAISE_OK;
+	}
+
 void TriggeredQueuedSTFMessageProcessingDispatcher::Trigger(void)
 	{
 	trigger.SetSignal();
@@ -180,7 +387,7 @@ TriggeredQueuedSTFMessageProcessingDispatcher::~TriggeredQueuedSTFMessageProcess
 
 STFResult TriggeredQueuedSTFMessageProcessingDispatcher::WaitMessage(void)
 	{
-	while (!abort && queueRead == queueWrite)
+	while (!abort && queue.IsEmpty())
 		{
 		trigger.Wait();
 		}
@@ -438,52 +645,24 @@ STFResult TriggeredMasterSTFMessageProcessor::TriggerMessageArrival(void)
 
 
 WaitableQueuedSTFMessageProcessingDispatcher::WaitableQueuedSTFMessageProcessingDispatcher(int queueSize) // must be power of two
+	: queue(queueSize)
 	{
-	this->queueSize = queueSize;
-	this->queueMask = queueSize - 1;
-	this->queueWrite = 0;
-	this->queueRead = 0;
-	this->queue = new STFMessageQueue[queueSize];
 	}
 
 WaitableQueuedSTFMessageProcessingDispatcher::~WaitableQueuedSTFMessageProcessingDispatcher()
    {
-   delete[] this->queue;
    }
 
 STFResult WaitableQueuedSTFMessageProcessingDispatcher::DispatchMessage(STFMessageSink * sink, STFMessage message, bool wait)
 	{
 	if (abort)
 		STFRES_RAISE(STFRES_OPERATION_ABORTED);
-	else if (queueWrite - queueRead < queueSize)
+	else if (queue.Enqueue(sink, message, wait) == STFRES_OK)
 		{
-		writeLock.Enter();
-		queue[queueWrite & queueMask].sink = sink;
-		if (wait)
-			{
-			message.BeginWait();
-
-			queue[queueWrite & queueMask].message = &message;
-
-			queueWrite++;
-
-			Trigger();
-
-			writeLock.Leave();
+		Trigger();
 
+		if (wait)
 			message.CompleteWait();
-			}
-		else
-			{
-			queue[queueWrite & queueMask].message_ = message;
-			queue[queueWrite & queueMask].message = &(queue[queueWrite & queueMask].message_);
-
-			queueWrite++;
-
-			Trigger();
-
-			writeLock.Leave();
-			}
 
 		STFRES_RAISE_OK;
 		}
@@ -498,34 +677,15 @@ STFResult WaitableQueuedSTFMessageProcessingDispatcher::ProcessMessages(void)
 	{
 	STFMessageSink	*	msgSink;
 	STFMessage			msg;
-	bool					messagesPresent = true;
 
-	while (messagesPresent)
+	readLock.Enter();
+	while (!abort && queue.Dequeue(msgSink, msg) == STFRES_OK)
 		{
+		readLock.Leave();
+		msgSink->ReceiveMessage(msg);
 		readLock.Enter();
-		if (!abort && queueRead < queueWrite)
-			{
-			if (queue[queueRead & queueMask].sink)
-				{
-				msgSink = queue[queueRead & queueMask].sink;
-				msg = STFMessage(*(queue[queueRead & queueMask].message));
-				queue[queueRead & queueMask].sink = NULL;
-				queueRead++;
-				readLock.Leave();
-				msgSink->ReceiveMessage(msg);
-				}
-			else
-				{
-				queueRead++;
-				readLock.Leave();
-				}
-			}
-		else
-			{
-			messagesPresent = false;
-			readLock.Leave();
-			}
 		}
+	readLock.Leave();
 
 	if (abort)
 		STFRES_RAISE(STFRES_OPERATION_ABORTED);
@@ -537,11 +697,7 @@ STFResult WaitableQueuedSTFMessageProcessingDispatcher::FlushMessages(void)
 	{
 	readLock.Enter();
 
-	while (queueRead < queueWrite)
-		{
-		queue[queueRead & queueMask].message->Complete();
-		queueRead++;
-		}
+	queue.Flush(true);
 
 	readLock.Leave();
 
@@ -550,22 +706,9 @@ STFResult WaitableQueuedSTFMessageProcessingDispatcher::FlushMessages(void)
 
 STFResult WaitableQueuedSTFMessageProcessingDispatcher::FlushMessages(STFMessageSink * sink)
 	{
-	int i;
-
 	readLock.Enter();
 
-	i = queueRead;
-	while (i < queueWrite)
-		{
-		if (queue[i & queueMask].sink == sink)
-			{
-			queue[i & queueMask].sink = NULL;
-			queue[i & queueMask].message->Complete();
-			if (i == queueRead)
-				queueRead++;
-			}
-		i++;
-		}
+	queue.FlushSink(sink, true);
 
 	readLock.Leave();
 
@@ -576,14 +719,28 @@ STFResult WaitableQueuedSTFMessageProcessingDispatcher::CheckQueueState(void)
 	{
 	if (abort)
 		STFRES_RAISE(STFRES_OPERATION_ABORTED);
-	else if (queueWrite == queueRead)
+	else if (queue.IsEmpty())
 		STFRES_RAISE(STFRES_OBJECT_EMPTY);
-	else if (queueWrite == queueRead + queueSize)
+	else if (queue.IsFull())
 		STFRES_RAISE(STFRES_OBJECT_FULL);
 	else
 		STFRES_RAISE_OK;
 	}
 
+STFResult WaitableQueuedSTFMessageProcessingDispatcher::GetQueueStatistics(uint32 & depth, uint32 & maxDepth, uint32 & rejected)
+	{
+	queue.GetStatistics(depth, maxDepth, rejected);
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult WaitableQueuedSTFMessageProcessingDispatcher::ResetQueueStatistics(void)
+	{
+	queue.ResetStatistics();
+
+	STFRES_RAISE_OK;
+	}
+
 
 
 
@@ -599,7 +756,7 @@ TriggeredWaitableQueuedSTFMessageProcessingDispatcher::TriggeredWaitableQueuedST
 
 STFResult TriggeredWaitableQueuedSTFMessageProcessingDispatcher::WaitMessage(void)
 	{
-	while (!abort && queueRead == queueWrite)
+	while (!abort && queue.IsEmpty())
 		{
 		trigger.Wait();
 		}
@@ -612,18 +769,13 @@ STFResult TriggeredWaitableQueuedSTFMessageProcessingDispatcher::WaitMessage(voi
 
 #if 1 //DEBUG_PERFORMANCE
 WaitablePriorityQueuedSTFMessageProcessingDispatcher::WaitablePriorityQueuedSTFMessageProcessingDispatcher(int queueSize, int prQueueSize) // must be power of two
-																	  :WaitableQueuedSTFMessageProcessingDispatcher(queueSize) // must be power of two
+																	  :WaitableQueuedSTFMessageProcessingDispatcher(queueSize), // must be power of two
+																	   priorityQueue(prQueueSize)
 	{
-	this->priorityQueueSize = prQueueSize;
-	this->priorityQueueMask = prQueueSize - 1;
-	this->priorityQueueWrite = 0;
-	this->priorityQueueRead = 0;
-	this->priorityQueue = new STFMessageQueue[prQueueSize];
 	}
 
 WaitablePriorityQueuedSTFMessageProcessingDispatcher::~WaitablePriorityQueuedSTFMessageProcessingDispatcher()
    {
-   delete[] this->priorityQueue;
    }
 
 STFResult WaitablePriorityQueuedSTFMessageProcessingDispatcher::DispatchMessage(STFMessageSink * sink, STFMessage message, bool wait)
@@ -632,8 +784,6 @@ STFResult WaitablePriorityQueuedSTFMessageProcessingDispatcher::DispatchMessage(
 		STFRES_RAISE(STFRES_OPERATION_ABORTED);
 	else if(message.param2 == STFMSG_HIGH_PRIORITY)
 		{
-		if(priorityQueueWrite - priorityQueueRead < priorityQueueSize)
-			{
 #if DEBUG_PERFORMANCE
 		switch (message.message)
 			{
@@ -641,48 +791,19 @@ STFResult WaitablePriorityQueuedSTFMessageProcessingDispatcher::DispatchMessage(
 			case 0x4d031: // VDRMID_STRM_START_REQUIRED
 			case 0x50022: //GVDI_FLUSH
 			case 0x50011: //PSB_ABORT
-				{
-				int i = queueRead;
-				DPS("1.msg in queue %d while posting prio msg %x\n\r", (queueWrite - queueRead), message.message);
-				while (i < queueWrite)
-					{
-					DPS("Already in queue %x \n\r",queue[i & queueMask].message->message);
-					i++;
-					}
+				DPS("1.msg in queue %d while posting prio msg %x\n\r", queue.NumElements(), message.message);
 				break;
-				}
 			default:
 				break;
 			}
 #endif
 
-			writeLock.Enter();
-			priorityQueue[priorityQueueWrite & priorityQueueMask].sink = sink;
-			if (wait)
-				{
-				message.BeginWait();
-
-				priorityQueue[priorityQueueWrite & priorityQueueMask].message = &message;
-
-				priorityQueueWrite++;
-
-				Trigger();
-
-				writeLock.Leave();
+		if (priorityQueue.Enqueue(sink, message, wait) == STFRES_OK)
+			{
+			Trigger();
 
+			if (wait)
 				message.CompleteWait();
-				}
-			else
-				{
-				priorityQueue[priorityQueueWrite & priorityQueueMask].message_ = message;
-				priorityQueue[priorityQueueWrite & priorityQueueMask].message = &(priorityQueue[priorityQueueWrite & priorityQueueMask].message_);
-
-				priorityQueueWrite++;
-
-				Trigger();
-
-				writeLock.Leave();
-				}
 
 			STFRES_RAISE_OK;
 			}
@@ -702,54 +823,15 @@ STFResult WaitablePriorityQueuedSTFMessageProcessingDispatcher::ProcessMessages(
 	{
 	STFMessageSink	*	msgSink;
 	STFMessage			msg;
-	bool					messagesPresent = true;
 
-	while (messagesPresent)
+	readLock.Enter();
+	while (!abort && (priorityQueue.Dequeue(msgSink, msg) == STFRES_OK || queue.Dequeue(msgSink, msg) == STFRES_OK))
 		{
+		readLock.Leave();
+		msgSink->ReceiveMessage(msg);
 		readLock.Enter();
-		if (!abort && priorityQueueRead < priorityQueueWrite)
-			{
-			if (priorityQueue[priorityQueueRead & priorityQueueMask].sink)
-				{
-				msgSink = priorityQueue[priorityQueueRead & priorityQueueMask].sink;
-				msg = STFMessage(*(priorityQueue[priorityQueueRead & priorityQueueMask].message));
-				priorityQueue[priorityQueueRead & priorityQueueMask].sink = NULL;
-				priorityQueueRead++;
-				readLock.Leave();
-				msgSink->ReceiveMessage(msg);
-				continue;
-				}
-			else
-				{
-				priorityQueueRead++;
-				readLock.Leave();
-				continue;
-				}
-			}
-
-		if (!abort && queueRead < queueWrite)
-			{
-			if (queue[queueRead & queueMask].sink)
-				{
-				msgSink = queue[queueRead & queueMask].sink;
-				msg = STFMessage(*(queue[queueRead & queueMask].message));
-				queue[queueRead & queueMask].sink = NULL;
-				queueRead++;
-				readLock.Leave();
-				msgSink->ReceiveMessage(msg);
-				}
-			else
-				{
-				queueRead++;
-				readLock.Leave();
-				}
-			}
-		else
-			{
-			messagesPresent = false;
-			readLock.Leave();
-			}
 		}
+	readLock.Leave();
 
 	if (abort)
 		STFRES_RAISE(STFRES_OPERATION_ABORTED);
@@ -761,17 +843,9 @@ STFResult WaitablePriorityQueuedSTFMessageProcessingDispatcher::FlushMessages(vo
 	{
 	readLock.Enter();
 
-	while (priorityQueueRead < priorityQueueWrite)
-		{
-		priorityQueue[priorityQueueRead & priorityQueueMask].message->Complete();
-		priorityQueueRead++;
-		}
+	priorityQueue.Flush(true);
+	queue.Flush(true);
 
-	while (queueRead < queueWrite)
-		{
-		queue[queueRead & queueMask].message->Complete();
-		queueRead++;
-		}
 	readLock.Leave();
 
 	STFRES_RAISE_OK;
@@ -779,36 +853,10 @@ STFResult WaitablePriorityQueuedSTFMessageProcessingDispatcher::FlushMessages(vo
 
 STFResult WaitablePriorityQueuedSTFMessageProcessingDispatcher::FlushMessages(STFMessageSink * sink)
 	{
-	int i;
-
 	readLock.Enter();
 
-	i = priorityQueueRead;
-	while (i < priorityQueueWrite)
-		{
-		if (priorityQueue[i & priorityQueueMask].sink == sink)
-			{
-			priorityQueue[i & priorityQueueMask].sink = NULL;
-			priorityQueue[i & priorityQueueMask].message->Complete();
-			DPS("Flushed %x\n\r", priorityQueue[i & priorityQueueMask].message->message);
-			if (i == priorityQueueRead)
-				priorityQueueRead++;
-			}
-		i++;
-		}
-
-	i = queueRead;
-	while (i < queueWrite)
-		{
-		if (queue[i & queueMask].sink == sink)
-			{
-			queue[i & queueMask].sink = NULL;
-			queue[i & queueMask].message->Complete();
-			if (i == queueRead)
-				queueRead++;
-			}
-		i++;
-		}
+	priorityQueue.FlushSink(sink, true);
+	queue.FlushSink(sink, true);
 
 	readLock.Leave();
 
@@ -827,7 +875,7 @@ TriggeredWaitablePriorityQueuedSTFMessageProcessingDispatcher::TriggeredWaitable
 
 STFResult TriggeredWaitablePriorityQueuedSTFMessageProcessingDispatcher::WaitMessage(void)
 	{
-	while (!abort && (queueRead == queueWrite) && (priorityQueueRead == priorityQueueWrite))
+	while (!abort && queue.IsEmpty() && priorityQueue.IsEmpty())
 		{
 		trigger.Wait();
 		}
@@ -842,6 +890,244 @@ STFResult TriggeredWaitablePriorityQueuedSTFMessageProcessingDispatcher::WaitMes
 
 
 
+MultiLevelQueuedSTFMessageProcessingDispatcher::MultiLevelQueuedSTFMessageProcessingDispatcher(int queueSize) // must be power of two
+	{
+	uint32 i;
+
+	for (i = 0; i < STFMSG_NUM_LEVELS; i++)
+		levels[i] = new STFMessageRing(queueSize);
+
+	ResetLatencyHistograms();
+	}
+
+MultiLevelQueuedSTFMessageProcessingDispatcher::~MultiLevelQueuedSTFMessageProcessingDispatcher()
+   {
+   uint32 i;
+
+   for (i = 0; i < STFMSG_NUM_LEVELS; i++)
+      delete levels[i];
+   }
+
+uint32 MultiLevelQueuedSTFMessageProcessingDispatcher::GetMessageLevel(const STFMessage & message)
+	{
+	if (message.param2 == STFMSG_HIGH_PRIORITY)
+		return STFMSG_LEVEL_CONTROL;
+	else
+		return STFMSG_LEVEL_NORMAL;
+	}
+
+void MultiLevelQueuedSTFMessageProcessingDispatcher::ResetLatencyHistograms(void)
+	{
+	uint32 i, j;
+
+	for (i = 0; i < STFMSG_NUM_LEVELS; i++)
+		{
+		for (j = 0; j < STFMSG_LATENCY_BUCKETS; j++)
+			latency[i].buckets[j] = 0;
+		latency[i].numMessages = 0;
+		latency[i].maxLatency = 0;
+		}
+	}
+
+bool MultiLevelQueuedSTFMessageProcessingDispatcher::IsEmpty(void)
+	{
+	uint32 i;
+
+	for (i = 0; i < STFMSG_NUM_LEVELS; i++)
+		{
+		if (!levels[i]->IsEmpty())
+			return false;
+		}
+
+	return true;
+	}
+
+uint32 MultiLevelQueuedSTFMessageProcessingDispatcher::GetLatencyTime(void)
+	{
+	STFHiPrec64BitTime time;
+
+	SystemTimer->GetTime(time);
+
+	// Only the difference of two values is used, so the wrap around of the lower 32 bits is harmless
+	return time.Get64BitTime(STFTU_MICROSECS).Lower();
+	}
+
+STFResult MultiLevelQueuedSTFMessageProcessingDispatcher::DispatchMessage(STFMessageSink * sink, STFMessage message, bool wait)
+	{
+	uint32 level;
+
+	if (abort)
+		STFRES_RAISE(STFRES_OPERATION_ABORTED);
+
+	level = GetMessageLevel(message);
+	if (level >= STFMSG_NUM_LEVELS)
+		level = STFMSG_NUM_LEVELS - 1;
+
+	if (levels[level]->Enqueue(sink, message, wait, GetLatencyTime()) == STFRES_OK)
+		{
+		Trigger();
+
+		if (wait)
+			message.CompleteWait();
+
+		STFRES_RAISE_OK;
+		}
+	else
+		{
+		DPR("!! OBJECT_FULL !! Failed to Put Message 0x%x in Level %d\n", message.message, level);
+		STFRES_RAISE(STFRES_OBJECT_FULL);
+		}
+	}
+
+STFResult MultiLevelQueuedSTFMessageProcessingDispatcher::ProcessMessages(void)
+	{
+	STFMessageSink	*	msgSink;
+	STFMessage			msg;
+	uint32				stamp, wait, bucket;
+	uint32				level;
+
+	readLock.Enter();
+	while (!abort)
+		{
+		//
+		// Start over at the control level after each message
+		//
+		level = 0;
+		while (level < STFMSG_NUM_LEVELS && levels[level]->Dequeue(msgSink, msg, stamp) != STFRES_OK)
+			level++;
+
+		if (level == STFMSG_NUM_LEVELS)
+			break;
+
+		wait = GetLatencyTime() - stamp;
+		bucket = 0;
+		while (bucket < STFMSG_LATENCY_BUCKETS - 1 && (wait >> bucket))
+			bucket++;
+
+		latency[level].buckets[bucket]++;
+		latency[level].numMessages++;
+		if (wait > latency[level].maxLatency)
+			latency[level].maxLatency = wait;
+
+		readLock.Leave();
+		msgSink->ReceiveMessage(msg);
+		readLock.Enter();
+		}
+	readLock.Leave();
+
+	if (abort)
+		STFRES_RAISE(STFRES_OPERATION_ABORTED);
+	else
+		STFRES_RAISE(STFRES_OBJECT_EMPTY);
+	}
+
+STFResult MultiLevelQueuedSTFMessageProcessingDispatcher::FlushMessages(void)
+	{
+	uint32 i;
+
+	readLock.Enter();
+
+	for (i = 0; i < STFMSG_NUM_LEVELS; i++)
+		levels[i]->Flush(true);
+
+	readLock.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult MultiLevelQueuedSTFMessageProcessingDispatcher::FlushMessages(STFMessageSink * sink)
+	{
+	uint32 i;
+
+	readLock.Enter();
+
+	for (i = 0; i < STFMSG_NUM_LEVELS; i++)
+		levels[i]->FlushSink(sink, true);
+
+	readLock.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult MultiLevelQueuedSTFMessageProcessingDispatcher::CheckQueueState(void)
+	{
+	uint32 i;
+
+	if (abort)
+		STFRES_RAISE(STFRES_OPERATION_ABORTED);
+	else if (IsEmpty())
+		STFRES_RAISE(STFRES_OBJECT_EMPTY);
+
+	for (i = 0; i < STFMSG_NUM_LEVELS; i++)
+		{
+		if (levels[i]->IsFull())
+			STFRES_RAISE(STFRES_OBJECT_FULL);
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult MultiLevelQueuedSTFMessageProcessingDispatcher::GetQueueStatistics(uint32 level, uint32 & depth, uint32 & maxDepth, uint32 & rejected)
+	{
+	if (level >= STFMSG_NUM_LEVELS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	levels[level]->GetStatistics(depth, maxDepth, rejected);
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult MultiLevelQueuedSTFMessageProcessingDispatcher::GetLatencyHistogram(uint32 level, STFMessageLatencyHistogram & histogram)
+	{
+	if (level >= STFMSG_NUM_LEVELS)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	readLock.Enter();
+	histogram = latency[level];
+	readLock.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult MultiLevelQueuedSTFMessageProcessingDispatcher::ResetQueueStatistics(void)
+	{
+	uint32 i;
+
+	readLock.Enter();
+
+	for (i = 0; i < STFMSG_NUM_LEVELS; i++)
+		levels[i]->ResetStatistics();
+	ResetLatencyHistograms();
+
+	readLock.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+void TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher::Trigger(void)
+	{
+	trigger.SetSignal();
+	}
+
+TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher::TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher(int queueSize) // must be power of two
+	: MultiLevelQueuedSTFMessageProcessingDispatcher(queueSize)
+	{
+	}
+
+STFResult TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher::WaitMessage(void)
+	{
+	while (!abort && IsEmpty())
+		{
+		trigger.Wait();
+		}
+
+	if (abort)
+		STFRES_RAISE(STFRES_OPERATION_ABORTED);
+	else
+		STFRES_RAISE_OK;
+	}
+
+
 STFResult STFMessageProcessorThread::NotifyThreadTermination(void)
 	{
 	STFRES_RAISE(processor->AbortProcessor());
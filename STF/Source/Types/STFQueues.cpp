@@ -97,6 +97,142 @@ uint32 STFFixedQueue::NumElements(void)
 	}
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Single Producer Single Consumer Queue
+///////////////////////////////////////////////////////////////////////////////
+
+STFSPSCQueue::STFSPSCQueue(uint32 size)
+	: writeIndex(0), readIndex(0)
+	{
+	this->size = size;
+	mask = 1;
+	while (mask < size)
+		mask <<= 1;
+	buffer = new VOIDPTR[mask];
+	mask -= 1;
+
+	cachedReadIndex = 0;
+	cachedWriteIndex = 0;
+	}
+
+STFSPSCQueue::~STFSPSCQueue(void)
+	{
+	delete[] buffer;
+	}
+
+STFResult STFSPSCQueue::Enqueue(void * data)
+	{
+	uint32 done;
+
+	STFRES_RAISE(EnqueueBatch(&data, 1, done));
+	}
+
+STFResult STFSPSCQueue::EnqueueBatch(void ** data, uint32 num, uint32 & done)
+	{
+	uint32 last = (uint32)(int32)writeIndex;	// Only written by us, so no ordering needed
+	uint32 i;
+
+	done = 0;
+	if (num == 0)
+		STFRES_RAISE_OK;
+
+	//
+	// Only reload the consumer's index if the queue looks too full for the request
+	//
+	if (last - cachedReadIndex + num > size)
+		cachedReadIndex = (uint32)(int32)readIndex;
+
+	done = size - (last - cachedReadIndex);
+	if (done > num)
+		done = num;
+
+	if (done == 0)
+		STFRES_RAISE(STFRES_OBJECT_FULL);
+
+	for (i = 0; i < done; i++)
+		buffer[(last + i) & mask] = data[i];
+
+	// Publish the elements, the release store orders the buffer writes before the index update
+	writeIndex = (int32)(last + done);
+
+	if (done < num)
+		STFRES_RAISE(STFRES_OBJECT_FULL);
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult STFSPSCQueue::Dequeue(void * &data)
+	{
+	uint32 num;
+
+	STFRES_RAISE(DequeueBatch(&data, 1, num));
+	}
+
+STFResult STFSPSCQueue::DequeueBatch(void ** data, uint32 max, uint32 & num)
+	{
+	uint32 first = (uint32)(int32)readIndex;	// Only written by us, so no ordering needed
+	uint32 i;
+
+	if (cachedWriteIndex - first < max)
+		cachedWriteIndex = (uint32)(int32)writeIndex;
+
+	num = cachedWriteIndex - first;
+	if (num > max)
+		num = max;
+
+	if (num == 0)
+		STFRES_RAISE(STFRES_OBJECT_EMPTY);
+
+	for (i = 0; i < num; i++)
+		data[i] = buffer[(first + i) & mask];
+
+	// Release the slots, the release store orders the buffer reads before the index update
+	readIndex = (int32)(first + num);
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult STFSPSCQueue::Peek(void * &data)
+	{
+	uint32 first = (uint32)(int32)readIndex;
+
+	if (cachedWriteIndex == first)
+		{
+		cachedWriteIndex = (uint32)(int32)writeIndex;
+		if (cachedWriteIndex == first)
+			STFRES_RAISE(STFRES_OBJECT_EMPTY);
+		}
+
+	data = buffer[first & mask];
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult STFSPSCQueue::Flush (void)
+	{
+	cachedWriteIndex = (uint32)(int32)writeIndex;
+	readIndex = (int32)cachedWriteIndex;
+
+	STFRES_RAISE_OK;
+	}
+
+bool STFSPSCQueue::IsEmpty(void)
+	{
+	return NumElements() == 0;
+	}
+
+bool STFSPSCQueue::IsFull(void)
+	{
+	return NumElements() >= size;
+	}
+		
+uint32 STFSPSCQueue::NumElements(void)
+	{
+	uint32 first = (uint32)(int32)readIndex;
+
+	return (uint32)(int32)writeIndex - first;
+	}
+
 
 
 
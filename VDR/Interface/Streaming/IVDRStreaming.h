@@ -469,4 +469,74 @@ class IVDRStreamingProxyUnit : public virtual IVDRBase
 	};
 
 
+
+///////////////////////////////////////////////////////////////////////////////
+// Streaming Statistics Interface
+///////////////////////////////////////////////////////////////////////////////
+
+
+/// @brief Counters of a connector of a Streaming Unit
+///
+/// The counters are updated without locking by the threads passing packets through
+/// the connector, so counts may occasionally be lost. Times are in microseconds.
+struct VDRStreamingConnectorStatistics
+	{
+	uint32	connectorID;
+	bool		input;					///< Input connector, otherwise output connector
+	uint32	packets;					///< Packets accepted (input) or sent (output)
+	uint64	bytes;					///< Data bytes of these packets
+	uint32	bounces;					///< Packets refused with STFRES_OBJECT_FULL by the input connector
+	uint32	maxQueueDepth;			///< High water mark of the queue of a queued input connector
+	uint32	emptyStoreMisses;		///< GetEmptyDataPacket calls on an output connector that found no packet
+	uint32	allocatorWaits;		///< Memory block requests of an output connector's allocator that could not be satisfied
+	uint32	processedPackets;		///< Packets handed to the unit by the input connector
+	uint64	processingTime;		///< Total time the unit took for these packets, includes synchronous downstream processing
+	uint32	maxProcessingTime;	///< Longest time the unit took for a single packet
+	};
+
+/// @brief Counters of a Streaming Unit, summed over its connectors
+struct VDRStreamingUnitStatistics
+	{
+	uint32	numConnectors;
+	uint32	packetsIn;
+	uint64	bytesIn;
+	uint32	packetsOut;
+	uint64	bytesOut;
+	uint32	bounces;
+	uint32	maxQueueDepth;			///< Largest high water mark of all input connectors
+	uint32	emptyStoreMisses;
+	uint32	allocatorWaits;
+	uint32	processedPackets;
+	uint64	processingTime;
+	uint32	maxProcessingTime;
+	};
+
+
+/// Streaming Statistics Interface ID
+static const VDRIID VDRIID_VDR_STREAMING_STATISTICS = 0x00000074;
+
+
+/// @brief Streaming Statistics Interface
+///
+/// Provides the packet flow counters of a Streaming Unit and its connectors. The
+/// counters are always maintained, also in release builds, so they can be used to
+/// find the point where a streaming chain is throttled.
+class IVDRStreamingStatistics : public virtual IVDRBase
+	{
+	public:
+		/// @brief Get the counters of the unit, summed over all its connectors
+		virtual STFResult GetUnitStatistics(VDRStreamingUnitStatistics & statistics) = 0;
+
+		/// @brief Get the counters of a single connector
+		///
+		/// \param index is the position of the connector in the unit, from 0 to
+		/// numConnectors - 1 as returned by GetUnitStatistics(). An index outside this
+		/// range is answered with STFRES_RANGE_VIOLATION.
+		virtual STFResult GetConnectorStatistics(uint32 index, VDRStreamingConnectorStatistics & statistics) = 0;
+
+		/// @brief Set all counters of the unit and its connectors to zero
+		virtual STFResult ResetStatistics(void) = 0;
+	};
+
+
 #endif // #ifndef IVDRSTREAMING_H
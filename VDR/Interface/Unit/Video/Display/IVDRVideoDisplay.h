@@ -383,12 +383,15 @@ enum VMixInput
 /// Public Unit ID of Video Mixer Unit
 static const VDRUID VDRUID_VIDEO_MIXER	= 0x00000004;
 
+/// IVDRVideoMixer interface ID
+static const VDRIID VDRIID_VDR_VIDEO_MIXER = 0x00000091;
+
 
 //
 //! Video Mixer Unit Interface definition
 //
 
-class IVDRVideoMixer : public IVDRBase
+class IVDRVideoMixer : public virtual IVDRBase
 	{
 	public:
 
@@ -529,7 +532,7 @@ class IVDRVideoMixer : public IVDRBase
 //! 2D Effect Unit Interface definition
 //
 
-class IVDR2dEffect : public IVDRBase
+class IVDR2dEffect : public virtual IVDRBase
 	{
 	public:
 
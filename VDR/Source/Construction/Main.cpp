@@ -5,6 +5,7 @@
 #include "STF/Interface/STFDebug.h"
 #include "VDR/Source/Startup/MemoryStartup.h"
 #include "VDR/Source/Startup/KernelStartup.h"
+#include "VDR/Source/Streaming/BaseStreamingUnit.h"
 
 IVDRBase * Board;
 
@@ -39,6 +40,9 @@ int main (int argc, char ** argv)
 
 		// Release Board interface here, to free up resources
 		Board->Release();
+
+		// The streaming units are gone now, so their executor can go as well
+		ShutdownStreamingUnitExecutor();
 		}
 	else
 		{
@@ -39,9 +39,21 @@ class IMemoryOverlapDetector : virtual public IVDRBase
 
 			\return Standard Error
 
-			If there is an overlap, STFRES_RANGE_VIOLATION is returned.
+			If there is an overlap, STFRES_RANGE_VIOLATION is returned and the range is not registered.
+			All registered ranges the new one overlaps with are reported in the debug output.
 		*/
 		virtual STFResult RegisterRange (PADDR startAddress, uint32 size) = 0;
+
+		//! Remove a memory range that was registered before.
+		/*!
+			\param startAddress IN: The start address, as passed to RegisterRange().
+			\param size IN: The size of the range in bytes, as passed to RegisterRange().
+
+			\return Standard Error
+
+			If the range was not registered, STFRES_OBJECT_NOT_FOUND is returned.
+		*/
+		virtual STFResult UnregisterRange (PADDR startAddress, uint32 size) = 0;
 	};
 
 
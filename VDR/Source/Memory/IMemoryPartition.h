@@ -30,6 +30,21 @@
 
 static const VDRTID VDRTID_MEMORYPARTITION = 0x0001a000;   // created by the ID value manager
 
+//! Page sizes a mapped memory partition can use.
+enum MemoryPartitionPageMode
+	{
+	MPPM_DEFAULT_PAGES,					//< the system page size, huge pages only as the system policy decides
+	MPPM_TRANSPARENT_HUGE_PAGES,		//< small pages with transparent huge page advice
+	MPPM_HUGETLB_PAGES					//< pages from the huge TLB page pool, transparent huge pages if the pool is empty
+	};
+
+// The tags of mapped memory partitions (see MappedMemoryPartition). Changing the page mode
+// remaps the partition, so it is refused while blocks are allocated from it.
+MKTAG(MEMPART_PAGE_MODE,	VDRTID_MEMORYPARTITION,	0x01,	MemoryPartitionPageMode)
+MKTAG(MEMPART_PREFAULT,		VDRTID_MEMORYPARTITION,	0x02,	bool)		//< fault in all pages up front
+MKTAG(MEMPART_LOCK,			VDRTID_MEMORYPARTITION,	0x03,	bool)		//< lock the pages into memory
+MKTAG(MEMPART_NUMA_NODE,	VDRTID_MEMORYPARTITION,	0x04,	int32)	//< NUMA node to place the pages on, -1 for no binding
+
 
 
 ////////////////////////////////////////////////////////////////////
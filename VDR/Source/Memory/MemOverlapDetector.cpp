@@ -31,104 +31,78 @@ UNIT_CREATION_FUNCTION (CreateMemoryOverlapDetector, MemoryOverlapDetector)
 
 
 ////////////////////////////////////////////////////////////////////
-//! MemoryOverlapDetector implementation.
+//! MemoryRangeSet implementation.
 ////////////////////////////////////////////////////////////////////
 
-MemoryOverlapDetector::MemoryOverlapDetector (VDRUID unitID)
-	: SharedPhysicalUnit (unitID)
+MemoryRangeSet::MemoryRangeSet (void)
 	{
 	ranges = NULL;
 	maxRanges = 0;
 	numRanges = 0;
 	}
 
-MemoryOverlapDetector::~MemoryOverlapDetector (void)
+MemoryRangeSet::~MemoryRangeSet (void)
 	{
 	delete[] ranges;
 	}
 
+int MemoryRangeSet::FindFirstEndingAbove (PADDR address)
+	{
+	int low, high, middle;
 
+	// The ranges are disjoint, so sorting by start address also sorts by end address.
+	low = 0;
+	high = numRanges;
+	while (low < high)
+		{
+		middle = (low + high) / 2;
+		if (ranges[middle].start + ranges[middle].size > address)
+			high = middle;
+		else
+			low = middle + 1;
+		}
 
-////////////////////////////////////////////////////////////////////
-// MemoryOverlapDetector IMemoryOverlapDetector implementation.
-////////////////////////////////////////////////////////////////////
+	return low;
+	}
 
-STFResult MemoryOverlapDetector::RegisterRange (PADDR startAddress, uint32 size)
+STFResult MemoryRangeSet::InsertRange (PADDR startAddress, uint32 size)
 	{
 	Range *newRanges;
 	int arraySize, copySize, i, k;
-	PADDR start;
-	uint32 end, newEnd;
-	bool newIsHigher;
+	PADDR newEnd;
 	//lint --e{613}
-	STFAutoMutex mutex (&registerMutex);
 
-	// Look if the new range overlaps with the registered ranges.
-	//??? This is a sub-optimal linear O(n) algorithm.
+	if (size == 0)
+		STFRES_RAISE_OK;
+
+	// All ranges below index i end at or below the new start address. The ranges from i on that
+	// start below the new end address are exactly the ones that overlap with the new range.
 	newEnd = startAddress + size;
-	i = 0;
-	newIsHigher = true;
-	while (i < numRanges  &&  newIsHigher)
+	i = FindFirstEndingAbove (startAddress);
+	k = i;
+	while (k < numRanges  &&  ranges[k].start < newEnd)
 		{
-		start = ranges[i].start;
-		end   = start + ranges[i].size;
-		if (newEnd <= start)
-			{
-			// New range is at a lower address.
-			if (newEnd == start)
-				{
-				// Extend the range with the new one.
-				ranges[i].start = startAddress;
-				ranges[i].size += size;
-				STFRES_RAISE_OK;   // no overlap
-				}
-			// The loop ends now because we know that the previous ranges were at lower addresses.
-			newIsHigher = false;
-			}
-		else if (end <= startAddress)
-			{
-			// New range is at a higher address somewhere.
-			if (end == startAddress)
-				{
-				// Extend the range with the new one.
-				ranges[i].size += size;
-				k = i + 1;
-				if (k < numRanges  &&  end + size == ranges[k].start)
-					{
-					// The new range exactly closes the gap between two ranges. Merge everything.
-					ranges[i].size += ranges[k].size;
-					copySize = (numRanges-k-1) * sizeof(Range);
-					if (copySize > 0)
-						memmove (&ranges[k], &ranges[k+1], copySize);
-					numRanges--;
-					}
-				STFRES_RAISE_OK;   // no overlap
-				}
-			// Continue in the loop...
-			i++;
-			}
-		else
-			{
-			// We now have start < newEnd and startAddress < end. Since startAdress < newEnd and start < end,
-			// this means an overlap of some sort.
-			DP("MemoryOverlapDetector: start address %08x, size %05x overlaps with previous range\n", startAddress, size);
-			STFRES_RAISE(STFRES_RANGE_VIOLATION);
-			}
+		DP("MemoryRangeSet: start address %08x, size %05x overlaps with range at %08x, size %05x\n",
+			startAddress, size, ranges[k].start, ranges[k].size);
+		k++;
 		}
 
-	// Here, "i" is the index of the range that is right above the new range and cannot be merged with it.
+	if (k > i)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	// Here, "i" is the index of the range that is right above the new range.
 
 	if (numRanges >= maxRanges)
 		{
-		// The array is too small. Allocate a new one with larger size.
-		arraySize = maxRanges + 20;
+		// The array is too small. Allocate a new one with twice the size.
+		arraySize = maxRanges > 0 ? 2 * maxRanges : 20;
 		newRanges = new Range[arraySize];
 		if (newRanges == NULL)
 			{
-			DP("MemoryOverlapDetector cannot allocate larger range array\n");
+			DP("MemoryRangeSet cannot allocate larger range array\n");
 			STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
 			}
-		copySize = maxRanges * sizeof(Range);
+		copySize = numRanges * sizeof(Range);
 		if (copySize > 0)
 			memcpy (&newRanges[0], &ranges[0], copySize);
 
@@ -150,6 +124,61 @@ STFResult MemoryOverlapDetector::RegisterRange (PADDR startAddress, uint32 size)
 	STFRES_RAISE_OK;
 	}
 
+STFResult MemoryRangeSet::RemoveRange (PADDR startAddress, uint32 size)
+	{
+	int copySize, i;
+
+	if (size == 0)
+		STFRES_RAISE_OK;
+
+	i = FindFirstEndingAbove (startAddress);
+	if (i >= numRanges  ||  ranges[i].start != startAddress  ||  ranges[i].size != size)
+		STFRES_RAISE(STFRES_OBJECT_NOT_FOUND);
+
+	// Move down all ranges above index i.
+	copySize = (numRanges-i-1) * sizeof(Range);
+	if (copySize > 0)
+		memmove (&ranges[i], &ranges[i+1], copySize);
+	numRanges--;
+
+	STFRES_RAISE_OK;
+	}
+
+
+
+////////////////////////////////////////////////////////////////////
+//! MemoryOverlapDetector implementation.
+////////////////////////////////////////////////////////////////////
+
+MemoryOverlapDetector::MemoryOverlapDetector (VDRUID unitID)
+	: SharedPhysicalUnit (unitID)
+	{
+	}
+
+MemoryOverlapDetector::~MemoryOverlapDetector (void)
+	{
+	}
+
+
+
+////////////////////////////////////////////////////////////////////
+// MemoryOverlapDetector IMemoryOverlapDetector implementation.
+////////////////////////////////////////////////////////////////////
+
+STFResult MemoryOverlapDetector::RegisterRange (PADDR startAddress, uint32 size)
+	{
+	STFAutoMutex mutex (&registerMutex);
+
+	STFRES_RAISE(registeredRanges.InsertRange (startAddress, size));
+	}
+
+STFResult MemoryOverlapDetector::UnregisterRange (PADDR startAddress, uint32 size)
+	{
+	STFAutoMutex mutex (&registerMutex);
+
+	STFRES_RAISE(registeredRanges.RemoveRange (startAddress, size));
+	}
+
 
 
 ////////////////////////////////////////////////////////////////////
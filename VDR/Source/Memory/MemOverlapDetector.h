@@ -24,15 +24,23 @@
 
 
 ////////////////////////////////////////////////////////////////////
-//! Memory Overlap Detector implementation.
+//! Set of non-overlapping memory ranges.
+/*!
+	The ranges are kept in an array sorted by start address. Since they never
+	overlap, their end addresses are sorted as well, so the first range a new
+	one could collide with is found by binary search, and all k collisions
+	follow it directly. Checking a range thus costs O(log n + k).
+
+	Ranges are not merged, so that each one can be removed again. Ranges of
+	size 0 never overlap and are not stored.
+
+	The set does not lock, the owner has to serialize the calls.
+*/
 ////////////////////////////////////////////////////////////////////
 
-class MemoryOverlapDetector : virtual public IMemoryOverlapDetector,
-										public SharedPhysicalUnit
+class MemoryRangeSet
 	{
 	protected:
-		STFMutex		registerMutex;		//< protects the internal variables
-
 		struct Range
 			{
 			PADDR		start;
@@ -40,7 +48,34 @@ class MemoryOverlapDetector : virtual public IMemoryOverlapDetector,
 			};
 		Range		*ranges;
 		int		maxRanges;		//< array size
-		int		numRanges;		//< valid entries in array
+		int		numRanges;		//< valid entries in array, sorted by start address
+
+		//! Return the index of the first range that ends above the given address, or numRanges.
+		int FindFirstEndingAbove (PADDR address);
+
+	public:
+		MemoryRangeSet (void);
+		~MemoryRangeSet (void);
+
+		//! Add a range, fails with STFRES_RANGE_VIOLATION if it overlaps with a stored range.
+		STFResult InsertRange (PADDR startAddress, uint32 size);
+
+		//! Remove a range that was added with exactly the same parameters.
+		STFResult RemoveRange (PADDR startAddress, uint32 size);
+	};
+
+
+
+////////////////////////////////////////////////////////////////////
+//! Memory Overlap Detector implementation.
+////////////////////////////////////////////////////////////////////
+
+class MemoryOverlapDetector : virtual public IMemoryOverlapDetector,
+										public SharedPhysicalUnit
+	{
+	protected:
+		STFMutex				registerMutex;		//< protects the internal variables
+		MemoryRangeSet		registeredRanges;
 
 	public:
 		// Constructor and destructor.
@@ -50,6 +85,7 @@ class MemoryOverlapDetector : virtual public IMemoryOverlapDetector,
 	public:
 		// IMemoryOverlapDetector implementation.
 		virtual STFResult RegisterRange (PADDR startAddress, uint32 size);
+		virtual STFResult UnregisterRange (PADDR startAddress, uint32 size);
 
 	public:
 		// Partial IVDRBase implementation.
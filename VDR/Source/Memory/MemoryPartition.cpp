@@ -34,6 +34,22 @@
 // We use a macro to implement the unit creation, in order to avoid mistakes.
 UNIT_CREATION_FUNCTION (CreateMemoryPartition, MemoryPartition)
 
+
+
+MemoryPartition::~MemoryPartition (void)
+	{
+	// If we registered our range in Connect(), we need to unregister it now.
+	if (overlapDetector != NULL)
+		{
+		if (STFRES_IS_ERROR(overlapDetector->UnregisterRange (registeredStartAddress, registeredSize)))
+			DP("MemoryPartition: Unit 0x%08x could not unregister its range at 0x%08x, size %07d\n",
+				this->GetUnitID(), registeredStartAddress, registeredSize);
+		overlapDetector->Release ();
+		}
+
+	delete heapManager;
+	}
+
 ////////////////////////////////////////////////////////////////////
 // MemoryPartition partial ITagUnit interface implementation.
 ////////////////////////////////////////////////////////////////////
@@ -124,18 +140,26 @@ STFResult MemoryPartition::Create(uint64 * createParams)
 
 STFResult MemoryPartition::Connect(uint64 localID, IPhysicalUnit * source)
 	{
-	IMemoryOverlapDetector *overlapDetector;
+	STFResult res;
 
 	if (heapManager)
 		{
 		// We are only connected to the Memory Overlap Detector.
-		if (localID != 0)
+		if (localID != 0  ||  overlapDetector != NULL)
 			STFRES_RAISE(STFRES_INVALID_PARAMETERS);
 
 		// Let the overlap detector check that our memory range doesn't collide with others.
+		// The interface is kept to unregister the range again.
 		STFRES_REASSERT(source->QueryInterface (VDRIID_MEMORYOVERLAPDETECTOR, (void *&)overlapDetector));
-		STFRES_REASSERT(overlapDetector->RegisterRange (physicalStartAddress, partitionSize));
-		overlapDetector->Release ();
+		if (STFRES_IS_ERROR(res = overlapDetector->RegisterRange (physicalStartAddress, partitionSize)))
+			{
+			overlapDetector->Release ();
+			overlapDetector = NULL;
+			STFRES_RAISE(res);
+			}
+
+		registeredStartAddress = physicalStartAddress;
+		registeredSize = partitionSize;
 		overlapDetectionDone = true;
 		}
 	else
@@ -171,8 +195,28 @@ STFResult MemoryPartition::Initialize(uint64 * depUnitsParams)
 
 STFResult MemoryPartition::Allocate (uint32 size, uint32 alignmentFactor, uint8 * &startAddress, PADDR &physicalAddress)
 	{
+	STFResult res;
+
 	if (heapManager != NULL)
-		STFRES_RAISE(heapManager->Allocate (size, alignmentFactor, startAddress, physicalAddress));
+		{
+		STFRES_REASSERT(heapManager->Allocate (size, alignmentFactor, startAddress, physicalAddress));
+
+		// Make sure that the new block does not collide with a block handed out before.
+		allocatedRangesMutex.Enter();
+		res = allocatedRanges.InsertRange ((PADDR)startAddress, size);
+		allocatedRangesMutex.Leave();
+
+		if (STFRES_IS_ERROR(res))
+			{
+			DP("MemoryPartition::Allocate(): Unit 0x%08x handed out an overlapping block at 0x%08x, size %07d\n",
+				this->GetUnitID(), physicalAddress, size);
+			heapManager->Deallocate (startAddress, size);
+			startAddress = NULL;
+			physicalAddress = (PADDR) NULL;
+			}
+
+		STFRES_RAISE(res);
+		}
 	else
 		{
 		uint8 *p = (uint8 *)new uint32[(size + 3) / 4];
@@ -189,8 +233,24 @@ STFResult MemoryPartition::Allocate (uint32 size, uint32 alignmentFactor, uint8
 
 STFResult MemoryPartition::Deallocate (uint8 *startAddress, uint32 size)
 	{
+	STFResult res;
+
 	if (heapManager != NULL)
+		{
+		allocatedRangesMutex.Enter();
+		res = allocatedRanges.RemoveRange ((PADDR)startAddress, size);
+		allocatedRangesMutex.Leave();
+
+		// A block that was not handed out like this must not go back to the heap manager.
+		if (STFRES_IS_ERROR(res))
+			{
+			DP("MemoryPartition::Deallocate(): Unit 0x%08x got back an unknown block at 0x%08x, size %07d\n",
+				this->GetUnitID(), (PADDR)startAddress, size);
+			STFRES_RAISE(res);
+			}
+
 		STFRES_RAISE(heapManager->Deallocate (startAddress,size));
+		}
 	else
 		{
 		delete[] (uint32 *)startAddress;
@@ -200,6 +260,25 @@ STFResult MemoryPartition::Deallocate (uint8 *startAddress, uint32 size)
 	}
 
 
+STFResult MemoryPartition::MoveRegisteredRange (PADDR startAddress, uint32 size)
+	{
+	if (overlapDetector != NULL)
+		{
+		// Register the new range first, so that the old one stays registered if the new one collides.
+		STFRES_REASSERT(overlapDetector->RegisterRange (startAddress, size));
+
+		if (STFRES_IS_ERROR(overlapDetector->UnregisterRange (registeredStartAddress, registeredSize)))
+			DP("MemoryPartition: Unit 0x%08x could not unregister its range at 0x%08x, size %07d\n",
+				this->GetUnitID(), registeredStartAddress, registeredSize);
+		}
+
+	registeredStartAddress = startAddress;
+	registeredSize = size;
+
+	STFRES_RAISE_OK;
+	}
+
+
 STFResult MemoryPartition::GetPhysicalUnitStatus (uint32 & freeBytes, uint32 & freeLargestBlockSize, uint32 & usedBytes)
 	{
 	if (heapManager != NULL)
@@ -250,6 +329,8 @@ STFResult VirtualMemoryPartition::QueryInterface (VDRIID iid, void * & ifp)
 
 STFResult VirtualMemoryPartition::SetAllocationParameters (uint32 size, uint32 alignmentFactor, char * ownerName)
 	{
+	// The new parameters take effect at the next allocation, where the physical partition
+	// checks the new block against all blocks that are still allocated.
 	this->size = size;
 	this->alignmentFactor = alignmentFactor;
 	this->ownerName = ownerName;
@@ -23,6 +23,7 @@
 #include "VDR/Source/Unit/PhysicalUnit.h"
 #include "VDR/Source/Unit/VirtualUnit.h"
 #include "VDR/Source/Memory/IMemoryPartition.h"
+#include "VDR/Source/Memory/MemOverlapDetector.h"
 #include "VDR/Source/Construction/IUnitConstruction.h"
 
 
@@ -48,21 +49,33 @@ class MemoryPartition : public SharedPhysicalUnit
 		uint32						partitionSize;
 		STFHeapMemoryManager		*heapManager;
 
+		// The range registered at the overlap detector, unregistered again when the partition is destroyed.
+		IMemoryOverlapDetector	*overlapDetector;
+		PADDR							registeredStartAddress;
+		uint32						registeredSize;
+
+		// The blocks currently handed out by the heap manager, checked against each other at runtime.
+		STFMutex						allocatedRangesMutex;
+		MemoryRangeSet				allocatedRanges;
+
 		virtual STFResult Allocate (uint32 size, uint32 alignmentFactor, uint8 *& startAddress, PADDR & physicalAddress);
 		virtual STFResult Deallocate (uint8 * startAddress, uint32 size);
 		virtual STFResult GetPhysicalUnitStatus (uint32 & freeBytes, uint32 & freeLargestBlockSize, uint32 & usedBytes);
 
+		//! Replace the range registered at the overlap detector, e.g. when the partition memory moves.
+		STFResult MoveRegisteredRange (PADDR startAddress, uint32 size);
+
 	public:
 		MemoryPartition (VDRUID unitID) : SharedPhysicalUnit (unitID)
 			{
 			overlapDetectionDone = false;
 			heapManager = NULL;
+			overlapDetector = NULL;
+			registeredStartAddress = 0;
+			registeredSize = 0;
 			}
 		
-		virtual ~MemoryPartition (void)
-			{
-			delete heapManager;
-			}
+		virtual ~MemoryPartition (void);
 
 	public:
 		// Partial ITagUnit implementation.
@@ -18,7 +18,6 @@
 #include "STF/Interface/STFDataManipulationMacros.h"
 
 #include "STF/Interface/STFDebug.h"
-#include <string.h>
 
 
 
@@ -28,6 +27,40 @@ IROMManagerNoUnit	*	ROMManagerNoUnit = NULL;
 
 
 
+/// Offset of the image control directory in the ROM layout header.
+static const uint32 ROM_DIRECTORY_OFFSET = 0x800;
+
+/// ROM partition directory entries are named "ROMP" followed by the unit ID in lower case hex digits.
+static const uint32 ROM_PARTITION_NAME_LENGTH = 12;
+
+
+
+/// Parse the name of a directory entry, return false if it does not name a ROM partition.
+static bool ParseROMPartitionName (const uint8 * name, VDRUID & unit)
+	{
+	uint32 i;
+	uint8 c;
+
+	if (name[0] != 'R'  ||  name[1] != 'O'  ||  name[2] != 'M'  ||  name[3] != 'P')
+		return false;
+
+	unit = 0;
+	for (i = 4; i < ROM_PARTITION_NAME_LENGTH; i++)
+		{
+		c = name[i];
+		if (c >= '0'  &&  c <= '9')
+			unit = (unit << 4) | (c - '0');
+		else if (c >= 'a'  &&  c <= 'f')
+			unit = (unit << 4) | (c - 'a' + 10);
+		else
+			return false;
+		}
+
+	return true;
+	}
+
+
+
 ////////////////////////////////////////////////////////////////////
 /// ManagerMulticoreLittleEndianNoUnit implementation.
 ////////////////////////////////////////////////////////////////////
@@ -35,6 +68,19 @@ IROMManagerNoUnit	*	ROMManagerNoUnit = NULL;
 ManagerMulticoreLittleEndianNoUnit::ManagerMulticoreLittleEndianNoUnit (PADDR romLayoutHeader)
 	{
 	this->romLayoutHeader = (uint8 *)romLayoutHeader;
+	romLinkAddress = (uint32)romLayoutHeader;
+	romImageSize = 0;
+
+	BuildPartitionIndex ();
+	}
+
+ManagerMulticoreLittleEndianNoUnit::ManagerMulticoreLittleEndianNoUnit (uint8 * romImage, uint32 romImageSize, uint32 romLinkAddress)
+	{
+	this->romLayoutHeader = romImage;
+	this->romLinkAddress = romLinkAddress;
+	this->romImageSize = romImageSize;
+
+	BuildPartitionIndex ();
 	}
 
 ManagerMulticoreLittleEndianNoUnit::~ManagerMulticoreLittleEndianNoUnit (void)
@@ -42,46 +88,100 @@ ManagerMulticoreLittleEndianNoUnit::~ManagerMulticoreLittleEndianNoUnit (void)
 	}
 
 
+uint8 * ManagerMulticoreLittleEndianNoUnit::TranslateAddress (uint32 romAddress)
+	{
+	uint32 offset;
 
-////////////////////////////////////////////////////////////////////
-// ManagerMulticoreLittleEndianNoUnit IROMManagerNoUnit implementation.
-////////////////////////////////////////////////////////////////////
+	offset = romAddress - romLinkAddress;
+	if (romImageSize != 0  &&  (romAddress < romLinkAddress  ||  offset >= romImageSize))
+		return NULL;
 
-STFResult ManagerMulticoreLittleEndianNoUnit::FindROMPartition (VDRUID unit, void *& address, uint32 & size)
+	return romLayoutHeader + offset;
+	}
+
+
+void ManagerMulticoreLittleEndianNoUnit::BuildPartitionIndex (void)
 	{
-	char searchName[14];
-	uint8 *p;
+	uint8 *p, *entry;
 	uint32 i, dataPtr;
-	
+	int k;
+	VDRUID unit;
+
+	numIndexedPartitions = 0;
+	if (romImageSize != 0  &&  romImageSize < ROM_DIRECTORY_OFFSET + 4 * ROM_DIRECTORY_ENTRIES)
+		{
+		DP("ManagerMulticoreLittleEndianNoUnit: ROM image too small for the image control directory\n");
+		return;
+		}
+
 	// Start at the image control directory.
-	p = (uint8 *)romLayoutHeader + 0x800;
+	p = romLayoutHeader + ROM_DIRECTORY_OFFSET;
 
-	sprintf (searchName, "ROMP%08x", unit);
-	i = 0;
-	do {
+	for (i = 0; i < ROM_DIRECTORY_ENTRIES; i++, p += 4)
+		{
 		dataPtr = MAKELONG4(p[0], p[1], p[2], p[3]);
+		if (dataPtr == 0)
+			continue;
+
+		entry = TranslateAddress (dataPtr);
+		if (entry == NULL  ||  (romImageSize != 0  &&  TranslateAddress (dataPtr + 0x3f) == NULL))
+			continue;
+
+		if (!ParseROMPartitionName (entry, unit))
+			continue;
 
-		//if (dataPtr != NULL)
-		if (dataPtr != 0)  // Fixed Nico
+		// Insertion sort. Equal IDs stay in directory order, so that the first one is found as before.
+		k = numIndexedPartitions;
+		while (k > 0  &&  partitionIndex[k-1].unit > unit)
 			{
-			if (0 == strncmp ((const char *)dataPtr, searchName, 12))
-				{
-				// Found the ROM partition. Get the address and size.
-				p = (uint8 *)dataPtr;
-				i = MAKELONG4(p[0x2c], p[0x2d], p[0x2e], p[0x2f]);
-				address = (void *)MAKELONG4(p[0x34], p[0x35], p[0x36], p[0x37]);
-				if (i == 0  ||  address != (void *)MAKELONG4(p[0x38], p[0x39], p[0x3a], p[0x3b]))
-					STFRES_RAISE(STFRES_OBJECT_INVALID);   // no section at all or different source and destination
-
-				// Success.
-				size = MAKELONG4(p[0x3c], p[0x3d], p[0x3e], p[0x3f]);
-				STFRES_RAISE_OK;
-				}
+			partitionIndex[k] = partitionIndex[k-1];
+			k--;
 			}
+		partitionIndex[k].unit = unit;
+		partitionIndex[k].entry = entry;
+		numIndexedPartitions++;
+		}
+	}
+
 
-		p += 4;
-		i++;
-		} while (i < 64);
 
-	STFRES_RAISE(STFRES_OBJECT_NOT_FOUND);
+////////////////////////////////////////////////////////////////////
+// ManagerMulticoreLittleEndianNoUnit IROMManagerNoUnit implementation.
+////////////////////////////////////////////////////////////////////
+
+STFResult ManagerMulticoreLittleEndianNoUnit::FindROMPartition (VDRUID unit, void *& address, uint32 & size)
+	{
+	uint8 *p;
+	uint32 low, high, middle, numSections, source, destination;
+
+	// Find the first index entry with the unit ID.
+	low = 0;
+	high = numIndexedPartitions;
+	while (low < high)
+		{
+		middle = (low + high) / 2;
+		if (partitionIndex[middle].unit < unit)
+			low = middle + 1;
+		else
+			high = middle;
+		}
+
+	if (low >= numIndexedPartitions  ||  partitionIndex[low].unit != unit)
+		STFRES_RAISE(STFRES_OBJECT_NOT_FOUND);
+
+	// Found the ROM partition. Get the address and size.
+	p = partitionIndex[low].entry;
+	numSections = MAKELONG4(p[0x2c], p[0x2d], p[0x2e], p[0x2f]);
+	source = MAKELONG4(p[0x34], p[0x35], p[0x36], p[0x37]);
+	destination = MAKELONG4(p[0x38], p[0x39], p[0x3a], p[0x3b]);
+	if (numSections == 0  ||  source != destination)
+		STFRES_RAISE(STFRES_OBJECT_INVALID);   // no section at all or different source and destination
+
+	size = MAKELONG4(p[0x3c], p[0x3d], p[0x3e], p[0x3f]);
+	address = (void *)TranslateAddress (source);
+	if (address == NULL  ||  (size != 0  &&  TranslateAddress (source + size - 1) == NULL))
+		STFRES_RAISE(STFRES_OBJECT_INVALID);   // the section is not inside the image
+
+	// Success.
+	STFRES_RAISE_OK;
 	}
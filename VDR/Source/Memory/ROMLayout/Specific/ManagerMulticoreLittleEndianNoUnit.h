@@ -29,14 +29,39 @@
 /// accesses, which leads to corrupted data.
 ////////////////////////////////////////////////////////////////////
 
+/// The number of entries in the image control directory.
+static const uint32 ROM_DIRECTORY_ENTRIES = 64;
+
 class ManagerMulticoreLittleEndianNoUnit : public IROMManagerNoUnit
 	{
 	protected:
 		uint8		*romLayoutHeader;
+		uint32	romLinkAddress;		///< address the image was built for
+		uint32	romImageSize;			///< 0 if unknown
+
+		/// The ROM partitions of the image control directory, sorted by unit ID.
+		struct PartitionIndexEntry
+			{
+			VDRUID	unit;
+			uint8		*entry;
+			};
+		PartitionIndexEntry	partitionIndex[ROM_DIRECTORY_ENTRIES];
+		uint32					numIndexedPartitions;
+
+		/// Convert an address inside the ROM image to a pointer, NULL if it is outside.
+		uint8 * TranslateAddress (uint32 romAddress);
+
+		void BuildPartitionIndex (void);
 
 	public:
 		// Constructor and destructor.
+
+		/// The image resides at the address it was built for.
 		ManagerMulticoreLittleEndianNoUnit (PADDR romLayoutHeader);
+
+		/// The image was loaded to a different address, e.g. mapped from a file by MappedROMImage.
+		ManagerMulticoreLittleEndianNoUnit (uint8 * romImage, uint32 romImageSize, uint32 romLinkAddress);
+
 		virtual ~ManagerMulticoreLittleEndianNoUnit (void);
 
 	public:
@@ -0,0 +1,336 @@
+///
+/// @brief      Memory partition mapped with mmap() for Linux User Mode
+///
+
+#include "VDR/Source/Memory/Specific/LinuxUser/MappedMemoryPartition.h"
+#include "STF/Interface/STFDebug.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+// Size of the node mask passed to mbind(), in unsigned longs
+#define MAPPED_PARTITION_NODE_MASK_WORDS	16
+
+///////////////////////////////////////////////////////////////////////////////
+// Global unit creation function.
+///////////////////////////////////////////////////////////////////////////////
+
+// We use a macro to implement the unit creation, in order to avoid mistakes.
+UNIT_CREATION_FUNCTION (CreateMappedMemoryPartition, MappedMemoryPartition)
+
+
+
+//! Return the size of the pages in the huge TLB page pool.
+static uint32 GetHugeTLBPageSize (void)
+	{
+	char line[128];
+	uint32 sizeKB;
+	FILE *meminfo;
+
+	sizeKB = 2048;		// the default on most systems
+
+	meminfo = fopen ("/proc/meminfo", "r");
+	if (meminfo)
+		{
+		while (fgets (line, sizeof(line), meminfo))
+			{
+			if (sscanf (line, "Hugepagesize: %u kB", &sizeKB) == 1)
+				break;
+			}
+		fclose (meminfo);
+		}
+
+	return sizeKB * 1024;
+	}
+
+
+
+////////////////////////////////////////////////////////////////////
+// MappedMemoryPartition implementation.
+////////////////////////////////////////////////////////////////////
+
+MappedMemoryPartition::MappedMemoryPartition (VDRUID unitID)
+	: MemoryPartition (unitID)
+	{
+	pageMode = MPPM_DEFAULT_PAGES;
+	prefault = false;
+	lockPages = false;
+	numaNode = -1;
+
+	mappedAddress = NULL;
+	mappedSize = 0;
+	mappedPageMode = MPPM_DEFAULT_PAGES;
+	}
+
+MappedMemoryPartition::~MappedMemoryPartition (void)
+	{
+	UnmapPartition ();
+	}
+
+
+STFResult MappedMemoryPartition::MapPartition (void)
+	{
+	uint8 *address;
+	uint32 size, hugePageSize, offset, pageSize;
+	int flags;
+	bool populated, hugeTLB;
+
+	// Mapping with MAP_POPULATE is the cheapest way to prefault, but the pages must be
+	// faulted in only after the huge page advice and the NUMA binding have been set.
+	populated = prefault  &&  numaNode < 0  &&  pageMode != MPPM_TRANSPARENT_HUGE_PAGES;
+	flags = MAP_PRIVATE | MAP_ANONYMOUS | (populated ? MAP_POPULATE : 0);
+
+	address = (uint8 *)MAP_FAILED;
+	size = partitionSize;
+	hugePageSize = 0;
+	hugeTLB = false;
+
+#ifdef MAP_HUGETLB
+	if (pageMode == MPPM_HUGETLB_PAGES)
+		{
+		// Huge TLB mappings must cover whole huge pages.
+		hugePageSize = GetHugeTLBPageSize ();
+		size = (partitionSize + hugePageSize - 1) & ~(hugePageSize - 1);
+
+		address = (uint8 *)mmap (NULL, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+		if (address != (uint8 *)MAP_FAILED)
+			hugeTLB = true;
+		else
+			{
+			DP("MappedMemoryPartition: No huge TLB pages for unit 0x%08x (errno %d), using transparent huge pages\n",
+				GetUnitID(), errno);
+			size = partitionSize;
+			populated = false;
+			flags &= ~MAP_POPULATE;
+			}
+		}
+#endif
+
+	if (address == (uint8 *)MAP_FAILED)
+		{
+		address = (uint8 *)mmap (NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+		if (address == (uint8 *)MAP_FAILED)
+			{
+			DP("MappedMemoryPartition: Cannot map %d bytes for unit 0x%08x (errno %d)\n", size, GetUnitID(), errno);
+			STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+			}
+
+#ifdef MADV_HUGEPAGE
+		if (pageMode != MPPM_DEFAULT_PAGES)
+			madvise (address, size, MADV_HUGEPAGE);
+#endif
+		}
+
+	mappedAddress = address;
+	mappedSize = size;
+	mappedPageMode = pageMode;
+
+	ApplyPlacement (true);
+
+	// Locked pages are faulted in by mlock() already. The new mapping is not used yet,
+	// so touching its pages does no harm.
+	if (prefault  &&  !populated  &&  !lockPages)
+		{
+		pageSize = hugeTLB ? hugePageSize : (uint32)sysconf (_SC_PAGESIZE);
+		for (offset = 0; offset < mappedSize; offset += pageSize)
+			((volatile uint8 *)mappedAddress)[offset] = 0;
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+
+void MappedMemoryPartition::UnmapPartition (void)
+	{
+	if (mappedAddress)
+		{
+		munmap (mappedAddress, mappedSize);
+		mappedAddress = NULL;
+		mappedSize = 0;
+		}
+	}
+
+
+void MappedMemoryPartition::ApplyPlacement (bool initial)
+	{
+#ifdef SYS_mbind
+	unsigned long nodeMask[MAPPED_PARTITION_NODE_MASK_WORDS];
+	int bitsPerWord = 8 * sizeof(unsigned long);
+
+	if (numaNode >= 0  &&  numaNode < MAPPED_PARTITION_NODE_MASK_WORDS * bitsPerWord)
+		{
+		memset (nodeMask, 0, sizeof(nodeMask));
+		nodeMask[numaNode / bitsPerWord] = 1UL << (numaNode % bitsPerWord);
+
+		// Pages that are already present are migrated to the node.
+		if (syscall (SYS_mbind, mappedAddress, (unsigned long)mappedSize, MPOL_BIND, nodeMask,
+						 (unsigned long)(8 * sizeof(nodeMask) + 1), initial ? 0 : MPOL_MF_MOVE) != 0)
+			{
+			DP("MappedMemoryPartition: Cannot bind unit 0x%08x to NUMA node %d (errno %d)\n", GetUnitID(), numaNode, errno);
+			}
+		}
+	else if (!initial)
+		syscall (SYS_mbind, mappedAddress, (unsigned long)mappedSize, MPOL_DEFAULT, NULL, 0UL, 0);
+#endif
+
+	if (lockPages)
+		{
+		if (mlock (mappedAddress, mappedSize) != 0)
+			DP("MappedMemoryPartition: Cannot lock %d bytes of unit 0x%08x (errno %d)\n", mappedSize, GetUnitID(), errno);
+		}
+	else if (!initial)
+		munlock (mappedAddress, mappedSize);
+	}
+
+
+
+////////////////////////////////////////////////////////////////////
+// MappedMemoryPartition partial ITagUnit implementation.
+////////////////////////////////////////////////////////////////////
+
+STFResult MappedMemoryPartition::InternalConfigureTags (TAG * tags)
+	{
+	PARSE_TAGS_START(tags, changeSet)
+		GETSETC(MEMPART_PAGE_MODE,		pageMode,	MMPCSG_PAGE_MODE);
+		GETSETC(MEMPART_PREFAULT,		prefault,	MMPCSG_PLACEMENT);
+		GETSETC(MEMPART_LOCK,			lockPages,	MMPCSG_PLACEMENT);
+		GETSETC(MEMPART_NUMA_NODE,		numaNode,	MMPCSG_PLACEMENT);
+	PARSE_TAGS_END
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult MappedMemoryPartition::InternalUpdate (void)
+	{
+	uint32 freeBytes, freeLargestBlockSize, usedBytes;
+	uint8 *previousAddress;
+	uint32 previousSize;
+	MemoryPartitionPageMode previousPageMode;
+	STFResult res;
+
+	// Before Initialize() the settings are simply used for the first mapping.
+	if (mappedAddress == NULL)
+		STFRES_RAISE_OK;
+
+	if ((changeSet & (1 << MMPCSG_PAGE_MODE))  &&  pageMode != mappedPageMode)
+		{
+		// The page size can only be changed by mapping the partition anew, which is
+		// impossible while blocks are allocated from it.
+		STFRES_REASSERT(heapManager->GetStatus (freeBytes, freeLargestBlockSize, usedBytes));
+		if (usedBytes != 0)
+			{
+			pageMode = mappedPageMode;
+			STFRES_RAISE(STFRES_OBJECT_IN_USE);
+			}
+
+		// Map the new memory first, so that the old one is kept if that fails.
+		previousAddress = mappedAddress;
+		previousSize = mappedSize;
+		previousPageMode = mappedPageMode;
+		if (STFRES_FAILED(res = MapPartition ()))
+			{
+			pageMode = mappedPageMode;
+			STFRES_RAISE(res);
+			}
+
+		// The overlap detector follows the partition to its new memory.
+		if (STFRES_FAILED(res = MoveRegisteredRange ((PADDR)mappedAddress, partitionSize)))
+			{
+			munmap (mappedAddress, mappedSize);
+			mappedAddress = previousAddress;
+			mappedSize = previousSize;
+			mappedPageMode = pageMode = previousPageMode;
+			STFRES_RAISE(res);
+			}
+		munmap (previousAddress, previousSize);
+
+		physicalStartAddress = (PADDR)mappedAddress;
+		STFRES_RAISE(heapManager->Initialize (physicalStartAddress, partitionSize));
+		}
+
+	if (changeSet & (1 << MMPCSG_PLACEMENT))
+		{
+		ApplyPlacement (false);
+
+#ifdef MADV_POPULATE_WRITE
+		// The blocks in use must not be touched, so let the kernel fault the pages in.
+		if (prefault  &&  !lockPages)
+			madvise (mappedAddress, mappedSize, MADV_POPULATE_WRITE);
+#endif
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+
+
+////////////////////////////////////////////////////////////////////
+// MappedMemoryPartition partial IPhysicalUnit implementation.
+////////////////////////////////////////////////////////////////////
+
+STFResult MappedMemoryPartition::Create(uint64 * createParams)
+	{
+	uint32 numParams, value;
+
+	// The start address is only used for checking the board configuration, the size must be given.
+	numParams = GetNumberOfParameters(createParams);
+	STFRES_REASSERT(GetDWordParameter(createParams, 0, value));
+	physicalStartAddress = (PADDR)value;
+	STFRES_REASSERT(GetDWordParameter(createParams, 1, partitionSize));
+	if (partitionSize == 0)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	// Optional parameters
+	if (numParams >= 3)
+		{
+		STFRES_REASSERT(GetDWordParameter(createParams, 2, value));
+		pageMode = (MemoryPartitionPageMode)value;
+		}
+
+	if (numParams >= 5)
+		{
+		STFRES_REASSERT(GetDWordParameter(createParams, 3, value));
+		prefault = value != 0;
+		STFRES_REASSERT(GetDWordParameter(createParams, 4, value));
+		lockPages = value != 0;
+		}
+
+	if (numParams >= 6)
+		{
+		STFRES_REASSERT(GetDWordParameter(createParams, 5, value));
+		numaNode = (int32)value;
+		}
+
+	heapManager = (STFHeapMemoryManager*)new STFFreeListHeapMemoryManager;
+	if (heapManager == NULL)
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult MappedMemoryPartition::Initialize(uint64 * depUnitsParams)
+	{
+	STFResult res;
+
+	STFRES_REASSERT(MapPartition ());
+
+	// From now on the partition manages the mapped memory, which also replaces the
+	// configured range at the overlap detector.
+	if (STFRES_SUCCEEDED(res = MoveRegisteredRange ((PADDR)mappedAddress, partitionSize)))
+		{
+		physicalStartAddress = (PADDR)mappedAddress;
+		res = MemoryPartition::Initialize (depUnitsParams);
+		}
+
+	if (STFRES_FAILED(res))
+		UnmapPartition ();
+
+	STFRES_RAISE(res);
+	}
@@ -0,0 +1,70 @@
+///
+/// @brief      Memory partition mapped with mmap() for Linux User Mode
+///
+
+#ifndef MAPPEDMEMORYPARTITION_H
+#define MAPPEDMEMORYPARTITION_H
+
+#include "VDR/Source/Memory/MemoryPartition.h"
+
+
+
+////////////////////////////////////////////////////////////////////
+//! Memory partition backed by an anonymous memory mapping.
+/*!
+	The create parameters start with the start address and size as for
+	MemoryPartition. The start address is only used for the overlap detection of
+	the board configuration, the memory itself is mapped in Initialize(). From then
+	on the mapped range is registered at the overlap detector instead. They can
+	optionally be followed by the MEMPART_PAGE_MODE, MEMPART_PREFAULT, MEMPART_LOCK
+	and MEMPART_NUMA_NODE values, which can be changed later through the tags.
+
+	Locking and NUMA placement are performance hints. If the system refuses them,
+	the partition keeps working with ordinary pages.
+*/
+////////////////////////////////////////////////////////////////////
+
+class MappedMemoryPartition : public MemoryPartition
+	{
+	protected:
+		// Change set groups of the tags.
+		enum ChangeSetGroup
+			{
+			MMPCSG_PAGE_MODE,
+			MMPCSG_PLACEMENT
+			};
+
+		// Variables configurable by create parameters and tags.
+		MemoryPartitionPageMode		pageMode;
+		bool								prefault;
+		bool								lockPages;
+		int32								numaNode;
+
+		// The current mapping.
+		uint8								*mappedAddress;
+		uint32							mappedSize;
+		MemoryPartitionPageMode		mappedPageMode;		//< as requested when mapping
+
+		STFResult MapPartition (void);
+		void UnmapPartition (void);
+
+		// Apply the locking and NUMA placement to the current mapping.
+		void ApplyPlacement (bool initial);
+
+	public:
+		MappedMemoryPartition (VDRUID unitID);
+		virtual ~MappedMemoryPartition (void);
+
+	public:
+		// Partial ITagUnit implementation.
+		virtual STFResult InternalConfigureTags (TAG * tags);
+		virtual STFResult InternalUpdate (void);
+
+	public:
+		// Partial IPhysicalUnit implementation.
+		virtual STFResult Create(uint64 * createParams);
+		virtual STFResult Initialize(uint64 * depUnitsParams);
+	};
+
+
+#endif
@@ -0,0 +1,78 @@
+///
+/// @brief      ROM image file mapped with mmap() for Linux User Mode
+///
+
+#include "VDR/Source/Memory/Specific/LinuxUser/MappedROMImage.h"
+#include "STF/Interface/STFDebug.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+
+////////////////////////////////////////////////////////////////////
+// MappedROMImage implementation.
+////////////////////////////////////////////////////////////////////
+
+MappedROMImage::MappedROMImage (void)
+	{
+	image = NULL;
+	imageSize = 0;
+	}
+
+MappedROMImage::~MappedROMImage (void)
+	{
+	Close ();
+	}
+
+
+STFResult MappedROMImage::Open (const char * fileName)
+	{
+	struct stat status;
+	void *mapping;
+	int file;
+
+	Close ();
+
+	file = open (fileName, O_RDONLY);
+	if (file < 0)
+		{
+		DP("MappedROMImage: Cannot open %s (errno %d)\n", fileName, errno);
+		STFRES_RAISE(STFRES_OBJECT_NOT_FOUND);
+		}
+
+	if (fstat (file, &status) != 0  ||  status.st_size == 0  ||  (off_t)(uint32)status.st_size != status.st_size)
+		{
+		close (file);
+		STFRES_RAISE(STFRES_OBJECT_INVALID);
+		}
+
+	// The mapping keeps its own reference to the file.
+	mapping = mmap (NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close (file);
+
+	if (mapping == MAP_FAILED)
+		{
+		DP("MappedROMImage: Cannot map %s (errno %d)\n", fileName, errno);
+		STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+		}
+
+	image = (uint8 *)mapping;
+	imageSize = (uint32)status.st_size;
+
+	STFRES_RAISE_OK;
+	}
+
+
+void MappedROMImage::Close (void)
+	{
+	if (image)
+		{
+		munmap (image, imageSize);
+		image = NULL;
+		imageSize = 0;
+		}
+	}
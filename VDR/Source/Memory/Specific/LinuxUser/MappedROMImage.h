@@ -0,0 +1,43 @@
+///
+/// @brief      ROM image file mapped with mmap() for Linux User Mode
+///
+
+#ifndef MAPPEDROMIMAGE_H
+#define MAPPEDROMIMAGE_H
+
+#include "STF/Interface/Types/STFBasicTypes.h"
+#include "STF/Interface/Types/STFResult.h"
+
+
+
+////////////////////////////////////////////////////////////////////
+//! A ROM image file, mapped read-only instead of being copied into memory.
+/*!
+	The pages of the image are only read from the file when they are accessed,
+	so the ROM partitions that are never used cost no load time. Pass the image
+	to the ManagerMulticoreLittleEndianNoUnit constructor that takes the image,
+	its size and its link address. The image must stay open as long as the ROM
+	manager and the partitions it returned are in use.
+*/
+////////////////////////////////////////////////////////////////////
+
+class MappedROMImage
+	{
+	protected:
+		uint8		*image;
+		uint32	imageSize;
+
+	public:
+		MappedROMImage (void);
+		~MappedROMImage (void);
+
+		//! Map the given image file, replacing a previously opened one.
+		STFResult Open (const char * fileName);
+		void Close (void);
+
+		uint8 * GetImage (void) {return image;}
+		uint32 GetImageSize (void) {return imageSize;}
+	};
+
+
+#endif
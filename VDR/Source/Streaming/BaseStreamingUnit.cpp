@@ -479,6 +479,7 @@ STFResult VirtualNonthreadedStandardStreamingUnit::QueryInterface(VDRIID iid, vo
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnit);
 
 	STFRES_RAISE_OK;
@@ -509,6 +510,7 @@ STFResult VirtualNonthreadedStandardStreamingUnitCollection::QueryInterface(VDRI
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnitCollection);
 
 	STFRES_RAISE_OK;
@@ -1005,6 +1007,7 @@ STFResult VirtualNonthreadedStandardInOutStreamingUnit::QueryInterface(VDRIID ii
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnit);
 
 	STFRES_RAISE_OK;
@@ -1035,6 +1038,7 @@ STFResult VirtualNonthreadedStandardInOutStreamingUnitCollection::QueryInterface
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnitCollection);
 
 	STFRES_RAISE_OK;
@@ -1047,6 +1051,57 @@ void VirtualNonthreadedStandardInOutStreamingUnitCollection::ReleaseDestruct(voi
 	}
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Shared executor for threaded streaming units
+///////////////////////////////////////////////////////////////////////////////
+
+static STFTaskExecutor * streamingUnitExecutor = NULL;
+
+STFResult GetStreamingUnitExecutor(STFTaskExecutor * & executor)
+	{
+	STFResult res = STFRES_OK;
+
+	STFGlobalLock();
+
+	if (!streamingUnitExecutor)
+		{
+		streamingUnitExecutor = new STFTaskExecutor("StrmExec", 0, VDR_STREAMING_UNIT_EXECUTOR_STACKSIZE, VDR_STREAMING_UNIT_EXECUTOR_PRIORITY);
+		res = streamingUnitExecutor->Start();
+		}
+
+	executor = streamingUnitExecutor;
+
+	STFGlobalUnlock();
+
+	STFRES_RAISE(res);
+	}
+
+void ShutdownStreamingUnitExecutor(void)
+	{
+	STFTaskExecutor * executor;
+
+	STFGlobalLock();
+
+	executor = streamingUnitExecutor;
+	streamingUnitExecutor = NULL;
+
+	STFGlobalUnlock();
+
+	// The destructor stops the workers
+	delete executor;
+	}
+
+void UseStreamingUnitExecutor(STFSchedulableThread * unit)
+	{
+#if VDR_STREAMING_UNIT_EXECUTOR
+	STFTaskExecutor * executor;
+
+	if (STFRES_SUCCEEDED(GetStreamingUnitExecutor(executor)))
+		unit->SetTaskExecutor(executor);
+#endif
+	}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // ThreadedBaseStreamingUnit
 ///////////////////////////////////////////////////////////////////////////////
@@ -1056,38 +1111,24 @@ ThreadedStandardStreamingUnit::ThreadedStandardStreamingUnit(uint32 inQueueSize,
 																				 int32 inThreshold,
 																				 STFString threadName)
 	: StandardStreamingUnit(),
-	  STFThread(threadName)
+	  STFSchedulableThread(threadName)
 	{
 	// This is merely a workaround for a ST40 compiler bug or limitation
 	SetConnectors(new QueuedInputConnector(inQueueSize, inThreshold, 0, this));
 	}
 
 
-void ThreadedStandardStreamingUnit::ThreadEntry(void)
+void ThreadedStandardStreamingUnit::ProcessThreadSignal(void)
 	{
-	// Don't do anything until we receive data (or are requested for more data)
-	// for the first time.
-	WaitThreadSignal();
-
-	while (!terminate)
+	// Process a possibly pending packet
+	if (ProcessPendingPacket() != STFRES_OBJECT_FULL && (!pendingPacket || !packetBounced))
 		{
-		// Process a possibly pending packet
-		if (ProcessPendingPacket() != STFRES_OBJECT_FULL && (!pendingPacket || !packetBounced))
-			{
-			// Request more data at the input connector if all pending data was sent/consumed, 
-			inputConnector->RequestPackets();
-			}
-		else
-			{
-			}
-
-		if (!flushRequest)
-			CompleteOutputProcessing();		
-
-
-		// Wait for the next packet or packet request from further downstream to arrive
-		WaitThreadSignal();
+		// Request more data at the input connector if all pending data was sent/consumed, 
+		inputConnector->RequestPackets();
 		}
+
+	if (!flushRequest)
+		CompleteOutputProcessing();		
 	}
 
 
@@ -1199,6 +1240,7 @@ STFResult VirtualThreadedStandardStreamingUnit::QueryInterface(VDRIID iid, void
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnit);
 
 	STFRES_RAISE_OK;
@@ -1231,6 +1273,7 @@ STFResult VirtualThreadedStandardStreamingUnitCollection::QueryInterface(VDRIID
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnitCollection);
 
 	STFRES_RAISE_OK;
@@ -1243,41 +1286,30 @@ ThreadedStandardInOutStreamingUnit::ThreadedStandardInOutStreamingUnit(uint32 nu
 																							  int32 inThreshold,
 																							  STFString threadName)
 	: StandardInOutStreamingUnit(numOutPackets),
-	  STFThread(threadName)
+	  STFSchedulableThread(threadName)
 	{
 	// This is merely a workaround for a ST40 compiler bug or limitation
 	SetConnectors(new QueuedInputConnector(inQueueSize, inThreshold, 0, this));
 	}
 
 
-void ThreadedStandardInOutStreamingUnit::ThreadEntry(void)
+void ThreadedStandardInOutStreamingUnit::ProcessThreadSignal(void)
 	{
-	// Don't do anything until we receive data (or are requested for more data)
-	// for the first time.
-	WaitThreadSignal();
-
-	while (!terminate)
+	// Process a possibly pending packet
+	if (ProcessPendingPacket() != STFRES_OBJECT_FULL && (!pendingPacket || !packetBounced))
 		{
-		// Process a possibly pending packet
-		if (ProcessPendingPacket() != STFRES_OBJECT_FULL && (!pendingPacket || !packetBounced))
-			{
-			// Request more data at the input connector if all pending data was sent/consumed, 
-			inputConnector->RequestPackets();			
-			}
-		else
-			{
-			// Do processing like delivery of produced data even if there is no more
-			// input data - the thread could potentially be woken up by an MME command
-			// completion callback...
-			}
-
-		if (!flushRequest)
-			CompleteOutputProcessing();
-
-
-		// Wait for the next packet or packet request from further downstream to arrive
-		WaitThreadSignal();
+		// Request more data at the input connector if all pending data was sent/consumed, 
+		inputConnector->RequestPackets();			
+		}
+	else
+		{
+		// Do processing like delivery of produced data even if there is no more
+		// input data - the thread could potentially be woken up by an MME command
+		// completion callback...
 		}
+
+	if (!flushRequest)
+		CompleteOutputProcessing();
 	}
 
 
@@ -1407,6 +1439,7 @@ STFResult VirtualThreadedStandardInOutStreamingUnit::QueryInterface(VDRIID iid,
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnit);
 
 	STFRES_RAISE_OK;
@@ -1442,6 +1475,7 @@ STFResult VirtualThreadedStandardInOutStreamingUnitCollection::QueryInterface(VD
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnitCollection);
 
 	STFRES_RAISE_OK;
@@ -26,9 +26,44 @@
 #include "VDR/Source/Streaming/StreamingFormatter.h"
 #include "VDR/Source/Unit/PhysicalUnit.h"
 #include "STF/Interface/STFSynchronisation.h"
+#include "STF/Interface/STFTaskExecutor.h"
 #include "VDR/Source/Streaming/StreamingDiagnostics.h"
 
 
+///
+/// Execution mode of threaded streaming units.
+///
+/// With VDR_STREAMING_UNIT_EXECUTOR set, threaded streaming units that opt in with
+/// UseStreamingUnitExecutor() do not get an OS thread of their own, but are run as tasks on a
+/// shared pool of work-stealing workers (one per processor). SignalPacketArrival() and the other
+/// thread signals then schedule the unit on the pool, and the unit processes its pending data to
+/// quiescence on the worker that picks it up. All other units keep their own thread.
+/// Individual units can also be switched with SetTaskExecutor() before their thread is started.
+///
+#ifndef VDR_STREAMING_UNIT_EXECUTOR
+#define VDR_STREAMING_UNIT_EXECUTOR						0
+#endif
+
+#ifndef VDR_STREAMING_UNIT_EXECUTOR_STACKSIZE
+#define VDR_STREAMING_UNIT_EXECUTOR_STACKSIZE		65536
+#endif
+
+#ifndef VDR_STREAMING_UNIT_EXECUTOR_PRIORITY
+#define VDR_STREAMING_UNIT_EXECUTOR_PRIORITY			STFTP_HIGHER
+#endif
+
+/// Retrieve the executor shared by all threaded streaming units, it is created and started on first use
+STFResult GetStreamingUnitExecutor(STFTaskExecutor * & executor);
+
+/// Stop and delete the shared executor, after all streaming units have been destroyed
+void ShutdownStreamingUnitExecutor(void);
+
+/// Run a threaded streaming unit on the shared executor if VDR_STREAMING_UNIT_EXECUTOR is set
+/// Units call this from their constructor. Units that block or pace themselves, like renderers
+/// waiting for the display time of a frame, must not opt in, as they would hold a shared worker.
+void UseStreamingUnitExecutor(STFSchedulableThread * unit);
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // StandardStreamingUnit
 ///////////////////////////////////////////////////////////////////////////////
@@ -234,13 +269,13 @@ class VirtualNonthreadedStandardStreamingUnitCollection : public VirtualUnitColl
 	};
 
 class ThreadedStandardStreamingUnit : public StandardStreamingUnit,
-												  public STFThread
+												  public STFSchedulableThread
 	{
 	protected:
 		//
-		// STFThread overrides
+		// STFSchedulableThread overrides
 		//
-		void ThreadEntry(void);
+		void ProcessThreadSignal(void);
 		STFResult NotifyThreadTermination(void);
 
 		virtual STFResult CompleteOutputProcessing()
@@ -661,13 +696,13 @@ class VirtualNonthreadedStandardInOutStreamingUnitCollection : public VirtualUni
 /// Usually , you do not directly derive a class from this - derive from
 /// the Virtual extensions instead (see below).
 class ThreadedStandardInOutStreamingUnit : public StandardInOutStreamingUnit,
-														 public STFThread
+														 public STFSchedulableThread
 	{
 	protected:
 		//
-		// STFThread overrides
+		// STFSchedulableThread overrides
 		//
-		void ThreadEntry(void);
+		void ProcessThreadSignal(void);
 		STFResult NotifyThreadTermination(void);
 
 		virtual STFResult CompleteOutputProcessing()
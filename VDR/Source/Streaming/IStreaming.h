@@ -142,6 +142,13 @@ class IStreamingConnector
    //! Check, whether this chain is a push chain (e.g. has a capture input as a source)
    virtual STFResult IsPushingChain(void) = 0;
 
+   //! Get the packet flow counters of the connector, see IVDRStreamingStatistics
+   /*!
+     The connectorID and input fields are not maintained, they are filled in by
+     the Streaming Unit when the counters are queried.
+   */
+   virtual VDRStreamingConnectorStatistics & GetStatistics(void) = 0;
+
 #if _DEBUG
    virtual STFString GetInformation(void) = 0;
 #endif
@@ -187,6 +194,17 @@ class IStreamingInputConnector : public virtual IStreamingConnector
    */
    virtual STFResult ReceivePacket(StreamingDataPacket * packet) = 0;
 
+   //! Receive a batch of data packets on the input connector
+   /*!
+     Same as calling ReceivePacket() for each packet, but the streaming state
+     is checked and the unit is signalled only once per batch.
+     Packets are accepted in order, \param accepted returns the number of packets
+     accepted. If not all packets were accepted, the error that refused the
+     first remaining packet is returned, and the remaining packets still belong
+     to the caller.
+   */
+   virtual STFResult ReceivePackets(StreamingDataPacket ** packets, uint32 num, uint32 & accepted) = 0;
+
    //! Called by the Input Connector's unit to ask for more data packets
    /*!
      If the Input Connector is buffered, one of the Streaming Unit's
@@ -251,6 +269,13 @@ class IStreamingOutputConnector : public virtual IStreamingConnector,
    */
    virtual STFResult SendPacket(StreamingDataPacket * packet) = 0;
 
+   //! Send a batch of packets to attached input connector
+   /*!
+     Batched version of SendPacket(), see IStreamingInputConnector::ReceivePackets()
+     for the meaning of \param accepted and the returned error.
+   */
+   virtual STFResult SendPackets(StreamingDataPacket ** packets, uint32 num, uint32 & accepted) = 0;
+
    //! Receive upstream notification
    /*!
      Called by the attached input connector. This notification is processed
@@ -312,6 +337,10 @@ class StreamingDataPacket : public STFInterlockedNode,
 
    public:
    VDRStreamingDataPacket vdrPacket;
+
+   //! Time of the last trace point and the trace session it belongs to, see StreamingTrace.h
+   STFHiPrec64BitTime	traceTime;
+   uint32				traceSession;
 		
    StreamingDataPacket(IStreamingDataPacketManager * originator);
    ~StreamingDataPacket(void);
@@ -203,6 +203,54 @@ STFResult VirtualStreamReplicatorStreamingUnit::ResetUpStreamCounters(void)
 	STFRES_RAISE_OK;
 	}
 
+STFResult VirtualStreamReplicatorStreamingUnit::SelectOutputRanges(const StreamingDataPacket * packet)
+	{
+	uint32 i;
+
+	for(i=0; i<numOutputs; i++)
+		outputRangeMasks[i] = MKFLAG(packet->vdrPacket.numRanges) - 1;
+
+	STFRES_RAISE_OK;
+	}
+
+///
+/// Remove all ranges from a replicated packet that are not selected in the mask,
+/// a frame start of a removed range moves to the next remaining range.
+///
+static void RemoveUnselectedRanges(VDRStreamingDataPacket * packet, uint32 mask)
+	{
+	VDRDataRange	*	ranges = packet->tagRanges.ranges + packet->numTags;
+	uint32				i, num;
+	uint16				frameStartFlags;
+	bool					frameStart;
+
+	num = 0;
+	frameStartFlags = 0;
+	frameStart = false;
+
+	for(i=0; i<packet->numRanges; i++)
+		{
+		if (packet->frameStartFlags & MKFLAG(i))
+			frameStart = true;
+
+		if (mask & MKFLAG(i))
+			{
+			ranges[num] = ranges[i];
+
+			if (frameStart)
+				{
+				frameStartFlags |= MKFLAG(num);
+				frameStart = false;
+				}
+
+			num++;
+			}
+		}
+
+	packet->numRanges = (uint8)num;
+	packet->frameStartFlags = frameStartFlags;
+	}
+
 STFResult VirtualStreamReplicatorStreamingUnit::GetStreamTagIDs(uint32 connectorID, VDRTID * & ids)
 	{
 	uint32		i, j, n;
@@ -296,15 +344,32 @@ STFResult VirtualStreamReplicatorStreamingUnit::ParseReceivePacket(const Streami
 				{
 				STFRES_REASSERT(ArmUpstreamCounter(SRMC_GROUP_END, groupID, numOutputs));
 				}
+			sendingState = SRSS_SELECT_OUTPUT_RANGES;
+
+		case SRSS_SELECT_OUTPUT_RANGES:
+			STFRES_REASSERT(SelectOutputRanges(packet));
 			sendingState = SRSS_REPLICATE_PACKETS;
 
 		case SRSS_REPLICATE_PACKETS:
 			// Replicating Packets for all output connectors
-			while (replicatedPackets < numOutputs && STFRES_SUCCEEDED(result = outputConnectors[replicatedPackets]->GetEmptyDataPacket(pendingOutputPackets[replicatedPackets])))
+			while (replicatedPackets < numOutputs)
 				{
-				pendingOutputPackets[replicatedPackets]->CopyFromVDRPacket(&(packet->vdrPacket));
-				pendingOutputPackets[replicatedPackets]->AddRefToRanges();
-				replicatedPackets++;
+				if (outputRangeMasks[replicatedPackets] == 0 && flags == 0)
+					{
+					// Nothing in this pure data packet is meant for this output
+					replicatedPackets++;
+					deliveredPackets++;
+					}
+				else if (STFRES_SUCCEEDED(result = outputConnectors[replicatedPackets]->GetEmptyDataPacket(pendingOutputPackets[replicatedPackets])))
+					{
+					pendingOutputPackets[replicatedPackets]->CopyFromVDRPacket(&(packet->vdrPacket));
+					if (outputRangeMasks[replicatedPackets] != MKFLAG(packet->vdrPacket.numRanges) - 1)
+						RemoveUnselectedRanges(&(pendingOutputPackets[replicatedPackets]->vdrPacket), outputRangeMasks[replicatedPackets]);
+					pendingOutputPackets[replicatedPackets]->AddRefToRanges();
+					replicatedPackets++;
+					}
+				else
+					break;
 				}
 
 			if (result == STFRES_OBJECT_EMPTY)
@@ -360,13 +425,14 @@ STFResult VirtualStreamReplicatorStreamingUnit::ProcessFlushing(void)
 			pendingOutputPackets[i]->ReleaseRanges();
 			pendingOutputPackets[i]->ReturnToOrigin();
 			pendingOutputPackets[i] = NULL;
-
-			deliveredPackets = 0;
-			replicatedPackets = 0;
-			sendingState = SRSS_ARM_SEGMENT_START;
 			}
 		}
 
+	// Outputs skipped for a pure data packet are counted without holding a pending packet
+	deliveredPackets = 0;
+	replicatedPackets = 0;
+	sendingState = SRSS_ARM_SEGMENT_START;
+
 	STFRES_REASSERT(ResetUpStreamCounters());
 
 	// flush the output formatter
@@ -385,6 +451,7 @@ VirtualStreamReplicatorStreamingUnit::VirtualStreamReplicatorStreamingUnit(IPhys
 	sendingState = SRSS_ARM_SEGMENT_START;
 	
 	pendingOutputPackets = NULL;
+	outputRangeMasks = NULL;
 	outputConnectors = NULL;
 	pendingPacket = NULL;
 	flushRequest = false;
@@ -408,6 +475,7 @@ VirtualStreamReplicatorStreamingUnit::~VirtualStreamReplicatorStreamingUnit(void
 		}
 
 	delete[] pendingOutputPackets;
+	delete[] outputRangeMasks;
 	delete[] streamingTAGIDs;
 	delete[] outputStreamTimes;
 	delete[] outputSegmentNumbers;
@@ -426,6 +494,7 @@ STFResult VirtualStreamReplicatorStreamingUnit::QueryInterface(VDRIID iid, void
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnit);
 
 	STFRES_RAISE_OK;
@@ -440,6 +509,7 @@ STFResult VirtualStreamReplicatorStreamingUnit::Initialize(void)
 
 	outputConnectors = new StreamingOutputConnectorPtr[numOutputs];
 	pendingOutputPackets = new StreamingDataPacketPtr[numOutputs];
+	outputRangeMasks = new uint32[numOutputs];
 	outputStreamTimes = new uint32[numOutputs];
 	outputSegmentNumbers = new uint32[numOutputs];
 
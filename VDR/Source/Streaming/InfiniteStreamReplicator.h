@@ -98,6 +98,7 @@ class VirtualStreamReplicatorStreamingUnit : public VirtualNonthreadedStandardSt
 		uint32											numOutputs;
 		uint32											numPacketsPerOutput;
 		StreamingDataPacket						**	pendingOutputPackets;		
+		uint32										*	outputRangeMasks;				/// Per output mask of the ranges of the current packet to be replicated
 		uint32											replicatedPackets;			/// The number of packets replicated
 		uint32											deliveredPackets;				/// The number of delivered packets
 		VDRTID										*	streamingTAGIDs;
@@ -110,6 +111,7 @@ class VirtualStreamReplicatorStreamingUnit : public VirtualNonthreadedStandardSt
 			SRSS_ARM_SEGMENT_END,
 			SRSS_ARM_GROUP_START,
 			SRSS_ARM_GROUP_END,
+			SRSS_SELECT_OUTPUT_RANGES,
 			SRSS_REPLICATE_PACKETS,
 			SRSS_SEND_PACKETS
 			} sendingState;
@@ -119,6 +121,12 @@ class VirtualStreamReplicatorStreamingUnit : public VirtualNonthreadedStandardSt
 		STFResult ArmUpstreamCounter(StreamReplicatorMessageCounters counter, uint32 key, int32 value);
 		STFResult TriggerUpstreamCounter(StreamReplicatorMessageCounters counter, uint32 key, uint32 connectorID, VDRMID message, uint32 param1, uint32 param2);
 		STFResult ResetUpStreamCounters(void);
+
+		/// Selects the data ranges of a packet that are replicated to each output.
+		/// Called once per incoming packet, sets one bit per range in outputRangeMasks.
+		/// The default implementation replicates all ranges to all outputs. Pure data
+		/// packets with no range selected for an output are not sent to that output.
+		virtual STFResult SelectOutputRanges(const StreamingDataPacket * packet);
 	public:
 		VirtualStreamReplicatorStreamingUnit(IPhysicalUnit * physical, uint32 numOutputs, uint32 numPacketsPerOutput, StreamReplicatorMessageForwardMode messageMode);
 		~VirtualStreamReplicatorStreamingUnit(void);
@@ -9,6 +9,7 @@
 
 #include <string.h>
 #include "IStreaming.h"
+#include "StreamingTrace.h"
 #include <string.h> // for memcpy
 #include <assert.h>
 
@@ -30,6 +31,7 @@ StreamingDataPacket::StreamingDataPacket(IStreamingDataPacketManager * originato
 	{
 	this->originator = originator;
 	vdrPacket.size = sizeof(VDRStreamingDataPacket);
+	traceSession = 0;
 
 #if _DEBUG
 	// Signal that packet is in the "released" state
@@ -62,6 +64,8 @@ STFResult StreamingDataPacket::ReturnToOrigin(void)
 	vdrPacket.numRanges = 255;
 #endif
 
+	STREAMING_TRACE(STRMTRC_RETURN_TO_ORIGIN, this, NULL, 0);
+
 	STFRES_RAISE(originator->ReturnDataPacket(this));
 	}
 
@@ -17,13 +17,20 @@
 ///
 
 #include "StreamingConnectors.h"
+#include "StreamingTrace.h"
 
 #include "STF/Interface/STFDebug.h"
+#include "STF/Interface/STFTimer.h"
+
+#include <string.h>
 
 #if _DEBUG
 InputConnectorQueueStatus GlobalInputConnectorQueueStatus;
 #endif
 
+/// Number of packets taken out of a connector queue at once when flushing
+#define QUEUED_CONNECTOR_FLUSH_BATCH	16
+
 ///////////////////////////////////////////////////////////////////////////////
 // Generic Streaming Connector Implementation
 ///////////////////////////////////////////////////////////////////////////////
@@ -32,6 +39,8 @@ StreamingConnector::StreamingConnector(uint32 id, IBaseStreamingUnit * unit)
 	{
 	this->id				= id;
 	this->unit			= unit;
+
+	memset(&statistics, 0, sizeof(statistics));
 	}
 
 
@@ -45,6 +54,25 @@ uint32 StreamingConnector::GetID(void)
 	return id;
 	}
 
+VDRStreamingConnectorStatistics & StreamingConnector::GetStatistics(void)
+	{
+	return statistics;
+	}
+
+void StreamingConnector::CountProcessingTime(const STFHiPrec64BitTime & startTime)
+	{
+	STFHiPrec64BitTime	endTime;
+	uint32					duration;
+
+	SystemTimer->GetTime(endTime);
+	duration = (uint32)(endTime - startTime).Get32BitDuration(STFTU_MICROSECS);
+
+	statistics.processedPackets++;
+	statistics.processingTime += duration;
+	if (duration > statistics.maxProcessingTime)
+		statistics.maxProcessingTime = duration;
+	}
+
 STFResult StreamingConnector::GetStreamingUnit(IBaseStreamingUnit *& unit)
 	{
 	// Typecast is allowed here
@@ -162,6 +190,24 @@ STFResult BaseStreamingInputConnector::RequestPackets(void)
 	STFRES_RAISE(source->UpstreamNotification(VDRMID_STRM_PACKET_REQUEST, 0, 0));
 	}
 		
+STFResult BaseStreamingInputConnector::ReceivePackets(StreamingDataPacket ** packets, uint32 num, uint32 & accepted)
+	{
+	STFResult res = STFRES_OK;
+
+	accepted = 0;
+	while (accepted < num)
+		{
+		res = ReceivePacket(packets[accepted]);
+		if (STFRES_IS_ERROR(res))
+			STFRES_RAISE(res);
+
+		accepted++;
+		}
+
+	STFRES_RAISE(res);
+	}
+
+
 STFResult BaseStreamingInputConnector::ProvideAllocator(IVDRMemoryPoolAllocator * allocator)
 	{
 	//lint --e{613}
@@ -184,7 +230,10 @@ STFResult BaseStreamingInputConnector::IsPushingChain(void)
 
 STFResult UnqueuedInputConnector::ReceivePacket(StreamingDataPacket * packet)
 	{
+	STFResult res;
 	VDRStreamingState curState;
+	STFHiPrec64BitTime startTime;
+	uint32 size;
 
 	STFRES_REASSERT(unit->GetState(curState));
 
@@ -195,6 +244,7 @@ STFResult UnqueuedInputConnector::ReceivePacket(StreamingDataPacket * packet)
 			// We are not accepting packets during stop and prepare, because we don't no
 			// the requested sequence number of direction yet.  We simply claim that
 			// we are full, so we might get the packet later.			
+			statistics.bounces++;
 			STFRES_RAISE(STFRES_OBJECT_FULL);
 			
 		case VDR_STRMSTATE_FLUSHING:
@@ -211,7 +261,23 @@ STFResult UnqueuedInputConnector::ReceivePacket(StreamingDataPacket * packet)
 			STFRES_RAISE(STFRES_ILLEGAL_STREAMING_STATE);
 			
 		default:
-			STFRES_RAISE(unit->ReceivePacket(id, packet));
+			STREAMING_TRACE(STRMTRC_RECEIVE_PACKET, packet, unit, id);
+
+			// The packet may already be returned to its origin when the unit is done with it
+			size = packet->GetPacketDataSize();
+			SystemTimer->GetTime(startTime);
+
+			res = unit->ReceivePacket(id, packet);
+
+			if (res == STFRES_OBJECT_FULL)
+				statistics.bounces++;
+			else if (!STFRES_IS_ERROR(res))
+				{
+				CountPacket(size);
+				CountProcessingTime(startTime);
+				}
+
+			STFRES_RAISE(res);
 		}
 	}
 
@@ -228,7 +294,10 @@ STFResult UnqueuedInputConnector::GetStreamTagIDs(VDRTID * & ids)
 
 STFResult UnqueuedNestedInputConnector::ReceivePacket(StreamingDataPacket * packet)
 	{
+	STFResult res;
 	VDRStreamingState curState;
+	STFHiPrec64BitTime startTime;
+	uint32 size;
 
 	STFRES_REASSERT(unit->GetState(curState));
 
@@ -239,6 +308,7 @@ STFResult UnqueuedNestedInputConnector::ReceivePacket(StreamingDataPacket * pack
 			// We are not accepting packets during stop and prepare, because we don't no
 			// the requested sequence number of direction yet.  We simply claim that
 			// we are full, so we might get the packet later.
+			statistics.bounces++;
 			STFRES_RAISE(STFRES_OBJECT_FULL);
 		
 		case VDR_STRMSTATE_FLUSHING:
@@ -255,7 +325,23 @@ STFResult UnqueuedNestedInputConnector::ReceivePacket(StreamingDataPacket * pack
 			STFRES_RAISE(STFRES_ILLEGAL_STREAMING_STATE);
 		
 		default:
-			STFRES_RAISE(unit->NestedReceivePacket(id, packet));
+			STREAMING_TRACE(STRMTRC_RECEIVE_PACKET, packet, unit, id);
+
+			// The packet may already be returned to its origin when the unit is done with it
+			size = packet->GetPacketDataSize();
+			SystemTimer->GetTime(startTime);
+
+			res = unit->NestedReceivePacket(id, packet);
+
+			if (res == STFRES_OBJECT_FULL)
+				statistics.bounces++;
+			else if (!STFRES_IS_ERROR(res))
+				{
+				CountPacket(size);
+				CountProcessingTime(startTime);
+				}
+
+			STFRES_RAISE(res);
 		}
 	}
 
@@ -278,7 +364,7 @@ QueuedInputConnector::QueuedInputConnector(uint32 queueSize,
 	DEBUG_EXECUTE(GlobalInputConnectorQueueStatus.AddInputConnector(this));
 	
 	this->unit = unit;
-	queue	= new STFFixedQueue(queueSize);
+	queue	= new STFSPSCQueue(queueSize);
 	
 	currentPacket	= NULL;
 	packetBounced	= false;
@@ -309,6 +395,7 @@ STFResult QueuedInputConnector::DequeuePacket(StreamingDataPacket *& packet)
 		else
 			{
 			STFRES_REASSERT(queue->Dequeue((void*&) packet));
+			STREAMING_TRACE(STRMTRC_DEQUEUE_PACKET, packet, unit, id);
 			packet->RemPacketOwner(unit);
 			}
 		}
@@ -321,6 +408,7 @@ STFResult QueuedInputConnector::DequeuePacket(StreamingDataPacket *& packet)
 STFResult QueuedInputConnector::RequestPackets(void)
 	{
 	STFResult res = STFRES_OK;
+	STFHiPrec64BitTime startTime;
 	//lint --e{613}
 	// First check if there is anything at all
 	if (currentPacket == NULL && queue->IsEmpty())
@@ -396,16 +484,22 @@ STFResult QueuedInputConnector::RequestPackets(void)
 				else 
 					CONDITIONAL_REQPKT_DP("%s (queuedinput) RequestPackets from %s (!packetBounced,!OBJECT_EMPTY)\n", (char *) unit->GetInformation(), (char *) source->GetInformation());
 #endif
+
+				STREAMING_TRACE(STRMTRC_DEQUEUE_PACKET, currentPacket, unit, id);
 				}
 
 #if _DEBUG
 			CONDITIONAL_REQPKT_DP("%s (queuedinput) RequestPackets calling ReceivePacket\n", (char *) unit->GetInformation());
 #endif
 			currentPacket->RemPacketOwner(unit);
+			SystemTimer->GetTime(startTime);
 			res = unit->ReceivePacket(id, currentPacket);
 
 			if (res != STFRES_OBJECT_FULL)
+				{
+				CountProcessingTime(startTime);
 				currentPacket = NULL;
+				}
 			else
 				currentPacket->AddPacketOwner(unit);
 			}
@@ -422,7 +516,8 @@ STFResult QueuedInputConnector::RequestPackets(void)
 
 STFResult QueuedInputConnector::FlushPackets(void)
 	{
-	StreamingDataPacket * tempPacket;
+	StreamingDataPacket * tempPackets[QUEUED_CONNECTOR_FLUSH_BATCH];
+	uint32 num, i;
 
 	if (currentPacket)
 		{
@@ -432,11 +527,14 @@ STFResult QueuedInputConnector::FlushPackets(void)
 		currentPacket = NULL;
 		}
 
-	while (!STFRES_IS_ERROR(queue->Dequeue((void*&)tempPacket)))
+	while (!STFRES_IS_ERROR(queue->DequeueBatch((void**)tempPackets, QUEUED_CONNECTOR_FLUSH_BATCH, num)))
 		{
-		tempPacket->ReleaseRanges();
-		tempPacket->RemPacketOwner(unit);
-		tempPacket->ReturnToOrigin();
+		for (i = 0; i < num; i++)
+			{
+			tempPackets[i]->ReleaseRanges();
+			tempPackets[i]->RemPacketOwner(unit);
+			tempPackets[i]->ReturnToOrigin();
+			}
 		}
 	
 	STFRES_RAISE_OK;
@@ -446,6 +544,7 @@ STFResult QueuedInputConnector::FlushPackets(void)
 STFResult QueuedInputConnector::ReceivePacket(StreamingDataPacket * packet)
 	{
 	STFResult res;
+	uint32 size;
 
 	VDRStreamingState curState;
 
@@ -461,6 +560,7 @@ STFResult QueuedInputConnector::ReceivePacket(StreamingDataPacket * packet)
 			// that we bounced the packet, so that we can later send a packet request 
 			// upstream notification.
 			packetBounced = true;
+			statistics.bounces++;
 			STFRES_RAISE(STFRES_OBJECT_FULL);
 		
 		case VDR_STRMSTATE_FLUSHING:
@@ -480,15 +580,23 @@ STFResult QueuedInputConnector::ReceivePacket(StreamingDataPacket * packet)
 			// First Add the new Owner and then enque it, otherwise
 			// the possibilty of a racing condition releasing the owner before
 			// adding it, is present.
+			size = packet->GetPacketDataSize();
 			packet->AddPacketOwner(unit);
 			if (STFRES_FAILED(queue->Enqueue(packet)))
 				{				
 				packet->RemPacketOwner(unit);
 				// As the queue was full, we must remember the bouncing condition.
 				packetBounced = true;
+				statistics.bounces++;
 				STFRES_RAISE(STFRES_OBJECT_FULL);
 				}
 
+			// Only trace accepted packets, the dequeue span runs from the send
+			STREAMING_TRACE(STRMTRC_ENQUEUE_PACKET, packet, unit, id);
+
+			CountPacket(size);
+			CountQueueDepth(queue->NumElements());
+
 			//
 			// A time discontinuity signals, that no packets can be expected in
 			// the near future, so we have to try to kick off processing in the unit.
@@ -510,6 +618,99 @@ STFResult QueuedInputConnector::ReceivePacket(StreamingDataPacket * packet)
 	STFRES_RAISE_OK;
 	}
 
+STFResult QueuedInputConnector::ReceivePackets(StreamingDataPacket ** packets, uint32 num, uint32 & accepted)
+	{
+	STFResult res, enqueueRes;
+	VDRStreamingState curState;
+	bool timeDiscontinuity;
+	uint32 i, size;
+
+	accepted = 0;
+
+	STFRES_REASSERT(unit->GetState(curState));
+
+	switch (curState)
+		{
+		case VDR_STRMSTATE_STOPPING:
+		case VDR_STRMSTATE_PREPARING:
+			// Bounce the whole batch, see ReceivePacket()
+			packetBounced = true;
+			statistics.bounces += num;
+			STFRES_RAISE(STFRES_OBJECT_FULL);
+
+		case VDR_STRMSTATE_FLUSHING:
+			for (i = 0; i < num; i++)
+				{
+				packets[i]->ReleaseRanges();
+				packets[i]->ReturnToOrigin();
+				}
+			accepted = num;
+
+			STFRES_RAISE_OK;
+
+		case VDR_STRMSTATE_IDLE:
+			STFRES_RAISE(STFRES_ILLEGAL_STREAMING_STATE);
+
+		default:
+			// First Add the new Owner and then enque them, otherwise
+			// the possibilty of a racing condition releasing the owner before
+			// adding it, is present.
+			size = 0;
+			for (i = 0; i < num; i++)
+				{
+				size += packets[i]->GetPacketDataSize();
+				packets[i]->AddPacketOwner(unit);
+				}
+
+			enqueueRes = queue->EnqueueBatch((void **)packets, num, accepted);
+
+			for (i = 0; i < accepted; i++)
+				STREAMING_TRACE(STRMTRC_ENQUEUE_PACKET, packets[i], unit, id);
+
+			for (i = accepted; i < num; i++)
+				{
+				packets[i]->RemPacketOwner(unit);
+				size -= packets[i]->GetPacketDataSize();
+				}
+
+			if (accepted < num)
+				{
+				// As the queue was full, we must remember the bouncing condition.
+				packetBounced = true;
+				statistics.bounces += num - accepted;
+				}
+
+			statistics.packets += accepted;
+			statistics.bytes += size;
+			CountQueueDepth(queue->NumElements());
+
+			timeDiscontinuity = false;
+			for (i = 0; i < accepted; i++)
+				{
+				if ((packets[i]->vdrPacket.flags & VDR_MSMF_TIME_DISCONTINUITY) != 0)
+					timeDiscontinuity = true;
+				}
+
+			//
+			// Signal the unit once for the whole batch, under the same conditions as
+			// in ReceivePacket()
+			//
+			if (accepted > 0 && (timeDiscontinuity || queue->NumElements() > 0))
+				{
+				res = unit->SignalPacketArrival(id, queue->NumElements());
+
+				if (res != STFRES_OBJECT_FULL)
+					STFRES_REASSERT(res);
+				}
+
+			if (accepted < num)
+				STFRES_RAISE(enqueueRes);
+			break;
+		}
+
+	STFRES_RAISE_OK;
+	}
+
 STFResult QueuedInputConnector::GetStreamTagIDs(VDRTID * & ids)
 	{
 	STFRES_RAISE(unit->GetStreamTagIDs(id, ids));
@@ -528,7 +729,7 @@ QueuedNestedInputConnector::QueuedNestedInputConnector(uint32 queueSize,
 	: BaseStreamingInputConnector(id, unit)
 	{
 	this->unit = unit;
-	queue	= new STFFixedQueue(queueSize);
+	queue	= new STFSPSCQueue(queueSize);
 	
 	currentPacket	= NULL;
 	packetBounced	= false;
@@ -558,6 +759,7 @@ STFResult QueuedNestedInputConnector::DequeuePacket(StreamingDataPacket *& packe
 		else
 			{
 			STFRES_REASSERT(queue->Dequeue((void*&) packet));
+			STREAMING_TRACE(STRMTRC_DEQUEUE_PACKET, packet, unit, id);
 			}
 		}
 
@@ -569,6 +771,7 @@ STFResult QueuedNestedInputConnector::DequeuePacket(StreamingDataPacket *& packe
 STFResult QueuedNestedInputConnector::RequestPackets(void)
 	{
 	STFResult res = STFRES_OK;
+	STFHiPrec64BitTime startTime;
 	//lint --e{613}
 	// First check if there is anything at all
 	if (currentPacket == NULL && queue->IsEmpty())
@@ -644,15 +847,21 @@ STFResult QueuedNestedInputConnector::RequestPackets(void)
 				else 
 					CONDITIONAL_REQPKT_DP("%s (queuednestedinput) RequestPackets from %s (!packetBounced,!OBJECT_FULL)\n", (char *) unit->GetInformation(), (char *) source->GetInformation());
 #endif
+
+				STREAMING_TRACE(STRMTRC_DEQUEUE_PACKET, currentPacket, unit, id);
 				}
 
 #if _DEBUG
 			CONDITIONAL_REQPKT_DP("%s (queuednestedinput) RequestPackets calling NestedReceivePacket\n", (char *) unit->GetInformation());
 #endif
+			SystemTimer->GetTime(startTime);
 			res = unit->NestedReceivePacket(id, currentPacket);
 
 			if (res != STFRES_OBJECT_FULL)
+				{
+				CountProcessingTime(startTime);
 				currentPacket = NULL;
+				}
 			else
 				DP("Nested receive returned failure %x", res);
 			}
@@ -668,7 +877,8 @@ STFResult QueuedNestedInputConnector::RequestPackets(void)
 
 STFResult QueuedNestedInputConnector::FlushPackets(void)
 	{
-	StreamingDataPacket * tempPacket;
+	StreamingDataPacket * tempPackets[QUEUED_CONNECTOR_FLUSH_BATCH];
+	uint32 num, i;
 
 	if (currentPacket)
 		{
@@ -677,10 +887,13 @@ STFResult QueuedNestedInputConnector::FlushPackets(void)
 		currentPacket = NULL;
 		}
 
-	while (!STFRES_IS_ERROR(queue->Dequeue((void*&)tempPacket)))
+	while (!STFRES_IS_ERROR(queue->DequeueBatch((void**)tempPackets, QUEUED_CONNECTOR_FLUSH_BATCH, num)))
 		{
-		tempPacket->ReleaseRanges();
-		tempPacket->ReturnToOrigin();
+		for (i = 0; i < num; i++)
+			{
+			tempPackets[i]->ReleaseRanges();
+			tempPackets[i]->ReturnToOrigin();
+			}
 		}
 	
 	STFRES_RAISE_OK;
@@ -690,6 +903,7 @@ STFResult QueuedNestedInputConnector::FlushPackets(void)
 STFResult QueuedNestedInputConnector::ReceivePacket(StreamingDataPacket * packet)
 	{
 	STFResult res;
+	uint32 size;
 
 	VDRStreamingState curState;
 
@@ -705,6 +919,7 @@ STFResult QueuedNestedInputConnector::ReceivePacket(StreamingDataPacket * packet
 			// that we bounced the packet, so that we can later send a packet request 
 			// upstream notification.
 			packetBounced = true;
+			statistics.bounces++;
 			STFRES_RAISE(STFRES_OBJECT_FULL);
 			
 		case VDR_STRMSTATE_FLUSHING:
@@ -724,13 +939,21 @@ STFResult QueuedNestedInputConnector::ReceivePacket(StreamingDataPacket * packet
 			// First Add the new Owner and then enque it, otherwise
 			// the possibilty of a racing condition releasing the owner before
 			// adding it, is present.
+			size = packet->GetPacketDataSize();
 			if (STFRES_FAILED(queue->Enqueue(packet)))
 				{
 				// As the queue was full, we must remember the bouncing condition.
 				packetBounced = true;
+				statistics.bounces++;
 				STFRES_RAISE(STFRES_OBJECT_FULL);
 				}
 
+			// Only trace accepted packets, the dequeue span runs from the send
+			STREAMING_TRACE(STRMTRC_ENQUEUE_PACKET, packet, unit, id);
+
+			CountPacket(size);
+			CountQueueDepth(queue->NumElements());
+
 			//
 			// A time discontinuity signals, that no packets can be expected in
 			// the near future, so we have to try to kick off processing in the unit.
@@ -752,6 +975,90 @@ STFResult QueuedNestedInputConnector::ReceivePacket(StreamingDataPacket * packet
 	STFRES_RAISE_OK;
 	}
 
+STFResult QueuedNestedInputConnector::ReceivePackets(StreamingDataPacket ** packets, uint32 num, uint32 & accepted)
+	{
+	STFResult res, enqueueRes;
+	VDRStreamingState curState;
+	bool timeDiscontinuity;
+	uint32 i, size;
+
+	accepted = 0;
+
+	STFRES_REASSERT(unit->GetState(curState));
+
+	switch (curState)
+		{
+		case VDR_STRMSTATE_STOPPING:
+		case VDR_STRMSTATE_PREPARING:
+			// Bounce the whole batch, see ReceivePacket()
+			packetBounced = true;
+			statistics.bounces += num;
+			STFRES_RAISE(STFRES_OBJECT_FULL);
+
+		case VDR_STRMSTATE_FLUSHING:
+			for (i = 0; i < num; i++)
+				{
+				packets[i]->ReleaseRanges();
+				packets[i]->ReturnToOrigin();
+				}
+			accepted = num;
+
+			STFRES_RAISE_OK;
+
+		case VDR_STRMSTATE_IDLE:
+			STFRES_RAISE(STFRES_ILLEGAL_STREAMING_STATE);
+
+		default:
+			size = 0;
+			for (i = 0; i < num; i++)
+				size += packets[i]->GetPacketDataSize();
+
+			enqueueRes = queue->EnqueueBatch((void **)packets, num, accepted);
+
+			for (i = 0; i < accepted; i++)
+				STREAMING_TRACE(STRMTRC_ENQUEUE_PACKET, packets[i], unit, id);
+
+			for (i = accepted; i < num; i++)
+				size -= packets[i]->GetPacketDataSize();
+
+			if (accepted < num)
+				{
+				// As the queue was full, we must remember the bouncing condition.
+				packetBounced = true;
+				statistics.bounces += num - accepted;
+				}
+
+			statistics.packets += accepted;
+			statistics.bytes += size;
+			CountQueueDepth(queue->NumElements());
+
+			timeDiscontinuity = false;
+			for (i = 0; i < accepted; i++)
+				{
+				if ((packets[i]->vdrPacket.flags & VDR_MSMF_TIME_DISCONTINUITY) != 0)
+					timeDiscontinuity = true;
+				}
+
+			//
+			// Signal the unit once for the whole batch, under the same conditions as
+			// in ReceivePacket()
+			//
+			if (accepted > 0 && (timeDiscontinuity || queue->NumElements() > 0))
+				{
+				res = unit->NestedSignalPacketArrival(id, queue->NumElements());
+
+				if (res != STFRES_OBJECT_FULL)
+					STFRES_REASSERT(res);
+				}
+
+			if (accepted < num)
+				STFRES_RAISE(enqueueRes);
+			break;
+		}
+
+	STFRES_RAISE_OK;
+	}
+
 STFResult QueuedNestedInputConnector::GetStreamTagIDs(VDRTID * & ids)
 	{
 	STFRES_RAISE(unit->NestedGetStreamTagIDs(id, ids));
@@ -899,15 +1206,58 @@ BaseStreamingOutputConnector::~BaseStreamingOutputConnector(void)
 STFResult BaseStreamingOutputConnector::SendPacket(StreamingDataPacket * packet)
 	{
 	STFResult res;
+	uint32 size;
 
 	if (!target)
 		res = STFRES_NOT_CONNECTED;
 	else
 		{
 		// Send the packet to the attached input connector
+		STREAMING_TRACE(STRMTRC_SEND_PACKET, packet, unit, id);
+		size = packet->GetPacketDataSize();
 		res = target->ReceivePacket(packet);
+
+		// A refused packet is still owned by the sender
+		if (STFRES_IS_ERROR(res))
+			STREAMING_TRACE(STRMTRC_PACKET_BOUNCED, packet, unit, id);
+		else
+			CountPacket(size);
+		}
+
+	STFRES_RAISE(res);
+	}
+
+
+STFResult BaseStreamingOutputConnector::SendPackets(StreamingDataPacket ** packets, uint32 num, uint32 & accepted)
+	{
+	STFResult res;
+	uint32 i, size;
+
+	accepted = 0;
+
+	if (!target)
+		STFRES_RAISE(STFRES_NOT_CONNECTED);
+
+	size = 0;
+	for (i = 0; i < num; i++)
+		{
+		STREAMING_TRACE(STRMTRC_SEND_PACKET, packets[i], unit, id);
+		size += packets[i]->GetPacketDataSize();
 		}
 
+	// Send the packets to the attached input connector
+	res = target->ReceivePackets(packets, num, accepted);
+
+	// The packets that were not accepted are still owned by the sender
+	for (i = accepted; i < num; i++)
+		{
+		STREAMING_TRACE(STRMTRC_PACKET_BOUNCED, packets[i], unit, id);
+		size -= packets[i]->GetPacketDataSize();
+		}
+
+	statistics.packets += accepted;
+	statistics.bytes += size;
+
 	STFRES_RAISE(res);
 	}
 
@@ -937,6 +1287,7 @@ STFResult BaseStreamingOutputConnector::GetEmptyDataPacket(StreamingDataPacket *
 				STFRES_RAISE_OK;
 			else
 				{
+				statistics.emptyStoreMisses++;
 				STFRES_RAISE(STFRES_OBJECT_EMPTY);
 				}
 		}
@@ -84,6 +84,25 @@ class StreamingConnector : public virtual IStreamingConnector
 
 		uint32 id;
 
+		VDRStreamingConnectorStatistics	statistics;
+
+		//! Count a packet accepted or sent by the connector
+		void CountPacket(uint32 size)
+			{
+			statistics.packets++;
+			statistics.bytes += size;
+			}
+
+		//! Count the time the unit took for a packet handed to it at startTime
+		void CountProcessingTime(const STFHiPrec64BitTime & startTime);
+
+		//! Update the queue depth high water mark
+		void CountQueueDepth(uint32 depth)
+			{
+			if (depth > statistics.maxQueueDepth)
+				statistics.maxQueueDepth = depth;
+			}
+
 	public:
 		StreamingConnector(uint32 id, IBaseStreamingUnit * unit);
 
@@ -102,6 +121,8 @@ class StreamingConnector : public virtual IStreamingConnector
 		//! Convert the connector interface to an output connector interface, if it is one
 		virtual IStreamingOutputConnector * QueryOutputConnector(void);
 
+		virtual VDRStreamingConnectorStatistics & GetStatistics(void);
+
 #if _DEBUG
 		virtual STFString GetInformation(void);
 #endif
@@ -151,6 +172,9 @@ class BaseStreamingInputConnector : public StreamingConnector,
 			STFRES_RAISE_OK;
 			}
 
+		/// Default implementation passing the packets one by one to ReceivePacket()
+		virtual STFResult ReceivePackets(StreamingDataPacket ** packets, uint32 num, uint32 & accepted);
+
 		STFResult SendUpstreamNotification(VDRMID message, uint32 param1, uint32 param2)
 			{
 #if _DEBUG // unavoidable because GetInformation does not exist in Release compile mode
@@ -248,7 +272,7 @@ class QueuedInputConnector : public BaseStreamingInputConnector
 		IStreamingUnit * unit;
 
 	protected:
-		STFFixedQueue * queue;
+		STFSPSCQueue * queue;
 
 		StreamingDataPacket * currentPacket;	/// The packet which is currently being processed
 
@@ -282,6 +306,7 @@ class QueuedInputConnector : public BaseStreamingInputConnector
 		virtual STFResult RequestPackets(void);
 		virtual STFResult FlushPackets(void);
 		virtual STFResult ReceivePacket(StreamingDataPacket * packet);
+		virtual STFResult ReceivePackets(StreamingDataPacket ** packets, uint32 num, uint32 & accepted);
 		virtual STFResult GetStreamTagIDs(VDRTID * & ids);
 #if _DEBUG
 		virtual STFString GetInformation(void);
@@ -295,7 +320,7 @@ class QueuedNestedInputConnector : public BaseStreamingInputConnector
 		IStreamingChainUnit * unit;
 
 	protected:
-		STFFixedQueue * queue;
+		STFSPSCQueue * queue;
 
 		StreamingDataPacket * currentPacket;	/// The packet which is currently being processed
 
@@ -333,6 +358,7 @@ class QueuedNestedInputConnector : public BaseStreamingInputConnector
 		virtual STFResult RequestPackets(void);
 		virtual STFResult FlushPackets(void);
 		virtual STFResult ReceivePacket(StreamingDataPacket * packet);
+		virtual STFResult ReceivePackets(StreamingDataPacket ** packets, uint32 num, uint32 & accepted);
 		virtual STFResult GetStreamTagIDs(VDRTID * & ids);
 #if _DEBUG
 		virtual STFString GetInformation(void);
@@ -450,6 +476,7 @@ class BaseStreamingOutputConnector : public StreamingConnector,
  		virtual STFResult GetLink(IStreamingInputConnector *& linkedWith);
 
 		virtual STFResult SendPacket(StreamingDataPacket * packet);
+		virtual STFResult SendPackets(StreamingDataPacket ** packets, uint32 num, uint32 & accepted);
 		virtual STFResult GetEmptyDataPacket(StreamingDataPacket *& packet);
 		virtual STFResult ReturnDataPacket(StreamingDataPacket * packet);
 
@@ -0,0 +1,218 @@
+///
+/// @file       VDR/Source/Streaming/StreamingTrace.cpp
+///
+/// @brief      Packet latency tracing for streaming chains
+///
+
+#include "StreamingTrace.h"
+#include "STF/Interface/STFThread.h"
+#include "STF/Interface/STFTimer.h"
+#include "STF/Interface/STFDebug.h"
+
+STFInterlockedInt				StreamingTrace::enabled;
+STFInterlockedInt				StreamingTrace::dropped;
+uint32							StreamingTrace::session;
+STFHiPrec64BitTime			StreamingTrace::sessionStart;
+StreamingTrace::Ring		*	StreamingTrace::rings;
+STFMutex							StreamingTrace::controlLock;
+
+static const char * StreamingTraceEventNames[] =
+	{
+	"SendPacket",
+	"ReceivePacket",
+	"DequeuePacket",
+	"ReturnToOrigin",
+	"PacketBounced",
+	"EnqueuePacket"
+	};
+
+
+STFResult StreamingTrace::Enable(void)
+	{
+	controlLock.Enter();
+
+	// The rings are only allocated once tracing is used, and never freed as other
+	// threads may still be inside Record()
+	if (rings == NULL)
+		{
+		rings = new Ring[STREAMING_TRACE_MAX_THREADS + 1];
+		if (rings == NULL)
+			{
+			controlLock.Leave();
+			STFRES_RAISE(STFRES_NOT_ENOUGH_MEMORY);
+			}
+		}
+
+	if (!IsEnabled())
+		{
+		// A new session invalidates the trace points of all packets in flight, and
+		// hides the records of previous sessions from the export
+		SystemTimer->GetTime(sessionStart);
+		session++;
+		if (session == 0)
+			session = 1;	// 0 marks packets without a trace point
+
+		enabled = 1;
+		}
+
+	controlLock.Leave();
+
+	STFRES_RAISE_OK;
+	}
+
+
+STFResult StreamingTrace::Disable(void)
+	{
+	enabled = 0;
+
+	STFRES_RAISE_OK;
+	}
+
+
+// Get the ring of the current thread, a free ring is assigned on the first call of a thread.
+// Threads not created through STF and threads beyond the limit share the last ring.
+// Returns NULL if the shared ring is in use.
+StreamingTrace::Ring * StreamingTrace::LockThreadRing(void)
+	{
+	STFThread	*	thread;
+	uint32			i;
+
+	if (!STFRES_FAILED(GetCurrentSTFThread(thread))  &&  thread != NULL)
+		{
+		for (i = 0;  i < STREAMING_TRACE_MAX_THREADS;  i++)
+			{
+			if ((pointer)rings[i].owner == (pointer)thread  ||
+				 rings[i].owner.CompareExchange(NULL, (pointer)thread) == NULL)
+				return &rings[i];
+			}
+		}
+
+	if (rings[STREAMING_TRACE_MAX_THREADS].busy.CompareExchange(0, 1) == 0)
+		return &rings[STREAMING_TRACE_MAX_THREADS];
+
+	return NULL;
+	}
+
+
+void StreamingTrace::UnlockThreadRing(Ring * ring)
+	{
+	if (ring == &rings[STREAMING_TRACE_MAX_THREADS])
+		ring->busy = 0;
+	}
+
+
+void StreamingTrace::Record(StreamingTraceEvent event, StreamingDataPacket * packet, IBaseStreamingUnit * unit, uint32 connectorID)
+	{
+	Ring						*	ring;
+	StreamingTraceRecord	*	record;
+	uint32						pos;
+
+	ring = LockThreadRing();
+	if (ring == NULL)
+		{
+		dropped++;
+		return;
+		}
+
+	pos = (uint32)(int32)ring->writePos;
+	record = &ring->records[pos & (STREAMING_TRACE_RING_SIZE - 1)];
+
+	SystemTimer->GetTime(record->time);
+	record->hasSince = event != STRMTRC_ENQUEUE_PACKET  &&  packet->traceSession == session;
+	if (record->hasSince)
+		record->since = packet->traceTime;
+	record->packet = packet;
+	record->unit = unit;
+	record->connectorID = (uint16)connectorID;
+	record->event = (uint8)event;
+
+	// Publish the record for the export
+	ring->writePos = (int32)(pos + 1);
+
+	switch (event)
+		{
+		case STRMTRC_RETURN_TO_ORIGIN:
+			// The next use of the packet starts without a previous trace point
+			packet->traceSession = 0;
+			break;
+
+		case STRMTRC_PACKET_BOUNCED:
+			// The packet stays with the sender, so the next span continues from the
+			// trace point before the bounce
+			break;
+
+		case STRMTRC_ENQUEUE_PACKET:
+			// The packet belongs to the receiving unit already
+			break;
+
+		default:
+			packet->traceTime = record->time;
+			packet->traceSession = session;
+			break;
+		}
+
+	UnlockThreadRing(ring);
+	}
+
+
+static double StreamingTraceMicroSeconds(const STFInt64 & time)
+	{
+	return (double)time.Upper() * 4294967296.0 + (double)time.Lower();
+	}
+
+
+STFResult StreamingTrace::Export(FILE * file)
+	{
+	StreamingTraceRecord	*	record;
+	STFInt64						ts;
+	uint32						i, pos, num, ringIndex;
+	bool							first = true;
+
+	if (file == NULL)
+		STFRES_RAISE(STFRES_INVALID_PARAMETERS);
+
+	controlLock.Enter();
+
+	fprintf(file, "{\"traceEvents\":[\n");
+
+	if (rings != NULL)
+		{
+		for (ringIndex = 0;  ringIndex <= STREAMING_TRACE_MAX_THREADS;  ringIndex++)
+			{
+			pos = (uint32)(int32)rings[ringIndex].writePos;
+			num = pos < STREAMING_TRACE_RING_SIZE ? pos : STREAMING_TRACE_RING_SIZE;
+
+			for (i = pos - num;  i != pos;  i++)
+				{
+				record = &rings[ringIndex].records[i & (STREAMING_TRACE_RING_SIZE - 1)];
+
+				// Skip records of previous sessions
+				ts = (record->time - sessionStart).Get64BitDuration(STFTU_MICROSECS);
+				if (ts.Upper() < 0)
+					continue;
+
+				fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"streaming\",", first ? "" : ",\n", StreamingTraceEventNames[record->event]);
+				first = false;
+
+				// A span starts at the previous trace point of the packet
+				if (record->hasSince && record->event != STRMTRC_PACKET_BOUNCED)
+					{
+					fprintf(file, "\"ph\":\"X\",\"ts\":%.0f,\"dur\":%d,",
+							  StreamingTraceMicroSeconds((record->since - sessionStart).Get64BitDuration(STFTU_MICROSECS)),
+							  (record->time - record->since).Get32BitDuration(STFTU_MICROSECS));
+					}
+				else
+					fprintf(file, "\"ph\":\"i\",\"s\":\"t\",\"ts\":%.0f,", StreamingTraceMicroSeconds(ts));
+
+				fprintf(file, "\"pid\":1,\"tid\":%lu,\"args\":{\"unit\":\"%p\",\"connector\":%u,\"thread\":%u}}",
+						  (unsigned long)(pointer)record->packet, (void *)record->unit, (uint32)record->connectorID, ringIndex);
+				}
+			}
+		}
+
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	controlLock.Leave();
+
+	STFRES_RAISE_OK;
+	}
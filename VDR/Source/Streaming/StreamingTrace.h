@@ -0,0 +1,116 @@
+#ifndef STREAMINGTRACE_H
+#define STREAMINGTRACE_H
+
+///
+/// @file VDR/Source/Streaming/StreamingTrace.h
+///
+/// @brief Packet latency tracing for streaming chains
+///
+/// @par OWNER:
+/// VDR Architecture Team
+///
+/// @par SCOPE:
+/// INTERNAL Header File
+///
+/// The streaming connectors record a trace point whenever a packet is sent, received,
+/// dequeued or returned to its origin. Each trace point is stored with the time of the
+/// previous trace point of the same packet, so the record describes how long the packet
+/// spent in the unit or queue it just left. Records go to per thread ring buffers that
+/// always keep the most recent records, and can be exported in the Chrome trace event
+/// format (JSON), which is also read by Perfetto.
+///
+/// Tracing is compiled in with CONFIG_STREAMING_TRACE and switched on and off at
+/// runtime with StreamingTrace::Enable() and StreamingTrace::Disable(). While it is
+/// switched off a trace point costs one flag test.
+///
+
+#include "VDR/Source/Streaming/IStreaming.h"
+#include "STF/Interface/STFSemaphore.h"
+#include "STF/Interface/STFMutex.h"
+
+#include <stdio.h>
+
+#ifndef CONFIG_STREAMING_TRACE
+#define CONFIG_STREAMING_TRACE	1
+#endif
+
+/// Number of threads that get a ring of their own, all other threads share one ring
+#define STREAMING_TRACE_MAX_THREADS		16
+/// Records per ring, must be a power of two
+#define STREAMING_TRACE_RING_SIZE		1024
+
+enum StreamingTraceEvent
+	{
+	STRMTRC_SEND_PACKET,				///< Packet sent by an output connector, span: time in the sending unit
+	STRMTRC_RECEIVE_PACKET,			///< Packet accepted by an unqueued input connector, span: hand over
+	STRMTRC_DEQUEUE_PACKET,			///< Packet taken from an input connector queue, span: time since it was sent
+	STRMTRC_RETURN_TO_ORIGIN,		///< Packet returned to its pool, span: time in the last unit
+	STRMTRC_PACKET_BOUNCED,			///< Input connector refused the packet, no span
+	STRMTRC_ENQUEUE_PACKET			///< Packet accepted by an input connector queue, no span
+	};
+
+struct StreamingTraceRecord
+	{
+	STFHiPrec64BitTime		time;
+	STFHiPrec64BitTime		since;			///< Previous trace point of the packet, valid if hasSince is set
+	StreamingDataPacket	*	packet;
+	IBaseStreamingUnit	*	unit;
+	uint16						connectorID;
+	uint8							event;
+	uint8							hasSince;
+	};
+
+class StreamingTrace
+	{
+	protected:
+		struct Ring
+			{
+			STFInterlockedPointer	owner;		// Thread writing the ring, NULL while unassigned
+			STFInterlockedInt			busy;			// Only used for the shared ring
+			STFInterlockedInt			writePos;	// Total number of records written
+			StreamingTraceRecord		records[STREAMING_TRACE_RING_SIZE];
+			};
+
+		static STFInterlockedInt	enabled;
+		static STFInterlockedInt	dropped;
+		static uint32					session;
+		static STFHiPrec64BitTime	sessionStart;
+		static Ring					*	rings;		// STREAMING_TRACE_MAX_THREADS own rings and the shared ring
+		static STFMutex				controlLock;
+
+		static Ring * LockThreadRing(void);
+		static void UnlockThreadRing(Ring * ring);
+	public:
+		static bool IsEnabled(void)
+			{
+			return (int32)enabled != 0;
+			}
+
+		/// Start a new trace session, packets in flight start with an instant trace point
+		static STFResult Enable(void);
+		static STFResult Disable(void);
+
+		/// Record a trace point of a packet owned by the caller
+		/// STRMTRC_ENQUEUE_PACKET is recorded after the queue took the packet, when the receiving unit
+		/// may already trace it, so it does not read or change the trace point of the packet.
+		static void Record(StreamingTraceEvent event, StreamingDataPacket * packet, IBaseStreamingUnit * unit, uint32 connectorID);
+
+		/// Number of records lost because the shared ring was busy
+		static uint32 GetDroppedRecords(void)
+			{
+			return (uint32)(int32)dropped;
+			}
+
+		/// Write the records of the current session as Chrome trace JSON. Each packet gets a track of its own.
+		/// Records written during the export may be torn, so tracing should be disabled first.
+		static STFResult Export(FILE * file);
+	};
+
+#if CONFIG_STREAMING_TRACE
+#define STREAMING_TRACE(event, packet, unit, connectorID) \
+	do { if (StreamingTrace::IsEnabled()) StreamingTrace::Record(event, packet, unit, connectorID); } while (0)
+#else
+#define STREAMING_TRACE(event, packet, unit, connectorID)	do {} while (0)
+#endif
+
+#endif
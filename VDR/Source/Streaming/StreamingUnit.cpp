@@ -19,12 +19,17 @@
 #include "VDR/Source/Construction/IUnitConstruction.h"
 #include "STF/Interface/STFDebug.h"
 
+#include <string.h>
+
 #if 0
 #define DPCMDS DPR
 #else
 #define DPCMDS while(0) DebugPrintEmpty
 #endif
 
+/// Maximum number of packets handed to the output connector in one SendPackets() call
+#define PROXY_DELIVERY_BATCH_SIZE	16
+
 ///////////////////////////////////////////////////////////////////////////////
 //"StreamingPoolAllocator" Unit Implementation
 ///////////////////////////////////////////////////////////////////////////////
@@ -76,9 +81,18 @@ STFResult StreamingPoolAllocator::SetAllocator(IVDRMemoryPoolAllocator * allocat
 
 STFResult StreamingPoolAllocator::GetMemoryBlocks (VDRMemoryBlock ** blocks, uint32 number, uint32 &done)
 	{
+	STFResult					res;
+	IStreamingConnector	*	connector;
+
 	//lint --e{613}
 	assert(allocator != NULL);
-	STFRES_RAISE(allocator->GetMemoryBlocks(blocks, 0, number, done, unit));
+	res = allocator->GetMemoryBlocks(blocks, 0, number, done, unit);
+
+	// The unit has to wait for VDRMID_STRM_ALLOCATOR_BLOCKS_AVAILABLE before it gets the missing blocks
+	if ((STFRES_IS_ERROR(res) || done < number) && STFRES_SUCCEEDED(unit->FindConnector(connectorID, connector)))
+		connector->GetStatistics().allocatorWaits++;
+
+	STFRES_RAISE(res);
 	}
 
 STFResult StreamingPoolAllocator::ReceiveMessage(STFMessage & message)
@@ -297,6 +311,65 @@ STFResult StreamingUnit::IsPushingChain(uint32 connectorID)
 	return STFRES_FALSE;
 	}
 
+STFResult StreamingUnit::GetUnitStatistics(VDRStreamingUnitStatistics & statistics)
+	{
+	VDRStreamingConnectorStatistics	connectorStatistics;
+	uint32									i;
+
+	memset(&statistics, 0, sizeof(statistics));
+	statistics.numConnectors = numConnectors;
+
+	for (i = 0; i < numConnectors; i++)
+		{
+		STFRES_REASSERT(GetConnectorStatistics(i, connectorStatistics));
+
+		if (connectorStatistics.input)
+			{
+			statistics.packetsIn += connectorStatistics.packets;
+			statistics.bytesIn += connectorStatistics.bytes;
+			}
+		else
+			{
+			statistics.packetsOut += connectorStatistics.packets;
+			statistics.bytesOut += connectorStatistics.bytes;
+			}
+
+		statistics.bounces += connectorStatistics.bounces;
+		if (connectorStatistics.maxQueueDepth > statistics.maxQueueDepth)
+			statistics.maxQueueDepth = connectorStatistics.maxQueueDepth;
+		statistics.emptyStoreMisses += connectorStatistics.emptyStoreMisses;
+		statistics.allocatorWaits += connectorStatistics.allocatorWaits;
+		statistics.processedPackets += connectorStatistics.processedPackets;
+		statistics.processingTime += connectorStatistics.processingTime;
+		if (connectorStatistics.maxProcessingTime > statistics.maxProcessingTime)
+			statistics.maxProcessingTime = connectorStatistics.maxProcessingTime;
+		}
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult StreamingUnit::GetConnectorStatistics(uint32 index, VDRStreamingConnectorStatistics & statistics)
+	{
+	if (index >= numConnectors)
+		STFRES_RAISE(STFRES_RANGE_VIOLATION);
+
+	statistics = connectors[index]->GetStatistics();
+	statistics.connectorID = connectors[index]->GetID();
+	statistics.input = (connectors[index]->GetType() & VDR_STRCTF_INPUT) != 0;
+
+	STFRES_RAISE_OK;
+	}
+
+STFResult StreamingUnit::ResetStatistics(void)
+	{
+	uint32	i;
+
+	for (i = 0; i < numConnectors; i++)
+		memset(&connectors[i]->GetStatistics(), 0, sizeof(VDRStreamingConnectorStatistics));
+
+	STFRES_RAISE_OK;
+	}
+
 #if _DEBUG
 
 STFResult StreamingUnit::PrintDebugInfo (uint32 id)
@@ -317,6 +390,7 @@ STFResult VirtualStreamingUnit::QueryInterface(VDRIID iid, void *& ifp)
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnit);
 
 	STFRES_RAISE_OK;
@@ -343,6 +417,7 @@ STFResult VirtualStreamingUnitCollection::QueryInterface(VDRIID iid, void *& ifp
 	{
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT, IStreamingUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS, IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnitCollection);
 
 	STFRES_RAISE_OK;
@@ -624,6 +699,7 @@ STFResult VirtualStreamingChainUnit::QueryInterface(VDRIID iid, void *& ifp)
 	VDRQI_BEGIN
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_UNIT,			IStreamingUnit);
 		VDRQI_IMPLEMENT(VDRIID_STREAMING_CHAIN_UNIT,	IStreamingChainUnit);
+		VDRQI_IMPLEMENT(VDRIID_VDR_STREAMING_STATISTICS,	IVDRStreamingStatistics);
 	VDRQI_END(VirtualUnitCollection);
 
 	STFRES_RAISE_OK;
@@ -1248,7 +1324,11 @@ STFResult VirtualSingleStreamingProxyUnit::DeliverDataPackets(uint32 connectorID
 																				  uint32 numPackets, uint32 & acceptedPackets)
 	{
 	STFResult err = STFRES_OK;
-	StreamingDataPacket * tempPacket;
+	STFResult sendErr;
+	StreamingDataPacket * tempPackets[PROXY_DELIVERY_BATCH_SIZE];
+	VDRStreamingDataPacket * vdrPacket;
+	uint32 num, sent, i;
+	int r;
 	//lint --e{613}
 	acceptedPackets = 0;
 
@@ -1266,33 +1346,51 @@ STFResult VirtualSingleStreamingProxyUnit::DeliverDataPackets(uint32 connectorID
 */
 		while (acceptedPackets < numPackets && !STFRES_IS_ERROR(err))
 			{
-			err = outputConnectors[connectorID]->GetEmptyDataPacket(tempPacket);
-			if (!STFRES_IS_ERROR(err))
+			//
+			// Fill a batch of streaming packets, and send it with a single call, so that
+			// the state check and the wakeup of the receiving unit are done once per batch
+			//
+			num = 0;
+			while (num < PROXY_DELIVERY_BATCH_SIZE && acceptedPackets + num < numPackets)
 				{
+				err = outputConnectors[connectorID]->GetEmptyDataPacket(tempPackets[num]);
+				if (STFRES_IS_ERROR(err))
+					break;
+
 				// Make copy of the VDRStreamingDataPacket into the StreamingDataPacket
-				tempPacket->CopyFromVDRPacket(&packets[acceptedPackets]);
+				tempPackets[num]->CopyFromVDRPacket(&packets[acceptedPackets + num]);
 
 				// Transfer ownership of ranges to copied range:
-				tempPacket->AddRefToRanges();
+				tempPackets[num]->AddRefToRanges();
 
-				// Send packet to output pin
-				err = outputConnectors[connectorID]->SendPacket(tempPacket);
+				num++;
+				}
+
+			if (num > 0)
+				{
+				// Send packets to output pin
+				sendErr = outputConnectors[connectorID]->SendPackets(tempPackets, num, sent);
 
-				if (!STFRES_IS_ERROR(err))
+				for (i = 0; i < sent; i++)
 					{
 					// Release the VDR Streaming Formatter's reference to the ranges
-					for (int i = 0; i < packets[acceptedPackets].numRanges; i++)
-						packets[acceptedPackets].tagRanges.ranges[packets[acceptedPackets].numTags + i].Release(NULL);	// Only NULL as holder possible 
-
-					acceptedPackets++;
+					vdrPacket = &packets[acceptedPackets + i];
+					for (r = 0; r < vdrPacket->numRanges; r++)
+						vdrPacket->tagRanges.ranges[vdrPacket->numTags + r].Release(NULL);	// Only NULL as holder possible 
 					}
-				else
+
+				for (i = sent; i < num; i++)
 					{
 					// Release ownership of ranges
-					tempPacket->ReleaseRanges();
+					tempPackets[i]->ReleaseRanges();
 					// Packet must be returned again as the connector refused to accept it
-					tempPacket->ReturnToOrigin();
+					tempPackets[i]->ReturnToOrigin();
 					}
+
+				acceptedPackets += sent;
+
+				if (STFRES_IS_ERROR(sendErr))
+					err = sendErr;
 				}
 			}
 
@@ -62,7 +62,8 @@ class StreamingPoolAllocator : public DirectSTFMessageSink
 
 
 //! Base Streaming Unit
-class StreamingUnit : virtual public IStreamingUnit
+class StreamingUnit : virtual public IStreamingUnit,
+							 virtual public IVDRStreamingStatistics
 	{
 	protected:
 		IStreamingChainUnit	*	parentStreamingUnit;	// Streaming Chain this unit is part of
@@ -120,6 +121,13 @@ class StreamingUnit : virtual public IStreamingUnit
 		virtual STFResult ReceiveAllocator(uint32 connectorID, IVDRMemoryPoolAllocator * allocator);
 		virtual STFResult IsPushingChain(uint32 connectorID);
 
+		//
+		// IVDRStreamingStatistics functions
+		//
+		virtual STFResult GetUnitStatistics(VDRStreamingUnitStatistics & statistics);
+		virtual STFResult GetConnectorStatistics(uint32 index, VDRStreamingConnectorStatistics & statistics);
+		virtual STFResult ResetStatistics(void);
+
 #if _DEBUG
 		//
 		// IStreamingUnitDebugging functions
@@ -10,6 +10,12 @@ class IMessageDispatcherUnit : public virtual IVDRBase
 	{
 	public:
 		virtual STFResult GetDispatcher(STFMessageDispatcher * & dispatcher) = 0;
+
+		/// Returns the queueing latency histogram of a message level (STFMSG_LEVEL_...)
+		virtual STFResult GetLatencyHistogram(uint32 level, STFMessageLatencyHistogram & histogram) = 0;
+
+		/// Returns the current and the highest queue depth and the number of rejected messages of a message level
+		virtual STFResult GetQueueStatistics(uint32 level, uint32 & depth, uint32 & maxDepth, uint32 & rejected) = 0;
 	};
 
 #endif
@@ -16,6 +16,7 @@
 
 #include "MessageDispatcherUnit.h"
 #include "VDR/Source/Construction/IUnitConstruction.h"
+#include "VDR/Interface/Streaming/IVDRStreaming.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // Unit creation function implementation
@@ -87,6 +88,34 @@ void VirtualMessageDispatcherUnit::Trigger(void)
 	}
 
 
+uint32 VirtualMessageDispatcherUnit::GetMessageLevel(const STFMessage & message)
+	{
+	switch (message.message)
+		{
+		case VDRMID_STRM_COMMAND_COMPLETED:
+		case VDRMID_STRM_STARVING:
+		case VDRMID_STRM_START_POSSIBLE:
+		case VDRMID_STRM_START_REQUIRED:
+		case VDRMID_STRM_DATA_DISCONTINUITY_PROCESSED:
+			return STFMSG_LEVEL_CONTROL;
+
+		case VDRMID_STRM_PACKET_REQUEST:
+		case VDRMID_STRM_PACKET_ARRIVAL:
+		case VDRMID_STRM_PACKET_ARRIVAL_VOBU:
+		case VDRMID_STRM_SEGMENT_START:
+		case VDRMID_STRM_SEGMENT_START_TIME:
+		case VDRMID_STRM_SEGMENT_END:
+		case VDRMID_STRM_GROUP_START:
+		case VDRMID_STRM_GROUP_END:
+		case VDRMID_STRM_ALLOCATOR_BLOCKS_AVAILABLE:
+			return STFMSG_LEVEL_DATA;
+
+		default:
+			return TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher::GetMessageLevel(message);
+		}
+	}
+
+
 STFResult VirtualMessageDispatcherUnit::PreemptUnit(uint32 flags)
 	{
 	if (flags & VDRUALF_PREEMPT_START_NEW)
@@ -118,7 +147,7 @@ STFResult VirtualMessageDispatcherUnit::InternalUpdate(void)
 
 VirtualMessageDispatcherUnit::VirtualMessageDispatcherUnit(PhysicalMessageDispatcherUnit * physical_)
 	: VirtualUnit(physical_), 
-	  TriggeredQueuedSTFMessageProcessingDispatcher(16), 
+	  TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher(16), 
 	  physical(physical_)
 	{
 	attached = false;
@@ -133,6 +162,18 @@ STFResult VirtualMessageDispatcherUnit::GetDispatcher(STFMessageDispatcher * & d
 	}
 
 
+STFResult VirtualMessageDispatcherUnit::GetLatencyHistogram(uint32 level, STFMessageLatencyHistogram & histogram)
+	{
+	STFRES_RAISE(TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher::GetLatencyHistogram(level, histogram));
+	}
+
+
+STFResult VirtualMessageDispatcherUnit::GetQueueStatistics(uint32 level, uint32 & depth, uint32 & maxDepth, uint32 & rejected)
+	{
+	STFRES_RAISE(TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher::GetQueueStatistics(level, depth, maxDepth, rejected));
+	}
+
+
 STFResult VirtualMessageDispatcherUnit::QueryInterface(VDRIID iid, void *& ifp)
 	{
 	VDRQI_BEGIN
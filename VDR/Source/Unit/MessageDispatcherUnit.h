@@ -31,17 +31,20 @@ class PhysicalMessageDispatcherUnit : public SharedPhysicalUnit
 
 
 class VirtualMessageDispatcherUnit : 	public virtual IMessageDispatcherUnit,
-													public VirtualUnit, TriggeredQueuedSTFMessageProcessingDispatcher
+													public VirtualUnit, TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher
 	{
 	protected:
 		PhysicalMessageDispatcherUnit *	physical;
 		bool										attached;
 
 		//
-		// From TriggeredQueuedSTFMessageProcessingDispatcher
+		// From TriggeredMultiLevelQueuedSTFMessageProcessingDispatcher
 		//
 		void Trigger(void);
 
+		/// Streaming commands and state changes bypass packet and group notifications
+		uint32 GetMessageLevel(const STFMessage & message);
+
 		//
 		// From VirutalUnit
 		//
@@ -55,6 +58,8 @@ class VirtualMessageDispatcherUnit : 	public virtual IMessageDispatcherUnit,
 		// IMessageDispatcherUnit implementation
 		//
 		virtual STFResult GetDispatcher(STFMessageDispatcher * & dispatcher);
+		virtual STFResult GetLatencyHistogram(uint32 level, STFMessageLatencyHistogram & histogram);
+		virtual STFResult GetQueueStatistics(uint32 level, uint32 & depth, uint32 & maxDepth, uint32 & rejected);
 	
 		// VirtualUnit::QueryInterface override
 		virtual STFResult QueryInterface(VDRIID iid, void *& ifp);